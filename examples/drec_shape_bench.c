@@ -0,0 +1,164 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <libfds.h>
+
+/*
+ * Compare decoding of Data Records into a structure using fds_drec_find() lookups and using
+ * a compiled shape (fds_drec_shape_decode()).
+ *
+ * Usage: drec_shape_bench [records] [rounds]
+ *
+ * The benchmark is built if the project is configured with -DENABLE_BENCHMARKS=ON.
+ */
+
+struct flow {
+    uint64_t ts_first;
+    uint64_t ts_last;
+    uint64_t bytes;
+    uint64_t pkts;
+    uint32_t src_ip;
+    uint32_t dst_ip;
+    uint16_t src_port;
+    uint16_t dst_port;
+    uint8_t proto;
+    uint8_t tcp_flags;
+};
+
+// Information Elements (IANA) and sizes of fields in the Template
+static const uint16_t fields[][2] = {
+    {152, 8}, // flowStartMilliseconds
+    {153, 8}, // flowEndMilliseconds
+    {  8, 4}, // sourceIPv4Address
+    { 12, 4}, // destinationIPv4Address
+    {  7, 2}, // sourceTransportPort
+    { 11, 2}, // destinationTransportPort
+    {  4, 1}, // protocolIdentifier
+    {  6, 1}, // tcpControlBits
+    {  1, 8}, // octetDeltaCount
+    {  2, 4}, // packetDeltaCount (reduced size)
+    { 10, 4}, // ingressInterface (unused by the structure)
+    { 14, 4}  // egressInterface (unused by the structure)
+};
+#define FIELDS_CNT (sizeof(fields) / sizeof(fields[0]))
+
+static const struct fds_shape_member members[] = {
+    {0, 152, 0, FDS_SHAPE_UINT, offsetof(struct flow, ts_first),  8},
+    {0, 153, 0, FDS_SHAPE_UINT, offsetof(struct flow, ts_last),   8},
+    {0,   1, 0, FDS_SHAPE_UINT, offsetof(struct flow, bytes),     8},
+    {0,   2, 0, FDS_SHAPE_UINT, offsetof(struct flow, pkts),      8},
+    {0,   8, 0, FDS_SHAPE_UINT, offsetof(struct flow, src_ip),    4},
+    {0,  12, 0, FDS_SHAPE_UINT, offsetof(struct flow, dst_ip),    4},
+    {0,   7, 0, FDS_SHAPE_UINT, offsetof(struct flow, src_port),  2},
+    {0,  11, 0, FDS_SHAPE_UINT, offsetof(struct flow, dst_port),  2},
+    {0,   4, 0, FDS_SHAPE_UINT, offsetof(struct flow, proto),     1},
+    {0,   6, 0, FDS_SHAPE_UINT, offsetof(struct flow, tcp_flags), 1}
+};
+#define MEMBERS_CNT (sizeof(members) / sizeof(members[0]))
+
+static double
+time_diff(const struct timespec *start, const struct timespec *end)
+{
+    return (double) (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// Decode a record using lookups of individual fields
+static void
+decode_find(struct fds_drec *rec, struct flow *flow)
+{
+    memset(flow, 0, sizeof(*flow));
+    for (size_t i = 0; i < MEMBERS_CNT; ++i) {
+        struct fds_drec_field field;
+        uint64_t value;
+        if (fds_drec_find(rec, members[i].pen, members[i].id, &field) == FDS_EOC
+                || fds_get_uint_be(field.data, field.size, &value) != FDS_OK) {
+            continue;
+        }
+
+        uint8_t *dst = ((uint8_t *) flow) + members[i].offset;
+        switch (members[i].size) {
+        case 1: *dst = (uint8_t) value; break;
+        case 2: { uint16_t tmp = (uint16_t) value; memcpy(dst, &tmp, 2); } break;
+        case 4: { uint32_t tmp = (uint32_t) value; memcpy(dst, &tmp, 4); } break;
+        default: memcpy(dst, &value, 8); break;
+        }
+    }
+}
+
+int
+main(int argc, char *argv[])
+{
+    size_t rec_cnt = (argc > 1) ? strtoul(argv[1], NULL, 10) : 100000;
+    size_t rounds = (argc > 2) ? strtoul(argv[2], NULL, 10) : 20;
+
+    // Prepare the Template
+    uint16_t tmplt_raw[2 + 2 * FIELDS_CNT];
+    tmplt_raw[0] = htons(256);
+    tmplt_raw[1] = htons(FIELDS_CNT);
+    uint16_t rec_size = 0;
+    for (size_t i = 0; i < FIELDS_CNT; ++i) {
+        tmplt_raw[2 + 2 * i] = htons(fields[i][0]);
+        tmplt_raw[3 + 2 * i] = htons(fields[i][1]);
+        rec_size += fields[i][1];
+    }
+
+    struct fds_template *tmplt;
+    uint16_t tmplt_len = sizeof(tmplt_raw);
+    if (fds_template_parse(FDS_TYPE_TEMPLATE, tmplt_raw, &tmplt_len, &tmplt) != FDS_OK) {
+        fprintf(stderr, "Failed to parse the Template\n");
+        return EXIT_FAILURE;
+    }
+
+    // Prepare records with pseudo-random content
+    uint8_t *data = malloc(rec_cnt * rec_size);
+    struct flow *flows = malloc(rec_cnt * sizeof(*flows));
+    fds_drec_shape_t *shape = NULL;
+    if (!data || !flows
+            || fds_drec_shape_create(&shape, members, MEMBERS_CNT, sizeof(struct flow)) != FDS_OK) {
+        fprintf(stderr, "Memory allocation error\n");
+        return EXIT_FAILURE;
+    }
+
+    uint32_t seed = 1;
+    for (size_t i = 0; i < rec_cnt * rec_size; ++i) {
+        seed = seed * 1103515245U + 12345U;
+        data[i] = (uint8_t) (seed >> 16);
+    }
+
+    struct timespec start, end;
+    uint64_t checksum[2] = {0, 0};
+    double duration[2];
+    for (int method = 0; method < 2; ++method) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (size_t round = 0; round < rounds; ++round) {
+            for (size_t i = 0; i < rec_cnt; ++i) {
+                struct fds_drec rec = {data + i * rec_size, rec_size, tmplt, NULL};
+                if (method == 0) {
+                    decode_find(&rec, &flows[i]);
+                } else {
+                    fds_drec_shape_decode(shape, &rec, &flows[i]);
+                }
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        duration[method] = time_diff(&start, &end);
+
+        for (size_t i = 0; i < rec_cnt; ++i) {
+            checksum[method] += flows[i].bytes + flows[i].pkts + flows[i].src_port + flows[i].proto;
+        }
+    }
+
+    const double total = (double) rec_cnt * rounds;
+    printf("fds_drec_find():         %8.2f ns/record\n", duration[0] * 1e9 / total);
+    printf("fds_drec_shape_decode(): %8.2f ns/record\n", duration[1] * 1e9 / total);
+    printf("Results %s\n", (checksum[0] == checksum[1]) ? "match" : "DO NOT match");
+
+    fds_drec_shape_destroy(shape);
+    fds_template_destroy(tmplt);
+    free(flows);
+    free(data);
+    return (checksum[0] == checksum[1]) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,49 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libfds.h>
+
+/*
+ * Rewrite an existing FDS file into a new, more compact, file.
+ *
+ * Usage: file_compact <src> <dst> [lz4|zstd|none] [level] [threads]
+ */
+int
+main(int argc, char *argv[])
+{
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <src> <dst> [lz4|zstd|none] [level] [threads]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    struct fds_file_compact_opts opts;
+    memset(&opts, 0, sizeof(opts));
+    opts.flags = FDS_FILE_ZSTD;
+
+    if (argc > 3) {
+        if (strcmp(argv[3], "lz4") == 0) {
+            opts.flags = FDS_FILE_LZ4;
+        } else if (strcmp(argv[3], "zstd") == 0) {
+            opts.flags = FDS_FILE_ZSTD;
+        } else if (strcmp(argv[3], "none") == 0) {
+            opts.flags = 0;
+        } else {
+            fprintf(stderr, "Unknown compression algorithm '%s'\n", argv[3]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (argc > 4) {
+        opts.level = atoi(argv[4]);
+    }
+    if (argc > 5) {
+        opts.threads = (unsigned int) atoi(argv[5]);
+    }
+
+    int rc = fds_file_compact(argv[1], argv[2], &opts);
+    if (rc != FDS_OK) {
+        fprintf(stderr, "Failed to compact the file (error code: %d)\n", rc);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,332 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <libfds.h>
+
+/*
+ * Microbenchmark of the Template manager (fds_tmgr_t). Each scenario reports the number of
+ * operations per second and the number of memory allocations per operation.
+ *
+ * Allocations are counted by wrappers of malloc(), calloc() and realloc() that call the
+ * allocator of the GNU C Library, i.e. the counter works only with glibc.
+ *
+ * Usage: tmgr_bench [ops]
+ *
+ * The benchmark is built if the project is configured with -DENABLE_BENCHMARKS=ON.
+ */
+
+/** Number of fields of each template */
+#define FIELDS_CNT 16U
+/** Number of 16-bit words of a raw template */
+#define TMPLT_WORDS (2U + 2U * FIELDS_CNT)
+/** Number of operations between garbage collections */
+#define GC_INTERVAL 1000U
+
+// Counter of memory allocations (the benchmark is single-threaded)
+static size_t alloc_cnt = 0;
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+// The wrappers must replace the allocator of the library even if built with hidden visibility
+#define BENCH_EXPORT __attribute__((visibility("default")))
+
+BENCH_EXPORT void *
+malloc(size_t size)
+{
+    alloc_cnt++;
+    return __libc_malloc(size);
+}
+
+BENCH_EXPORT void *
+calloc(size_t nmemb, size_t size)
+{
+    alloc_cnt++;
+    return __libc_calloc(nmemb, size);
+}
+
+BENCH_EXPORT void *
+realloc(void *ptr, size_t size)
+{
+    alloc_cnt++;
+    return __libc_realloc(ptr, size);
+}
+
+static struct timespec bench_ts;
+static int bench_errors = 0;
+
+static double
+time_diff(const struct timespec *start, const struct timespec *end)
+{
+    return (double) (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// Start measurement of a scenario (preparation of the scenario is not measured)
+static void
+bench_start(void)
+{
+    alloc_cnt = 0;
+    clock_gettime(CLOCK_MONOTONIC, &bench_ts);
+}
+
+// Stop measurement of a scenario and print results
+static void
+bench_stop(const char *name, size_t ops)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    const size_t allocs = alloc_cnt;
+    const double duration = time_diff(&bench_ts, &end);
+    printf("%-26s %10zu ops %14.0f ops/s %9.2f allocs/op\n", name, ops, ops / duration,
+        (double) allocs / ops);
+}
+
+// Check a return code
+static void
+check(int ret_code, int expected, const char *what)
+{
+    if (ret_code != expected) {
+        fprintf(stderr, "%s: unexpected return code %d\n", what, ret_code);
+        bench_errors++;
+    }
+}
+
+// Prepare a raw template (fields differ for each Template ID)
+static uint16_t
+tmplt_raw(uint16_t *raw, uint16_t id)
+{
+    raw[0] = htons(id);
+    raw[1] = htons(FIELDS_CNT);
+    for (uint16_t i = 0; i < FIELDS_CNT; ++i) {
+        raw[2 + 2 * i] = htons(1U + (id + i) % 200U);
+        raw[3 + 2 * i] = htons(4);
+    }
+    return TMPLT_WORDS * sizeof(*raw);
+}
+
+// Parse a raw template and add it to the manager
+static int
+tmplt_add(fds_tmgr_t *tmgr, const uint16_t *raw, uint16_t len)
+{
+    struct fds_template *tmplt;
+    int ret_code = fds_template_parse(FDS_TYPE_TEMPLATE, raw, &len, &tmplt);
+    if (ret_code != FDS_OK) {
+        return ret_code;
+    }
+
+    if ((ret_code = fds_tmgr_template_add(tmgr, tmplt)) != FDS_OK) {
+        fds_template_destroy(tmplt);
+    }
+    return ret_code;
+}
+
+// Destroy garbage of the manager
+static void
+gc_collect(fds_tmgr_t *tmgr)
+{
+    fds_tgarbage_t *gc;
+    check(fds_tmgr_garbage_get(tmgr, &gc), FDS_OK, "fds_tmgr_garbage_get()");
+    fds_tmgr_garbage_destroy(gc);
+}
+
+// UDP exporter periodically resends the same templates
+static void
+bench_refresh(size_t ops, uint16_t tmplt_cnt, int raw_refresh)
+{
+    fds_tmgr_t *tmgr = fds_tmgr_create(FDS_SESSION_UDP);
+    uint16_t (*raw)[TMPLT_WORDS] = malloc(tmplt_cnt * sizeof(*raw));
+    uint16_t len = 0;
+    uint32_t time = 1;
+
+    check(fds_tmgr_set_time(tmgr, time), FDS_OK, "fds_tmgr_set_time()");
+    for (uint16_t i = 0; i < tmplt_cnt; ++i) {
+        len = tmplt_raw(raw[i], 256 + i);
+        check(tmplt_add(tmgr, raw[i], len), FDS_OK, "fds_tmgr_template_add()");
+    }
+
+    bench_start();
+    for (size_t i = 0; i < ops; ++i) {
+        const uint16_t idx = i % tmplt_cnt;
+        if (idx == 0) {
+            // All templates are resent in every message
+            check(fds_tmgr_set_time(tmgr, ++time), FDS_OK, "fds_tmgr_set_time()");
+        }
+
+        if (raw_refresh) {
+            check(fds_tmgr_template_refresh(tmgr, FDS_TYPE_TEMPLATE, raw[idx], len), FDS_OK,
+                "fds_tmgr_template_refresh()");
+        } else {
+            check(tmplt_add(tmgr, raw[idx], len), FDS_OK, "fds_tmgr_template_add()");
+        }
+
+        if (i % GC_INTERVAL == 0) {
+            gc_collect(tmgr);
+        }
+    }
+    bench_stop(raw_refresh ? "refresh storm (raw)" : "refresh storm (parse+add)", ops);
+
+    fds_tmgr_destroy(tmgr);
+    free(raw);
+}
+
+// Definitions and lookups of thousands of Template IDs spread over the whole range
+static void
+bench_many_ids(size_t ops, uint16_t tmplt_cnt)
+{
+    fds_tmgr_t *tmgr = fds_tmgr_create(FDS_SESSION_FILE);
+    const uint16_t id_range = UINT16_MAX - 256;
+    uint16_t raw[TMPLT_WORDS];
+    uint32_t time = 1;
+
+    check(fds_tmgr_set_time(tmgr, time), FDS_OK, "fds_tmgr_set_time()");
+    bench_start();
+    for (size_t i = 0; i < ops; ++i) {
+        if (i % tmplt_cnt == 0) {
+            check(fds_tmgr_set_time(tmgr, ++time), FDS_OK, "fds_tmgr_set_time()");
+            gc_collect(tmgr);
+        }
+
+        // Template IDs are scattered over the whole range of IDs
+        const uint16_t id = 256 + ((i % tmplt_cnt) * 7919U) % id_range;
+        const uint16_t len = tmplt_raw(raw, id + (uint16_t) (time % 2)); // Different fields
+        raw[0] = htons(id);
+        check(tmplt_add(tmgr, raw, len), FDS_OK, "fds_tmgr_template_add()");
+    }
+    bench_stop("add (scattered IDs)", ops);
+
+    // Look up only Template IDs that have been defined
+    const size_t defined = (ops < tmplt_cnt) ? ops : tmplt_cnt;
+    const struct fds_template *tmplt;
+    uint32_t seed = 1;
+    bench_start();
+    for (size_t i = 0; i < ops; ++i) {
+        seed = seed * 1103515245U + 12345U;
+        const uint16_t id = 256 + (((seed >> 8) % defined) * 7919U) % id_range;
+        check(fds_tmgr_template_get(tmgr, id, &tmplt), FDS_OK, "fds_tmgr_template_get()");
+    }
+    bench_stop("lookup (scattered IDs)", ops);
+
+    fds_tmgr_destroy(tmgr);
+}
+
+// Definitions followed by withdrawals
+static void
+bench_withdrawals(size_t ops, uint16_t tmplt_cnt)
+{
+    fds_tmgr_t *tmgr = fds_tmgr_create(FDS_SESSION_SCTP);
+    uint16_t raw[TMPLT_WORDS];
+    uint32_t time = 1;
+
+    bench_start();
+    for (size_t i = 0; i < ops; ++i) {
+        const uint16_t id = 256 + (i % tmplt_cnt);
+        if (id == 256) {
+            check(fds_tmgr_set_time(tmgr, ++time), FDS_OK, "fds_tmgr_set_time()");
+        }
+
+        const uint16_t len = tmplt_raw(raw, id);
+        check(tmplt_add(tmgr, raw, len), FDS_OK, "fds_tmgr_template_add()");
+        check(fds_tmgr_template_withdraw(tmgr, id, FDS_TYPE_TEMPLATE), FDS_OK,
+            "fds_tmgr_template_withdraw()");
+
+        if (i % GC_INTERVAL == 0) {
+            gc_collect(tmgr);
+        }
+    }
+    bench_stop("add + withdraw", ops);
+
+    fds_tmgr_destroy(tmgr);
+}
+
+// Random seeks to the history (e.g. reordered UDP messages or replay of files)
+static void
+bench_seeks(size_t ops, uint16_t history)
+{
+    fds_tmgr_t *tmgr = fds_tmgr_create(FDS_SESSION_UDP);
+    fds_tmgr_set_snapshot_timeout(tmgr, UINT16_MAX);
+    uint16_t raw[TMPLT_WORDS];
+
+    // Each second a new template is defined
+    for (uint16_t i = 0; i < history; ++i) {
+        check(fds_tmgr_set_time(tmgr, i), FDS_OK, "fds_tmgr_set_time()");
+        const uint16_t len = tmplt_raw(raw, 256 + i);
+        check(tmplt_add(tmgr, raw, len), FDS_OK, "fds_tmgr_template_add()");
+    }
+
+    const struct fds_template *tmplt;
+    uint32_t seed = 1;
+    bench_start();
+    for (size_t i = 0; i < ops; ++i) {
+        seed = seed * 1103515245U + 12345U;
+        const uint32_t time = (seed >> 8) % history;
+        check(fds_tmgr_set_time(tmgr, time), FDS_OK, "fds_tmgr_set_time()");
+        check(fds_tmgr_template_get(tmgr, 256 + time / 2, &tmplt), FDS_OK,
+            "fds_tmgr_template_get()");
+    }
+    bench_stop("backward seek + lookup", ops);
+
+    fds_tmgr_destroy(tmgr);
+}
+
+// Modification of a large snapshot that is referenced by the user (copy-on-write)
+static void
+bench_clones(size_t ops, uint16_t tmplt_cnt)
+{
+    fds_tmgr_t *tmgr = fds_tmgr_create(FDS_SESSION_UDP);
+    fds_tmgr_set_snapshot_timeout(tmgr, 0);
+    uint16_t (*raw)[TMPLT_WORDS] = malloc(tmplt_cnt * sizeof(*raw));
+    uint16_t len = 0;
+    uint32_t time = 1;
+
+    check(fds_tmgr_set_time(tmgr, time), FDS_OK, "fds_tmgr_set_time()");
+    for (uint16_t i = 0; i < tmplt_cnt; ++i) {
+        len = tmplt_raw(raw[i], 256 + i * 64U); // Spread over L2 tables
+        check(tmplt_add(tmgr, raw[i], len), FDS_OK, "fds_tmgr_template_add()");
+    }
+
+    const fds_tsnapshot_t *snap;
+    bench_start();
+    for (size_t i = 0; i < ops; ++i) {
+        // Freeze the snapshot and modify it in the next second
+        check(fds_tmgr_snapshot_get(tmgr, &snap), FDS_OK, "fds_tmgr_snapshot_get()");
+        check(fds_tmgr_set_time(tmgr, ++time), FDS_OK, "fds_tmgr_set_time()");
+        check(fds_tmgr_template_refresh(tmgr, FDS_TYPE_TEMPLATE, raw[i % tmplt_cnt], len), FDS_OK,
+            "fds_tmgr_template_refresh()");
+
+        if (i % GC_INTERVAL == 0) {
+            gc_collect(tmgr);
+        }
+    }
+    bench_stop("snapshot clone", ops);
+
+    fds_tmgr_destroy(tmgr);
+    free(raw);
+}
+
+int
+main(int argc, char *argv[])
+{
+    size_t ops = (argc > 1) ? strtoul(argv[1], NULL, 10) : 200000;
+    if (ops == 0) {
+        fprintf(stderr, "Usage: %s [ops]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    bench_refresh(ops, 100, 1);
+    bench_refresh(ops, 100, 0);
+    bench_many_ids(ops, 4096);
+    bench_withdrawals(ops, 1000);
+    bench_seeks(ops, 1000);
+    bench_clones(ops, 1000);
+
+    if (bench_errors != 0) {
+        fprintf(stderr, "%d operation(s) failed\n", bench_errors);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -46,6 +46,7 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
 #include <stdint.h>
 #include "template.h"
 #include "template_mgr.h"
@@ -109,6 +110,400 @@ struct fds_drec_field {
 FDS_API int
 fds_drec_find(struct fds_drec *rec, uint32_t pen, uint16_t id, struct fds_drec_field *field);
 
+/** Maximum number of fields in a table of per-record offsets (see fds_drec_offsets)       */
+#define FDS_DREC_OFFSETS_MAX 256
+
+/**
+ * \brief Table of per-record field offsets
+ *
+ * If multiple fields are accessed in a Data Record based on a Template with variable-length
+ * fields, each lookup has to decode length prefixes of all preceding fields. The table holds
+ * positions and real lengths of all fields decoded in a single pass by fds_drec_index(), so
+ * the following lookups and iterations can access any field in constant time.
+ *
+ * \note If the Template has more than #FDS_DREC_OFFSETS_MAX fields, only the first fields are
+ *   part of the table and the remaining fields are located by decoding their length prefixes.
+ * \warning The table is valid only for the Data Record for which it has been created.
+ */
+struct fds_drec_offsets {
+    /** Data Record start for which the table has been created                               */
+    const uint8_t *data;
+    /** Template of the Data Record                                                          */
+    const struct fds_template *tmplt;
+    /** Number of fields in the table                                                        */
+    uint16_t cnt;
+    /** Offset of the first field that is not part of the table                              */
+    uint16_t next;
+    /** Fields of the Data Record (the same order as the Template fields)                    */
+    struct fds_drec_offsets_rec {
+        /** Offset of the field data (i.e. behind the length prefix) from the record start   */
+        uint16_t offset;
+        /** Real length of the field                                                         */
+        uint16_t size;
+    } fields[FDS_DREC_OFFSETS_MAX];
+};
+
+/**
+ * \brief Create a table of per-record field offsets
+ *
+ * All field boundaries of the Data Record are decoded in a single pass and stored into the
+ * table. The table can be later passed to fds_drec_find_indexed() or attached to a Data Record
+ * iterator (see fds_drec_iter_offsets()).
+ * \param[in]  rec Pointer to the data record
+ * \param[out] out Table to fill
+ * \return #FDS_OK on success.
+ * \return #FDS_ERR_FORMAT if the fields exceed the size of the record (the table is undefined).
+ */
+FDS_API int
+fds_drec_index(const struct fds_drec *rec, struct fds_drec_offsets *out);
+
+/**
+ * \brief Get a field in a data record using a table of per-record offsets
+ *
+ * The same as fds_drec_find(), however, position of the field is taken from the table.
+ * \param[in]  rec   Pointer to the data record
+ * \param[in]  offs  Table of offsets created for the record by fds_drec_index()
+ * \param[in]  pen   Private Enterprise Number
+ * \param[in]  id    Information Element ID
+ * \param[out] field Pointer to a variable where the result will be stored
+ * \return Index of the field in the record or #FDS_EOC (see fds_drec_find()).
+ */
+FDS_API int
+fds_drec_find_indexed(struct fds_drec *rec, const struct fds_drec_offsets *offs, uint32_t pen,
+    uint16_t id, struct fds_drec_field *field);
+
+/** Number of Templates remembered by a field accessor (see fds_drec_accessor)             */
+#define FDS_DREC_ACCESSOR_CACHE 4
+/** Special field index of a field accessor entry: the field is not present in the Template  */
+#define FDS_DREC_ACCESSOR_MISSING UINT16_MAX
+/** Special offset of a field accessor entry: the field position depends on the Data Record */
+#define FDS_DREC_ACCESSOR_DYNAMIC UINT16_MAX
+
+/** \brief Resolved position of a field in a Template (internal part of a field accessor)  */
+struct fds_drec_accessor_entry {
+    uint64_t uid;                           /**< Template identifier (0 = unused entry)  */
+    uint16_t idx;                           /**< Field index (or missing)                */
+    uint16_t offset;                        /**< Fixed offset of the field (or dynamic)  */
+    uint16_t size;                          /**< Fixed length of the field               */
+    uint16_t rev;                           /**< Field info is in the reverse fields     */
+};
+
+/**
+ * \brief Field accessor
+ *
+ * The accessor represents a field (an Information Element in the selected Biflow direction)
+ * that is repeatedly read from Data Records, for example, in a per-record loop of a plugin.
+ * Position of the field is resolved only once per Template and remembered for up to
+ * #FDS_DREC_ACCESSOR_CACHE most recently seen Templates. Therefore, if the field has a fixed
+ * position in the Data Record (i.e. it is not placed behind a variable-length field), lookup
+ * in a Data Record of an already seen Template is only a comparison and a pointer addition.
+ *
+ * Templates are identified by their unique identifier (fds_template_index#uid), so the accessor
+ * remains valid even if Templates are replaced or freed.
+ *
+ * \code{.c}
+ *  struct fds_drec_accessor acc;
+ *  fds_drec_accessor_init(&acc, 0, 1, 0); // octetDeltaCount
+ *
+ *  // For each Data Record...
+ *  struct fds_drec_field field;
+ *  uint64_t bytes;
+ *  if (fds_drec_accessor_get(&acc, rec, &field) != FDS_EOC
+ *          && fds_get_uint_be(field.data, field.size, &bytes) == FDS_OK) {
+ *      // Add your code here...
+ *  }
+ * \endcode
+ */
+struct fds_drec_accessor {
+    /** FOR INTERNAL USE ONLY. DO NOT USE DIRECTLY!                                      */
+    struct {
+        uint32_t pen;                       /**< Private Enterprise Number               */
+        uint16_t id;                        /**< Information Element ID                  */
+        uint16_t flags;                     /**< Biflow direction flag (or 0)            */
+        uint16_t replace;                   /**< Cache entry to replace on the next miss */
+        /** Resolved positions of the field in recently seen Templates                   */
+        struct fds_drec_accessor_entry cache[FDS_DREC_ACCESSOR_CACHE];
+    } _private; /**< Internal field (implementation can be changed!)                     */
+};
+
+/**
+ * \brief Initialize a field accessor
+ *
+ * \note If one of Biflow direction flags (i.e. ::FDS_DREC_BIFLOW_FWD or ::FDS_DREC_BIFLOW_REV) is
+ *   set, the field is searched from the point of view of the selected direction in Biflow
+ *   Data Records (see fds_drec_iter_find()). Other flags are ignored.
+ * \param[out] acc   Accessor to initialize
+ * \param[in]  pen   Private Enterprise Number
+ * \param[in]  id    Information Element ID
+ * \param[in]  flags Biflow direction flag (see #fds_drec_iter_flags) or 0
+ */
+FDS_API void
+fds_drec_accessor_init(struct fds_drec_accessor *acc, uint32_t pen, uint16_t id, uint16_t flags);
+
+/**
+ * \brief Get a field in a data record using a field accessor (slow path)
+ *
+ * The field is resolved and the result is remembered in the accessor. Usually, the function
+ * should not be called directly, use fds_drec_accessor_get() instead.
+ * \param[in,out] acc   Field accessor
+ * \param[in]     rec   Pointer to the data record
+ * \param[in]     offs  Table of offsets created for the record by fds_drec_index() (can be NULL)
+ * \param[out]    field Pointer to a variable where the result will be stored
+ * \return Index of the field in the record or #FDS_EOC (see fds_drec_find()).
+ */
+FDS_API int
+fds_drec_accessor_find(struct fds_drec_accessor *acc, struct fds_drec *rec,
+    const struct fds_drec_offsets *offs, struct fds_drec_field *field);
+
+/**
+ * \brief Get a field in a data record using a field accessor
+ *
+ * The same as fds_drec_find() (or fds_drec_iter_find() with a Biflow direction flag), however,
+ * the position of the field is resolved only once per Template.
+ * \param[in,out] acc   Field accessor
+ * \param[in]     rec   Pointer to the data record
+ * \param[out]    field Pointer to a variable where the result will be stored
+ * \return If the field is present in the record, this function will fill \p field and return
+ *   an index of the field in the record (the index starts from 0). Otherwise (the field is not
+ *   present in the record) returns #FDS_EOC and the \p field is not filled.
+ */
+static inline int
+fds_drec_accessor_get(struct fds_drec_accessor *acc, struct fds_drec *rec,
+    struct fds_drec_field *field)
+{
+    const struct fds_template *tmplt = rec->tmplt;
+    const uint64_t uid = tmplt->index.uid;
+
+    for (unsigned int i = 0; i < FDS_DREC_ACCESSOR_CACHE; ++i) {
+        const struct fds_drec_accessor_entry *entry = &acc->_private.cache[i];
+        if (entry->uid != uid) {
+            continue;
+        }
+
+        if (entry->idx == FDS_DREC_ACCESSOR_MISSING) {
+            return FDS_EOC;
+        }
+
+        if (entry->offset == FDS_DREC_ACCESSOR_DYNAMIC) {
+            // Unused entry or a field behind a variable-length field
+            break;
+        }
+
+        field->data = rec->data + entry->offset;
+        field->size = entry->size;
+        field->info = (entry->rev ? tmplt->fields_rev : tmplt->fields) + entry->idx;
+        return entry->idx;
+    }
+
+    return fds_drec_accessor_find(acc, rec, NULL, field);
+}
+
+/** \brief Type of a column filled by fds_drec_extract_batch()                             */
+enum fds_extract_type {
+    /** Presence of the field (uint8_t, 1 if present, 0 otherwise)                           */
+    FDS_EXTRACT_PRESENT,
+    /** Unsigned integer (uint64_t)                                                          */
+    FDS_EXTRACT_UINT,
+    /** Signed integer (int64_t)                                                             */
+    FDS_EXTRACT_INT,
+    /** Floating point number (double)                                                       */
+    FDS_EXTRACT_DOUBLE,
+    /** Timestamp (uint64_t, milliseconds since the UNIX epoch)                              */
+    FDS_EXTRACT_TIME_MS,
+    /** IP address (16 bytes, IPv4 addresses are stored as IPv4-mapped IPv6 addresses)       */
+    FDS_EXTRACT_IP,
+    /** MAC address (6 bytes)                                                                */
+    FDS_EXTRACT_MAC
+};
+
+/** \brief Field to extract by fds_drec_extract_batch()                                     */
+struct fds_extract_field {
+    /** Private Enterprise Number                                                            */
+    uint32_t pen;
+    /** Information Element ID                                                               */
+    uint16_t id;
+    /** Biflow direction flag (see fds_drec_accessor_init()) or 0                            */
+    uint16_t flags;
+    /** Type of the column                                                                   */
+    enum fds_extract_type type;
+};
+
+/** \brief Specification of fields to extract by fds_drec_extract_batch()                   */
+struct fds_extract_spec {
+    /** Array of fields (one column per field)                                               */
+    const struct fds_extract_field *fields;
+    /** Number of fields in the array                                                        */
+    size_t fields_cnt;
+};
+
+/**
+ * \brief Extract fields of multiple data records into columns
+ *
+ * For each field of the specification, the \p columns array contains a pointer to a column
+ * (i.e. an array of \p n values of the type given by #fds_extract_type) that is filled with
+ * values of the field in host byte order. The i-th value of each column belongs to the i-th
+ * record. If the field is not present in a record or its value cannot be converted (for example,
+ * due to an unexpected size), the value is set to zero. Use an extra column of the type
+ * ::FDS_EXTRACT_PRESENT to distinguish missing fields.
+ *
+ * Consecutive records based on the same Template are processed together, so the field is
+ * resolved only once per group and values of fields with fixed position in the records are
+ * converted in tight loops without per-record lookups.
+ * \param[in]  recs    Array of data records
+ * \param[in]  n       Number of data records
+ * \param[in]  spec    Specification of fields to extract
+ * \param[out] columns Array of \p spec->fields_cnt columns (each of them of \p n values)
+ * \return #FDS_OK on success.
+ * \return #FDS_ERR_ARG if the specification contains an unknown column type.
+ * \return #FDS_ERR_NOMEM if a memory allocation error has occurred.
+ */
+FDS_API int
+fds_drec_extract_batch(const struct fds_drec *recs, size_t n, const struct fds_extract_spec *spec,
+    void **columns);
+
+/** \brief Conversion of a field into a member of a user-defined structure                  */
+enum fds_shape_conv {
+    /** Unsigned integer (member of 1, 2, 4 or 8 bytes, too big values are saturated)         */
+    FDS_SHAPE_UINT,
+    /** Signed integer (member of 1, 2, 4 or 8 bytes, too big values are saturated)           */
+    FDS_SHAPE_INT,
+    /** Floating point number (float or double member)                                       */
+    FDS_SHAPE_FLOAT,
+    /** Raw bytes in network byte order (e.g. addresses, longer fields are truncated)         */
+    FDS_SHAPE_BYTES
+};
+
+/** \brief Member of a user-defined structure filled by fds_drec_shape_decode()              */
+struct fds_shape_member {
+    /** Private Enterprise Number                                                            */
+    uint32_t pen;
+    /** Information Element ID                                                               */
+    uint16_t id;
+    /** Biflow direction flag (see fds_drec_accessor_init()) or 0                            */
+    uint16_t flags;
+    /** Conversion of the field                                                              */
+    enum fds_shape_conv conv;
+    /** Offset of the member in the structure (i.e. offsetof())                              */
+    size_t offset;
+    /** Size of the member (i.e. sizeof())                                                   */
+    size_t size;
+};
+
+/**
+ * \brief Decoder of Data Records into a user-defined structure
+ *
+ * For each Template, the decoder compiles a "shape" that maps members of the structure to
+ * positions of fields in records and conversions to use. Records based on Templates without
+ * variable-length fields are then decoded by a straight-line loop without any lookups.
+ */
+typedef struct fds_drec_shape fds_drec_shape_t;
+
+/**
+ * \brief Create a decoder of Data Records into a user-defined structure
+ *
+ * \code{.c}
+ *  struct flow {
+ *      uint64_t bytes;
+ *      uint16_t src_port;
+ *      uint8_t src_ip[4];
+ *  };
+ *
+ *  const struct fds_shape_member members[] = {
+ *      {0, 1, 0, FDS_SHAPE_UINT,  offsetof(struct flow, bytes),    sizeof(uint64_t)},
+ *      {0, 7, 0, FDS_SHAPE_UINT,  offsetof(struct flow, src_port), sizeof(uint16_t)},
+ *      {0, 8, 0, FDS_SHAPE_BYTES, offsetof(struct flow, src_ip),   4}
+ *  };
+ *  fds_drec_shape_t *shape;
+ *  fds_drec_shape_create(&shape, members, 3, sizeof(struct flow));
+ * \endcode
+ * \param[out] shape       Newly created decoder
+ * \param[in]  members     Array of members of the structure
+ * \param[in]  members_cnt Number of members
+ * \param[in]  struct_size Size of the structure
+ * \return #FDS_OK on success.
+ * \return #FDS_ERR_ARG if a member is outside of the structure or its size doesn't match its
+ *   conversion.
+ * \return #FDS_ERR_NOMEM if a memory allocation error has occurred.
+ */
+FDS_API int
+fds_drec_shape_create(fds_drec_shape_t **shape, const struct fds_shape_member *members,
+    size_t members_cnt, size_t struct_size);
+
+/**
+ * \brief Destroy a decoder of Data Records
+ * \param[in] shape Decoder
+ */
+FDS_API void
+fds_drec_shape_destroy(fds_drec_shape_t *shape);
+
+/**
+ * \brief Decode a Data Record into a user-defined structure
+ *
+ * Values of fields are converted into host byte order (except ::FDS_SHAPE_BYTES). Members of
+ * fields that are not present in the record (or cannot be converted) are set to zero.
+ * \param[in]  shape Decoder
+ * \param[in]  rec   Data Record
+ * \param[out] dst   Structure to fill
+ * \return #FDS_OK on success.
+ * \return #FDS_ERR_FORMAT if the record is malformed (the structure is zeroed).
+ */
+FDS_API int
+fds_drec_shape_decode(fds_drec_shape_t *shape, struct fds_drec *rec, void *dst);
+
+/**
+ * \brief Arena of Data Record copies
+ *
+ * The arena allows to preserve Data Records (e.g. returned by fds_file_read_rec()) that would
+ * be otherwise overwritten. Content of the records is stored into large memory blocks instead
+ * of allocating each record separately and copies of Templates are shared by all records based
+ * on the same Template. All copies are released at once by fds_drec_arena_reset().
+ */
+typedef struct fds_drec_arena fds_drec_arena_t;
+
+/**
+ * \brief Create a new arena of Data Record copies
+ * \return Pointer to the arena or NULL (memory allocation error)
+ */
+FDS_API fds_drec_arena_t *
+fds_drec_arena_create();
+
+/**
+ * \brief Destroy an arena of Data Record copies
+ *
+ * All records copied into the arena (and their Templates) are freed.
+ * \param[in] arena Arena
+ */
+FDS_API void
+fds_drec_arena_destroy(fds_drec_arena_t *arena);
+
+/**
+ * \brief Invalidate all records copied into an arena
+ *
+ * The memory of the records is kept and reused for following copies, so the operation takes
+ * constant time. Copies of Templates that are not used by any record after the reset are
+ * released lazily.
+ * \param[in] arena Arena
+ */
+FDS_API void
+fds_drec_arena_reset(fds_drec_arena_t *arena);
+
+/**
+ * \brief Create a deep copy of a Data Record in an arena
+ *
+ * The content of the record is copied into the arena. The Template of the record is copied only
+ * once, i.e. records based on the same Template (see fds_template_index#uid) share the same copy.
+ * Templates with the same identifier but different flow key flags or timestamps (e.g. copies
+ * modified by the template manager) get their own copies.
+ * The reference to a Template snapshot (fds_drec#snap) is not preserved and it is set to NULL.
+ *
+ * The copy is valid until the arena is reset or destroyed.
+ * \param[in] arena Arena
+ * \param[in] rec   Data Record to copy
+ * \return Pointer to the copy of the record or NULL (memory allocation error)
+ */
+FDS_API struct fds_drec *
+fds_drec_copy(fds_drec_arena_t *arena, const struct fds_drec *rec);
+
 /** \brief Iterator over all data fields in a data record                                */
 struct fds_drec_iter {
     /** Current field of an iterator                                                     */
@@ -118,6 +513,10 @@ struct fds_drec_iter {
     struct {
         struct fds_drec *rec;               /**< Pointer to the data record              */
         const struct fds_tfield *fields;    /**< Template fields                         */
+        const struct fds_drec_offsets *offs;/**< Per-record offsets (can be NULL)        */
+        const uint16_t *view;               /**< View of Biflow fields (can be NULL)     */
+        uint16_t view_cnt;                  /**< Number of fields in the view            */
+        uint16_t view_pos;                  /**< Position of the next field in the view  */
         uint16_t next_offset;               /**< Offset of the next field                */
         uint16_t next_idx;                  /**< Index of the next field                 */
         uint16_t flags;                     /**< Iterator flags                          */
@@ -164,6 +563,13 @@ enum fds_drec_iter_flags {
  *   field and for code example, see fds_drec_iter_next().
  * \note The \p flags argument contains a bitwise OR of zero or more of the flags defined in
      #fds_drec_iter_flags enumeration.
+ * \note If ::FDS_DREC_REVERSE_SKIP is set for a Biflow record (and ::FDS_DREC_PADDING_SHOW is
+ *   not), the iterator walks over precomputed views of the template fields of the selected
+ *   direction (see fds_template_index#views). Skipped fields are not visited at all.
+ * \note Offsets of fields precomputed by the template (see fds_tfield#offset and
+ *   fds_template_index#dyn_start) are used automatically, i.e. fds_drec_iter_find() jumps
+ *   directly to the searched field and only length prefixes of variable-length fields in front
+ *   of it are decoded. A table of per-record offsets can override it, see fds_drec_iter_offsets().
  * \param[out] iter   Pointer to the iterator to initialize
  * \param[in]  record Pointer to the data record
  * \param[in]  flags  Iterator flags (see #fds_drec_iter_flags)
@@ -171,6 +577,22 @@ enum fds_drec_iter_flags {
 FDS_API void
 fds_drec_iter_init(struct fds_drec_iter *iter, struct fds_drec *record, uint16_t flags);
 
+/**
+ * \brief Attach a table of per-record offsets to an iterator
+ *
+ * By default, the iterator uses offsets precomputed by the template (see fds_drec_iter_init()).
+ * The table overrides them, i.e. positions of all fields are then taken from the table instead
+ * of decoding length prefixes of variable-length fields. It is useful only if the record has
+ * been already indexed (e.g. for other lookups) and it has variable-length fields.
+ * The table must exist as long as the iterator is used.
+ * \param[in,out] iter Pointer to the iterator
+ * \param[in]     offs Table of offsets created for the record of the iterator by fds_drec_index()
+ * \return #FDS_OK on success.
+ * \return #FDS_ERR_ARG if the table doesn't belong to the record of the iterator.
+ */
+FDS_API int
+fds_drec_iter_offsets(struct fds_drec_iter *iter, const struct fds_drec_offsets *offs);
+
 /**
  * \brief Get the next field in the record
  *
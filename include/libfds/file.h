@@ -146,6 +146,17 @@ enum fds_file_flags
 
     /// Disable asynchronous I/O (i.e. use only synchronous)
     FDS_FILE_NOASYNC = (1U << 5),
+    /**
+     * @brief Bypass the page cache during transfers of Data Blocks
+     *
+     * Intended for large sequential scans where the file content is not going to be read again
+     * soon, so it would only evict other useful data from the page cache. In read mode, Data
+     * Blocks are loaded using direct I/O (O_DIRECT) into aligned buffers. In write and append
+     * mode, written Data Blocks are flushed to the storage and dropped from the page cache.
+     *
+     * If the file system doesn't support direct I/O, the flag is silently ignored.
+     */
+    FDS_FILE_DIRECT = (1U << 6),
 };
 
 /**
@@ -476,7 +487,7 @@ struct fds_file_read_ctx
  *   Returned pointers represent a Data Record and its IPFIX Template stored withing the file
  *   handler instance. Therefore, subsequent calls of this function may overwrite internal buffers
  *   where the Data Records are stored. If a user wants to preserve the Data Record, a deep copy
- *   of the record and its IPFIX Template MUST be made.
+ *   of the record and its IPFIX Template MUST be made (e.g. using fds_drec_copy()).
  *
  * @param[in]  file File handle
  * @param[out] rec  Data Record (pointer to the Data Record, IPFIX Template, etc.)
@@ -490,6 +501,68 @@ struct fds_file_read_ctx
 FDS_API int
 fds_file_read_rec(fds_file_t *file, struct fds_drec *rec, struct fds_file_read_ctx *ctx);
 
+/**
+ * @brief Callback of fds_file_scan() called for each matching Data Record
+ *
+ * The callback is called from multiple worker threads at the same time. Each thread has its own
+ * private accumulator which is initialized to NULL. The callback can allocate and initialize it
+ * on its first call and update it on all subsequent calls of the same thread.
+ *
+ * @param[in]     rec  Data Record (valid only during the callback)
+ * @param[in]     ctx  Data Record context (valid only during the callback)
+ * @param[in,out] acc  Private accumulator of the worker thread
+ * @param[in]     user User data passed to fds_file_scan()
+ * @return #FDS_OK to continue or any other code to stop the scan (the code is returned by
+ *   fds_file_scan())
+ */
+typedef int (*fds_file_scan_map_cb)(struct fds_drec *rec, const struct fds_file_read_ctx *ctx,
+    void **acc, void *user);
+
+/**
+ * @brief Callback of fds_file_scan() called to merge a private accumulator of a worker thread
+ *
+ * The callback is called sequentially from the calling thread for each worker thread after all
+ * workers finished (even if the scan failed), so the accumulator can be merged into the
+ * result and freed.
+ *
+ * @param[in] acc  Private accumulator of the worker thread (can be NULL if it hasn't been created)
+ * @param[in] user User data passed to fds_file_scan()
+ * @return #FDS_OK on success or any other code (the code is returned by fds_file_scan())
+ */
+typedef int (*fds_file_scan_merge_cb)(void *acc, void *user);
+
+/**
+ * @brief Scan all Data Records of the file in parallel and aggregate them
+ *
+ * Data Blocks of the file are distributed among worker threads. Each thread uses its own
+ * Data Block reader, filter and private accumulator, so map callbacks don't need any locking.
+ * When all Data Blocks are processed, the private accumulators are merged by the merge callback.
+ * This is suitable for queries such as top-N or group-by aggregations.
+ *
+ * The Transport Session and ODID filter (see fds_file_read_sfilter()) is applied. Data Records
+ * of each Data Block are processed in the order in which they were stored, however, there is no
+ * guarantee about the order of Data Blocks.
+ *
+ * @note The expression filter requires definitions of Information Elements
+ *   (see fds_file_set_iemgr()).
+ * @note The position of the reader (see fds_file_read_rec()) is not changed.
+ * @param[in] file     File handler
+ * @param[in] filter   Filter expression (see fds_ipfix_filter_create()) or NULL (all records)
+ * @param[in] nthreads Number of worker threads (0 == number of online processors)
+ * @param[in] map_cb   Callback called for each matching Data Record
+ * @param[in] merge_cb Callback called to merge a private accumulator (can be NULL)
+ * @param[in] user     User data passed to the callbacks
+ *
+ * @return #FDS_OK on success
+ * @return #FDS_ERR_ARG if the filter expression is invalid or an IE manager is not set
+ * @return #FDS_ERR_DENIED if the file is not opened in the reader mode
+ * @return #FDS_ERR_INTERNAL if a fatal error has occurred (e.g. malformed file)
+ * @return Any other code returned by a callback (the scan has been stopped)
+ */
+FDS_API int
+fds_file_scan(fds_file_t *file, const char *filter, unsigned int nthreads,
+    fds_file_scan_map_cb map_cb, fds_file_scan_merge_cb merge_cb, void *user);
+
 // Writer only API ---------------------------------------------------------------------------------
 
 /**
@@ -648,6 +721,88 @@ fds_file_write_tmplt_get(fds_file_t *file, uint16_t tid, enum fds_template_type
 FDS_API int
 fds_file_write_rec(fds_file_t *file, uint16_t tid, const uint8_t *rec_data, uint16_t rec_size);
 
+
+/// Default maximum size of idle Data Block buffers kept by the library (in bytes)
+#define FDS_FILE_BUFFERS_IDLE_DEF (8U * 1024U * 1024U)
+
+/// List of flags for fds_file_buffers_cfg()
+enum fds_file_buffers_flags {
+    /// Back newly allocated buffers by huge pages (if not available, transparent huge pages)
+    FDS_FILE_BUFFERS_HUGEPAGES = (1U << 0),
+};
+
+/**
+ * @brief Configure the process-wide pool of Data Block buffers
+ *
+ * All file readers and writers (and all their Data Block readers and writers) borrow their large
+ * (de)compression buffers from a single process-wide pool. A buffer is borrowed only for
+ * the time a Data Block is being loaded (or filled) and processed, and then it's returned to
+ * the pool and reused by other Data Blocks or files. Therefore, reading and writing of many
+ * files doesn't cause repeated allocations and page faults, and an open file without any
+ * Data Block in progress doesn't hold any buffer. Idle buffers are kept in the pool only up to
+ * the given limit, buffers over the limit are immediately freed.
+ *
+ * By default, the limit is #FDS_FILE_BUFFERS_IDLE_DEF and huge pages are not used.
+ * @note The function is thread-safe and can be called anytime. The hugepage flag only applies
+ *   to newly allocated buffers.
+ * @param[in] idle_max Maximum size of idle buffers kept in the pool (in bytes, 0 = no caching)
+ * @param[in] flags    Zero or more flags (see #fds_file_buffers_flags)
+ * @return #FDS_OK on success
+ * @return #FDS_ERR_ARG if the flags are invalid
+ */
+FDS_API int
+fds_file_buffers_cfg(size_t idle_max, uint32_t flags);
+
+/// Default compression level of fds_file_compact() (ZSTD only)
+#define FDS_FILE_COMPACT_LEVEL_DEF (9)
+
+/// Options of fds_file_compact()
+struct fds_file_compact_opts {
+    /**
+     * @brief Compression algorithm and I/O flags of the destination file
+     *
+     * Only #FDS_FILE_LZ4, #FDS_FILE_ZSTD (at most one of them) and #FDS_FILE_NOASYNC are allowed.
+     * If no compression algorithm is selected, the destination file is not compressed.
+     */
+    uint32_t flags;
+    /**
+     * @brief Compression level
+     *
+     * Only applicable to ZSTD compression. Higher levels produce smaller files but the
+     * compression is slower. If the value is 0, #FDS_FILE_COMPACT_LEVEL_DEF is used.
+     */
+    int level;
+    /// Number of worker threads (0 == number of online processors)
+    unsigned int threads;
+};
+
+/**
+ * @brief Rewrite an existing file into a new, more compact, file
+ *
+ * All Data Records of the source file are repacked into Data Blocks that are filled up to their
+ * maximum capacity and compressed using the given algorithm and level. Duplicate Template Blocks
+ * (e.g. the writer re-emits all Templates after each append) are merged. Transport Sessions,
+ * internal Transport Session IDs, statistics and the order of Data Records within each
+ * combination of a Transport Session and ODID are preserved.
+ *
+ * Independent combinations of a Transport Session and ODID are processed by multiple threads
+ * in parallel.
+ *
+ * @note If the destination file already exists, it is truncated. If the function fails,
+ *   the content of the destination file is undefined.
+ * @param[in] src  Path to the source file
+ * @param[in] dst  Path to the destination file (must be different from the source file)
+ * @param[in] opts Compaction options (can be NULL, i.e. ZSTD with the default level)
+ *
+ * @return #FDS_OK on success
+ * @return #FDS_ERR_ARG if the options are invalid or the source and destination are the same file
+ * @return #FDS_ERR_DENIED if the destination file is being written by another process
+ * @return #FDS_ERR_INTERNAL if any of the files cannot be opened, the source file is malformed or
+ *   another fatal error has occurred (e.g. memory allocation error)
+ */
+FDS_API int
+fds_file_compact(const char *src, const char *dst, const struct fds_file_compact_opts *opts);
+
 #ifdef __cplusplus
 }
 #endif
@@ -47,6 +47,7 @@ extern "C" {
 #endif
 
 /** Size of an internal error buffer */
+#include <stddef.h>
 #include <stdint.h>
 #include <libfds/api.h>
 #include "template.h"
@@ -148,6 +149,114 @@ fds_sets_iter_next(struct fds_sets_iter *it);
 FDS_API const char *
 fds_sets_iter_err(const struct fds_sets_iter *it);
 
+/**
+ * @}
+ *
+ * \defgroup fds_msg_index IPFIX Message index
+ * \ingroup fds_parsers
+ * \brief One-pass validation of an IPFIX Message and a summary of its Sets
+ *
+ * The index is built by a single pass over an IPFIX Message. It stores positions of all Sets,
+ * so the Message doesn't have to be parsed again. For example, a collector can process all
+ * (Options) Template Sets first and then pass Data Sets to other threads.
+ *
+ * Similarly to the \ref fds_sets_iter "IPFIX Sets iterator", only headers and lengths of the
+ * Sets are checked. Content of the Sets is NOT checked for consistency.
+ *
+ * @{
+ */
+
+/** Maximum number of Sets stored in the index of an IPFIX Message */
+#define FDS_MSG_INDEX_MAX 64U
+
+/** Flags of the IPFIX Message index and its Sets                                     */
+enum fds_msg_index_flags {
+    /** At least one Template Set (Set ID 2)                                            */
+    FDS_MSG_INDEX_TSET = (1U << 0),
+    /** At least one Options Template Set (Set ID 3)                                    */
+    FDS_MSG_INDEX_OTSET = (1U << 1),
+    /** At least one Data Set (Set ID >= 256)                                           */
+    FDS_MSG_INDEX_DSET = (1U << 2),
+    /**
+     * At least one (Options) Template Set Withdrawal
+     * \note The flag is based on the first record of each (Options) Template Set.
+     */
+    FDS_MSG_INDEX_WDRL = (1U << 3),
+    /**
+     * The Message contains more Sets than #FDS_MSG_INDEX_MAX (only the first Sets are stored,
+     * but the whole Message has been validated)
+     */
+    FDS_MSG_INDEX_TRUNC = (1U << 4)
+};
+
+/** Description of an IPFIX Set in the index                                          */
+struct fds_msg_index_set {
+    /** Offset of the Set from the beginning of the IPFIX Message                       */
+    uint16_t offset;
+    /** Set ID (in host byte order)                                                     */
+    uint16_t id;
+    /** Total length of the Set including its header (in host byte order)               */
+    uint16_t length;
+    /** Flags of the Set (#FDS_MSG_INDEX_TSET, #FDS_MSG_INDEX_WDRL, etc.)               */
+    uint16_t flags;
+};
+
+/** Index of an IPFIX Message                                                         */
+struct fds_msg_index {
+    /** Flags of the Message (bitwise OR of flags of all Sets, see ::fds_msg_index_flags) */
+    uint16_t flags;
+    /** Number of (Options) Template Sets in the Message (including not stored ones)    */
+    uint16_t tsets_cnt;
+    /** Number of Data Sets in the Message (including not stored ones)                  */
+    uint16_t dsets_cnt;
+    /** Number of stored Sets (at most #FDS_MSG_INDEX_MAX)                              */
+    uint16_t sets_cnt;
+    /** Stored Sets in the order of appearance in the Message                           */
+    struct fds_msg_index_set sets[FDS_MSG_INDEX_MAX];
+    /** Error message (statically allocated string)                                     */
+    const char *err_msg;
+};
+
+/**
+ * \brief Validate an IPFIX Message and build its index
+ *
+ * The header of the Message (version and length) and headers of all its Sets are checked.
+ * Sets with a reserved Set ID (i.e. 0, 1, and 4 - 255) are stored in the index, but they are
+ * not counted as (Options) Template Sets nor Data Sets.
+ *
+ * \code{.c}
+ *   struct fds_msg_index idx;
+ *   if (fds_msg_index(msg, msg_len, &idx) != FDS_OK) {
+ *      fprintf(stderr, "Error: %s\n", idx.err_msg);
+ *      return;
+ *   }
+ *
+ *   if (idx.flags & (FDS_MSG_INDEX_TSET | FDS_MSG_INDEX_OTSET)) {
+ *      // Process (Options) Template Sets first...
+ *   }
+ *
+ *   for (uint16_t i = 0; i < idx.sets_cnt; ++i) {
+ *      if (idx.sets[i].id < FDS_IPFIX_SET_MIN_DSET) {
+ *          continue;
+ *      }
+ *
+ *      struct fds_ipfix_set_hdr *set = (struct fds_ipfix_set_hdr *)
+ *          (((uint8_t *) msg) + idx.sets[i].offset);
+ *      // Pass the Data Set to another thread...
+ *   }
+ * \endcode
+ * \param[in]  msg     IPFIX Message
+ * \param[in]  msg_len Size of the buffer with the Message (the Message length in its header
+ *   must not exceed it, however, the buffer can be bigger, e.g. a whole received datagram)
+ * \param[out] idx     Index of the Message
+ * \return #FDS_OK on success (if the number of Sets exceeds #FDS_MSG_INDEX_MAX, the flag
+ *   #FDS_MSG_INDEX_TRUNC is set).
+ * \return #FDS_ERR_FORMAT if the format of the Message is invalid (an appropriate error message
+ *   is set to fds_msg_index#err_msg). Content of the index is undefined.
+ */
+FDS_API int
+fds_msg_index(const struct fds_ipfix_msg_hdr *msg, size_t msg_len, struct fds_msg_index *idx);
+
 /**
  * @}
  *
@@ -238,6 +347,39 @@ fds_dset_iter_init(struct fds_dset_iter *it, struct fds_ipfix_set_hdr *set,
 FDS_API int
 fds_dset_iter_next(struct fds_dset_iter *it);
 
+/**
+ * \brief Get the next batch of Data Records in the Data Set
+ *
+ * The same as fds_dset_iter_next(), however, up to \p max following Records are prepared at once
+ * and their positions and sizes are stored into the given arrays. For Templates without
+ * variable-length fields, positions of Records are calculated without any per-record checks.
+ * After the call, the public part of the iterator points to the last Record of the batch,
+ * so the function can be combined with fds_dset_iter_next().
+ *
+ * \code{.c}
+ *   uint8_t *recs[64];
+ *   uint16_t sizes[64];
+ *   int rc;
+ *   while ((rc = fds_dset_iter_next_batch(&it, recs, sizes, 64)) > 0) {
+ *      for (int i = 0; i < rc; ++i) {
+ *          // Add your code here...
+ *      }
+ *   }
+ * \endcode
+ * \param[in]  it    Pointer to the iterator
+ * \param[out] recs  Array of pointers to the start of Data Records (at least \p max items)
+ * \param[out] sizes Array of sizes of Data Records (at least \p max items)
+ * \param[in]  max   Maximum number of Data Records to prepare (must be greater than zero)
+ * \return Number of prepared Records (always positive).
+ * \return #FDS_EOC if no more Records are available (the end of the Set has been reached).
+ * \return #FDS_ERR_FORMAT if the format of the Data Set is invalid (an appropriate error message
+ *   is set - see fds_dset_iter_err()). If valid Records precede the malformed one, they are
+ *   returned first and the error is reported by the next call.
+ * \return #FDS_ERR_ARG if \p max is zero.
+ */
+FDS_API int
+fds_dset_iter_next_batch(struct fds_dset_iter *it, uint8_t **recs, uint16_t *sizes, size_t max);
+
 /**
  * \brief Get the last error message
  * \note The message is statically allocated string that can be passed to other function even
@@ -248,6 +390,30 @@ fds_dset_iter_next(struct fds_dset_iter *it);
 FDS_API const char *
 fds_dset_iter_err(const struct fds_dset_iter *it);
 
+/**
+ * \brief Split an IPFIX Data Set into Data Records
+ *
+ * All Data Records in the Data Set are located in a single pass and their positions and sizes
+ * are stored into the given arrays. Records are checked the same way as by
+ * fds_dset_iter_next(), however, the per-record overhead of the iterator is avoided.
+ *
+ * \warning
+ *   Make sure that the length of allocated memory of the Set is at least the same as the length
+ *   from the Set header (see fds_dset_iter_init()).
+ * \param[in]     set   Data set header
+ * \param[in]     tmplt Parsed template of Data Records
+ * \param[out]    recs  Array of pointers to the start of Data Records
+ * \param[out]    sizes Array of sizes of Data Records (in bytes)
+ * \param[in,out] cnt   [in] Capacity of the arrays / [out] Number of filled Data Records
+ * \return #FDS_OK if all Data Records have been stored.
+ * \return #FDS_ERR_BUFFER if the capacity of the arrays is not sufficient (the arrays are full).
+ * \return #FDS_ERR_FORMAT if the format of the Data Set is invalid (only Data Records before
+ *   the malformed one are stored).
+ */
+FDS_API int
+fds_dset_split(struct fds_ipfix_set_hdr *set, const struct fds_template *tmplt, uint8_t **recs,
+    uint16_t *sizes, size_t *cnt);
+
 
 /**
  * @}
@@ -226,6 +226,8 @@ enum fds_template_features {
  * This dynamically sized structure wraps a parsed copy of an IPFIX template.
  * \warning Never modify values directly. Otherwise, consistency of the template cannot be
  *   guaranteed!
+ * \note The structure has been extended with the field lookup index (#index) in libfds 0.7.0,
+ *   which is not binary compatible with previous versions (the soname has been changed).
  */
 struct fds_template {
     /** Type of the template                                                                     */
@@ -318,6 +320,60 @@ struct fds_template {
      */
     struct fds_tfield *fields_rev;
 
+    /**
+     * \brief Field lookup index
+     *
+     * Hash table that maps Enterprise Number and Information Element ID of template fields to
+     * the index of their first occurrence in the array of fields. The index is built by
+     * fds_template_parse() and used by fds_template_find() and fds_drec_find() to avoid linear
+     * search. If the table is not defined (i.e. NULL), linear search is used instead.
+     *
+     * \warning Internal structure, do NOT access or modify it directly!
+     */
+    struct fds_template_index {
+        /** Hash table of field indexes increased by one (zero represents an empty slot)         */
+        uint16_t *table;
+        /** Size of the hash table minus one (the size is always a power of two)                 */
+        uint16_t mask;
+        /**
+         * Index of the first variable-length field (or #fields_cnt_total if not present).
+         * All preceding fields and the field itself have known offset (fds_tfield#offset).
+         */
+        uint16_t dyn_start;
+        /** Number of variable-length fields                                                     */
+        uint16_t dyn_cnt;
+        /**
+         * Total length of fixed-length fields before each variable-length field (counted from
+         * the previous variable-length field) and after the last one, i.e. #dyn_cnt + 1 items.
+         * Defined only for Templates with variable-length fields (otherwise NULL).
+         */
+        uint16_t *dyn_runs;
+        /**
+         * Indexes of fields visible from the forward and the reverse point of view of a Biflow
+         * record, i.e. without reverse fields (see ::FDS_TFIELD_REVERSE in the fields and reverse
+         * fields, respectively) and padding fields. The first #view_fwd_cnt items belong to the
+         * forward view and the following #view_rev_cnt items to the reverse view. Defined only
+         * for Biflow templates with known reverse fields (otherwise NULL).
+         */
+        uint16_t *views;
+        /** Number of fields in the forward view                                                 */
+        uint16_t view_fwd_cnt;
+        /** Number of fields in the reverse view                                                 */
+        uint16_t view_rev_cnt;
+        /**
+         * Unique identifier of the template layout (never zero for parsed templates). It is
+         * assigned by fds_template_parse(), preserved by fds_template_copy() and changed by
+         * fds_template_ies_define(). Unlike the address of the template, the identifier is never
+         * reused, so it can be used to cache template-specific information (see fds_drec_accessor).
+         */
+        uint64_t uid;
+        /**
+         * Immutable arrays shared with identical templates (or NULL), see fds_tpool_template().
+         * The arrays of the index and the raw copy of the template can point to this block.
+         */
+        struct fds_template_shared *shared;
+    } index;
+
     /**
      * Array of parsed fields.
      * This element MUST be the last element in this structure.
@@ -491,6 +547,67 @@ fds_template_flowkey_define(struct fds_template *tmplt, uint64_t flowkey);
 FDS_API int
 fds_template_flowkey_cmp(const struct fds_template *tmplt, uint64_t flowkey);
 
+/** Internal template pool declaration */
+typedef struct fds_tpool fds_tpool_t;
+
+/**
+ * \brief Create a new pool of shared templates
+ *
+ * Exporters of the same model usually send byte-identical templates. The pool keeps parsed
+ * templates with definitions of Information Elements and creates new templates that share
+ * immutable parts (the raw copy and lookup indexes) with the templates in the pool. Therefore,
+ * identical templates are parsed only once, even if they are used by many template managers.
+ *
+ * The pool is thread-safe, so it can be shared by template managers in multiple threads.
+ * \return Pointer to the pool or NULL (memory allocation error)
+ */
+FDS_API fds_tpool_t *
+fds_tpool_create();
+
+/**
+ * \brief Destroy a pool of shared templates
+ *
+ * Templates previously created by the pool stay valid.
+ * \param[in] pool Pool (can be NULL)
+ */
+FDS_API void
+fds_tpool_destroy(fds_tpool_t *pool);
+
+/**
+ * \brief Parse an IPFIX template using a pool of shared templates
+ *
+ * The function is equivalent to fds_template_parse() followed by fds_template_ies_define()
+ * (without preserving definitions). If the pool already contains an identical template (based
+ * on the raw template and the \p iemgr), the new template is created from it without parsing
+ * and shares immutable parts with it. Otherwise, the template is parsed and added to the pool.
+ * Templates Withdrawals are never shared.
+ *
+ * The template can be used as any other template (for example, added to a template manager
+ * with the same IE manager without redefinition of its fields) and MUST be destroyed by
+ * fds_template_destroy().
+ * \warning Templates in the pool keep references to definitions of the IE manager. If the IE
+ *   manager is destroyed, the pool MUST be destroyed too (or purged by fds_tpool_purge() when
+ *   no template created by the pool with the IE manager exists).
+ * \param[in]     pool  Pool
+ * \param[in]     type  Type of template (::FDS_TYPE_TEMPLATE or ::FDS_TYPE_TEMPLATE_OPTS)
+ * \param[in]     ptr   Pointer to the header of the template
+ * \param[in,out] len   [in] Maximal length of the raw template /
+ *                      [out] real length of the raw template in  octets
+ * \param[in]     iemgr IE manager (can be NULL)
+ * \param[out]    tmplt Parsed template (automatically allocated)
+ * \return Same as fds_template_parse()
+ */
+FDS_API int
+fds_tpool_template(fds_tpool_t *pool, enum fds_template_type type, const void *ptr,
+    uint16_t *len, const fds_iemgr_t *iemgr, struct fds_template **tmplt);
+
+/**
+ * \brief Remove templates that are not used by any template created by the pool
+ * \param[in] pool Pool
+ */
+FDS_API void
+fds_tpool_purge(fds_tpool_t *pool);
+
 #ifdef __cplusplus
 }
 #endif
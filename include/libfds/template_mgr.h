@@ -47,11 +47,14 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
 #include <stdint.h>
 #include <libfds/api.h>
 #include "template.h"
 #include "iemgr.h"
 
+struct fds_tset_iter;
+
 /**
  * \defgroup fds_template_mgr IPFIX Template manager
  * \ingroup publicAPIs
@@ -88,12 +91,14 @@ extern "C" {
  *       fds_tmgr_snapshot_get(...);
  *       fds_tmgr_template_get(...);
  *       fds_tmgr_template_add(...);
+ *       fds_tmgr_template_refresh(...);
+ *       fds_tmgr_template_add_set(...);
  *       fds_tmgr_template_withdraw(...);
  *       fds_tmgr_template_withdraw_all(...);
  *       fds_tmgr_template_remove(...);
  *
  *     // Cleanup of old snapshots/templates (usually after modification add/withdraw/remove)
- *     fds_tmgr_garbage_get(...);
+ *     fds_tmgr_garbage_get(...);    // or fds_tmgr_publish(...) if readers in other threads
  *   }
  *
  *   // Destruction
@@ -122,6 +127,12 @@ typedef struct fds_tmgr fds_tmgr_t;
 typedef struct fds_tsnapshot fds_tsnapshot_t;
 /** Internal template garbage declaration   */
 typedef struct fds_tgarbage fds_tgarbage_t;
+/** Internal snapshot reader declaration     */
+typedef struct fds_treader fds_treader_t;
+/** Internal registry of template managers declaration */
+typedef struct fds_tmgr_registry fds_tmgr_registry_t;
+/** Internal background reclaimer of garbage declaration */
+typedef struct fds_tmgr_reclaimer fds_tmgr_reclaimer_t;
 
 
 /**
@@ -223,6 +234,20 @@ fds_tmgr_set_udp_timeouts(fds_tmgr_t *tmgr, uint16_t tl_data, uint16_t tl_opts);
 FDS_API void
 fds_tmgr_set_snapshot_timeout(fds_tmgr_t *tmgr, uint16_t timeout);
 
+/**
+ * \brief Set maximal number of template snapshots
+ *
+ * In addition to the timeout of snapshots (see fds_tmgr_set_snapshot_timeout()), the history
+ * can be bounded by the number of snapshots. If the limit is exceeded, the oldest snapshots are
+ * removed during the next cleanup and export time for fds_tmgr_set_time() cannot go back before
+ * start of the oldest remaining snapshot (#FDS_ERR_NOTFOUND is returned).
+ * \note To disable the limit, use value 0 (default). The newest snapshot is never removed.
+ * \param[in] tmgr  Template manager
+ * \param[in] limit Maximal number of snapshots
+ */
+FDS_API void
+fds_tmgr_set_snapshot_limit(fds_tmgr_t *tmgr, uint16_t limit);
+
 /**
  * \brief Add a reference to a IE manager and redefine all fields
  *
@@ -264,6 +289,8 @@ fds_tmgr_set_iemgr(fds_tmgr_t *tmgr, const fds_iemgr_t *iemgr);
  * behavior of an exporting process. For example, a TCP connection must be always reliable, thus
  * Export Time must be only increasing (i.e. the same or greater).
  *
+ * \note If the manager belongs to a registry and the IE manager of the registry has been changed,
+ *   all templates are redefined first (see fds_tmgr_registry_find()).
  * \param[in] tmgr     Template manager
  * \param[in] exp_time Export time
  * \return On success returns #FDS_OK.
@@ -315,6 +342,67 @@ fds_tmgr_template_get(fds_tmgr_t *tmgr, uint16_t id, const struct fds_template *
 FDS_API int
 fds_tmgr_template_add(fds_tmgr_t *tmgr, struct fds_template *tmplt);
 
+/**
+ * \brief Refresh a template using its raw definition
+ *
+ * Exporters over UDP periodically resend all their templates. If the raw template is exactly
+ * the same as the definition of the template in the current context, the template is refreshed
+ * without parsing (its last seen timestamp and lifetime are updated) and the function returns
+ * #FDS_OK. Otherwise, the manager is not modified and the template must be parsed and added by
+ * fds_tmgr_template_add().
+ *
+ * \note Only timestamps of the template are updated, if the template has been defined or
+ *   refreshed at the current Export Time and the current snapshot has not been passed to the
+ *   user or readers yet (see fds_tmgr_snapshot_get(), fds_tmgr_template_get() and
+ *   fds_tmgr_publish()). In case of TCP sessions or if the snapshot timeout is zero (i.e.
+ *   without access to history), this also applies to templates defined at an older Export Time.
+ *   Otherwise, the refresh creates a new snapshot and a copy of the template that shares
+ *   immutable parts of its definition with the original template.
+ * \warning This operation is related to a context (determined by the current Export Time).
+ *   For more information see: fds_tmgr_set_time().
+ * \param[in] tmgr Template manager
+ * \param[in] type Type of the template (::FDS_TYPE_TEMPLATE or ::FDS_TYPE_TEMPLATE_OPTS)
+ * \param[in] ptr  Pointer to the raw template (i.e. the header of the Template Record)
+ * \param[in] len  Length of the raw template
+ * \return #FDS_OK on success (the template has been refreshed).
+ *   #FDS_ERR_NOTFOUND, if an identical template is not present (the manager is not modified).
+ *   #FDS_ERR_DENIED, if modification of the historical snapshot is not allowed.
+ *   #FDS_ERR_NOMEM, if a memory allocation error has occurred.
+ *   #FDS_ERR_ARG, if the type or the length is not valid or the time context is not defined.
+ */
+FDS_API int
+fds_tmgr_template_refresh(fds_tmgr_t *tmgr, enum fds_template_type type, const void *ptr,
+    uint16_t len);
+
+/**
+ * \brief Add all templates of an (Options) Template Set
+ *
+ * All (Options) Template Records in the Set are parsed first and, if the whole Set is valid,
+ * added to the manager at once (i.e. the snapshot is prepared for modification only once).
+ * Records that are exactly the same as the definitions in the current context are only
+ * refreshed (see fds_tmgr_template_refresh()) and they are not parsed at all.
+ *
+ * If the Set is malformed, a template cannot be parsed or it is not allowed to add a template
+ * (see fds_tmgr_template_add()), the manager is not modified. However, if an error (e.g. memory
+ * allocation error) occurs when the templates are being added, the templates added before the
+ * error remain in the manager.
+ *
+ * \warning Template Withdrawals are not supported, see fds_tmgr_template_withdraw() and
+ *   fds_tmgr_template_withdraw_all().
+ * \warning This operation is related to a context (determined by the current Export Time).
+ *   For more information see: fds_tmgr_set_time().
+ * \param[in] tmgr Template manager
+ * \param[in] it   Initialized iterator over the (Options) Template Set (see fds_tset_iter_init()).
+ *   The iterator will be moved to the end of the Set.
+ * \return #FDS_OK on success (all templates have been added).
+ *   #FDS_ERR_FORMAT, if the Set or a template is malformed.
+ *   #FDS_ERR_DENIED, if the operation is not allowed for a template and session combination.
+ *   #FDS_ERR_NOMEM, if a memory allocation error has occurred.
+ *   #FDS_ERR_ARG, if the Set contains withdrawals or the time context is not defined.
+ */
+FDS_API int
+fds_tmgr_template_add_set(fds_tmgr_t *tmgr, struct fds_tset_iter *it);
+
 /**
  * \brief Withdraw a template
  *
@@ -486,6 +574,412 @@ fds_tsnapshot_deep_copy(const fds_tsnapshot_t *snap);
 FDS_API void
 fds_tsnapshot_destroy(fds_tsnapshot_t *snap);
 
+/**
+ * \brief Publish a snapshot of valid templates to readers in other threads
+ *
+ * The snapshot selected by the current time context (see fds_tmgr_set_time()) replaces the
+ * previously published snapshot and readers (see fds_treader_lock()) can access it without
+ * any locks. Until the first snapshot is published, readers get NULL.
+ *
+ * The function also replaces manual garbage handling. Unreachable templates and snapshots
+ * are collected and destroyed as soon as no reader can access them (epoch-based reclamation).
+ * Therefore, the function should be called regularly, for example, after processing of each
+ * IPFIX Message.
+ *
+ * Example usage:
+ * \code{.c}
+ *   // Template processing thread (the only thread that modifies the manager)
+ *   fds_tmgr_set_time(...);
+ *   fds_tmgr_template_add(...);
+ *   fds_tmgr_publish(...);
+ *
+ *   // Data processing threads (each with its own reader)
+ *   const fds_tsnapshot_t *snap = fds_treader_lock(reader);
+ *   // ... find templates in the snapshot and decode Data Records ...
+ *   fds_treader_unlock(reader);
+ * \endcode
+ *
+ * \warning If snapshots are published, garbage MUST NOT be retrieved using
+ *   fds_tmgr_garbage_get() as it could contain templates and snapshots still used by readers.
+ * \warning The function MUST be called by the same thread that modifies the manager.
+ * \param[in] tmgr Template manager
+ * \return On success returns #FDS_OK.
+ *   If the time context is no longer available returns #FDS_ERR_NOTFOUND.
+ *   If a memory allocation error has occurred returns #FDS_ERR_NOMEM. In this case, the new
+ *   snapshot might not be published and readers can get NULL.
+ */
+FDS_API int
+fds_tmgr_publish(fds_tmgr_t *tmgr);
+
+/**
+ * \brief Set a background reclaimer of garbage of published snapshots
+ *
+ * Garbage collected by fds_tmgr_publish() that is no longer accessible by readers is passed
+ * to the reclaimer (see fds_tmgr_reclaimer_create()) instead of being destroyed by the thread
+ * that publishes snapshots. If the reclaimer fails to accept the garbage, it is destroyed
+ * immediately as usual.
+ *
+ * \note Garbage that is still accessible by readers when the manager is destroyed is
+ *   destroyed immediately by fds_tmgr_destroy().
+ * \warning The reclaimer MUST exist until it is unset or until the manager is destroyed.
+ * \param[in] tmgr Template manager
+ * \param[in] rcl  Reclaimer (NULL to destroy garbage by fds_tmgr_publish() again)
+ */
+FDS_API void
+fds_tmgr_set_reclaimer(fds_tmgr_t *tmgr, fds_tmgr_reclaimer_t *rcl);
+
+/**
+ * \brief Create a reader of published snapshots
+ *
+ * Each thread that accesses published snapshots must have its own reader. Unlike other
+ * functions of the manager, this function can be called from any thread.
+ * \note Readers MUST be destroyed before the template manager.
+ * \param[in] tmgr Template manager
+ * \return Pointer to the reader or NULL (memory allocation error)
+ */
+FDS_API fds_treader_t *
+fds_treader_create(fds_tmgr_t *tmgr);
+
+/**
+ * \brief Destroy a reader of published snapshots
+ * \warning The reader MUST NOT be in a critical section (see fds_treader_lock()).
+ * \param[in] reader Reader (can be NULL)
+ */
+FDS_API void
+fds_treader_destroy(fds_treader_t *reader);
+
+/**
+ * \brief Enter a critical section and get the published snapshot
+ *
+ * The snapshot and its templates are valid until the reader leaves the critical section
+ * (see fds_treader_unlock()). The function is lock-free and never blocks the thread which
+ * modifies the manager, however, templates and snapshots retired during a long critical section
+ * cannot be destroyed. Critical sections must not be nested.
+ * \param[in] reader Reader
+ * \return Pointer to the snapshot or NULL (nothing has been published yet)
+ */
+FDS_API const fds_tsnapshot_t *
+fds_treader_lock(fds_treader_t *reader);
+
+/**
+ * \brief Leave a critical section
+ *
+ * The snapshot returned by fds_treader_lock() and its templates must not be accessed anymore.
+ * \param[in] reader Reader
+ */
+FDS_API void
+fds_treader_unlock(fds_treader_t *reader);
+
+/**
+ * \brief Create a registry of template managers
+ *
+ * Collectors usually need one template manager per combination of a Transport Session and an
+ * Observation Domain ID (ODID). The registry owns the managers and provides a fast lookup of
+ * them even if there are tens of thousands of exporters. Managers are stored in independently
+ * locked shards, therefore, multiple threads can access the registry at the same time.
+ *
+ * Managers removed from the registry (see fds_tmgr_registry_remove(),
+ * fds_tmgr_registry_remove_session() and fds_tmgr_registry_sweep()) are not destroyed
+ * immediately. They are moved to the shared garbage of the registry that should be retrieved
+ * and destroyed by fds_tmgr_registry_garbage_get() when the managers are not used by any thread.
+ *
+ * Example usage:
+ * \code{.c}
+ *   // For each IPFIX Message
+ *   fds_tmgr_t *tmgr = fds_tmgr_registry_find(reg, session, odid, now);
+ *   if (!tmgr) {
+ *     tmgr = fds_tmgr_create(...);
+ *     // ... configure the manager ...
+ *     fds_tmgr_registry_add(reg, session, odid, tmgr, now);
+ *   }
+ *   fds_tmgr_set_time(tmgr, ...);
+ *
+ *   // Periodically (e.g. once per second)
+ *   fds_tmgr_registry_sweep(reg, now, timeout, 1000);
+ *   fds_tmgr_registry_garbage_get(reg, &gc);
+ *   fds_tmgr_garbage_destroy(gc);
+ * \endcode
+ *
+ * \note The registry doesn't make template managers thread-safe. Each manager MUST be used
+ *   by one thread at a time.
+ * \param[in] shards Number of shards (0 = default number)
+ * \return Pointer to the registry or NULL (memory allocation error)
+ */
+FDS_API fds_tmgr_registry_t *
+fds_tmgr_registry_create(unsigned int shards);
+
+/**
+ * \brief Destroy a registry of template managers
+ *
+ * All managers in the registry and the shared garbage are destroyed.
+ * \param[in] reg Registry
+ */
+FDS_API void
+fds_tmgr_registry_destroy(fds_tmgr_registry_t *reg);
+
+/**
+ * \brief Add a template manager to a registry
+ *
+ * \param[in] reg     Registry
+ * \param[in] session Transport Session (an identifier, the pointer is never dereferenced)
+ * \param[in] odid    Observation Domain ID
+ * \param[in] tmgr    Template manager
+ * \param[in] now     Current time (in seconds, see fds_tmgr_registry_sweep())
+ * \return On success returns #FDS_OK and the registry takes responsibility for the manager.
+ *   If a manager with the same key is already present returns #FDS_ERR_DENIED.
+ *   If a memory allocation error has occurred returns #FDS_ERR_NOMEM.
+ */
+FDS_API int
+fds_tmgr_registry_add(fds_tmgr_registry_t *reg, const void *session, uint32_t odid,
+    fds_tmgr_t *tmgr, uint32_t now);
+
+/**
+ * \brief Find a template manager in a registry
+ *
+ * The time of the last use of the manager is updated. If the IE manager of the registry has been
+ * changed (see fds_tmgr_registry_set_iemgr()), the lookup only asks the manager to redefine its
+ * templates. The templates are redefined on the first use of the manager, i.e. by the next call
+ * of fds_tmgr_set_time() in the thread that uses the manager. Unlike fds_tmgr_set_iemgr(),
+ * the time context of the manager is preserved.
+ * \param[in] reg     Registry
+ * \param[in] session Transport Session
+ * \param[in] odid    Observation Domain ID
+ * \param[in] now     Current time (in seconds, see fds_tmgr_registry_sweep())
+ * \return Pointer to the manager or NULL (not found)
+ */
+FDS_API fds_tmgr_t *
+fds_tmgr_registry_find(fds_tmgr_registry_t *reg, const void *session, uint32_t odid,
+    uint32_t now);
+
+/**
+ * \brief Remove a template manager from a registry
+ *
+ * The manager is moved to the shared garbage.
+ * \param[in] reg     Registry
+ * \param[in] session Transport Session
+ * \param[in] odid    Observation Domain ID
+ * \return On success returns #FDS_OK. If the manager is not present returns #FDS_ERR_NOTFOUND.
+ *   If a memory allocation error has occurred returns #FDS_ERR_NOMEM and the manager remains
+ *   in the registry.
+ */
+FDS_API int
+fds_tmgr_registry_remove(fds_tmgr_registry_t *reg, const void *session, uint32_t odid);
+
+/**
+ * \brief Remove all template managers of a Transport Session from a registry
+ *
+ * The managers are moved to the shared garbage. Usually called when the session is closed.
+ * \param[in] reg     Registry
+ * \param[in] session Transport Session
+ * \return On success returns #FDS_OK. If a memory allocation error has occurred returns
+ *   #FDS_ERR_NOMEM and some managers might remain in the registry.
+ */
+FDS_API int
+fds_tmgr_registry_remove_session(fds_tmgr_registry_t *reg, const void *session);
+
+/**
+ * \brief Remove inactive template managers from a registry
+ *
+ * Managers that have not been used (see fds_tmgr_registry_find()) for more than \p timeout
+ * seconds are moved to the shared garbage. To avoid latency spikes, only a limited number of
+ * managers is checked by each call. The next call continues where the previous one has ended,
+ * so all managers are checked after enough calls.
+ *
+ * \note Time values are defined by the user (e.g. a monotonic clock in seconds), however, the
+ *   same clock MUST be used for all functions of the registry.
+ * \param[in] reg     Registry
+ * \param[in] now     Current time (in seconds)
+ * \param[in] timeout Inactivity timeout (in seconds)
+ * \param[in] batch   Maximal number of managers to check (approximate)
+ * \return Number of removed managers
+ */
+FDS_API size_t
+fds_tmgr_registry_sweep(fds_tmgr_registry_t *reg, uint32_t now, uint32_t timeout, size_t batch);
+
+/**
+ * \brief Add garbage of a template manager to the shared garbage of a registry
+ *
+ * Threads that process templates can pass garbage of their managers (see fds_tmgr_garbage_get())
+ * to the registry, so all garbage can be destroyed at once in a single place.
+ * \param[in] reg Registry
+ * \param[in] gc  Garbage (can be NULL)
+ * \return On success returns #FDS_OK and the registry takes responsibility for the garbage.
+ *   Otherwise returns #FDS_ERR_NOMEM and the garbage must be destroyed by the user.
+ */
+FDS_API int
+fds_tmgr_registry_garbage_add(fds_tmgr_registry_t *reg, fds_tgarbage_t *gc);
+
+/**
+ * \brief Get the shared garbage of a registry
+ *
+ * The garbage contains removed managers and garbage added by fds_tmgr_registry_garbage_add().
+ * It should be destroyed by fds_tmgr_garbage_destroy() when no thread uses the removed
+ * managers and their templates.
+ *
+ * If a reclaimer is set (see fds_tmgr_registry_set_reclaimer()), the garbage is passed to the
+ * reclaimer and \p gc is set to NULL. If the reclaimer fails to accept the garbage, it is
+ * returned as usual.
+ * \warning Therefore, the function must be called only when the removed managers are not
+ *   used by any thread even if a reclaimer is set.
+ * \param[in]  reg Registry
+ * \param[out] gc  Garbage (NULL, if there is no garbage or it has been passed to the reclaimer)
+ */
+FDS_API void
+fds_tmgr_registry_garbage_get(fds_tmgr_registry_t *reg, fds_tgarbage_t **gc);
+
+/**
+ * \brief Set a background reclaimer of the shared garbage of a registry
+ *
+ * The shared garbage retrieved by fds_tmgr_registry_garbage_get() is destroyed by the
+ * reclaimer (see fds_tmgr_reclaimer_create()) in the background.
+ * \warning The reclaimer MUST exist until it is unset or until the registry is destroyed.
+ * \param[in] reg Registry
+ * \param[in] rcl Reclaimer (NULL to return the garbage to the caller again)
+ */
+FDS_API void
+fds_tmgr_registry_set_reclaimer(fds_tmgr_registry_t *reg, fds_tmgr_reclaimer_t *rcl);
+
+/**
+ * \brief Set an IE manager of all template managers in a registry
+ *
+ * Templates of the managers are not redefined immediately. Each manager is redefined lazily
+ * on its first use after the lookup (see fds_tmgr_registry_find()) by the thread that uses it,
+ * so the expensive redefinition is spread over the threads and doesn't block the registry.
+ * This applies also to managers added to the registry after this call. Managers that are not
+ * used anymore can be redefined by fds_tmgr_registry_redefine().
+ *
+ * \warning The previous IE manager MUST exist until all managers are redefined, i.e. until
+ *   fds_tmgr_registry_iemgr_pending() returns zero or until the managers are removed from the
+ *   registry and their garbage is destroyed.
+ * \param[in] reg   Registry
+ * \param[in] iemgr IE manager (can be NULL)
+ */
+FDS_API void
+fds_tmgr_registry_set_iemgr(fds_tmgr_registry_t *reg, const fds_iemgr_t *iemgr);
+
+/**
+ * \brief Redefine templates of all template managers in a registry using its IE manager
+ *
+ * Templates of managers that have not been redefined using the IE manager of the registry yet
+ * (see fds_tmgr_registry_set_iemgr()) are redefined immediately, i.e. it is not necessary to
+ * wait for their next use (e.g. idle managers that still reference the previous IE manager).
+ * The time context of the managers is preserved, however, the current snapshot is selected
+ * by the next call of fds_tmgr_set_time() and their garbage must be collected by the threads
+ * that use them (see fds_tmgr_garbage_get()).
+ *
+ * Each shard of the registry is locked while its managers are redefined, so lookups of
+ * other managers in the same shard are blocked for that time.
+ *
+ * \warning The managers MUST NOT be used by any other thread during the call.
+ * \param[in] reg Registry
+ * \return On success returns #FDS_OK. If a memory allocation error has occurred, returns
+ *   #FDS_ERR_NOMEM and the managers that failed remain waiting for redefinition (see
+ *   fds_tmgr_registry_iemgr_pending()). The call can be repeated later.
+ */
+FDS_API int
+fds_tmgr_registry_redefine(fds_tmgr_registry_t *reg);
+
+/**
+ * \brief Get the number of template managers waiting for redefinition
+ *
+ * Managers that have not been redefined using the IE manager of the registry yet
+ * (see fds_tmgr_registry_set_iemgr()).
+ * \note All managers in the registry are checked.
+ * \param[in] reg Registry
+ * \return Number of managers
+ */
+FDS_API size_t
+fds_tmgr_registry_iemgr_pending(fds_tmgr_registry_t *reg);
+
+/** Statistics of a background reclaimer of garbage (see fds_tmgr_reclaimer_stats()) */
+struct fds_tmgr_reclaimer_stats {
+    /** Number of added garbage collections                                 */
+    uint64_t gc_added;
+    /** Number of destroyed garbage collections                             */
+    uint64_t gc_destroyed;
+    /** Number of destroyed garbage records (templates, snapshots, etc.)    */
+    uint64_t rec_destroyed;
+    /** Number of garbage records waiting for destruction                   */
+    uint64_t rec_pending;
+    /** Number of batches (i.e. wake-ups of the background thread)          */
+    uint64_t batches;
+};
+
+/**
+ * \brief Create a background reclaimer of garbage
+ *
+ * Destruction of garbage (see fds_tmgr_garbage_get()) of large managers can take a significant
+ * amount of time. The reclaimer destroys garbage in its own background thread, so threads that
+ * process templates don't have to. Garbage added to the reclaimer is destroyed in batches, i.e.
+ * after a garbage is added, the thread waits for \p interval milliseconds to collect more
+ * garbage and then destroys all of it at once.
+ *
+ * Garbage can be added manually by fds_tmgr_reclaimer_add() or the reclaimer can be set to
+ * a template manager (see fds_tmgr_set_reclaimer()) or a registry of template managers
+ * (see fds_tmgr_registry_set_reclaimer()) that pass their garbage to it automatically.
+ *
+ * Usage example:
+ * \code{.c}
+ *   fds_tmgr_reclaimer_t *rcl = fds_tmgr_reclaimer_create(100);
+ *   // ... in any thread
+ *   fds_tmgr_garbage_get(tmgr, &gc);
+ *   if (fds_tmgr_reclaimer_add(rcl, gc) != FDS_OK) {
+ *     fds_tmgr_garbage_destroy(gc);
+ *   }
+ *   // ...
+ *   fds_tmgr_reclaimer_destroy(rcl);
+ * \endcode
+ *
+ * \warning Garbage can be added only if nothing refers to its content anymore (e.g. snapshots
+ *   and templates used by other threads). The reclaimer doesn't delay the destruction.
+ * \param[in] interval Minimal interval between batches (in milliseconds, 0 = no delay)
+ * \return Pointer to the reclaimer or NULL (memory allocation error or the thread cannot be
+ *   started)
+ */
+FDS_API fds_tmgr_reclaimer_t *
+fds_tmgr_reclaimer_create(uint32_t interval);
+
+/**
+ * \brief Destroy a background reclaimer of garbage
+ *
+ * All garbage waiting for destruction is destroyed first and the thread is stopped.
+ * \param[in] rcl Reclaimer (can be NULL)
+ */
+FDS_API void
+fds_tmgr_reclaimer_destroy(fds_tmgr_reclaimer_t *rcl);
+
+/**
+ * \brief Add garbage to a background reclaimer
+ *
+ * The function is thread-safe.
+ * \param[in] rcl Reclaimer
+ * \param[in] gc  Garbage (can be NULL)
+ * \return On success returns #FDS_OK and the reclaimer takes responsibility for the garbage.
+ *   Otherwise returns #FDS_ERR_NOMEM and the garbage must be destroyed by the user.
+ */
+FDS_API int
+fds_tmgr_reclaimer_add(fds_tmgr_reclaimer_t *rcl, fds_tgarbage_t *gc);
+
+/**
+ * \brief Wait until all garbage added to a background reclaimer is destroyed
+ *
+ * The interval between batches is not applied. Garbage added after the call is not waited for.
+ * The function is thread-safe.
+ * \param[in] rcl Reclaimer
+ */
+FDS_API void
+fds_tmgr_reclaimer_flush(fds_tmgr_reclaimer_t *rcl);
+
+/**
+ * \brief Get statistics of a background reclaimer
+ *
+ * The function is thread-safe.
+ * \param[in]  rcl   Reclaimer
+ * \param[out] stats Statistics
+ */
+FDS_API void
+fds_tmgr_reclaimer_stats(fds_tmgr_reclaimer_t *rcl, struct fds_tmgr_reclaimer_stats *stats);
+
 /**
  * @}
  */
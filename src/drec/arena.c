@@ -0,0 +1,348 @@
+/**
+ * \file src/drec/arena.c
+ * \author agent <agent@local>
+ * \brief Arena of Data Record copies (source file)
+ * \date October 2026
+ *
+ * Copyright(c) 2026 CESNET z.s.p.o.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <libfds.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Size of a memory block for records (must be greater than the maximum size of a record) */
+#define ARENA_BLOCK_SIZE (1024U * 1024U)
+/** Alignment of records in memory blocks                                                     */
+#define ARENA_ALIGN 8U
+/** Minimal size of the hash table of Templates (must be a power of two)                     */
+#define ARENA_TABLE_MIN 16U
+
+/** Memory block for records                                                                 */
+struct arena_block {
+    /** Next block (or NULL)                                                                 */
+    struct arena_block *next;
+    /** Content of the block                                                                 */
+    uint8_t data[];
+};
+
+/** Shared copy of a Template (an item of the hash table)                                     */
+struct arena_tmplt {
+    /** Identifier of the Template (0 = empty slot), see fds_template_index#uid              */
+    uint64_t uid;
+    /** Generation of the arena in which the Template has been used for the last time        */
+    uint64_t gen;
+    /** Copy of the Template                                                                 */
+    struct fds_template *tmplt;
+};
+
+struct fds_drec_arena {
+    /** The first memory block (or NULL)                                                     */
+    struct arena_block *head;
+    /** The currently filled memory block (or NULL)                                          */
+    struct arena_block *cur;
+    /** Number of used bytes in the current block                                            */
+    size_t used;
+
+    /** Current generation (i.e. number of resets)                                           */
+    uint64_t gen;
+    /** Hash table of shared Templates (open addressing with linear probing)                 */
+    struct arena_tmplt *table;
+    /** Size of the hash table (always a power of two)                                       */
+    size_t table_size;
+    /** Number of Templates in the hash table                                                */
+    size_t table_cnt;
+    /** The last used Template (or NULL)                                                     */
+    struct arena_tmplt *last;
+    /** The last identifier assigned to a Template without its own identifier               */
+    uint64_t uid_local;
+};
+
+fds_drec_arena_t *
+fds_drec_arena_create()
+{
+    fds_drec_arena_t *arena = calloc(1, sizeof(*arena));
+    if (!arena) {
+        return NULL;
+    }
+
+    arena->table = calloc(ARENA_TABLE_MIN, sizeof(*arena->table));
+    if (!arena->table) {
+        free(arena);
+        return NULL;
+    }
+
+    arena->table_size = ARENA_TABLE_MIN;
+    arena->uid_local = UINT64_MAX;
+    return arena;
+}
+
+void
+fds_drec_arena_destroy(fds_drec_arena_t *arena)
+{
+    if (!arena) {
+        return;
+    }
+
+    struct arena_block *block = arena->head;
+    while (block) {
+        struct arena_block *next = block->next;
+        free(block);
+        block = next;
+    }
+
+    for (size_t i = 0; i < arena->table_size; ++i) {
+        if (arena->table[i].uid != 0) {
+            fds_template_destroy(arena->table[i].tmplt);
+        }
+    }
+
+    free(arena->table);
+    free(arena);
+}
+
+void
+fds_drec_arena_reset(fds_drec_arena_t *arena)
+{
+    // Memory blocks are reused and unused Templates are removed later (see arena_table_rebuild())
+    arena->cur = arena->head;
+    arena->used = 0;
+    arena->gen++;
+}
+
+/**
+ * \brief Allocate memory for a record in an arena
+ * \param[in] arena Arena
+ * \param[in] size  Size of the memory (must be at most #ARENA_BLOCK_SIZE)
+ * \return Pointer to the memory or NULL (memory allocation error)
+ */
+static void *
+arena_alloc(fds_drec_arena_t *arena, size_t size)
+{
+    assert(size <= ARENA_BLOCK_SIZE);
+    size = (size + (ARENA_ALIGN - 1U)) & ~((size_t) ARENA_ALIGN - 1U);
+
+    if (arena->cur != NULL && arena->used + size > ARENA_BLOCK_SIZE && arena->cur->next != NULL) {
+        // Reuse the following block (after reset)
+        arena->cur = arena->cur->next;
+        arena->used = 0;
+    }
+
+    if (arena->cur == NULL || arena->used + size > ARENA_BLOCK_SIZE) {
+        struct arena_block *block = malloc(sizeof(*block) + ARENA_BLOCK_SIZE);
+        if (!block) {
+            return NULL;
+        }
+
+        block->next = NULL;
+        if (arena->cur != NULL) {
+            assert(arena->cur->next == NULL);
+            arena->cur->next = block;
+        } else {
+            assert(arena->head == NULL);
+            arena->head = block;
+        }
+
+        arena->cur = block;
+        arena->used = 0;
+    }
+
+    void *ptr = &arena->cur->data[arena->used];
+    arena->used += size;
+    return ptr;
+}
+
+/**
+ * \brief Calculate a hash of a Template identifier
+ * \param[in] uid Identifier
+ * \return Hash value (must be masked by the size of the hash table)
+ */
+static inline size_t
+arena_table_hash(uint64_t uid)
+{
+    uint64_t hash = uid * 0x9E3779B97F4A7C15ULL;
+    return (size_t) (hash ^ (hash >> 32));
+}
+
+/**
+ * \brief Insert a Template into the hash table
+ * \param[in] table      Hash table
+ * \param[in] table_size Size of the hash table
+ * \param[in] item       Item to insert
+ * \return Pointer to the inserted item
+ */
+static struct arena_tmplt *
+arena_table_insert(struct arena_tmplt *table, size_t table_size, const struct arena_tmplt *item)
+{
+    const size_t mask = table_size - 1U;
+    size_t pos = arena_table_hash(item->uid) & mask;
+    while (table[pos].uid != 0) {
+        pos = (pos + 1U) & mask;
+    }
+
+    table[pos] = *item;
+    return &table[pos];
+}
+
+/**
+ * \brief Remove unused Templates from the hash table and make space for a new one
+ *
+ * Templates which have not been used since the last reset are not referenced by any valid
+ * record, so they are destroyed. The size of the table is adjusted to the number of remaining
+ * Templates.
+ * \param[in] arena Arena
+ * \return #FDS_OK or #FDS_ERR_NOMEM
+ */
+static int
+arena_table_rebuild(fds_drec_arena_t *arena)
+{
+    size_t live_cnt = 0;
+    for (size_t i = 0; i < arena->table_size; ++i) {
+        if (arena->table[i].uid != 0 && arena->table[i].gen == arena->gen) {
+            live_cnt++;
+        }
+    }
+
+    // Keep the table at most half full (including the new Template)
+    size_t new_size = ARENA_TABLE_MIN;
+    while (new_size < 4U * (live_cnt + 1U)) {
+        new_size <<= 1;
+    }
+
+    struct arena_tmplt *new_table = calloc(new_size, sizeof(*new_table));
+    if (!new_table) {
+        return FDS_ERR_NOMEM;
+    }
+
+    for (size_t i = 0; i < arena->table_size; ++i) {
+        struct arena_tmplt *item = &arena->table[i];
+        if (item->uid == 0) {
+            continue;
+        }
+
+        if (item->gen != arena->gen) {
+            fds_template_destroy(item->tmplt);
+            continue;
+        }
+
+        arena_table_insert(new_table, new_size, item);
+    }
+
+    free(arena->table);
+    arena->table = new_table;
+    arena->table_size = new_size;
+    arena->table_cnt = live_cnt;
+    arena->last = NULL;
+    return FDS_OK;
+}
+
+/**
+ * \brief Check if a shared copy of a Template can be used for records of a Template
+ *
+ * The identifier of the Template covers only its layout and definitions of fields. Flow key
+ * flags (see fds_template_flowkey_define()) and timestamps are changed by the template manager
+ * without changing the identifier, so they must be compared too.
+ * \param[in] item  Shared copy
+ * \param[in] tmplt Template
+ * \return True or false
+ */
+static bool
+arena_tmplt_match(const struct arena_tmplt *item, const struct fds_template *tmplt)
+{
+    const struct fds_template *cpy = item->tmplt;
+    if (item->uid != tmplt->index.uid || cpy->flags != tmplt->flags
+            || cpy->time.first_seen != tmplt->time.first_seen
+            || cpy->time.last_seen != tmplt->time.last_seen
+            || cpy->time.end_of_life != tmplt->time.end_of_life) {
+        return false;
+    }
+
+    if ((tmplt->flags & FDS_TEMPLATE_FKEY) == 0) {
+        // No field is a flow key
+        return true;
+    }
+
+    for (uint16_t i = 0; i < tmplt->fields_cnt_total; ++i) {
+        if ((cpy->fields[i].flags ^ tmplt->fields[i].flags) & FDS_TFIELD_FKEY) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * \brief Get a shared copy of a Template
+ *
+ * If the copy doesn't exist yet, it is created.
+ * \param[in] arena Arena
+ * \param[in] tmplt Template
+ * \return Pointer to the copy or NULL (memory allocation error)
+ */
+static const struct fds_template *
+arena_tmplt_get(fds_drec_arena_t *arena, const struct fds_template *tmplt)
+{
+    const uint64_t uid = tmplt->index.uid;
+    if (uid != 0) {
+        // Records are usually based on the same Template as the previous one
+        struct arena_tmplt *item = arena->last;
+        if (item == NULL || !arena_tmplt_match(item, tmplt)) {
+            // Multiple copies with the same identifier can exist
+            const size_t mask = arena->table_size - 1U;
+            size_t pos = arena_table_hash(uid) & mask;
+            while (arena->table[pos].uid != 0 && !arena_tmplt_match(&arena->table[pos], tmplt)) {
+                pos = (pos + 1U) & mask;
+            }
+            item = (arena->table[pos].uid != 0) ? &arena->table[pos] : NULL;
+        }
+
+        if (item != NULL) {
+            item->gen = arena->gen;
+            arena->last = item;
+            return item->tmplt;
+        }
+    }
+
+    // Create a new copy
+    if (2U * (arena->table_cnt + 1U) > arena->table_size && arena_table_rebuild(arena) != FDS_OK) {
+        return NULL;
+    }
+
+    struct arena_tmplt item;
+    item.tmplt = fds_template_copy(tmplt);
+    if (!item.tmplt) {
+        return NULL;
+    }
+
+    // Templates without an identifier cannot be shared (local identifiers never collide)
+    item.uid = (uid != 0) ? uid : arena->uid_local--;
+    item.gen = arena->gen;
+    arena->last = arena_table_insert(arena->table, arena->table_size, &item);
+    arena->table_cnt++;
+    return item.tmplt;
+}
+
+struct fds_drec *
+fds_drec_copy(fds_drec_arena_t *arena, const struct fds_drec *rec)
+{
+    const struct fds_template *tmplt = arena_tmplt_get(arena, rec->tmplt);
+    if (!tmplt) {
+        return NULL;
+    }
+
+    // Both the record description and its content are stored together
+    struct fds_drec *cpy = arena_alloc(arena, sizeof(*cpy) + rec->size);
+    if (!cpy) {
+        return NULL;
+    }
+
+    cpy->data = (uint8_t *) (cpy + 1);
+    memcpy(cpy->data, rec->data, rec->size);
+    cpy->size = rec->size;
+    cpy->tmplt = tmplt;
+    cpy->snap = NULL;
+    return cpy;
+}
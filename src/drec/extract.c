@@ -0,0 +1,304 @@
+/**
+ * \file src/drec/extract.c
+ * \author agent <agent@local>
+ * \brief Batch extraction of Data Record fields into columns (source file)
+ * \date October 2026
+ *
+ * Copyright(c) 2026 CESNET z.s.p.o.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <libfds.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <endian.h>    // be64toh
+#include <arpa/inet.h> // ntohs, ntohl
+
+/**
+ * \brief Get size of a value in a column
+ * \param[in] type Type of the column
+ * \return Size of the value (in bytes) or 0 if the type is unknown
+ */
+static size_t
+extract_type_size(enum fds_extract_type type)
+{
+    switch (type) {
+    case FDS_EXTRACT_PRESENT:
+        return sizeof(uint8_t);
+    case FDS_EXTRACT_UINT:
+        return sizeof(uint64_t);
+    case FDS_EXTRACT_INT:
+        return sizeof(int64_t);
+    case FDS_EXTRACT_DOUBLE:
+        return sizeof(double);
+    case FDS_EXTRACT_TIME_MS:
+        return sizeof(uint64_t);
+    case FDS_EXTRACT_IP:
+        return 16U;
+    case FDS_EXTRACT_MAC:
+        return 6U;
+    default:
+        return 0;
+    }
+}
+
+/** Read a 16-bit value in network byte order from an unaligned address */
+static inline uint16_t
+extract_load16(const uint8_t *ptr)
+{
+    uint16_t value;
+    memcpy(&value, ptr, sizeof(value));
+    return ntohs(value);
+}
+
+/** Read a 32-bit value in network byte order from an unaligned address */
+static inline uint32_t
+extract_load32(const uint8_t *ptr)
+{
+    uint32_t value;
+    memcpy(&value, ptr, sizeof(value));
+    return ntohl(value);
+}
+
+/** Read a 64-bit value in network byte order from an unaligned address */
+static inline uint64_t
+extract_load64(const uint8_t *ptr)
+{
+    uint64_t value;
+    memcpy(&value, ptr, sizeof(value));
+    return be64toh(value);
+}
+
+/**
+ * \brief Convert a value of a field (scalar version)
+ *
+ * If the value cannot be converted, the destination is set to zero.
+ * \param[in]  data Field data
+ * \param[in]  size Real length of the field
+ * \param[in]  info Field description
+ * \param[in]  type Type of the column
+ * \param[out] dst  Destination value in the column
+ */
+static void
+extract_value(const uint8_t *data, uint16_t size, const struct fds_tfield *info,
+    enum fds_extract_type type, uint8_t *dst)
+{
+    int ret = FDS_ERR_ARG;
+
+    switch (type) {
+    case FDS_EXTRACT_PRESENT:
+        *dst = 1;
+        return;
+    case FDS_EXTRACT_UINT: {
+        uint64_t value;
+        ret = fds_get_uint_be(data, size, &value);
+        if (ret == FDS_OK) {
+            memcpy(dst, &value, sizeof(value));
+        }
+        } break;
+    case FDS_EXTRACT_INT: {
+        int64_t value;
+        ret = fds_get_int_be(data, size, &value);
+        if (ret == FDS_OK) {
+            memcpy(dst, &value, sizeof(value));
+        }
+        } break;
+    case FDS_EXTRACT_DOUBLE: {
+        double value;
+        ret = fds_get_float_be(data, size, &value);
+        if (ret == FDS_OK) {
+            memcpy(dst, &value, sizeof(value));
+        }
+        } break;
+    case FDS_EXTRACT_TIME_MS: {
+        uint64_t value;
+        if (info->def != NULL) {
+            ret = fds_get_datetime_lp_be(data, size, info->def->data_type, &value);
+        }
+        if (ret == FDS_OK) {
+            memcpy(dst, &value, sizeof(value));
+        }
+        } break;
+    case FDS_EXTRACT_IP:
+        if (size == 16U) {
+            memcpy(dst, data, 16U);
+            ret = FDS_OK;
+        } else if (size == 4U) {
+            // IPv4-mapped IPv6 address (::ffff:a.b.c.d)
+            memset(dst, 0, 10U);
+            memset(dst + 10U, 0xFF, 2U);
+            memcpy(dst + 12U, data, 4U);
+            ret = FDS_OK;
+        }
+        break;
+    case FDS_EXTRACT_MAC:
+        ret = fds_get_mac(data, size, dst);
+        break;
+    }
+
+    if (ret != FDS_OK) {
+        memset(dst, 0, extract_type_size(type));
+    }
+}
+
+/**
+ * \brief Extract a field with fixed position from a group of records
+ *
+ * All records must be based on the same Template, so the field has the same offset and size
+ * in all of them. Common types and sizes are converted in tight loops.
+ * \param[in]  recs   Group of data records
+ * \param[in]  cnt    Number of records in the group
+ * \param[in]  offset Offset of the field in the records
+ * \param[in]  size   Length of the field
+ * \param[in]  info   Field description
+ * \param[in]  type   Type of the column
+ * \param[out] dst    The first value of the group in the column
+ */
+static void
+extract_static(const struct fds_drec *recs, size_t cnt, uint16_t offset, uint16_t size,
+    const struct fds_tfield *info, enum fds_extract_type type, uint8_t *dst)
+{
+    switch (type) {
+    case FDS_EXTRACT_PRESENT:
+        memset(dst, 1, cnt);
+        return;
+    case FDS_EXTRACT_UINT:
+    case FDS_EXTRACT_INT: {
+        // Sign extension is applied by the cast of the loaded value
+        const bool sign = (type == FDS_EXTRACT_INT);
+        uint64_t *values = (uint64_t *) dst;
+        switch (size) {
+        case 8:
+            for (size_t i = 0; i < cnt; ++i) {
+                values[i] = extract_load64(recs[i].data + offset);
+            }
+            return;
+        case 4:
+            for (size_t i = 0; i < cnt; ++i) {
+                const uint32_t value = extract_load32(recs[i].data + offset);
+                values[i] = sign ? (uint64_t) (int64_t) (int32_t) value : value;
+            }
+            return;
+        case 2:
+            for (size_t i = 0; i < cnt; ++i) {
+                const uint16_t value = extract_load16(recs[i].data + offset);
+                values[i] = sign ? (uint64_t) (int64_t) (int16_t) value : value;
+            }
+            return;
+        case 1:
+            for (size_t i = 0; i < cnt; ++i) {
+                const uint8_t value = recs[i].data[offset];
+                values[i] = sign ? (uint64_t) (int64_t) (int8_t) value : value;
+            }
+            return;
+        default:
+            break;
+        }
+        } break;
+    case FDS_EXTRACT_DOUBLE:
+        if (size == sizeof(uint64_t)) {
+            double *values = (double *) dst;
+            for (size_t i = 0; i < cnt; ++i) {
+                const uint64_t value = extract_load64(recs[i].data + offset);
+                memcpy(&values[i], &value, sizeof(value));
+            }
+            return;
+        }
+        break;
+    case FDS_EXTRACT_TIME_MS:
+        if (size == sizeof(uint64_t) && info->def != NULL
+                && info->def->data_type == FDS_ET_DATE_TIME_MILLISECONDS) {
+            uint64_t *values = (uint64_t *) dst;
+            for (size_t i = 0; i < cnt; ++i) {
+                values[i] = extract_load64(recs[i].data + offset);
+            }
+            return;
+        }
+        break;
+    default:
+        break;
+    }
+
+    // Other types and sizes
+    const size_t width = extract_type_size(type);
+    for (size_t i = 0; i < cnt; ++i) {
+        extract_value(recs[i].data + offset, size, info, type, dst + i * width);
+    }
+}
+
+int
+fds_drec_extract_batch(const struct fds_drec *recs, size_t n, const struct fds_extract_spec *spec,
+    void **columns)
+{
+    const size_t fields_cnt = spec->fields_cnt;
+    for (size_t f = 0; f < fields_cnt; ++f) {
+        if (extract_type_size(spec->fields[f].type) == 0) {
+            return FDS_ERR_ARG;
+        }
+    }
+
+    if (n == 0 || fields_cnt == 0) {
+        return FDS_OK;
+    }
+
+    // Field accessors remember positions of fields in recently seen Templates
+    struct fds_drec_accessor *accessors = malloc(fields_cnt * sizeof(*accessors));
+    if (!accessors) {
+        return FDS_ERR_NOMEM;
+    }
+
+    for (size_t f = 0; f < fields_cnt; ++f) {
+        const struct fds_extract_field *field = &spec->fields[f];
+        fds_drec_accessor_init(&accessors[f], field->pen, field->id, field->flags);
+    }
+
+    size_t start = 0;
+    while (start < n) {
+        // Find a group of consecutive records based on the same Template
+        const struct fds_template *tmplt = recs[start].tmplt;
+        size_t end = start + 1;
+        while (end < n && recs[end].tmplt == tmplt) {
+            ++end;
+        }
+
+        const size_t cnt = end - start;
+        for (size_t f = 0; f < fields_cnt; ++f) {
+            const enum fds_extract_type type = spec->fields[f].type;
+            const size_t width = extract_type_size(type);
+            uint8_t *dst = ((uint8_t *) columns[f]) + start * width;
+
+            // Resolve the field once per group (the record is not modified)
+            struct fds_drec_field field;
+            struct fds_drec *first = (struct fds_drec *) &recs[start];
+            int idx = fds_drec_accessor_find(&accessors[f], first, NULL, &field);
+            if (idx == FDS_EOC) {
+                memset(dst, 0, cnt * width);
+                continue;
+            }
+
+            const struct fds_tfield *field_pos = &tmplt->fields[idx];
+            if (field_pos->offset != FDS_IPFIX_VAR_IE_LEN
+                    && field_pos->length != FDS_IPFIX_VAR_IE_LEN) {
+                extract_static(&recs[start], cnt, field_pos->offset, field_pos->length,
+                    field.info, type, dst);
+                continue;
+            }
+
+            // Position of the field depends on content of each record
+            extract_value(field.data, field.size, field.info, type, dst);
+            for (size_t i = 1; i < cnt; ++i) {
+                struct fds_drec *rec = (struct fds_drec *) &recs[start + i];
+                int ret = fds_drec_accessor_get(&accessors[f], rec, &field);
+                assert(ret == idx);
+                (void) ret;
+                extract_value(field.data, field.size, field.info, type, dst + i * width);
+            }
+        }
+
+        start = end;
+    }
+
+    free(accessors);
+    return FDS_OK;
+}
@@ -51,9 +51,132 @@
 #define IANA_PEN_REV 29305
 
 
+/**
+ * \brief Decode the real length of a field
+ *
+ * If the field has variable-length encoding, the real length is decoded from the length prefix
+ * and the offset is moved behind the prefix.
+ * \param[in]     rec_start Start of the Data Record
+ * \param[in]     length    Length of the field in the Template
+ * \param[in,out] offset    [in] Offset of the field / [out] Offset of the field data
+ * \return Real length of the field
+ */
+static inline uint16_t
+drec_field_decode(const uint8_t *rec_start, uint16_t length, uint16_t *offset)
+{
+    if (length != FDS_IPFIX_VAR_IE_LEN) {
+        return length;
+    }
+
+    // This is field with variable length encoding -> read size from data
+    uint16_t field_size = rec_start[*offset];
+    (*offset)++;
+
+    if (field_size == 255U) {
+        // Real size is on next 2 bytes
+        field_size = ntohs(*(const uint16_t *) &rec_start[*offset]);
+        *offset += 2U;
+    }
+
+    return field_size;
+}
+
+/**
+ * \brief Get position of a field from a table of per-record offsets
+ *
+ * If the field is not part of the table, length prefixes of fields behind the table are decoded.
+ * \param[in]  rec    Data Record
+ * \param[in]  offs   Table of per-record offsets of the Data Record
+ * \param[in]  idx    Index of the field
+ * \param[out] offset Offset of the field data
+ * \param[out] size   Real length of the field
+ */
+static inline void
+drec_offsets_get(const struct fds_drec *rec, const struct fds_drec_offsets *offs, uint16_t idx,
+    uint16_t *offset, uint16_t *size)
+{
+    if (idx < offs->cnt) {
+        *offset = offs->fields[idx].offset;
+        *size = offs->fields[idx].size;
+        return;
+    }
+
+    const struct fds_tfield *fields = rec->tmplt->fields;
+    uint16_t pos = offs->next;
+    for (uint16_t i = offs->cnt; i < idx; ++i) {
+        const uint16_t field_size = drec_field_decode(rec->data, fields[i].length, &pos);
+        pos += field_size;
+    }
+
+    *size = drec_field_decode(rec->data, fields[idx].length, &pos);
+    *offset = pos;
+}
+
+/**
+ * \brief Get offset of a field placed behind a variable-length field
+ *
+ * Only lengths of fields between the first variable-length field (its offset is always known)
+ * and the required field are decoded.
+ * \param[in] rec Data Record
+ * \param[in] idx Index of the field (must be greater than fds_template_index#dyn_start)
+ * \return Offset of the field (i.e. its length prefix, if any)
+ */
+static inline uint16_t
+drec_offset_dynamic(const struct fds_drec *rec, uint16_t idx)
+{
+    const struct fds_template *tmplt = rec->tmplt;
+    uint16_t pos = tmplt->index.dyn_start;
+    uint16_t offset = tmplt->fields[pos].offset;
+    assert(pos < idx && offset != FDS_IPFIX_VAR_IE_LEN);
+
+    for (; pos < idx; ++pos) {
+        const uint16_t field_size = drec_field_decode(rec->data, tmplt->fields[pos].length,
+            &offset);
+        offset += field_size;
+    }
+
+    return offset;
+}
+
+/**
+ * \brief Find the first occurrence of a field using the lookup index of the Template
+ *
+ * Fields before the first variable-length field are located directly. Otherwise, only lengths
+ * of fields between the first variable-length field and the required field are decoded.
+ * \param[in]  rec   Data Record (its Template MUST have the lookup index)
+ * \param[in]  pen   Private Enterprise Number
+ * \param[in]  id    Information Element ID
+ * \param[out] field Found field
+ * \return Index of the field or #FDS_EOC
+ */
+static inline int
+drec_find_indexed(struct fds_drec *rec, uint32_t pen, uint16_t id, struct fds_drec_field *field)
+{
+    const struct fds_template *tmplt = rec->tmplt;
+    const struct fds_tfield *field_def = fds_template_cfind(tmplt, pen, id);
+    if (!field_def) {
+        return FDS_EOC;
+    }
+
+    const uint16_t idx = (uint16_t) (field_def - tmplt->fields);
+    uint16_t offset = field_def->offset;
+    if (offset == FDS_IPFIX_VAR_IE_LEN) {
+        offset = drec_offset_dynamic(rec, idx);
+    }
+
+    field->size = drec_field_decode(rec->data, field_def->length, &offset);
+    field->data = &rec->data[offset];
+    field->info = field_def;
+    return idx;
+}
+
 int
 fds_drec_find(struct fds_drec *rec, uint32_t pen, uint16_t id, struct fds_drec_field *field)
 {
+    if (rec->tmplt->index.table != NULL) {
+        return drec_find_indexed(rec, pen, id, field);
+    }
+
     const uint16_t fields_cnt = rec->tmplt->fields_cnt_total;
     uint8_t *rec_start = rec->data;
 
@@ -100,6 +223,73 @@ fds_drec_find(struct fds_drec *rec, uint32_t pen, uint16_t id, struct fds_drec_f
     return idx;
 }
 
+int
+fds_drec_index(const struct fds_drec *rec, struct fds_drec_offsets *out)
+{
+    const struct fds_template *tmplt = rec->tmplt;
+    const uint16_t fields_cnt = tmplt->fields_cnt_total;
+    const uint16_t cnt = (fields_cnt < FDS_DREC_OFFSETS_MAX) ? fields_cnt : FDS_DREC_OFFSETS_MAX;
+    const uint8_t *rec_start = rec->data;
+    const uint32_t rec_size = rec->size;
+    uint32_t offset = 0;
+
+    for (uint16_t idx = 0; idx < cnt; ++idx) {
+        uint16_t field_size = tmplt->fields[idx].length;
+
+        if (field_size == FDS_IPFIX_VAR_IE_LEN) {
+            // This is field with variable length encoding -> read size from data
+            if (offset + 1U > rec_size) {
+                return FDS_ERR_FORMAT;
+            }
+
+            field_size = rec_start[offset];
+            offset++;
+
+            if (field_size == 255U) {
+                // Real size is on next 2 bytes
+                if (offset + 2U > rec_size) {
+                    return FDS_ERR_FORMAT;
+                }
+
+                field_size = ntohs(*(const uint16_t *) &rec_start[offset]);
+                offset += 2U;
+            }
+        }
+
+        if (offset + field_size > rec_size) {
+            return FDS_ERR_FORMAT;
+        }
+
+        out->fields[idx].offset = (uint16_t) offset;
+        out->fields[idx].size = field_size;
+        offset += field_size;
+    }
+
+    out->data = rec->data;
+    out->tmplt = tmplt;
+    out->cnt = cnt;
+    out->next = (uint16_t) offset;
+    return FDS_OK;
+}
+
+int
+fds_drec_find_indexed(struct fds_drec *rec, const struct fds_drec_offsets *offs, uint32_t pen,
+    uint16_t id, struct fds_drec_field *field)
+{
+    assert(offs->data == rec->data && offs->tmplt == rec->tmplt && "Offsets of another record");
+    const struct fds_tfield *field_def = fds_template_cfind(rec->tmplt, pen, id);
+    if (!field_def) {
+        return FDS_EOC;
+    }
+
+    const uint16_t idx = (uint16_t) (field_def - rec->tmplt->fields);
+    uint16_t offset;
+    drec_offsets_get(rec, offs, idx, &offset, &field->size);
+    field->data = &rec->data[offset];
+    field->info = field_def;
+    return idx;
+}
+
 void
 fds_drec_iter_init(struct fds_drec_iter *iter, struct fds_drec *record, uint16_t flags)
 {
@@ -115,18 +305,157 @@ fds_drec_iter_init(struct fds_drec_iter *iter, struct fds_drec *record, uint16_t
     // Both direction flags (forward + reverse) cannot be set together
     assert((flags & mask) != mask);
 
+    const struct fds_template *tmplt = record->tmplt;
     iter->_private.rec = record;
+    iter->_private.offs = NULL;
+    iter->_private.view = NULL;
+    iter->_private.view_cnt = 0;
+    iter->_private.view_pos = 0;
     iter->_private.next_offset = 0;
     iter->_private.next_idx = 0;
     iter->_private.flags = flags;
     if ((flags & FDS_DREC_BIFLOW_REV) == 0) {
         // Use forward fields
-        iter->_private.fields = record->tmplt->fields;
+        iter->_private.fields = tmplt->fields;
     } else {
         // Use reverse fields
-        iter->_private.fields = record->tmplt->fields_rev;
+        iter->_private.fields = tmplt->fields_rev;
         assert(iter->_private.fields != NULL);
     }
+
+    const uint16_t view_mask = FDS_DREC_REVERSE_SKIP | FDS_DREC_PADDING_SHOW;
+    if ((flags & view_mask) == FDS_DREC_REVERSE_SKIP && tmplt->index.views != NULL
+            && (tmplt->flags & FDS_TEMPLATE_BIFLOW) != 0) {
+        // Visit only fields of the precomputed view of the selected direction
+        if ((flags & FDS_DREC_BIFLOW_REV) == 0) {
+            iter->_private.view = tmplt->index.views;
+            iter->_private.view_cnt = tmplt->index.view_fwd_cnt;
+        } else {
+            iter->_private.view = tmplt->index.views + tmplt->index.view_fwd_cnt;
+            iter->_private.view_cnt = tmplt->index.view_rev_cnt;
+        }
+    }
+}
+
+/**
+ * \brief Get position of a field in the record of an iterator
+ *
+ * If a table of per-record offsets is attached to the iterator (see fds_drec_iter_offsets()),
+ * the position is taken from the table. Otherwise, fields with known offset are located using
+ * the Template (see fds_tfield#offset) and for the other fields only lengths of fields between
+ * the closest known position (i.e. the next field of the iterator or the first variable-length
+ * field) and the required field are decoded.
+ * \param[in]  iter   Pointer to the iterator
+ * \param[in]  idx    Index of the field (must not be lower than the index of the next field)
+ * \param[out] offset Offset of the field data
+ * \param[out] size   Real length of the field
+ */
+static inline void
+drec_iter_locate(const struct fds_drec_iter *iter, uint16_t idx, uint16_t *offset,
+    uint16_t *size)
+{
+    const struct fds_drec *rec = iter->_private.rec;
+    if (iter->_private.offs != NULL) {
+        drec_offsets_get(rec, iter->_private.offs, idx, offset, size);
+        return;
+    }
+
+    const struct fds_template *tmplt = rec->tmplt;
+    uint16_t pos = tmplt->fields[idx].offset;
+    if (pos == FDS_IPFIX_VAR_IE_LEN) {
+        // Decode lengths of skipped fields (from the first one with known offset)
+        uint16_t i = iter->_private.next_idx;
+        pos = iter->_private.next_offset;
+        if (i <= tmplt->index.dyn_start) {
+            i = tmplt->index.dyn_start;
+            pos = tmplt->fields[i].offset;
+        }
+
+        for (; i < idx; ++i) {
+            const uint16_t field_size = drec_field_decode(rec->data, tmplt->fields[i].length, &pos);
+            pos += field_size;
+        }
+    }
+
+    *size = drec_field_decode(rec->data, tmplt->fields[idx].length, &pos);
+    *offset = pos;
+}
+
+/**
+ * \brief Update the position of an iterator in its view of Biflow fields
+ *
+ * The next field of the view will be the first one behind the current field.
+ * \param[in,out] iter Pointer to the iterator (with a view)
+ */
+static inline void
+drec_iter_view_sync(struct fds_drec_iter *iter)
+{
+    const uint16_t *view = iter->_private.view;
+    const uint16_t next_idx = iter->_private.next_idx;
+    // Indexes in the view are sorted
+    uint16_t low = 0;
+    uint16_t high = iter->_private.view_cnt;
+    while (low < high) {
+        const uint16_t mid = low + (high - low) / 2U;
+        if (view[mid] < next_idx) {
+            low = mid + 1U;
+        } else {
+            high = mid;
+        }
+    }
+
+    iter->_private.view_pos = low;
+}
+
+/**
+ * \brief Get the next field in the view of Biflow fields of an iterator
+ * \param[in,out] iter Pointer to the iterator (with a view)
+ * \return Index of the field in the record or #FDS_EOC
+ */
+static int
+drec_iter_view_next(struct fds_drec_iter *iter)
+{
+    const struct fds_drec *rec = iter->_private.rec;
+    const struct fds_template *tmplt = rec->tmplt;
+    const bool unknown_skip = (iter->_private.flags & FDS_DREC_UNKNOWN_SKIP) != 0;
+
+    uint16_t pos = iter->_private.view_pos;
+    for (; pos < iter->_private.view_cnt; ++pos) {
+        const uint16_t idx = iter->_private.view[pos];
+        const struct fds_tfield *field_def = &iter->_private.fields[idx];
+        if (unknown_skip && field_def->def == NULL) {
+            continue;
+        }
+
+        // Determine the start of the field and its real length
+        uint16_t offset;
+        uint16_t field_size;
+        drec_iter_locate(iter, idx, &offset, &field_size);
+
+        iter->_private.view_pos = pos + 1U;
+        iter->_private.next_idx = idx + 1U;
+        iter->_private.next_offset = offset + field_size;
+        iter->field.data = &rec->data[offset];
+        iter->field.size = field_size;
+        iter->field.info = field_def;
+        return idx;
+    }
+
+    iter->_private.view_pos = pos;
+    iter->_private.next_idx = tmplt->fields_cnt_total;
+    return FDS_EOC;
+}
+
+int
+fds_drec_iter_offsets(struct fds_drec_iter *iter, const struct fds_drec_offsets *offs)
+{
+    const struct fds_drec *rec = iter->_private.rec;
+    if (offs->data != rec->data || offs->tmplt != rec->tmplt) {
+        return FDS_ERR_ARG;
+    }
+
+    iter->_private.offs = offs;
+    return FDS_OK;
 }
 
 void
@@ -134,11 +463,16 @@ fds_drec_iter_rewind(struct fds_drec_iter *iter)
 {
     iter->_private.next_offset = 0;
     iter->_private.next_idx = 0;
+    iter->_private.view_pos = 0;
 }
 
 int
 fds_drec_iter_next(struct fds_drec_iter *iter)
 {
+    if (iter->_private.view != NULL) {
+        return drec_iter_view_next(iter);
+    }
+
     const uint16_t fields_cnt = iter->_private.rec->tmplt->fields_cnt_total;
     uint8_t *rec_start = iter->_private.rec->data;
 
@@ -146,6 +480,8 @@ fds_drec_iter_next(struct fds_drec_iter *iter)
     uint16_t field_size;
     const struct fds_tfield *field_def;
 
+    const struct fds_drec_offsets *offs = iter->_private.offs;
+
     uint16_t idx;
     for (idx = iter->_private.next_idx; idx < fields_cnt; ++idx) {
         // Determine the start of the field and its real length
@@ -153,7 +489,11 @@ fds_drec_iter_next(struct fds_drec_iter *iter)
         field_def = &iter->_private.fields[idx];
         field_size = field_def->length;
 
-        if (field_size == FDS_IPFIX_VAR_IE_LEN) {
+        if (offs != NULL && idx < offs->cnt) {
+            // Use the table of per-record offsets
+            offset = offs->fields[idx].offset;
+            field_size = offs->fields[idx].size;
+        } else if (field_size == FDS_IPFIX_VAR_IE_LEN) {
             // This is field with variable length encoding -> read size from data
             field_size = rec_start[offset];
             offset++;
@@ -209,8 +549,13 @@ fds_drec_iter_next(struct fds_drec_iter *iter)
     return idx;
 }
 
-int
-fds_drec_iter_find(struct fds_drec_iter *iter, uint32_t pen, uint16_t id)
+/**
+ * \brief Find a field in the record (see fds_drec_iter_find())
+ *
+ * The position of the iterator in its view of Biflow fields is not updated.
+ */
+static int
+drec_iter_find(struct fds_drec_iter *iter, uint32_t pen, uint16_t id)
 {
     const uint16_t fields_cnt = iter->_private.rec->tmplt->fields_cnt_total;
     uint8_t *rec_start = iter->_private.rec->data;
@@ -219,6 +564,30 @@ fds_drec_iter_find(struct fds_drec_iter *iter, uint32_t pen, uint16_t id)
     uint16_t field_size;
     const struct fds_tfield *field_def;
 
+    const struct fds_drec_offsets *offs = iter->_private.offs;
+    const struct fds_template *tmplt = iter->_private.rec->tmplt;
+    if (iter->_private.fields == tmplt->fields && tmplt->index.table != NULL) {
+        // Jump directly to the first occurrence of the field (if not already passed)
+        field_def = fds_template_cfind(tmplt, pen, id);
+        if (field_def == NULL) {
+            iter->_private.next_idx = fields_cnt;
+            return FDS_EOC;
+        }
+
+        const uint16_t idx_first = (uint16_t) (field_def - tmplt->fields);
+        if (idx_first >= iter->_private.next_idx) {
+            drec_iter_locate(iter, idx_first, &offset, &field_size);
+            iter->_private.next_idx = idx_first + 1U;
+            iter->_private.next_offset = offset + field_size;
+            iter->field.data = &rec_start[offset];
+            iter->field.size = field_size;
+            iter->field.info = field_def;
+            return idx_first;
+        }
+
+        // Another occurrence of the field might follow
+    }
+
     uint16_t idx;
     for (idx = iter->_private.next_idx; idx < fields_cnt; ++idx) {
         // Determine the start of the field and its real length
@@ -226,7 +595,11 @@ fds_drec_iter_find(struct fds_drec_iter *iter, uint32_t pen, uint16_t id)
         field_def = &iter->_private.fields[idx];
         field_size = field_def->length;
 
-        if (field_size == FDS_IPFIX_VAR_IE_LEN) {
+        if (offs != NULL && idx < offs->cnt) {
+            // Use the table of per-record offsets
+            offset = offs->fields[idx].offset;
+            field_size = offs->fields[idx].size;
+        } else if (field_size == FDS_IPFIX_VAR_IE_LEN) {
             // This is field with variable length encoding -> read size from data
             field_size = rec_start[offset];
             offset++;
@@ -259,3 +632,136 @@ fds_drec_iter_find(struct fds_drec_iter *iter, uint32_t pen, uint16_t id)
     iter->field.info = field_def;
     return idx;
 }
+
+int
+fds_drec_iter_find(struct fds_drec_iter *iter, uint32_t pen, uint16_t id)
+{
+    int ret = drec_iter_find(iter, pen, id);
+    if (iter->_private.view != NULL) {
+        drec_iter_view_sync(iter);
+    }
+    return ret;
+}
+
+void
+fds_drec_accessor_init(struct fds_drec_accessor *acc, uint32_t pen, uint16_t id, uint16_t flags)
+{
+    static const uint16_t mask = FDS_DREC_BIFLOW_FWD | FDS_DREC_BIFLOW_REV;
+    // Both direction flags (forward + reverse) cannot be set together
+    assert((flags & mask) != mask);
+
+    acc->_private.pen = pen;
+    acc->_private.id = id;
+    acc->_private.flags = flags & mask;
+    acc->_private.replace = 0;
+
+    for (unsigned int i = 0; i < FDS_DREC_ACCESSOR_CACHE; ++i) {
+        // Unused entries always lead to the slow path
+        struct fds_drec_accessor_entry *entry = &acc->_private.cache[i];
+        entry->uid = 0;
+        entry->idx = 0;
+        entry->offset = FDS_DREC_ACCESSOR_DYNAMIC;
+        entry->size = 0;
+        entry->rev = 0;
+    }
+}
+
+/**
+ * \brief Resolve position of the field of a field accessor in a Template
+ * \param[in]  acc   Field accessor
+ * \param[in]  tmplt Template
+ * \param[out] entry Cache entry to fill
+ */
+static void
+drec_accessor_resolve(const struct fds_drec_accessor *acc, const struct fds_template *tmplt,
+    struct fds_drec_accessor_entry *entry)
+{
+    const uint32_t pen = acc->_private.pen;
+    const uint16_t id = acc->_private.id;
+    const bool rev = (acc->_private.flags & FDS_DREC_BIFLOW_REV) != 0
+        && (tmplt->flags & FDS_TEMPLATE_BIFLOW) != 0;
+    const struct fds_tfield *field_def = NULL;
+
+    if (!rev) {
+        field_def = fds_template_cfind(tmplt, pen, id);
+    } else {
+        // Reverse fields are not part of the lookup index
+        const uint16_t fields_cnt = tmplt->fields_cnt_total;
+        for (uint16_t i = 0; i < fields_cnt; ++i) {
+            if (tmplt->fields_rev[i].id == id && tmplt->fields_rev[i].en == pen) {
+                field_def = &tmplt->fields_rev[i];
+                break;
+            }
+        }
+    }
+
+    entry->uid = tmplt->index.uid;
+    entry->rev = rev;
+    entry->offset = FDS_DREC_ACCESSOR_DYNAMIC;
+    entry->size = 0;
+    if (!field_def) {
+        entry->idx = FDS_DREC_ACCESSOR_MISSING;
+        return;
+    }
+
+    // Both views of the fields share positions in the record
+    entry->idx = (uint16_t) (field_def - (rev ? tmplt->fields_rev : tmplt->fields));
+    const struct fds_tfield *field_pos = &tmplt->fields[entry->idx];
+    if (field_pos->offset != FDS_IPFIX_VAR_IE_LEN && field_pos->length != FDS_IPFIX_VAR_IE_LEN) {
+        entry->offset = field_pos->offset;
+        entry->size = field_pos->length;
+    }
+}
+
+int
+fds_drec_accessor_find(struct fds_drec_accessor *acc, struct fds_drec *rec,
+    const struct fds_drec_offsets *offs, struct fds_drec_field *field)
+{
+    const struct fds_template *tmplt = rec->tmplt;
+    const uint64_t uid = tmplt->index.uid;
+    const struct fds_drec_accessor_entry *entry = NULL;
+    struct fds_drec_accessor_entry entry_tmp;
+
+    if (uid != 0) {
+        // Is the Template among the recently seen Templates?
+        for (unsigned int i = 0; i < FDS_DREC_ACCESSOR_CACHE; ++i) {
+            if (acc->_private.cache[i].uid == uid) {
+                entry = &acc->_private.cache[i];
+                break;
+            }
+        }
+    }
+
+    if (!entry) {
+        // Resolve the field and replace the oldest entry (Templates without uid are not cached)
+        drec_accessor_resolve(acc, tmplt, &entry_tmp);
+        if (uid != 0) {
+            acc->_private.cache[acc->_private.replace] = entry_tmp;
+            acc->_private.replace = (acc->_private.replace + 1U) % FDS_DREC_ACCESSOR_CACHE;
+        }
+        entry = &entry_tmp;
+    }
+
+    if (entry->idx == FDS_DREC_ACCESSOR_MISSING) {
+        return FDS_EOC;
+    }
+
+    const uint16_t idx = entry->idx;
+    uint16_t offset = entry->offset;
+    if (offset != FDS_DREC_ACCESSOR_DYNAMIC) {
+        field->size = entry->size;
+    } else if (offs != NULL) {
+        assert(offs->data == rec->data && offs->tmplt == tmplt && "Offsets of another record");
+        drec_offsets_get(rec, offs, idx, &offset, &field->size);
+    } else {
+        offset = tmplt->fields[idx].offset;
+        if (offset == FDS_IPFIX_VAR_IE_LEN) {
+            offset = drec_offset_dynamic(rec, idx);
+        }
+        field->size = drec_field_decode(rec->data, tmplt->fields[idx].length, &offset);
+    }
+
+    field->data = &rec->data[offset];
+    field->info = (entry->rev ? tmplt->fields_rev : tmplt->fields) + idx;
+    return idx;
+}
@@ -0,0 +1,442 @@
+/**
+ * \file src/drec/shape.c
+ * \author agent <agent@local>
+ * \brief Decoder of Data Records into user-defined structures (source file)
+ * \date October 2026
+ *
+ * Copyright(c) 2026 CESNET z.s.p.o.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <libfds.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <endian.h>    // be64toh
+#include <arpa/inet.h> // ntohs, ntohl
+
+/** Number of compiled shapes (i.e. recently seen Templates) remembered by a decoder          */
+#define SHAPE_CACHE 4
+
+/** Operation of a compiled shape                                                            */
+enum shape_op_kind {
+    /** Copy 1 byte                                                                          */
+    SHAPE_OP_COPY8,
+    /** Swap byte order of 2 bytes (integer of the same size as the member)                  */
+    SHAPE_OP_SWAP16,
+    /** Swap byte order of 4 bytes (integer or float of the same size as the member)         */
+    SHAPE_OP_SWAP32,
+    /** Swap byte order of 8 bytes (integer or double of the same size as the member)        */
+    SHAPE_OP_SWAP64,
+    /** Copy raw bytes                                                                       */
+    SHAPE_OP_BYTES,
+    /** Generic conversion (the field and the member have different sizes)                  */
+    SHAPE_OP_CONVERT,
+    /** Position of the field depends on content of the record                              */
+    SHAPE_OP_DYNAMIC
+};
+
+/** Operation of a compiled shape (one per member present in the Template)                  */
+struct shape_op {
+    /** Offset of the member in the structure                                                */
+    uint32_t dst;
+    /** Offset of the field in the record (undefined for ::SHAPE_OP_DYNAMIC)                 */
+    uint16_t src;
+    /** Number of bytes to read from the record (undefined for ::SHAPE_OP_DYNAMIC)           */
+    uint16_t size;
+    /** Index of the member                                                                  */
+    uint16_t member;
+    /** Kind of the operation (see #shape_op_kind)                                           */
+    uint16_t kind;
+};
+
+/** Shape compiled for a Template                                                           */
+struct shape_compiled {
+    /** Identifier of the Template (0 = unused, see fds_template_index#uid)                  */
+    uint64_t uid;
+    /** Operations (the capacity is the number of members)                                   */
+    struct shape_op *ops;
+    /** Number of operations                                                                 */
+    uint16_t ops_cnt;
+    /** Minimal size of a record to perform operations with fixed positions                 */
+    uint16_t rec_min;
+    /** At least one operation is ::SHAPE_OP_DYNAMIC                                         */
+    bool dynamic;
+};
+
+struct fds_drec_shape {
+    /** Members of the structure                                                             */
+    struct fds_shape_member *members;
+    /** Field accessors of the members (used for fields with variable position)             */
+    struct fds_drec_accessor *accessors;
+    /** Number of members                                                                    */
+    uint16_t members_cnt;
+    /** Size of the structure                                                                */
+    size_t struct_size;
+    /** Recently compiled shapes                                                             */
+    struct shape_compiled cache[SHAPE_CACHE];
+    /** Index of the shape to replace                                                        */
+    unsigned int replace;
+};
+
+int
+fds_drec_shape_create(fds_drec_shape_t **shape, const struct fds_shape_member *members,
+    size_t members_cnt, size_t struct_size)
+{
+    if (members_cnt > UINT16_MAX || struct_size > UINT32_MAX) {
+        return FDS_ERR_ARG;
+    }
+
+    for (size_t i = 0; i < members_cnt; ++i) {
+        const struct fds_shape_member *member = &members[i];
+        if (member->size == 0 || member->offset + member->size > struct_size) {
+            return FDS_ERR_ARG;
+        }
+
+        const size_t size = member->size;
+        bool valid;
+        switch (member->conv) {
+        case FDS_SHAPE_UINT:
+        case FDS_SHAPE_INT:
+            valid = (size == 1U || size == 2U || size == 4U || size == 8U);
+            break;
+        case FDS_SHAPE_FLOAT:
+            valid = (size == sizeof(float) || size == sizeof(double));
+            break;
+        case FDS_SHAPE_BYTES:
+            valid = (size <= UINT16_MAX);
+            break;
+        default:
+            valid = false;
+            break;
+        }
+
+        if (!valid) {
+            return FDS_ERR_ARG;
+        }
+    }
+
+    fds_drec_shape_t *res = calloc(1, sizeof(*res));
+    if (!res) {
+        return FDS_ERR_NOMEM;
+    }
+
+    // Allocate at least one item, so NULL always represents an allocation error
+    const size_t alloc_cnt = (members_cnt > 0) ? members_cnt : 1U;
+    res->members = malloc(alloc_cnt * sizeof(*res->members));
+    res->accessors = malloc(alloc_cnt * sizeof(*res->accessors));
+    bool failed = (!res->members || !res->accessors);
+    for (unsigned int i = 0; !failed && i < SHAPE_CACHE; ++i) {
+        res->cache[i].ops = malloc(alloc_cnt * sizeof(*res->cache[i].ops));
+        failed = (res->cache[i].ops == NULL);
+    }
+
+    if (failed) {
+        fds_drec_shape_destroy(res);
+        return FDS_ERR_NOMEM;
+    }
+
+    for (size_t i = 0; i < members_cnt; ++i) {
+        res->members[i] = members[i];
+        fds_drec_accessor_init(&res->accessors[i], members[i].pen, members[i].id, members[i].flags);
+    }
+
+    res->members_cnt = (uint16_t) members_cnt;
+    res->struct_size = struct_size;
+    *shape = res;
+    return FDS_OK;
+}
+
+void
+fds_drec_shape_destroy(fds_drec_shape_t *shape)
+{
+    if (!shape) {
+        return;
+    }
+
+    for (unsigned int i = 0; i < SHAPE_CACHE; ++i) {
+        free(shape->cache[i].ops);
+    }
+
+    free(shape->accessors);
+    free(shape->members);
+    free(shape);
+}
+
+/**
+ * \brief Find the first occurrence of a field of a member in a Template
+ * \param[in] tmplt  Template
+ * \param[in] member Member
+ * \return Index of the field or -1 (not found)
+ */
+static int
+shape_field_find(const struct fds_template *tmplt, const struct fds_shape_member *member)
+{
+    const bool rev = (member->flags & FDS_DREC_BIFLOW_REV) != 0
+        && (tmplt->flags & FDS_TEMPLATE_BIFLOW) != 0;
+    if (!rev) {
+        const struct fds_tfield *field = fds_template_cfind(tmplt, member->pen, member->id);
+        return (field != NULL) ? (int) (field - tmplt->fields) : -1;
+    }
+
+    // Reverse fields are not part of the lookup index (both views share positions)
+    for (uint16_t i = 0; i < tmplt->fields_cnt_total; ++i) {
+        const struct fds_tfield *field = &tmplt->fields_rev[i];
+        if (field->id == member->id && field->en == member->pen) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * \brief Compile a shape for a Template
+ * \param[in]  shape    Decoder
+ * \param[in]  tmplt    Template
+ * \param[out] compiled Compiled shape to fill
+ */
+static void
+shape_compile(const fds_drec_shape_t *shape, const struct fds_template *tmplt,
+    struct shape_compiled *compiled)
+{
+    compiled->uid = tmplt->index.uid;
+    compiled->ops_cnt = 0;
+    compiled->rec_min = 0;
+    compiled->dynamic = false;
+
+    for (uint16_t i = 0; i < shape->members_cnt; ++i) {
+        const struct fds_shape_member *member = &shape->members[i];
+        const int idx = shape_field_find(tmplt, member);
+        if (idx < 0) {
+            // Missing field (the member stays zeroed)
+            continue;
+        }
+
+        struct shape_op *op = &compiled->ops[compiled->ops_cnt++];
+        const struct fds_tfield *field = &tmplt->fields[idx];
+        op->dst = (uint32_t) member->offset;
+        op->member = i;
+
+        if (field->offset == FDS_IPFIX_VAR_IE_LEN || field->length == FDS_IPFIX_VAR_IE_LEN) {
+            op->kind = SHAPE_OP_DYNAMIC;
+            op->src = 0;
+            op->size = 0;
+            compiled->dynamic = true;
+            continue;
+        }
+
+        op->src = field->offset;
+        op->size = field->length;
+        if (member->conv == FDS_SHAPE_BYTES) {
+            op->kind = SHAPE_OP_BYTES;
+            op->size = (field->length < member->size) ? field->length : (uint16_t) member->size;
+        } else if (field->length != member->size) {
+            op->kind = SHAPE_OP_CONVERT;
+        } else {
+            switch (member->size) {
+            case 1:
+                op->kind = SHAPE_OP_COPY8;
+                break;
+            case 2:
+                op->kind = SHAPE_OP_SWAP16;
+                break;
+            case 4:
+                op->kind = SHAPE_OP_SWAP32;
+                break;
+            default:
+                assert(member->size == 8U);
+                op->kind = SHAPE_OP_SWAP64;
+                break;
+            }
+        }
+
+        // Total length of fields with fixed position fits into 16 bits
+        const uint16_t field_end = (uint16_t) (field->offset + field->length);
+        if (field_end > compiled->rec_min) {
+            compiled->rec_min = field_end;
+        }
+    }
+}
+
+/**
+ * \brief Store an unsigned integer into a member (with saturation)
+ * \param[out] dst   Member
+ * \param[in]  size  Size of the member
+ * \param[in]  value Value to store
+ */
+static void
+shape_store_uint(uint8_t *dst, size_t size, uint64_t value)
+{
+    switch (size) {
+    case 1: {
+        const uint8_t res = (value > UINT8_MAX) ? UINT8_MAX : (uint8_t) value;
+        memcpy(dst, &res, sizeof(res));
+        } break;
+    case 2: {
+        const uint16_t res = (value > UINT16_MAX) ? UINT16_MAX : (uint16_t) value;
+        memcpy(dst, &res, sizeof(res));
+        } break;
+    case 4: {
+        const uint32_t res = (value > UINT32_MAX) ? UINT32_MAX : (uint32_t) value;
+        memcpy(dst, &res, sizeof(res));
+        } break;
+    default:
+        memcpy(dst, &value, sizeof(value));
+        break;
+    }
+}
+
+/**
+ * \brief Store a signed integer into a member (with saturation)
+ * \param[out] dst   Member
+ * \param[in]  size  Size of the member
+ * \param[in]  value Value to store
+ */
+static void
+shape_store_int(uint8_t *dst, size_t size, int64_t value)
+{
+    switch (size) {
+    case 1: {
+        const int8_t res = (value > INT8_MAX) ? INT8_MAX : ((value < INT8_MIN) ? INT8_MIN : value);
+        memcpy(dst, &res, sizeof(res));
+        } break;
+    case 2: {
+        const int16_t res = (value > INT16_MAX) ? INT16_MAX
+            : ((value < INT16_MIN) ? INT16_MIN : value);
+        memcpy(dst, &res, sizeof(res));
+        } break;
+    case 4: {
+        const int32_t res = (value > INT32_MAX) ? INT32_MAX
+            : ((value < INT32_MIN) ? INT32_MIN : value);
+        memcpy(dst, &res, sizeof(res));
+        } break;
+    default:
+        memcpy(dst, &value, sizeof(value));
+        break;
+    }
+}
+
+/**
+ * \brief Convert a field into a member (generic version)
+ *
+ * If the value cannot be converted, the member is not modified.
+ * \param[in]  member Member description
+ * \param[in]  data   Field data
+ * \param[in]  size   Real length of the field
+ * \param[out] dst    Member in the structure
+ */
+static void
+shape_convert(const struct fds_shape_member *member, const uint8_t *data, uint16_t size,
+    uint8_t *dst)
+{
+    switch (member->conv) {
+    case FDS_SHAPE_UINT: {
+        uint64_t value;
+        if (fds_get_uint_be(data, size, &value) == FDS_OK) {
+            shape_store_uint(dst, member->size, value);
+        }
+        } break;
+    case FDS_SHAPE_INT: {
+        int64_t value;
+        if (fds_get_int_be(data, size, &value) == FDS_OK) {
+            shape_store_int(dst, member->size, value);
+        }
+        } break;
+    case FDS_SHAPE_FLOAT: {
+        double value;
+        if (fds_get_float_be(data, size, &value) != FDS_OK) {
+            break;
+        }
+
+        if (member->size == sizeof(float)) {
+            const float res = (float) value;
+            memcpy(dst, &res, sizeof(res));
+        } else {
+            memcpy(dst, &value, sizeof(value));
+        }
+        } break;
+    case FDS_SHAPE_BYTES:
+        memcpy(dst, data, (size < member->size) ? size : member->size);
+        break;
+    }
+}
+
+int
+fds_drec_shape_decode(fds_drec_shape_t *shape, struct fds_drec *rec, void *dst)
+{
+    const struct fds_template *tmplt = rec->tmplt;
+    const uint64_t uid = tmplt->index.uid;
+    struct shape_compiled *compiled = NULL;
+
+    for (unsigned int i = 0; uid != 0 && i < SHAPE_CACHE; ++i) {
+        if (shape->cache[i].uid == uid) {
+            compiled = &shape->cache[i];
+            break;
+        }
+    }
+
+    if (!compiled) {
+        // Compile the shape and replace the oldest one (Templates without uid are not cached)
+        compiled = &shape->cache[shape->replace];
+        shape->replace = (shape->replace + 1U) % SHAPE_CACHE;
+        shape_compile(shape, tmplt, compiled);
+    }
+
+    uint8_t *out = dst;
+    memset(out, 0, shape->struct_size);
+    if (rec->size < compiled->rec_min) {
+        return FDS_ERR_FORMAT;
+    }
+
+    // Positions of fields behind variable-length fields are shared by all members
+    struct fds_drec_offsets offs;
+    if (compiled->dynamic && fds_drec_index(rec, &offs) != FDS_OK) {
+        return FDS_ERR_FORMAT;
+    }
+
+    const uint8_t *data = rec->data;
+    const struct shape_op *ops = compiled->ops;
+    const uint16_t ops_cnt = compiled->ops_cnt;
+    for (uint16_t i = 0; i < ops_cnt; ++i) {
+        const struct shape_op *op = &ops[i];
+        switch (op->kind) {
+        case SHAPE_OP_COPY8:
+            out[op->dst] = data[op->src];
+            break;
+        case SHAPE_OP_SWAP16: {
+            uint16_t value;
+            memcpy(&value, &data[op->src], sizeof(value));
+            value = ntohs(value);
+            memcpy(&out[op->dst], &value, sizeof(value));
+            } break;
+        case SHAPE_OP_SWAP32: {
+            uint32_t value;
+            memcpy(&value, &data[op->src], sizeof(value));
+            value = ntohl(value);
+            memcpy(&out[op->dst], &value, sizeof(value));
+            } break;
+        case SHAPE_OP_SWAP64: {
+            uint64_t value;
+            memcpy(&value, &data[op->src], sizeof(value));
+            value = be64toh(value);
+            memcpy(&out[op->dst], &value, sizeof(value));
+            } break;
+        case SHAPE_OP_BYTES:
+            memcpy(&out[op->dst], &data[op->src], op->size);
+            break;
+        case SHAPE_OP_CONVERT:
+            shape_convert(&shape->members[op->member], &data[op->src], op->size, &out[op->dst]);
+            break;
+        case SHAPE_OP_DYNAMIC: {
+            struct fds_drec_field field;
+            struct fds_drec_accessor *acc = &shape->accessors[op->member];
+            if (fds_drec_accessor_find(acc, rec, &offs, &field) != FDS_EOC) {
+                shape_convert(&shape->members[op->member], field.data, field.size, &out[op->dst]);
+            }
+            } break;
+        }
+    }
+
+    return FDS_OK;
+}
@@ -8,6 +8,9 @@
  * SPDX-License-Identifier: BSD-3-Clause
  */
 
+#include <algorithm>
+#include <cstring>
+
 #include <libfds.h>
 #include <fds_lz4.h>
 #include <fds_zstd.h>
@@ -38,12 +41,8 @@ Block_data_reader::Block_data_reader(enum fds_file_alg comp_alg)
         throw File_exception(FDS_ERR_INTERNAL, "Unknown type of compression algorithm");
     }
 
-    // Allocate buffers
+    // Buffers are borrowed from the process-wide pool only when a Data Block is loaded
     m_alloc = alloc_size;
-    m_buffer_main.reset(new uint8_t[m_alloc]);
-    if (comp_alg != FDS_FILE_CALG_NONE) {
-        m_buffer_aux.reset(new uint8_t[m_alloc]);
-    }
 }
 
 Block_data_reader::~Block_data_reader()
@@ -59,8 +58,14 @@ Block_data_reader::~Block_data_reader()
 }
 
 void
-Block_data_reader::load_from_file(int fd, off_t offset, size_t size_hint, Io_factory::Type type)
+Block_data_reader::load_from_file(int fd, off_t offset, size_t size_hint, Io_factory::Type type,
+    size_t align)
 {
+    assert(align <= DIRECT_ALIGN_MAX && (align & (align - 1)) == 0 && "Invalid alignment");
+    if (align != 0 && size_hint == 0) {
+        throw File_exception(FDS_ERR_INTERNAL, "Direct I/O read of a Data Block requires its size");
+    }
+
     if (size_hint > m_alloc) {
         throw File_exception(FDS_ERR_INTERNAL, "Invalid hint size of a Data Block to read");
     }
@@ -93,15 +98,50 @@ Block_data_reader::load_from_file(int fd, off_t offset, size_t size_hint, Io_fac
     // Make sure that any previous I/O is not running (the buffer cannot be used by multiple I/Os)
     m_io_request.reset();
 
+    if (m_buffer_main == nullptr) {
+        // Borrow a buffer from the process-wide pool (with a reserve for aligned direct I/O)
+        m_buffer_main = Buffer_pool::instance().get(m_alloc + 2 * DIRECT_ALIGN_MAX);
+    }
+
+    // Direct I/O requires the offset and size aligned to the logical block size of the storage
+    off_t io_offset = offset;
+    size_t io_size = size2load;
+    m_io_shift = 0;
+    if (align != 0) {
+        io_offset = offset & ~static_cast<off_t>(align - 1);
+        m_io_shift = static_cast<size_t>(offset - io_offset);
+        io_size = (m_io_shift + size2load + align - 1) & ~(align - 1);
+    }
+
     // Create a new I/O request and initialize read
-    auto new_io = Io_factory::new_request(fd, m_buffer_main.get(), m_alloc, type);
-    new_io->read(offset, size2load);
+    const size_t buffer_size = m_buffer_main.get_deleter().size();
+    auto new_io = Io_factory::new_request(fd, m_buffer_main.get(), buffer_size, type);
+    new_io->read(io_offset, io_size);
 
     m_io_request = std::move(new_io);
     m_io_size = size2load;
     m_read = 0; // Nothing is ready yet
 }
 
+void
+Block_data_reader::release()
+{
+    if (m_io_request) {
+        m_io_request->cancel();
+        m_io_request.reset();
+    }
+
+    m_read = 0;
+    m_iters_ready = false;
+    m_msg_next = nullptr;
+    m_msg_end = nullptr;
+    m_tsnap = nullptr;
+
+    // Return the buffers to the pool
+    m_buffer_main.reset();
+    m_buffer_aux.reset();
+}
+
 void
 Block_data_reader::set_templates(const fds_tsnapshot_t *snap)
 {
@@ -239,6 +279,13 @@ Block_data_reader::data_loader()
     size_t ret_size = m_io_request->wait();
     m_io_request.reset(); // Remove the request
 
+    if (m_io_shift != 0 || ret_size > m_io_size) {
+        // Aligned direct I/O -> remove the extra bytes before and after the requested block
+        ret_size = (ret_size > m_io_shift) ? std::min(ret_size - m_io_shift, m_io_size) : 0;
+        memmove(m_buffer_main.get(), &m_buffer_main[m_io_shift], ret_size);
+        m_io_shift = 0;
+    }
+
     if (ret_size != m_io_size && ret_size != m_io_size - FDS_FILE_BHDR_SIZE) {
         throw File_exception(FDS_ERR_INTERNAL, "read() failed to load a Data Block");
     }
@@ -310,9 +357,12 @@ Block_data_reader::decompress()
 {
     assert(m_read >= FDS_FILE_BDATA_HDR_SIZE && "The main buffer must not be empty");
     assert(m_calg != FDS_FILE_CALG_NONE && "Compression algorithm must be selected");
-    assert(m_buffer_aux != nullptr && "Decompression buffer must exist");
     size_t ret_val = FDS_FILE_BDATA_HDR_SIZE; // Uncompressed Data Block header
 
+    if (m_buffer_aux == nullptr) {
+        m_buffer_aux = Buffer_pool::instance().get(m_alloc + 2 * DIRECT_ALIGN_MAX);
+    }
+
     // First, copy the Data Block header (always uncompressed)
     memcpy(m_buffer_aux.get(), m_buffer_main.get(), FDS_FILE_BDATA_HDR_SIZE);
 
@@ -348,6 +398,7 @@ Block_data_reader::decompress()
     }
 
     m_buffer_main.swap(m_buffer_aux); // Swap buffers
+    m_buffer_aux.reset(); // The compressed block is not needed anymore, return it to the pool
     m_read = ret_val;
 }
 
@@ -15,6 +15,7 @@
 #include <memory>
 
 #include "structure.h"
+#include "Buffer_pool.hpp"
 #include "Io_request.hpp"
 #include "Block_templates.hpp"
 
@@ -35,6 +36,9 @@ namespace fds_file {
  */
 class Block_data_reader {
 public:
+    /// Maximum supported direct I/O alignment (in bytes)
+    static constexpr size_t DIRECT_ALIGN_MAX = 4096;
+
     /**
      * @brief Class constructor
      * @param[in] comp_alg Compression algorithm
@@ -67,14 +71,32 @@ public:
      * @warning
      *   If the hint size is specified but doesn't match the real size of the block, load will fail.
      *
+     * If the direct I/O alignment (@p align) is non-zero, the file descriptor is expected to be
+     * opened with O_DIRECT flag. The read request is extended to the aligned boundaries and
+     * the Data Block is moved to the beginning of the buffer after the I/O is complete. In this
+     * case, the size hint MUST be defined.
+     *
      * @param[in] fd        File descriptor (must be opened for reading)
      * @param[in] offset    Offset in the file where the start of the Data Block is placed
      * @param[in] size_hint Size of the Data Block to load (if unknown, set to 0)
      * @param[in] type      Type of I/O operation used for reading (sync./async./default)
+     * @param[in] align     Direct I/O alignment (power of 2 up to #DIRECT_ALIGN_MAX) or 0
      */
     void
     load_from_file(int fd, off_t offset, size_t size_hint = 0,
-        Io_factory::Type type = Io_factory::Type::IO_DEFAULT);
+        Io_factory::Type type = Io_factory::Type::IO_DEFAULT, size_t align = 0);
+
+    /**
+     * @brief Release the loaded Data Block
+     *
+     * Any I/O in progress is canceled and buffers are returned to the process-wide pool (see
+     * Buffer_pool). The instance doesn't hold any memory of Data Blocks until the next
+     * load_from_file().
+     * @warning
+     *   All Data Records previously returned by next_rec() are invalidated.
+     */
+    void
+    release();
 
     /**
      * @brief Get the header of the loaded Data Block
@@ -164,10 +186,10 @@ private:
     struct fds_file_read_ctx m_ctx;
     /// Number of bytes that be been read from a file (i.e. valid size of the main buffer)
     size_t m_read = 0;
-    /// Buffer with loaded (uncompressed) Data Block
-    std::unique_ptr<uint8_t[]> m_buffer_main = nullptr;
-    /// Auxiliary buffer for decompression
-    std::unique_ptr<uint8_t[]> m_buffer_aux = nullptr;
+    /// Buffer with loaded (uncompressed) Data Block (nullptr == not loaded)
+    Buffer_pool::Buffer m_buffer_main = nullptr;
+    /// Auxiliary buffer for decompression (held only during decompression)
+    Buffer_pool::Buffer m_buffer_aux = nullptr;
 
     /// Pointer to the next IPFIX Message in the order
     uint8_t *m_msg_next = nullptr;
@@ -188,6 +210,8 @@ private:
     std::unique_ptr<Io_request> m_io_request = nullptr;
     /// Size of the requested block (valid only if m_io_request is not nullptr)
     size_t m_io_size;
+    /// Offset of the requested block in the buffer due to direct I/O alignment (usually 0)
+    size_t m_io_shift = 0;
 
     /// Common Block header of the following block
     struct fds_file_bhdr m_next_hdr;
@@ -10,6 +10,9 @@
 
 #include <cassert>
 
+#include <fcntl.h>  // posix_fadvise, sync_file_range
+#include <unistd.h> // fdatasync
+
 #include <libfds.h>
 #include <fds_lz4.h>
 #include <fds_zstd.h>
@@ -20,8 +23,9 @@
 
 using namespace fds_file;
 
-Block_data_writer::Block_data_writer(uint32_t odid, enum fds_file_alg comp_alg, uint16_t msg_size)
-    : m_odid(odid), m_calg(comp_alg), m_size_max(msg_size)
+Block_data_writer::Block_data_writer(uint32_t odid, enum fds_file_alg comp_alg, uint16_t msg_size,
+        int comp_level)
+    : m_odid(odid), m_calg(comp_alg), m_clevel(comp_level), m_size_max(msg_size)
 {
     // Calculate buffer size big enough for compression of not compressible data
     size_t alloc_size = FDS_FILE_BDATA_HDR_SIZE;
@@ -40,14 +44,8 @@ Block_data_writer::Block_data_writer(uint32_t odid, enum fds_file_alg comp_alg,
         throw File_exception(FDS_ERR_INTERNAL, "Unknown type of compression algorithm");
     }
 
-    // Allocate buffers
+    // Buffers are borrowed from the process-wide pool only when a Data Block is being filled
     m_alloc = alloc_size;
-    m_buffer_main.reset(new uint8_t[m_alloc]);
-    if (comp_alg != FDS_FILE_CALG_NONE) {
-        m_buffer_comp.reset(new uint8_t[m_alloc]);
-    }
-
-    // Initialize Data Block header on the top of the buffer
     reset_buffer();
 }
 
@@ -71,6 +69,11 @@ Block_data_writer::add(const uint8_t *data, uint16_t size, const struct fds_temp
         throw File_exception(FDS_ERR_FORMAT, "Size of the Data Record doesn't match its Template");
     }
 
+    if (m_prepared != 0) {
+        throw File_exception(FDS_ERR_INTERNAL, "Unable to add a Data Record while a prepared Data "
+            "Block hasn't been written yet");
+    }
+
     // Check if there is enough space in the buffer (for the worst case scenario)
     if (size > remains()) {
         throw File_exception(FDS_ERR_INTERNAL, "Unable to store the Data Record due to full buffer");
@@ -81,6 +84,11 @@ Block_data_writer::add(const uint8_t *data, uint16_t size, const struct fds_temp
         throw File_exception(FDS_ERR_FORMAT, "The Data Record exceeds the maximum allowed size");
     }
 
+    if (m_buffer_main == nullptr) {
+        // The first Data Record of the Data Block
+        buffer_borrow();
+    }
+
     /*
      * Check if a new IPFIX Message should be create (and the old one closed).
      * - Export time has been changed
@@ -147,7 +155,23 @@ uint64_t
 Block_data_writer::write_to_file(int fd, off_t offset, uint16_t sid, uint64_t off_btmplt,
     Io_factory::Type type)
 {
-    uint64_t result;
+    uint64_t result = write_prepare(sid, off_btmplt);
+    if (result == 0) {
+        // Nothing to do
+        return 0;
+    }
+
+    write_prepared(fd, offset, type);
+    return result;
+}
+
+uint64_t
+Block_data_writer::write_prepare(uint16_t sid, uint64_t off_btmplt)
+{
+    if (m_prepared != 0) {
+        throw File_exception(FDS_ERR_INTERNAL, "The Data Block has been already prepared");
+    }
+
     if (m_written <= FDS_FILE_BDATA_HDR_SIZE) {
         // Nothing to do
         return 0;
@@ -175,18 +199,35 @@ Block_data_writer::write_to_file(int fd, off_t offset, uint16_t sid, uint64_t of
         // Update the Data Block header (in the compression buffer) to contain correct block size
         auto block_ptr = reinterpret_cast<struct fds_file_bdata *>(m_buffer_comp.get());
         block_ptr->hdr.length = htole64(comp_size);
-        // Store the block
-        store(fd, offset, m_buffer_comp, comp_size, type);
-        result = comp_size;
+        m_prepared = comp_size;
+    } else {
+        // The content of the main buffer is ready
+        m_prepared = m_written;
+    }
+
+    return m_prepared;
+}
+
+void
+Block_data_writer::write_prepared(int fd, off_t offset, Io_factory::Type type)
+{
+    if (m_prepared == 0) {
+        throw File_exception(FDS_ERR_INTERNAL, "No Data Block has been prepared");
+    }
+
+    if (m_calg != FDS_FILE_CALG_NONE) {
+        // Store the compressed block
+        store(fd, offset, m_buffer_comp, m_prepared, type);
     } else {
         // Just store the content of the main buffer to the file
-        store(fd, offset, m_buffer_main, m_written, type);
-        result = m_written;
+        store(fd, offset, m_buffer_main, m_prepared, type);
     }
 
-    // Initialize Data Block header on the top of the main buffer (and reset position variables)
+    // Return the buffers of the written block to the pool (and reset position variables)
+    m_buffer_main.reset();
+    m_buffer_comp.reset();
+    m_prepared = 0;
     reset_buffer();
-    return result;
 }
 
 /**
@@ -201,9 +242,12 @@ Block_data_writer::compress()
 {
     assert(m_written > FDS_FILE_BDATA_HDR_SIZE && "The block must contain useful data");
     assert(m_calg != FDS_FILE_CALG_NONE && "Compression algorithm must be selected");
-    assert(m_buffer_comp != nullptr && "Compression buffer must exist");
     size_t ret_val = FDS_FILE_BDATA_HDR_SIZE; // Uncompressed Data Block header
 
+    if (m_buffer_comp == nullptr) {
+        m_buffer_comp = Buffer_pool::instance().get(m_alloc);
+    }
+
     // First, copy the Data Block header (always uncompressed)
     memcpy(m_buffer_comp.get(), m_buffer_main.get(), FDS_FILE_BDATA_HDR_SIZE);
 
@@ -230,7 +274,11 @@ Block_data_writer::compress()
     } else if (m_calg == FDS_FILE_CALG_ZSTD) {
         // ZSTD compression
         assert(size_out >= ZSTD_compressBound(size_in) && "Non optimal output buffer size");
-        size_t rc = ZSTD_compress(ptr_out, size_out, ptr_in, size_in, 1); // Fastest possible level
+        int level = 1; // Fastest possible level
+        if (m_clevel > level) {
+            level = (m_clevel < ZSTD_maxCLevel()) ? m_clevel : ZSTD_maxCLevel();
+        }
+        size_t rc = ZSTD_compress(ptr_out, size_out, ptr_in, size_in, level);
         if (ZSTD_isError(rc)) {
             const char *err_msg = ZSTD_getErrorName(rc);
             throw File_exception(FDS_ERR_INTERNAL, "ZSTD failed to compress a Data Block ("
@@ -253,8 +301,8 @@ Block_data_writer::compress()
  * (@p src_buffer) without any limitation (i.e. it can be overwritten with new content).
  *
  * @note
- *   If asynchronous I/O operation has been started, then source buffer (@p src_buffer) and
- *   internal asynchronous buffer are transparently swapped.
+ *   If asynchronous I/O operation has been started, then the source buffer (@p src_buffer) is
+ *   moved to the internal asynchronous buffer and returned to the pool by write_wait().
  * @note
  *   Synchronous I/O operations are performed immediately without any delay.
  * @param[in] fd           File descriptor
@@ -264,7 +312,7 @@ Block_data_writer::compress()
  * @param[in] io_type      Type of I/O operation to use (synchronous vs. asynchronous)
  */
 void
-Block_data_writer::store(int fd, off_t offset, std::unique_ptr<uint8_t[]> &src_buffer, size_t src_size,
+Block_data_writer::store(int fd, off_t offset, Buffer_pool::Buffer &src_buffer, size_t src_size,
     Io_factory::Type io_type)
 {
     // First, wait for the previous asynchronous I/O operation to complete
@@ -282,29 +330,26 @@ Block_data_writer::store(int fd, off_t offset, std::unique_ptr<uint8_t[]> &src_b
         }
 
         // Everything is done
+        cache_drop(fd, offset, src_size);
         return;
     }
 
-    // Asynchronous I/O only -> store the I/O instance and swap buffers
-    if (m_buffer_async == nullptr) {
-        // The asynchronous buffer hasn't been allocated yet
-        m_buffer_async.reset(new uint8_t[m_alloc]);
-    }
-
+    // Asynchronous I/O only -> store the I/O instance and keep the buffer until it's complete
     m_async_io = std::move(new_req);
     m_async_size = src_size;
-    src_buffer.swap(m_buffer_async); // Swap buffers now
+    m_async_fd = fd;
+    m_async_offset = offset;
+    m_buffer_async = std::move(src_buffer);
 }
 
 /**
- * @brief Initialize FDS Data block header in the main buffer
- *
- * After calling this function, the block is considered as empty i.e. all position variables
- * are reset to point right behind the block header.
+ * @brief Borrow the main buffer from the pool and initialize FDS Data block header in it
  */
 void
-Block_data_writer::reset_buffer()
+Block_data_writer::buffer_borrow()
 {
+    m_buffer_main = Buffer_pool::instance().get(m_alloc);
+
     // Common message header (length will be filled before writing to a file)
     auto ptr = reinterpret_cast<struct fds_file_bdata *>(m_buffer_main.get());
     ptr->hdr.type = htole16(FDS_FILE_BTYPE_DATA);
@@ -313,7 +358,17 @@ Block_data_writer::reset_buffer()
     // Data Block header (Session ID + Template Block offset will be filled during writing)
     ptr->odid = htole32(m_odid);
     ptr->flags = htole16(0);
+}
 
+/**
+ * @brief Reset position variables of the main buffer
+ *
+ * After calling this function, the block is considered as empty i.e. all position variables
+ * are reset to point right behind the block header.
+ */
+void
+Block_data_writer::reset_buffer()
+{
     // Reset position variables
     m_written = FDS_FILE_BDATA_HDR_SIZE;
     m_pos_msg = m_written;
@@ -400,4 +455,33 @@ Block_data_writer::write_wait()
     }
 
     m_async_io.reset();
+    m_buffer_async.reset(); // Return the buffer to the pool
+    cache_drop(m_async_fd, m_async_offset, m_async_size);
+}
+
+/**
+ * @brief Flush a written Data Block to the storage and drop it from the page cache
+ *
+ * Only performed if enabled by set_nocache(). Dirty pages cannot be dropped from the page cache,
+ * so the range is written back first. Both operations are only hints, therefore, failures
+ * are ignored.
+ * @param[in] fd     File descriptor
+ * @param[in] offset Offset of the Data Block in the file
+ * @param[in] size   Size of the Data Block
+ */
+void
+Block_data_writer::cache_drop(int fd, off_t offset, size_t size)
+{
+    if (!m_nocache) {
+        return;
+    }
+
+#ifdef SYNC_FILE_RANGE_WRITE
+    const unsigned int flags = SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE
+        | SYNC_FILE_RANGE_WAIT_AFTER;
+    sync_file_range(fd, offset, static_cast<off_t>(size), flags);
+#else
+    fdatasync(fd);
+#endif
+    posix_fadvise(fd, offset, static_cast<off_t>(size), POSIX_FADV_DONTNEED);
 }
@@ -11,6 +11,7 @@
 #ifndef LIBFDS_BLOCK_DATA_WRITER_HPP
 #define LIBFDS_BLOCK_DATA_WRITER_HPP
 
+#include "Buffer_pool.hpp"
 #include "Io_request.hpp"
 #include "structure.h"
 
@@ -26,11 +27,17 @@ namespace fds_file {
  * The Data Block can contain Data Records based on different IPFIX (Options) Templates. All of
  * these Templates MUST have a unique Template ID. In other words, there MUST NOT be Data Records
  * based on different Templates with the same Template ID.
+ *
+ * Buffers are borrowed from the process-wide pool (see Buffer_pool) when the first Data Record
+ * of a Data Block is added and returned as soon as the block is written, i.e. an empty writer
+ * doesn't hold any buffer.
  */
 class Block_data_writer {
 public:
     /// Default maximum IPFIX Message size
     static const uint16_t MSG_DEF_SIZE = 1400;
+    /// Default compression level (i.e. the fastest level of the selected algorithm)
+    static const int CLEVEL_DEF = 0;
 
     /**
      * @brief Class constructor
@@ -39,11 +46,17 @@ public:
      *   The maximum IPFIX Message size (@p msg_size) is ignored if a size of a Data Record
      *   that is added exceeds the maximum size.
      *
-     * @param[in] odid     Observation Domain ID (common for all Data Records to be added)
-     * @param[in] comp_alg Compression algorithm (used during writing to the file)
-     * @param[in] msg_size Maximum IPFIX message size
+     * @note
+     *   The compression level (@p comp_level) is applicable only to ZSTD. Values greater than
+     *   the maximum level supported by the library are silently truncated.
+     *
+     * @param[in] odid       Observation Domain ID (common for all Data Records to be added)
+     * @param[in] comp_alg   Compression algorithm (used during writing to the file)
+     * @param[in] msg_size   Maximum IPFIX message size
+     * @param[in] comp_level Compression level (#CLEVEL_DEF for the fastest compression)
      */
-    Block_data_writer(uint32_t odid, enum fds_file_alg comp_alg, uint16_t msg_size = MSG_DEF_SIZE);
+    Block_data_writer(uint32_t odid, enum fds_file_alg comp_alg, uint16_t msg_size = MSG_DEF_SIZE,
+        int comp_level = CLEVEL_DEF);
     /**
      * @brief Class destructor
      *
@@ -81,6 +94,38 @@ public:
     write_to_file(int fd, off_t offset, uint16_t sid, uint64_t off_btmplt,
         Io_factory::Type type = Io_factory::Type::IO_DEFAULT);
 
+    /**
+     * @brief Finalize and (if enabled) compress all added IPFIX Data Records as a Data block
+     *
+     * This is the first half of write_to_file() that doesn't require knowledge of the position
+     * of the block in the file. It is useful when multiple writers share the same output file,
+     * because the expensive compression can be performed before the file space is reserved.
+     * The prepared block MUST be written using write_prepared() before any other Data Record is
+     * added.
+     *
+     * @param[in] sid        Internal Transport Session ID
+     * @param[in] off_btmplt Offset of the Template block in the file used to decode this Data block
+     *   (MUST be placed before this block in the file!)
+     * @return Size of the prepared block (in bytes, can be 0 i.e. no records = nothing to write).
+     * @throw File_exception if compression fails
+     */
+    uint64_t
+    write_prepare(uint16_t sid, uint64_t off_btmplt);
+
+    /**
+     * @brief Write the Data block previously prepared by write_prepare() to a file
+     *
+     * @note
+     *   If the previous asynchronous write is still in progress, the function waits for the
+     *   operation to complete before the next operation is started.
+     * @param[in] fd     File descriptor (must be opened for writing)
+     * @param[in] offset Offset in the file where the Data block will be placed
+     * @param[in] type   Type of I/O operation used for writing (sync./async./default)
+     * @throw File_exception if no block has been prepared or the writing operation fails
+     */
+    void
+    write_prepared(int fd, off_t offset, Io_factory::Type type = Io_factory::Type::IO_DEFAULT);
+
     /**
      * @brief Set Export Time
      *
@@ -92,6 +137,18 @@ public:
     void
     set_etime(uint32_t time) {m_etime_set = time;};
 
+    /**
+     * @brief Drop written Data Blocks from the page cache
+     *
+     * If enabled, each Data Block is flushed to the storage as soon as its write operation is
+     * complete and its pages are dropped from the page cache. It is useful for writing large files
+     * that are not going to be read again soon. By default, the page cache is used as usual.
+     *
+     * @param[in] enable Enable/disable
+     */
+    void
+    set_nocache(bool enable) {m_nocache = enable;};
+
     /**
      * @brief Add a Data Record
      *
@@ -163,6 +220,8 @@ private:
     uint32_t m_odid;
     /// Selected compression algorithm
     enum fds_file_alg m_calg;
+    /// Selected compression level
+    int m_clevel;
     /// Maximum size of an IPFIX Message
     uint16_t m_size_max;
 
@@ -172,18 +231,26 @@ private:
     uint32_t m_written = 0;
     /// Total number of Data Records in the unwritten buffer
     uint32_t m_rec_cnt = 0;
+    /// Size of the block prepared by write_prepare() (0 == not prepared)
+    size_t m_prepared = 0;
 
-    /// Main buffer used for adding new Data Records
-    std::unique_ptr<uint8_t[]> m_buffer_main = nullptr;
+    /// Main buffer used for adding new Data Records (nullptr == the block is empty)
+    Buffer_pool::Buffer m_buffer_main = nullptr;
     /// Compression buffer (i.e. compressed version of the Data block for writing)
-    std::unique_ptr<uint8_t[]> m_buffer_comp = nullptr;
-    /// Buffer for asynchronous write operations (cannot be changed when I/O is in progress)
-    std::unique_ptr<uint8_t[]> m_buffer_async = nullptr;
+    Buffer_pool::Buffer m_buffer_comp = nullptr;
+    /// Buffer of the asynchronous write operation (cannot be changed when I/O is in progress)
+    Buffer_pool::Buffer m_buffer_async = nullptr;
 
     /// Asynchronous write I/O request
     std::unique_ptr<Io_request> m_async_io = nullptr;
     /// Size of asynchronously requested block (valid only if m_async_io is not nullptr)
     size_t m_async_size;
+    /// File descriptor of asynchronously requested block (valid only if m_async_io is not nullptr)
+    int m_async_fd;
+    /// Offset of asynchronously requested block (valid only if m_async_io is not nullptr)
+    off_t m_async_offset;
+    /// Drop written Data Blocks from the page cache
+    bool m_nocache = false;
 
     /// The selected export time (of the next Data Record)
     uint32_t m_etime_set = 0;
@@ -201,6 +268,9 @@ private:
     // Calculate real length of an IPFIX Data Record
     int
     rec_length(const uint8_t *data, uint16_t *size, const struct fds_template *tmplt);
+    // Borrow the main buffer and initialize the Data Block header
+    void
+    buffer_borrow();
     // Reset content of the main buffer
     void
     reset_buffer();
@@ -209,8 +279,10 @@ private:
     compress();
     // Store a content of a buffer to a file
     void
-    store(int fd, off_t offset, std::unique_ptr<uint8_t[]> &src_buffer, size_t src_size,
+    store(int fd, off_t offset, Buffer_pool::Buffer &src_buffer, size_t src_size,
         Io_factory::Type io_type = Io_factory::Type::IO_DEFAULT);
+    void
+    cache_drop(int fd, off_t offset, size_t size);
 };
 
 } // namespace
@@ -39,9 +39,13 @@ Block_templates::Block_templates() : m_tmgr(nullptr, &fds_tmgr_destroy)
 uint64_t
 Block_templates::load_from_file(int fd, off_t offset, uint16_t *sid, uint32_t *odid)
 {
-    // Remove all IPFIX (Options) Templates
-    clear();
+    std::vector<uint8_t> buffer = read_from_file(fd, offset);
+    return load_from_buffer(buffer.data(), buffer.size(), sid, odid);
+}
 
+std::vector<uint8_t>
+Block_templates::read_from_file(int fd, off_t offset)
+{
     // Determine size of the block
     struct fds_file_bhdr block_hdr;
     constexpr size_t block_hdr_size = sizeof(block_hdr);
@@ -58,22 +62,39 @@ Block_templates::load_from_file(int fd, off_t offset, uint16_t *sid, uint32_t *o
     }
 
     const size_t msg_hdr_size = offsetof(struct fds_file_btmplt, recs);
-    const size_t rec_hdr_size = offsetof(struct fds_file_trec, data);
     uint64_t bsize = le64toh(block_hdr.length);
     if (bsize < msg_hdr_size) {
         throw File_exception(FDS_ERR_INTERNAL, "The block size is too small");
     }
 
     // Read the whole Template block into a buffer
-    std::unique_ptr<uint8_t[]> buffer(new uint8_t[bsize]);
-    Io_sync block_reader(fd, buffer.get(), bsize);
+    std::vector<uint8_t> buffer(bsize);
+    Io_sync block_reader(fd, buffer.data(), bsize);
     block_reader.read(offset, bsize);
     if (block_reader.wait() != bsize) {
         throw File_exception(FDS_ERR_INTERNAL, "read() failed to load the whole block");
     }
 
+    return buffer;
+}
+
+uint64_t
+Block_templates::load_from_buffer(const uint8_t *data, uint64_t size, uint16_t *sid,
+    uint32_t *odid)
+{
+    // Remove all IPFIX (Options) Templates
+    clear();
+
+    const size_t msg_hdr_size = offsetof(struct fds_file_btmplt, recs);
+    const size_t rec_hdr_size = offsetof(struct fds_file_trec, data);
+    auto block_ptr = reinterpret_cast<const fds_file_btmplt *>(data);
+    if (size < msg_hdr_size || le16toh(block_ptr->hdr.type) != FDS_FILE_BTYPE_TMPLTS
+            || le64toh(block_ptr->hdr.length) != size) {
+        throw File_exception(FDS_ERR_INTERNAL, "Invalid Template Block header");
+    }
+    const uint64_t bsize = size;
+
     // Fill ODID and Transport Session ID
-    auto block_ptr = reinterpret_cast<fds_file_btmplt *>(buffer.get());
     if (sid) {
         *sid = le16toh(block_ptr->session_id);
     }
@@ -82,12 +103,12 @@ Block_templates::load_from_file(int fd, off_t offset, uint16_t *sid, uint32_t *o
     }
 
     // Process all IPFIX (Options) Templates
-    uint8_t *block_rec_pos = &buffer[msg_hdr_size];
-    const uint8_t *block_end = &buffer[bsize];
+    const uint8_t *block_rec_pos = &data[msg_hdr_size];
+    const uint8_t *block_end = &data[bsize];
 
     while (block_rec_pos + rec_hdr_size <= block_end) {
         // Parse the record header
-        auto rec_ptr = reinterpret_cast<fds_file_trec *>(block_rec_pos);
+        auto rec_ptr = reinterpret_cast<const fds_file_trec *>(block_rec_pos);
         uint16_t trec_type = le16toh(rec_ptr->type);
         uint16_t trec_size = le16toh(rec_ptr->length);
 
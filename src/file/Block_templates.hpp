@@ -14,6 +14,7 @@
 #include <cstdint>
 #include <memory>
 #include <set>
+#include <vector>
 #include <libfds.h>
 #include "File_base.hpp"
 
@@ -66,6 +67,32 @@ public:
     uint64_t
     load_from_file(int fd, off_t offset, uint16_t *sid = nullptr, uint32_t *odid = nullptr);
 
+    /**
+     * @brief Load IPFIX (Options) Templates from a Template Block in a buffer
+     *
+     * @warning
+     *   All IPFIX (Options) Template stored in the manager will be replaced or removed.
+     * @param[in]  data Template Block (including the Common Block header)
+     * @param[in]  size Size of the Template Block
+     * @param[out] sid  Extracted Internal Transport Session ID (can be nullptr)
+     * @param[out] odid Extracted Observation domain ID (ODID) (can be nullptr)
+     * @return Size of the block (in bytes)
+     * @throw File_exception if the block is malformed and the object is in an undefined state.
+     */
+    uint64_t
+    load_from_buffer(const uint8_t *data, uint64_t size, uint16_t *sid = nullptr,
+        uint32_t *odid = nullptr);
+
+    /**
+     * @brief Read a raw Template Block from a file (without parsing)
+     * @param[in] fd     File descriptor (must be opened for reading)
+     * @param[in] offset Offset in the file where the start of the Template Block is placed
+     * @return The whole Template Block (including the Common Block header)
+     * @throw File_exception if the block cannot be read or it is not a Template Block
+     */
+    static std::vector<uint8_t>
+    read_from_file(int fd, off_t offset);
+
     /**
      * @brief Write all IPFIX (Options) Templates as a Template Block to a file
      *
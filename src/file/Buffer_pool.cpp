@@ -0,0 +1,196 @@
+/**
+ * @file   src/file/Buffer_pool.cpp
+ * @brief  Process-wide pool of Data Block buffers (source file)
+ * @author agent <agent@local>
+ * @date   October 2026
+ *
+ * Copyright(c) 2026 CESNET z.s.p.o.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <cerrno>
+#include <cstdlib>
+#include <iterator>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <libfds.h>
+#include "Buffer_pool.hpp"
+#include "File_exception.hpp"
+
+using namespace fds_file;
+
+/// Size of a huge page (the most common one)
+static constexpr size_t HUGEPAGE_SIZE = 2U * 1024U * 1024U;
+/// Allocation granularity (buffers of readers and writers slightly differ in size)
+static constexpr size_t ALLOC_GRANULARITY = 64U * 1024U;
+
+void
+Buffer_pool::Deleter::operator()(uint8_t *ptr) const
+{
+    if (!ptr) {
+        return;
+    }
+
+    Buffer_pool::instance().put(ptr, m_size, m_mapped);
+}
+
+Buffer_pool &
+Buffer_pool::instance()
+{
+    // The instance is never destroyed, so buffers of static objects can be returned at exit
+    static Buffer_pool *pool = new Buffer_pool();
+    return *pool;
+}
+
+Buffer_pool::Buffer
+Buffer_pool::get(size_t size)
+{
+    bool hugepages;
+    size = ((size + ALLOC_GRANULARITY - 1) / ALLOC_GRANULARITY) * ALLOC_GRANULARITY;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // Prefer the most recently returned buffer (it is probably still in CPU caches)
+        for (auto it = m_idle.rbegin(); it != m_idle.rend(); ++it) {
+            if (it->size != size) {
+                continue;
+            }
+
+            struct idle_rec rec = *it;
+            m_idle.erase(std::next(it).base());
+            m_idle_size -= rec.size;
+            m_borrowed_size += rec.size;
+            return Buffer(rec.ptr, Deleter(rec.size, rec.mapped));
+        }
+
+        hugepages = m_hugepages;
+    }
+
+    Buffer buffer = alloc(size, hugepages);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_borrowed_size += size;
+    return buffer;
+}
+
+/**
+ * @brief Allocate a new buffer
+ * @param[in] size      Size of the buffer (already rounded to the allocation granularity)
+ * @param[in] hugepages Back the buffer by huge pages
+ * @return The buffer
+ * @throw File_exception if memory allocation fails
+ */
+Buffer_pool::Buffer
+Buffer_pool::alloc(size_t size, bool hugepages)
+{
+
+    // Allocate a new buffer
+    if (hugepages) {
+        const size_t map_size = ((size + HUGEPAGE_SIZE - 1) / HUGEPAGE_SIZE) * HUGEPAGE_SIZE;
+        const int prot = PROT_READ | PROT_WRITE;
+        const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+        void *ptr = MAP_FAILED;
+#ifdef MAP_HUGETLB
+        ptr = mmap(nullptr, map_size, prot, flags | MAP_HUGETLB, -1, 0);
+#endif
+        if (ptr == MAP_FAILED) {
+            // Explicit huge pages are not available, try transparent huge pages
+            ptr = mmap(nullptr, map_size, prot, flags, -1, 0);
+            if (ptr == MAP_FAILED) {
+                File_exception::throw_errno(errno, "mmap() failed");
+            }
+#ifdef MADV_HUGEPAGE
+            madvise(ptr, map_size, MADV_HUGEPAGE); // Only a hint, failure is not fatal
+#endif
+        }
+
+        return Buffer(static_cast<uint8_t *>(ptr), Deleter(size, true));
+    }
+
+    void *ptr;
+    const size_t align = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    if (posix_memalign(&ptr, align, size) != 0) {
+        throw File_exception(FDS_ERR_NOMEM, "Failed to allocate a Data Block buffer");
+    }
+
+    return Buffer(static_cast<uint8_t *>(ptr), Deleter(size, false));
+}
+
+void
+Buffer_pool::configure(size_t idle_max, bool hugepages)
+{
+    std::vector<struct idle_rec> to_release;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_idle_max = idle_max;
+        m_hugepages = hugepages;
+
+        while (m_idle_size > m_idle_max) {
+            // Release the oldest buffers first
+            to_release.push_back(m_idle.front());
+            m_idle_size -= m_idle.front().size;
+            m_idle.erase(m_idle.begin());
+        }
+    }
+
+    for (const struct idle_rec &rec : to_release) {
+        release(rec.ptr, rec.size, rec.mapped);
+    }
+}
+
+size_t
+Buffer_pool::idle_size()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_idle_size;
+}
+
+size_t
+Buffer_pool::borrowed_size()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_borrowed_size;
+}
+
+/**
+ * @brief Return a buffer back to the pool
+ *
+ * If the limit of idle buffers would be exceeded, the buffer is immediately released.
+ * @param[in] ptr    Pointer to the buffer
+ * @param[in] size   Size of the buffer
+ * @param[in] mapped The buffer has been allocated using mmap()
+ */
+void
+Buffer_pool::put(uint8_t *ptr, size_t size, bool mapped)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_borrowed_size -= size;
+        if (m_idle_size + size <= m_idle_max) {
+            m_idle.push_back({ptr, size, mapped});
+            m_idle_size += size;
+            return;
+        }
+    }
+
+    release(ptr, size, mapped);
+}
+
+/**
+ * @brief Free memory of a buffer
+ * @param[in] ptr    Pointer to the buffer
+ * @param[in] size   Size of the buffer
+ * @param[in] mapped The buffer has been allocated using mmap()
+ */
+void
+Buffer_pool::release(uint8_t *ptr, size_t size, bool mapped)
+{
+    if (!mapped) {
+        free(ptr);
+        return;
+    }
+
+    const size_t map_size = ((size + HUGEPAGE_SIZE - 1) / HUGEPAGE_SIZE) * HUGEPAGE_SIZE;
+    munmap(ptr, map_size);
+}
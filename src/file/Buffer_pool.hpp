@@ -0,0 +1,144 @@
+/**
+ * @file   src/file/Buffer_pool.hpp
+ * @brief  Process-wide pool of Data Block buffers (header file)
+ * @author agent <agent@local>
+ * @date   October 2026
+ *
+ * Copyright(c) 2026 CESNET z.s.p.o.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef LIBFDS_BUFFER_POOL_HPP
+#define LIBFDS_BUFFER_POOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <libfds/file.h>
+
+namespace fds_file {
+
+/**
+ * @brief Process-wide pool of large Data Block buffers
+ *
+ * Each Data Block reader and writer requires a few buffers, each of them big enough to hold
+ * a whole (compressed) Data Block, i.e. more than 1 MiB. Instead of allocating (and page
+ * faulting) new buffers for every Data Block, the buffers are borrowed from the pool only for
+ * the time a Data Block is being loaded/filled and processed, and returned to it right after.
+ * Idle readers and writers don't hold any buffer. Idle buffers are kept in the pool up to
+ * the configured limit, so the memory footprint of idle buffers is capped.
+ *
+ * Optionally, the buffers can be backed by huge pages. If explicit huge pages are not available,
+ * transparent huge pages are requested instead.
+ *
+ * All buffers are aligned to the page boundary.
+ * @note The class is thread-safe.
+ */
+class Buffer_pool {
+public:
+    /// Default maximum size of idle buffers kept in the pool (in bytes)
+    static constexpr size_t IDLE_MAX_DEF = FDS_FILE_BUFFERS_IDLE_DEF;
+
+    /// Deleter that returns a buffer back to the pool
+    class Deleter {
+    public:
+        Deleter() = default;
+        Deleter(size_t size, bool mapped) : m_size(size), m_mapped(mapped) {};
+
+        void
+        operator()(uint8_t *ptr) const;
+
+        /// Allocated size of the buffer
+        size_t
+        size() const {return m_size;};
+    private:
+        /// Allocated size of the buffer
+        size_t m_size = 0;
+        /// The buffer has been allocated using mmap()
+        bool m_mapped = false;
+    };
+
+    /// Borrowed buffer (automatically returned to the pool on destruction)
+    using Buffer = std::unique_ptr<uint8_t[], Deleter>;
+
+    /**
+     * @brief Get the process-wide instance of the pool
+     * @return Pool
+     */
+    static Buffer_pool &
+    instance();
+
+    /**
+     * @brief Borrow a buffer from the pool
+     *
+     * If there is no idle buffer of the requested size, a new one is allocated.
+     * @param[in] size Size of the buffer (in bytes, the buffer can be slightly bigger)
+     * @return The buffer
+     * @throw File_exception if memory allocation fails
+     */
+    Buffer
+    get(size_t size);
+
+    /**
+     * @brief Configure the pool
+     *
+     * Idle buffers that exceed the new limit are immediately released. The hugepage backing
+     * only applies to newly allocated buffers.
+     * @param[in] idle_max  Maximum size of idle buffers kept in the pool (in bytes)
+     * @param[in] hugepages Back new buffers by huge pages
+     */
+    void
+    configure(size_t idle_max, bool hugepages);
+
+    /// Total size of idle buffers in the pool (in bytes)
+    size_t
+    idle_size();
+    /// Total size of borrowed buffers, i.e. buffers in use (in bytes)
+    size_t
+    borrowed_size();
+
+private:
+    /// Idle buffer
+    struct idle_rec {
+        /// Pointer to the buffer
+        uint8_t *ptr;
+        /// Allocated size
+        size_t size;
+        /// The buffer has been allocated using mmap()
+        bool mapped;
+    };
+
+    Buffer_pool() = default;
+    ~Buffer_pool() = default;
+
+    // Disable copy constructors
+    Buffer_pool(const Buffer_pool &other) = delete;
+    Buffer_pool &operator=(const Buffer_pool &other) = delete;
+
+    /// Mutex protecting all members
+    std::mutex m_mutex;
+    /// Idle buffers
+    std::vector<struct idle_rec> m_idle;
+    /// Total size of idle buffers
+    size_t m_idle_size = 0;
+    /// Maximum size of idle buffers
+    size_t m_idle_max = IDLE_MAX_DEF;
+    /// Total size of borrowed buffers
+    size_t m_borrowed_size = 0;
+    /// Back new buffers by huge pages
+    bool m_hugepages = false;
+
+    static Buffer
+    alloc(size_t size, bool hugepages);
+    void
+    put(uint8_t *ptr, size_t size, bool mapped);
+    static void
+    release(uint8_t *ptr, size_t size, bool mapped);
+};
+
+} // namespace
+
+#endif // LIBFDS_BUFFER_POOL_HPP
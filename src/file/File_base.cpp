@@ -23,17 +23,13 @@
 using namespace fds_file;
 
 File_base::File_base(const char *path, int oflag, mode_t mode, fds_file_alg calg)
+    : File_base(calg)
 {
-    if (path == nullptr) {
-        throw File_exception(FDS_ERR_ARG, "Path specification cannot be nullptr!");
-    }
-
-    // Open/create the file
-    m_fd = open(path, oflag, mode);
-    if (m_fd < 0) {
-        File_exception::throw_errno(errno, "Failed to open the file");
-    }
+    file_open(path, oflag, mode);
+}
 
+File_base::File_base(fds_file_alg calg)
+{
     // Clear statistics and prepare default file header
     memset(&m_stats, 0, sizeof m_stats);
     memset(&m_file_hdr, 0, sizeof m_file_hdr);
@@ -45,9 +41,25 @@ File_base::File_base(const char *path, int oflag, mode_t mode, fds_file_alg calg
     m_file_hdr.table_offset = htole64(0);
 }
 
+void
+File_base::file_open(const char *path, int oflag, mode_t mode)
+{
+    if (path == nullptr) {
+        throw File_exception(FDS_ERR_ARG, "Path specification cannot be nullptr!");
+    }
+
+    // Open/create the file
+    m_fd = open(path, oflag, mode);
+    if (m_fd < 0) {
+        File_exception::throw_errno(errno, "Failed to open the file");
+    }
+}
+
 File_base::~File_base()
 {
-    close(m_fd);
+    if (m_fd >= 0) {
+        close(m_fd);
+    }
 }
 
 void
@@ -78,6 +90,18 @@ File_base::read_rec(struct fds_drec *rec, struct fds_file_read_ctx *ctx)
     not_impl_handler();
 }
 
+int
+File_base::read_scan(const char *filter, unsigned int threads, fds_file_scan_map_cb map_cb,
+    fds_file_scan_merge_cb merge_cb, void *user)
+{
+    (void) filter;
+    (void) threads;
+    (void) map_cb;
+    (void) merge_cb;
+    (void) user;
+    not_impl_handler();
+}
+
 fds_file_sid_t
 File_base::session_add(const struct fds_file_session *info)
 {
@@ -160,6 +160,22 @@ public:
     virtual int
     read_rec(struct fds_drec *rec, struct fds_file_read_ctx *ctx);
 
+    /**
+     * @brief Scan all Data Records of the file in parallel
+     *
+     * @see fds_file_scan()
+     * @param[in] filter   Filter expression (can be nullptr)
+     * @param[in] threads  Number of worker threads (0 == number of online processors)
+     * @param[in] map_cb   Callback called for each matching Data Record
+     * @param[in] merge_cb Callback called to merge a private accumulator (can be nullptr)
+     * @param[in] user     User data passed to the callbacks
+     * @return #FDS_OK on success or the first non-OK code returned by a callback
+     * @throw File_exception if the filter is invalid, the file is malformed or any parser fails
+     */
+    virtual int
+    read_scan(const char *filter, unsigned int threads, fds_file_scan_map_cb map_cb,
+        fds_file_scan_merge_cb merge_cb, void *user);
+
     /**
      * @brief Select context of writer operations (Transport Session, ODID, Export Time)
      * @see fds_file_write_ctx()
@@ -217,8 +233,26 @@ public:
     tmplt_get(uint16_t tid, enum fds_template_type *t_type, const uint8_t **t_data, uint16_t *t_size);
 
 protected:
-    /// File descriptor of the file
-    int m_fd;
+    /// File descriptor of the file (-1 == not opened yet)
+    int m_fd = -1;
+
+    /**
+     * @brief Base class constructor without opening the file
+     *
+     * The file must be opened later by the derived class using file_open(). This allows the
+     * derived class to check its other resources before the file is created (or truncated).
+     * @param[in] calg Selected compression algorithm
+     */
+    explicit File_base(fds_file_alg calg);
+    /**
+     * @brief Open or create the file
+     * @param[in] path  Path to the file
+     * @param[in] oflag Creation flags (read/write/append - see man 3 open)
+     * @param[in] mode  File mode bits applied when a new file is created
+     * @throw File_exception if the file cannot be opened or created.
+     */
+    void
+    file_open(const char *path, int oflag, mode_t mode = DEF_MODE);
 
     /**
      * @brief Update global statistics about Data Records in the file
@@ -232,6 +266,13 @@ protected:
     void
     stats_update(const uint8_t *rec_data, uint16_t rec_size, const struct fds_template *tmplt);
 
+    /**
+     * @brief Replace global statistics about Data Records in the file
+     * @param[in] stats New statistics
+     */
+    void
+    stats_set(const struct fds_file_stats *stats) {m_stats = *stats;};
+
     /**
      * @brief Load the content of the file header and global statistics from the file
      *
@@ -0,0 +1,341 @@
+/**
+ * @file   src/file/File_compactor.cpp
+ * @brief  File compactor (source file)
+ * @author agent <agent@local>
+ * @date   October 2026
+ *
+ * Copyright(c) 2026 CESNET z.s.p.o.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+
+#include <sys/stat.h>  // fstat, stat
+#include <sys/types.h> // lseek
+#include <unistd.h>    // lseek, lockf
+
+#include "Block_data_reader.hpp"
+#include "Block_session.hpp"
+#include "File_compactor.hpp"
+#include "File_exception.hpp"
+
+using namespace fds_file;
+
+File_compactor::File_compactor(const char *src, const char *dst, fds_file_alg calg, int clevel,
+        unsigned int threads, Io_factory::Type io_type)
+    : File_base(calg), m_src(src, io_type), m_calg(calg), m_clevel(clevel), m_threads(threads),
+      m_io_type(io_type), m_streams_next(0)
+{
+    // The source file has been opened and validated, create the destination file now
+    if (dst == nullptr) {
+        throw File_exception(FDS_ERR_ARG, "Path specification cannot be nullptr!");
+    }
+
+    // The source file MUST NOT be truncated as the destination file
+    struct stat st_src, st_dst;
+    if (fstat(m_src.m_fd, &st_src) == 0 && stat(dst, &st_dst) == 0
+            && st_src.st_dev == st_dst.st_dev && st_src.st_ino == st_dst.st_ino) {
+        throw File_exception(FDS_ERR_ARG, "The source and destination files must be different");
+    }
+
+    file_open(dst, File_base::CF_TRUNC, File_base::DEF_MODE);
+
+    // Lock the whole file for writing (only this process must be able to write to the file)
+    if (lseek(m_fd, 0, SEEK_SET) == -1) {
+        File_exception::throw_errno(errno, "lseek() failed");
+    }
+    if (lockf(m_fd, F_TLOCK, 0) != 0) {
+        File_exception::throw_errno(errno, "Unable to lock the file (it's probably being written "
+            "by another process)", FDS_ERR_DENIED);
+    }
+
+    if (m_threads == 0) {
+        // Note: The function can return 0 if the value is not computable
+        m_threads = std::thread::hardware_concurrency();
+        m_threads = (m_threads != 0) ? m_threads : 1U;
+    }
+
+    // Write the default file header to the file (the Content Table position is still undefined)
+    file_hdr_store();
+    m_offset = sizeof(struct fds_file_hdr);
+}
+
+void
+File_compactor::iemgr_set(const fds_iemgr_t *iemgr)
+{
+    // Definitions are only used by parsed Templates of worker threads
+    m_iemgr = iemgr;
+}
+
+const struct fds_file_session *
+File_compactor::session_get(fds_file_sid_t sid)
+{
+    // Internal Transport Session IDs are preserved
+    return m_src.session_get(sid);
+}
+
+void
+File_compactor::session_list(fds_file_sid_t **arr, size_t *size)
+{
+    File_base::session_list_from_ctable(m_ctable, arr, size);
+}
+
+void
+File_compactor::session_odids(fds_file_sid_t sid, uint32_t **arr, size_t *size)
+{
+    File_base::session_odids_from_ctable(m_ctable, sid, arr, size);
+}
+
+void
+File_compactor::run()
+{
+    const Block_content &src_ctable = m_src.m_ctable;
+
+    // Copy all Transport Session descriptions (internal IDs are preserved)
+    for (const struct Block_content::info_session &rec : src_ctable.get_sessions()) {
+        Block_session session(m_src.m_fd, rec.offset);
+        if (session.get_sid() != rec.session_id) {
+            throw File_exception(FDS_ERR_INTERNAL, "Content Table record of a Transport Session "
+                "description doesn't match its parameters (different internal IDs)");
+        }
+
+        uint64_t bsize = session.write_to_file(m_fd, m_offset);
+        m_ctable.add_session(m_offset, bsize, rec.session_id);
+        m_offset += bsize;
+    }
+
+    // Split Data Blocks into independent streams (i.e. Transport Session + ODID combinations)
+    std::map<std::pair<uint16_t, uint32_t>, size_t> stream_idx;
+    for (const struct Block_content::info_data_block &rec : src_ctable.get_data_blocks()) {
+        const auto key = std::make_pair(rec.session_id, rec.odid);
+        auto it = stream_idx.find(key);
+        if (it == stream_idx.end()) {
+            it = stream_idx.emplace(key, m_streams.size()).first;
+            m_streams.push_back({rec.session_id, rec.odid, {}});
+        }
+
+        m_streams[it->second].blocks.push_back(&rec);
+    }
+
+    // Process all streams
+    const size_t threads_cnt = std::min<size_t>(m_threads, m_streams.size());
+    m_streams_next = 0;
+
+    if (threads_cnt <= 1) {
+        worker();
+    } else {
+        std::vector<std::thread> threads;
+        threads.reserve(threads_cnt);
+        for (size_t i = 0; i < threads_cnt; ++i) {
+            threads.emplace_back(&File_compactor::worker, this);
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+
+    if (m_error) {
+        std::rethrow_exception(m_error);
+    }
+
+    // Store the Content Table and update the file header (Data Records haven't been changed)
+    m_ctable.write_to_file(m_fd, m_offset);
+    stats_set(m_src.stats_get());
+    file_hdr_set_ctable(m_offset);
+    file_hdr_store();
+}
+
+/**
+ * @brief Process streams until all of them are done (body of a worker thread)
+ *
+ * If an exception is thrown, it is stored and all workers stop processing of other streams.
+ */
+void
+File_compactor::worker()
+{
+    try {
+        while (true) {
+            const size_t idx = m_streams_next++;
+            if (idx >= m_streams.size()) {
+                return;
+            }
+
+            stream_process(m_streams[idx]);
+        }
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_error) {
+            m_error = std::current_exception();
+        }
+        m_streams_next = m_streams.size();
+    }
+}
+
+/**
+ * @brief Rewrite all Data Blocks of a stream to the destination file
+ * @param[in] stream Stream to process
+ * @throw File_exception if any block is malformed or an I/O operation fails
+ */
+void
+File_compactor::stream_process(const struct stream_info &stream)
+{
+    stream_output out(stream.sid, stream.odid, m_calg, m_clevel);
+    Block_data_reader reader(m_src.file_hdr_get_calg());
+    Block_templates tmplts;
+    uint64_t tmplts_offset = 0;
+
+    tmplts.ie_source(m_iemgr);
+
+    for (const struct Block_content::info_data_block *block : stream.blocks) {
+        if (block->tmplt_offset != tmplts_offset) {
+            // Load the Template Block and merge it with the current output Template Block
+            uint16_t tmplts_sid;
+            uint32_t tmplts_odid;
+
+            tmplts.load_from_file(m_src.m_fd, block->tmplt_offset, &tmplts_sid, &tmplts_odid);
+            if (tmplts_sid != stream.sid || tmplts_odid != stream.odid) {
+                throw File_exception(FDS_ERR_INTERNAL, "Failed to load a Template Block (offset: "
+                    + std::to_string(block->tmplt_offset) + ") - Transport Session ID or ODID "
+                    "mismatch");
+            }
+
+            tmplts_offset = block->tmplt_offset;
+            stream_merge(out, tmplts);
+        }
+
+        reader.load_from_file(m_src.m_fd, block->offset, block->len, m_io_type);
+        reader.set_templates(tmplts.snapshot());
+
+        struct fds_drec rec;
+        struct fds_file_read_ctx ctx;
+        while (reader.next_rec(&rec, &ctx) == FDS_OK) {
+            if (rec.size > out.data.remains()) {
+                // The buffer is full
+                stream_flush(out);
+            }
+
+            out.data.set_etime(ctx.exp_time);
+            out.data.add(rec.data, rec.size, rec.tmplt);
+        }
+    }
+
+    stream_flush(out);
+    out.data.write_wait();
+}
+
+/// Auxiliary data structure for stream_merge_cb()
+struct stream_merge_data {
+    /// Output Template Block
+    Block_templates *out;
+    /// Templates which are not defined in the output Template Block
+    std::vector<const struct fds_template *> missing;
+    /// At least one Template has a different definition in the output Template Block
+    bool conflict;
+};
+
+/**
+ * @brief Compare a Template with the output Template Block (callback function)
+ * @param[in] tmplt Template of the source Template Block
+ * @param[in] data  Auxiliary data structure
+ * @return True if the iteration should continue
+ */
+static bool
+stream_merge_cb(const struct fds_template *tmplt, void *data)
+{
+    auto info = reinterpret_cast<struct stream_merge_data *>(data);
+    const struct fds_template *tmplt_out = info->out->get(tmplt->id);
+    if (!tmplt_out) {
+        info->missing.push_back(tmplt);
+        return true;
+    }
+
+    if (tmplt_out->type != tmplt->type
+            || tmplt_out->raw.length != tmplt->raw.length
+            || memcmp(tmplt_out->raw.data, tmplt->raw.data, tmplt->raw.length) != 0) {
+        info->conflict = true;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Merge a source Template Block into the output Template Block of a stream
+ *
+ * If all Templates are already defined in the output Template Block, nothing is changed and
+ * the already written Template Block is reused. If the source Template Block only adds new
+ * Templates, they are added and the Template Block will be written again before the next Data
+ * Block. Otherwise (i.e. at least one Template ID has been redefined), the buffered Data Records
+ * are flushed first and the output Template Block is replaced.
+ *
+ * @param[in] out    Output context of the stream
+ * @param[in] tmplts Source Template Block
+ */
+void
+File_compactor::stream_merge(struct stream_output &out, Block_templates &tmplts)
+{
+    struct stream_merge_data data;
+    data.out = &out.tmplts;
+    data.conflict = false;
+    fds_tsnapshot_for(tmplts.snapshot(), &stream_merge_cb, &data);
+
+    if (data.conflict) {
+        // Records based on the previous definitions must be written first
+        stream_flush(out);
+        out.tmplts.clear();
+
+        data.missing.clear();
+        data.conflict = false;
+        fds_tsnapshot_for(tmplts.snapshot(), &stream_merge_cb, &data);
+        assert(!data.conflict && "No conflict can occur after cleanup");
+    }
+
+    if (data.missing.empty()) {
+        return;
+    }
+
+    for (const struct fds_template *tmplt : data.missing) {
+        out.tmplts.add(tmplt->type, tmplt->raw.data, tmplt->raw.length);
+    }
+
+    out.tmplts_offset = 0; // Make sure that the Template Block will be written later
+}
+
+/**
+ * @brief Write the buffered Data Records of a stream as a Data Block
+ *
+ * If the Template Block of the stream hasn't been written yet, it is written first.
+ * Compression of the Data Block is performed without holding the lock, only the space in the
+ * file is reserved exclusively.
+ * @param[in] out Output context of the stream
+ */
+void
+File_compactor::stream_flush(struct stream_output &out)
+{
+    if (out.data.count() == 0) {
+        return;
+    }
+
+    if (out.tmplts_offset == 0) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        uint64_t bsize = out.tmplts.write_to_file(m_fd, m_offset, out.sid, out.odid);
+        out.tmplts_offset = m_offset;
+        m_offset += bsize;
+    }
+
+    uint64_t bsize = out.data.write_prepare(out.sid, out.tmplts_offset);
+    uint64_t boffset;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        boffset = m_offset;
+        m_ctable.add_data_block(boffset, bsize, out.tmplts_offset, out.odid, out.sid);
+        m_offset += bsize;
+    }
+
+    out.data.write_prepared(m_fd, boffset, m_io_type);
+}
@@ -0,0 +1,154 @@
+/**
+ * @file   src/file/File_compactor.hpp
+ * @brief  File compactor (header file)
+ * @author agent <agent@local>
+ * @date   October 2026
+ *
+ * Copyright(c) 2026 CESNET z.s.p.o.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef LIBFDS_FILE_COMPACTOR_HPP
+#define LIBFDS_FILE_COMPACTOR_HPP
+
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <vector>
+
+#include "Block_content.hpp"
+#include "Block_data_writer.hpp"
+#include "Block_templates.hpp"
+#include "File_base.hpp"
+#include "File_reader.hpp"
+
+namespace fds_file {
+
+/**
+ * @brief File compactor
+ *
+ * The class rewrites all Data Records of an existing file into a new file using a (usually
+ * stronger) compression algorithm. Data Records of each combination of Transport Session and
+ * ODID are repacked into Data Blocks that are filled up to their maximum capacity and equal
+ * Template Blocks (re-emitted by the writer, for example, after each append) are merged into
+ * a single one. The Content Table and the file header of the new file are rebuilt.
+ *
+ * Combinations of Transport Session and ODID (i.e. streams) are independent of each other,
+ * therefore, they are distributed among multiple worker threads. Each thread uses its own
+ * Data Block reader and writer and only the allocation of space in the new file is serialized.
+ * The order of Data Records of each stream is preserved.
+ */
+class File_compactor : public File_base {
+public:
+    /**
+     * @brief Class constructor
+     *
+     * Open and validate the source file for reading first and then create (or truncate) the
+     * destination file, i.e. the destination file is untouched if the source file is invalid.
+     * @param[in] src     Path to the source file
+     * @param[in] dst     Path to the destination file
+     * @param[in] calg    Compression algorithm of the destination file
+     * @param[in] clevel  Compression level (see Block_data_writer)
+     * @param[in] threads Number of worker threads (0 == number of available processors)
+     * @param[in] io_type I/O method used for reading/writing Data Blocks
+     * @throw File_exception if any of the files cannot be opened
+     */
+    File_compactor(const char *src, const char *dst, fds_file_alg calg,
+        int clevel = Block_data_writer::CLEVEL_DEF, unsigned int threads = 0,
+        Io_factory::Type io_type = Io_factory::Type::IO_DEFAULT);
+    /**
+     * @brief Class destructor
+     * @note If run() hasn't been successfully finished, the destination file is incomplete.
+     */
+    ~File_compactor() = default;
+
+    // Disable copy constructors
+    File_compactor(const File_compactor &other) = delete;
+    File_compactor &operator=(const File_compactor &other) = delete;
+
+    /**
+     * @brief Rewrite the source file into the destination file
+     * @throw File_exception if any of the blocks is malformed or an I/O operation fails
+     */
+    void
+    run();
+
+    // ---- Implementation of the base class functions ----
+    void
+    iemgr_set(const fds_iemgr_t *iemgr) override;
+
+    const struct fds_file_session *
+    session_get(fds_file_sid_t sid) override;
+    void
+    session_list(fds_file_sid_t **arr, size_t *size) override;
+    void
+    session_odids(fds_file_sid_t sid, uint32_t **arr, size_t *size) override;
+
+private:
+    /// Data Blocks of a combination of Transport Session and ODID (in the order of the source)
+    struct stream_info {
+        /// Internal Transport Session ID
+        uint16_t sid;
+        /// Observation Domain ID
+        uint32_t odid;
+        /// Data Blocks in the source file
+        std::vector<const Block_content::info_data_block *> blocks;
+    };
+
+    /// Output context of a stream processed by a worker thread
+    struct stream_output {
+        /// Internal Transport Session ID
+        uint16_t sid;
+        /// Observation Domain ID
+        uint32_t odid;
+        /// Merged Template Block
+        Block_templates tmplts;
+        /// Offset of the merged Template Block in the destination file (0 == not written yet)
+        uint64_t tmplts_offset;
+        /// Buffer of Data Records
+        Block_data_writer data;
+
+        stream_output(uint16_t sid, uint32_t odid, enum fds_file_alg calg, int clevel)
+            : sid(sid), odid(odid), tmplts(), tmplts_offset(0),
+              data(odid, calg, Block_data_writer::MSG_DEF_SIZE, clevel) {}
+    };
+
+    /// Source file
+    File_reader m_src;
+    /// Compression algorithm of the destination file
+    enum fds_file_alg m_calg;
+    /// Compression level of the destination file
+    int m_clevel;
+    /// Number of worker threads
+    unsigned int m_threads;
+    /// Type of I/O used for large file blocks
+    Io_factory::Type m_io_type;
+    /// Reference to the IE manager (can be nullptr)
+    const fds_iemgr_t *m_iemgr = nullptr;
+
+    /// Streams to process
+    std::vector<struct stream_info> m_streams;
+    /// Index of the next stream to process by a worker thread
+    std::atomic<size_t> m_streams_next;
+    /// Mutex protecting the file offset, the Content Table and the error
+    std::mutex m_mutex;
+    /// The first exception thrown by a worker thread
+    std::exception_ptr m_error = nullptr;
+    /// Content Table of the destination file
+    Block_content m_ctable;
+    /// File offset where the next block should be placed
+    uint64_t m_offset = 0;
+
+    void
+    worker();
+    void
+    stream_process(const struct stream_info &stream);
+    void
+    stream_merge(struct stream_output &out, Block_templates &tmplts);
+    void
+    stream_flush(struct stream_output &out);
+};
+
+} // namespace
+
+#endif // LIBFDS_FILE_COMPACTOR_HPP
@@ -9,21 +9,33 @@
  */
 
 #include <algorithm>
+#include <atomic>
+#include <exception>
+#include <cstring>
+#include <iterator>
+#include <mutex>
 #include <set>
 #include <string>
+#include <thread>
 
+#include <fcntl.h>   // open
 #include <sys/types.h>
-#include <unistd.h>  // lseek
+#include <unistd.h>  // lseek, pread, close
 
 #include "File_reader.hpp"
 #include "File_exception.hpp"
 #include "Io_sync.hpp"
+#include "structure.h"
 
 using namespace fds_file;
 
-File_reader::File_reader(const char *path, Io_factory::Type io_type)
+File_reader::File_reader(const char *path, Io_factory::Type io_type, bool direct)
     : File_base(path, File_base::CF_READ), m_io_type(io_type)
 {
+    if (direct) {
+        direct_open(path);
+    }
+
     // Try to load the file header
     file_hdr_load();
 
@@ -37,27 +49,36 @@ File_reader::File_reader(const char *path, Io_factory::Type io_type)
         ctable_rebuild();
     }
 
-    /* Prepare 2 Data Block readers
-     * Why? For asynchronous I/O read we need 2 readers. The first one is used to return Data
+    /* Data Block readers are created on demand (see scheduler_prepare_next())
+     * For asynchronous I/O read we need 2 readers. The first one is used to return Data
      * Records from the current Data Block while the latter is asynchronously loading the next
      * Data Block in background.
      */
-    enum fds_file_alg alg = file_hdr_get_calg();
-    m_db_idles.emplace_back(new Block_data_reader(alg));
-    m_db_idles.emplace_back(new Block_data_reader(alg));
 
     // Rewind
     read_rewind();
 }
 
+File_reader::~File_reader()
+{
+    // Pending I/O requests of Data Block readers might still use the direct I/O descriptor
+    m_db_current.reset();
+    m_db_next.reset();
+    m_db_idles.clear();
+
+    if (m_fd_direct >= 0) {
+        close(m_fd_direct);
+    }
+}
+
 void
 File_reader::iemgr_set(const fds_iemgr_t *iemgr)
 {
     m_iemgr = iemgr;
 
-    // Update each already loaded Template Block
-    for (auto &tblock : m_tmplts) {
-        tblock.second.block.ie_source(iemgr);
+    // Update each already parsed Template Block (all of them are in the cache)
+    for (auto &rec : m_tcache) {
+        rec.block->ie_source(iemgr);
     }
 
     // Templates and template snapshots used by Data Block readers are not valid anymore!
@@ -138,15 +159,10 @@ void
 File_reader::read_rewind()
 {
     // Move active Data Block readers to the list of inactive Data Block readers
-    if (m_db_current) {
-        m_db_idles.emplace_back(std::move(m_db_current));
-        m_db_current = nullptr;
-    }
+    db_idle(m_db_current);
+    db_idle(m_db_next);
 
-    if (m_db_next) {
-        m_db_idles.emplace_back(std::move(m_db_next));
-        m_db_next = nullptr;
-    }
+    m_db_current_tmplts = nullptr;
 
     // The next Data Block start from the beginning of the file
     m_db_next_idx = 0;
@@ -180,30 +196,256 @@ File_reader::read_rec(struct fds_drec *rec, struct fds_file_read_ctx *ctx)
     }
 }
 
+/// Shared context of worker threads of read_scan()
+struct File_reader::scan_ctx {
+    /// Filter expression (can be nullptr)
+    const char *filter;
+    /// Callback called for each matching Data Record
+    fds_file_scan_map_cb map_cb;
+    /// User data passed to the callbacks
+    void *user;
+
+    /// Data Blocks to process (i.e. indexes to the Content Table)
+    std::vector<size_t> blocks;
+    /// Template snapshots of the Data Blocks (in the same order)
+    std::vector<const fds_tsnapshot_t *> snaps;
+    /// Index of the next Data Block to process
+    std::atomic<size_t> next;
+
+    /// Private accumulators of worker threads
+    std::vector<void *> accs;
+    /// Mutex protecting the error
+    std::mutex mutex;
+    /// The first exception thrown by a worker thread
+    std::exception_ptr error = nullptr;
+    /// The first non-OK return code of the map callback
+    int rc = FDS_OK;
+};
+
+int
+File_reader::read_scan(const char *filter, unsigned int threads, fds_file_scan_map_cb map_cb,
+    fds_file_scan_merge_cb merge_cb, void *user)
+{
+    if (filter != nullptr) {
+        // Check the filter before start of the worker threads
+        if (!m_iemgr) {
+            throw File_exception(FDS_ERR_ARG, "The filter expression requires definitions of "
+                "Information Elements");
+        }
+
+        fds_ipfix_filter_t *aux;
+        int rc = fds_ipfix_filter_create(&aux, m_iemgr, filter);
+        std::unique_ptr<fds_ipfix_filter_t, decltype(&fds_ipfix_filter_destroy)>
+            aux_wrap(aux, &fds_ipfix_filter_destroy);
+        if (rc != FDS_OK) {
+            throw File_exception((rc == FDS_ERR_NOMEM) ? FDS_ERR_INTERNAL : FDS_ERR_ARG,
+                std::string("Invalid filter expression: ") + fds_ipfix_filter_get_error(aux));
+        }
+    }
+
+    if (threads == 0) {
+        // Note: The function can return 0 if the value is not computable
+        threads = std::thread::hardware_concurrency();
+        threads = (threads != 0) ? threads : 1U;
+    }
+
+    struct scan_ctx ctx;
+    ctx.filter = filter;
+    ctx.map_cb = map_cb;
+    ctx.user = user;
+    ctx.next = 0;
+
+    /*
+     * Prepare Template Blocks of all Data Blocks to process in advance (i.e. the cache of Template
+     * Blocks is accessed only from this thread). Identical Template Blocks are shared, so only
+     * a few of them are usually kept alive during the scan.
+     */
+    std::vector<std::shared_ptr<Block_templates>> tblocks;
+    std::map<uint64_t, const fds_tsnapshot_t *> tsnaps;
+    const auto &dblocks = m_ctable.get_data_blocks();
+
+    for (size_t i = 0; i < dblocks.size(); ++i) {
+        const auto &dblock_info = dblocks[i];
+        if (!sfilter_match(dblock_info.session_id, dblock_info.odid)) {
+            continue;
+        }
+
+        auto it = tsnaps.find(dblock_info.tmplt_offset);
+        if (it == tsnaps.end()) {
+            uint16_t tblock_sid;
+            uint32_t tblock_odid;
+            std::shared_ptr<Block_templates> tblock = get_tblock(dblock_info.tmplt_offset,
+                tblock_sid, tblock_odid);
+            if (tblock_sid != dblock_info.session_id || tblock_odid != dblock_info.odid) {
+                throw File_exception(FDS_ERR_INTERNAL, "Failed to load a Template Block of a Data "
+                    "Block based on the Content Table (Transport Session ID or ODID mismatch)");
+            }
+
+            it = tsnaps.emplace(dblock_info.tmplt_offset, tblock->snapshot()).first;
+            tblocks.emplace_back(std::move(tblock));
+        }
+
+        ctx.blocks.push_back(i);
+        ctx.snaps.push_back(it->second);
+    }
+
+    // Process all Data Blocks
+    threads = std::max<size_t>(1U, std::min<size_t>(threads, ctx.blocks.size()));
+    ctx.accs.resize(threads, nullptr);
+
+    if (threads == 1) {
+        scan_worker(ctx, 0);
+    } else {
+        std::vector<std::thread> workers;
+        workers.reserve(threads);
+        for (size_t i = 0; i < threads; ++i) {
+            workers.emplace_back(&File_reader::scan_worker, this, std::ref(ctx), i);
+        }
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+    // Merge private accumulators (always, so the user is able to free them)
+    int rc = ctx.rc;
+    for (void *acc : ctx.accs) {
+        if (!merge_cb) {
+            continue;
+        }
+
+        int ret = merge_cb(acc, ctx.user);
+        if (ret != FDS_OK && rc == FDS_OK) {
+            rc = ret;
+        }
+    }
+
+    if (ctx.error) {
+        std::rethrow_exception(ctx.error);
+    }
+
+    return rc;
+}
+
+/**
+ * @brief Calculate a hash of Template records (FNV-1a)
+ * @param[in] data Data
+ * @param[in] size Size of the data
+ * @return Hash
+ */
+static uint64_t
+tcache_hash(const uint8_t *data, size_t size)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
 /**
  * @brief Get a Template Block with a given offset
  *
- * If the Template Block hasn't been previously loaded, the block is located in the file, parsed,
- * and stored into the internal list and returned.
+ * If the Template Block hasn't been previously loaded (or it has been already evicted from the
+ * cache), the block is located in the file and its Template records are compared with parsed
+ * Template Blocks in the cache. The writer usually emits identical Template Blocks many times
+ * (e.g. after each append), therefore, if the same Template records are already parsed,
+ * the parsed block is shared. Otherwise, the block is parsed and stored into the cache. The least
+ * recently used blocks are evicted from the cache when it is full.
  *
- * @param[in] offset Offset of the Template Block from the start of the file
- * @return Reference of the Template Block
+ * @param[in]  offset Offset of the Template Block from the start of the file
+ * @param[out] sid    Internal Transport Session ID of the Template Block
+ * @param[out] odid   Observation Domain ID of the Template Block
+ * @return Parsed Template Block
  * @throw File_exception if a valid Template Block is not available at the offset in the file
  */
-struct File_reader::tblock_info &
-File_reader::get_tblock(uint64_t offset)
+std::shared_ptr<Block_templates>
+File_reader::get_tblock(uint64_t offset, uint16_t &sid, uint32_t &odid)
+{
+    struct tblock_info &info = m_tmplts[offset];
+    std::shared_ptr<Block_templates> block = info.block.lock();
+    if (block) {
+        // Already parsed, mark it as recently used
+        for (auto it = m_tcache.begin(); it != m_tcache.end(); ++it) {
+            if (it->block == block) {
+                m_tcache.splice(m_tcache.begin(), m_tcache, it);
+                break;
+            }
+        }
+
+        sid = info.sid;
+        odid = info.odid;
+        return block;
+    }
+
+    // Not found -> try to load it and find the same Template records in the cache
+    const std::vector<uint8_t> raw = Block_templates::read_from_file(m_fd, offset);
+    const size_t hdr_size = offsetof(struct fds_file_btmplt, recs);
+    const uint8_t *recs_data = raw.data() + hdr_size;
+    const size_t recs_size = raw.size() - hdr_size;
+    const uint64_t hash = tcache_hash(recs_data, recs_size);
+
+    auto block_hdr = reinterpret_cast<const struct fds_file_btmplt *>(raw.data());
+    info.sid = le16toh(block_hdr->session_id);
+    info.odid = le32toh(block_hdr->odid);
+    sid = info.sid;
+    odid = info.odid;
+
+    block = tcache_find(hash, recs_data, recs_size);
+    if (block) {
+        info.block = block;
+        return block;
+    }
+
+    // Parse it and insert it into the cache
+    block = std::make_shared<Block_templates>();
+    block->ie_source(m_iemgr);
+    block->load_from_buffer(raw.data(), raw.size());
+
+    m_tcache.push_front({hash, std::vector<uint8_t>(recs_data, recs_data + recs_size), block});
+    m_tcache_idx.emplace(hash, m_tcache.begin());
+    info.block = block;
+
+    if (m_tcache.size() > TCACHE_SIZE) {
+        // Evict the least recently used block (it is destroyed when it is not used anymore)
+        auto lru = std::prev(m_tcache.end());
+        auto range = m_tcache_idx.equal_range(lru->hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == lru) {
+                m_tcache_idx.erase(it);
+                break;
+            }
+        }
+        m_tcache.erase(lru);
+    }
+
+    return block;
+}
+
+/**
+ * @brief Find a parsed Template Block with given Template records in the cache
+ *
+ * If found, the block is marked as recently used.
+ * @param[in] hash Hash of the Template records
+ * @param[in] data Template records
+ * @param[in] size Size of the Template records
+ * @return Parsed Template Block or nullptr
+ */
+std::shared_ptr<Block_templates>
+File_reader::tcache_find(uint64_t hash, const uint8_t *data, size_t size)
 {
-    const auto it = m_tmplts.find(offset);
-    if (it != m_tmplts.end()) {
-        // Found
-        return it->second;
+    auto range = m_tcache_idx.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        const std::vector<uint8_t> &content = it->second->content;
+        if (content.size() != size || memcmp(content.data(), data, size) != 0) {
+            continue; // Hash collision
+        }
+
+        m_tcache.splice(m_tcache.begin(), m_tcache, it->second);
+        return it->second->block;
     }
 
-    // Not found -> try to load it
-    struct tblock_info &tblock = m_tmplts[offset];
-    tblock.block.ie_source(m_iemgr);
-    tblock.block.load_from_file(m_fd, offset, &tblock.sid, &tblock.odid);
-    return tblock;
+    return nullptr;
 }
 
 /**
@@ -399,11 +641,8 @@ File_reader::scheduler()
     assert(!m_db_current || m_db_current->next_rec(&aux_rec, nullptr) == FDS_EOC);
 #endif
 
-    if (m_db_current) {
-        // Move the current reader to the list of idle Data Block readers
-        m_db_idles.emplace_back(std::move(m_db_current));
-        m_db_current = nullptr;
-    }
+    // Move the current reader to the list of idle Data Block readers
+    db_idle(m_db_current);
 
     if (m_db_next) {
         // The next Data Block reader is ready to be used
@@ -440,11 +679,8 @@ File_reader::scheduler_next2current()
     assert(m_db_next != nullptr && "The next Data Block must be defined!");
     assert(m_db_next_idx < m_ctable.get_data_blocks().size() && "Index out of range!");
 
-    if (m_db_current) {
-        // Move the current reader to the list of idle Data Block readers
-        m_db_idles.emplace_back(std::move(m_db_current));
-        m_db_current = nullptr;
-    }
+    // Move the current reader to the list of idle Data Block readers
+    db_idle(m_db_current);
 
     /*
      * Order of the following operations is important!
@@ -468,8 +704,11 @@ File_reader::scheduler_next2current()
     assert(sblock_info->get_sid() == dblock_info.session_id && "Sesssion ID mismatch!");
 
     // Check if its Template Block has been already loaded
-    struct tblock_info &tblock_info = get_tblock(dblock_info.tmplt_offset);
-    if (tblock_info.sid != dblock_info.session_id || tblock_info.odid != dblock_info.odid) {
+    uint16_t tblock_sid;
+    uint32_t tblock_odid;
+    std::shared_ptr<Block_templates> tblock = get_tblock(dblock_info.tmplt_offset, tblock_sid,
+        tblock_odid);
+    if (tblock_sid != dblock_info.session_id || tblock_odid != dblock_info.odid) {
         // The reference in the Content Table contains unexpected Transport Session ID or ODID
         throw File_exception(FDS_ERR_INTERNAL, "Failed to load a Template Block for the next "
             "Data Block based on the Content Table (Transport Session ID or ODID mismatch)");
@@ -498,8 +737,9 @@ File_reader::scheduler_next2current()
             "next Data Block due to invalid record in the Content Table");
     }
 
-    m_db_next->set_templates(tblock_info.block.snapshot());
+    m_db_next->set_templates(tblock->snapshot());
     m_db_current = std::move(m_db_next);
+    m_db_current_tmplts = std::move(tblock);
     m_db_next = nullptr;
 
     // Change index of the next Data Block to prepare
@@ -522,7 +762,6 @@ void
 File_reader::scheduler_prepare_next()
 {
     assert(m_db_next == nullptr && "The next Data Block must not be defined!");
-    assert(!m_db_idles.empty() && "The must be always at least one idle Data Block reader!");
 
     const struct Block_content::info_data_block *dblock_next = nullptr;
     const std::vector<Block_content::info_data_block> &dblock_list = m_ctable.get_data_blocks();
@@ -544,16 +783,84 @@ File_reader::scheduler_prepare_next()
         return;
     }
 
-    // Configure the first idle reader to start loading the next Data Block
-    m_db_next = std::move(m_db_idles.front());
-    m_db_idles.pop_front();
+    // Configure the first idle reader (or a new one) to start loading the next Data Block
+    if (m_db_idles.empty()) {
+        m_db_next.reset(new Block_data_reader(file_hdr_get_calg()));
+    } else {
+        m_db_next = std::move(m_db_idles.front());
+        m_db_idles.pop_front();
+    }
 
     /*
      * For asynchronous I/O it will start loading of the block in the background immediately.
      * For synchronous I/O it will only initialize the reader but loading is postponed until the
      *   Data Records are not required (yes, that's what we want)
      */
-    m_db_next->load_from_file(m_fd, dblock_next->offset, dblock_next->len, m_io_type);
+    dblock_load(*m_db_next, *dblock_next);
+}
+
+/**
+ * @brief Move a Data Block reader to the list of idle Data Block readers
+ *
+ * The loaded Data Block is released, i.e. an idle reader doesn't hold any buffer.
+ * @param[in,out] reader Data Block reader (can be nullptr, always nullptr after return)
+ */
+void
+File_reader::db_idle(std::unique_ptr<Block_data_reader> &reader)
+{
+    if (!reader) {
+        return;
+    }
+
+    reader->release();
+    m_db_idles.emplace_back(std::move(reader));
+    reader = nullptr;
+}
+
+/**
+ * @brief Open the file for direct I/O of Data Blocks
+ *
+ * Direct I/O bypasses the page cache, however, it requires the file offset, size and memory
+ * buffer of each transfer to be aligned to the logical block size of the storage. Since not all
+ * file systems support it (e.g. some network file systems), a probe read is performed first.
+ * If direct I/O is not available, the regular file descriptor is silently used instead.
+ * @param[in] path File to be opened for reading
+ */
+void
+File_reader::direct_open(const char *path)
+{
+    constexpr size_t align = Block_data_reader::DIRECT_ALIGN_MAX;
+    int fd = open(path, O_RDONLY | O_DIRECT);
+    if (fd < 0) {
+        return;
+    }
+
+    auto probe = Buffer_pool::instance().get(align);
+    if (pread(fd, probe.get(), align, 0) < 0) {
+        close(fd);
+        return;
+    }
+
+    m_fd_direct = fd;
+}
+
+/**
+ * @brief Start loading of a Data Block
+ *
+ * If direct I/O is available, the Data Block is loaded bypassing the page cache.
+ * @param[in] reader Data Block reader
+ * @param[in] info   Description of the Data Block from the Content Table
+ */
+void
+File_reader::dblock_load(Block_data_reader &reader, const struct Block_content::info_data_block &info)
+{
+    if (m_fd_direct < 0) {
+        reader.load_from_file(m_fd, info.offset, info.len, m_io_type);
+        return;
+    }
+
+    const size_t align = Block_data_reader::DIRECT_ALIGN_MAX;
+    reader.load_from_file(m_fd_direct, info.offset, info.len, m_io_type, align);
 }
 
 /**
@@ -594,4 +901,82 @@ File_reader::sfilter_match(uint16_t sid, uint32_t odid)
 
     // Not found
     return false;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Process Data Blocks until all of them are done (body of a worker thread of read_scan())
+ *
+ * If an exception is thrown or the map callback fails, the error is stored and all workers
+ * stop processing of other Data Blocks.
+ * @param[in] ctx Shared context of worker threads
+ * @param[in] idx Index of the worker thread (i.e. index of its private accumulator)
+ */
+void
+File_reader::scan_worker(struct scan_ctx &ctx, size_t idx)
+{
+    void **acc = &ctx.accs[idx];
+
+    try {
+        std::unique_ptr<fds_ipfix_filter_t, decltype(&fds_ipfix_filter_destroy)>
+            filter(nullptr, &fds_ipfix_filter_destroy);
+        if (ctx.filter != nullptr) {
+            // The filter is not thread-safe, each thread must have its own instance
+            fds_ipfix_filter_t *aux;
+            int rc = fds_ipfix_filter_create(&aux, m_iemgr, ctx.filter);
+            filter.reset(aux);
+            if (rc != FDS_OK) {
+                throw File_exception(FDS_ERR_INTERNAL, "Failed to create a filter");
+            }
+        }
+
+        const auto &dblocks = m_ctable.get_data_blocks();
+        Block_data_reader reader(file_hdr_get_calg());
+
+        while (true) {
+            const size_t pos = ctx.next++;
+            if (pos >= ctx.blocks.size()) {
+                return;
+            }
+
+            const auto &dblock_info = dblocks[ctx.blocks[pos]];
+            dblock_load(reader, dblock_info);
+
+            const struct fds_file_bdata *dblock_hdr = reader.get_block_header();
+            if (le16toh(dblock_hdr->session_id) != dblock_info.session_id
+                    || le32toh(dblock_hdr->odid) != dblock_info.odid
+                    || le64toh(dblock_hdr->offset_tmptls) != dblock_info.tmplt_offset) {
+                throw File_exception(FDS_ERR_INTERNAL, "Failed to load a Data Block based on the "
+                    "Content Table (Transport Session ID, ODID or Template Block mismatch)");
+            }
+
+            reader.set_templates(ctx.snaps[pos]);
+
+            struct fds_drec rec;
+            struct fds_file_read_ctx rec_ctx;
+            while (reader.next_rec(&rec, &rec_ctx) == FDS_OK) {
+                if (filter && !fds_ipfix_filter_eval(filter.get(), &rec)) {
+                    continue;
+                }
+
+                int rc = ctx.map_cb(&rec, &rec_ctx, acc, ctx.user);
+                if (rc == FDS_OK) {
+                    continue;
+                }
+
+                // Stop all workers
+                std::lock_guard<std::mutex> lock(ctx.mutex);
+                if (ctx.rc == FDS_OK && !ctx.error) {
+                    ctx.rc = rc;
+                }
+                ctx.next = ctx.blocks.size();
+                return;
+            }
+        }
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(ctx.mutex);
+        if (!ctx.error && ctx.rc == FDS_OK) {
+            ctx.error = std::current_exception();
+        }
+        ctx.next = ctx.blocks.size();
+    }
+}
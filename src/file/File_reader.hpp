@@ -15,6 +15,8 @@
 #include <memory>
 #include <list>
 #include <set>
+#include <unordered_map>
+#include <vector>
 
 #include <libfds.h>
 #include "Block_content.hpp"
@@ -31,6 +33,8 @@ namespace fds_file {
  * Class implements the interface for reading Data Records stored in a file.
  */
 class File_reader : public File_base {
+    // The compactor uses the Content Table and the file descriptor of the source file
+    friend class File_compactor;
 public:
     /**
      * @brief Class constructor
@@ -42,16 +46,21 @@ public:
      *   For I/O parameter @p io_type has impact only on loading of large file blocks. For (usually)
      *   small blocks (such as the Content Block, Template Block, etc.) synchronous I/O is always
      *   used.
+     * @note
+     *   If direct I/O is enabled (@p direct), Data Blocks are loaded bypassing the page cache.
+     *   If the file system doesn't support direct I/O, the regular I/O is used instead.
      * @param[in] path    File to be opened for reading
      * @param[in] io_type I/0 method used for loading large blocks (i.e. Data Blocks, etc.)
+     * @param[in] direct  Use direct I/O for loading large blocks
      */
-    File_reader(const char *path, Io_factory::Type io_type = Io_factory::Type::IO_DEFAULT);
+    File_reader(const char *path, Io_factory::Type io_type = Io_factory::Type::IO_DEFAULT,
+        bool direct = false);
     /**
      * @brief Class destructor
      *
      * Free all allocated resources and close the file.
      */
-    ~File_reader() = default;
+    ~File_reader();
 
     // Disable copy constructors
     File_reader(const File_reader &other) = delete;
@@ -74,27 +83,51 @@ public:
     read_rewind() override;
     virtual int
     read_rec(struct fds_drec *rec, struct fds_file_read_ctx *ctx) override;
+    int
+    read_scan(const char *filter, unsigned int threads, fds_file_scan_map_cb map_cb,
+        fds_file_scan_merge_cb merge_cb, void *user) override;
 
 private:
-    /// Auxiliary structure with information about a loaded Template Block
+    /// Maximum number of parsed Template Blocks in the cache
+    static constexpr size_t TCACHE_SIZE = 64;
+
+    /// Parsed Template Block in the cache (shared by all identical Template Blocks)
+    struct tcache_rec {
+        /// Hash of the Template records
+        uint64_t hash;
+        /// Template records of the block (i.e. without Template Block header)
+        std::vector<uint8_t> content;
+        /// Parsed Template Block
+        std::shared_ptr<Block_templates> block;
+    };
+
+    /// Auxiliary structure with information about a Template Block at a specific offset
     struct tblock_info {
         /// Internal Transport Session ID
         uint16_t sid;
         /// Observation Domain ID
         uint32_t odid;
-        /// Template Block
-        Block_templates block;
+        /// Parsed Template Block (can be already evicted from the cache)
+        std::weak_ptr<Block_templates> block;
     };
 
     /// Manager of Information Elements
     const fds_iemgr_t *m_iemgr = nullptr;
     /// Type of I/O used for loading large file blocks
     Io_factory::Type m_io_type;
+    /// File descriptor opened for direct I/O of Data Blocks (-1 == direct I/O is not used)
+    int m_fd_direct = -1;
 
     /// Content Table (can be nullptr if the table is not available)
     Block_content m_ctable;
-    /// Loaded Template Blocks identified by their offset in the file
+    /// Known Template Blocks identified by their offset in the file
     std::map<uint64_t, struct tblock_info> m_tmplts;
+    /// Cache of parsed Template Blocks (the most recently used first)
+    std::list<struct tcache_rec> m_tcache;
+    /// Index of the cache (hash of Template records -> cache records)
+    std::unordered_multimap<uint64_t, std::list<struct tcache_rec>::iterator> m_tcache_idx;
+    /// Template Block of the current Data Block reader (must exist as long as the reader is used)
+    std::shared_ptr<Block_templates> m_db_current_tmplts = nullptr;
     /// Loaded Session Blocks identified by internal Transport Session ID
     std::map<uint16_t, std::unique_ptr<Block_session>> m_sessions;
 
@@ -119,11 +152,18 @@ private:
     } m_sfilter;
 
 
-    struct tblock_info &
-    get_tblock(uint64_t offset);
+    std::shared_ptr<Block_templates>
+    get_tblock(uint64_t offset, uint16_t &sid, uint32_t &odid);
+    std::shared_ptr<Block_templates>
+    tcache_find(uint64_t hash, const uint8_t *data, size_t size);
     const Block_session *
     get_sblock(uint16_t sid);
 
+    void
+    direct_open(const char *path);
+    void
+    dblock_load(Block_data_reader &reader, const struct Block_content::info_data_block &info);
+
     void
     ctable_rebuild();
     void
@@ -137,10 +177,17 @@ private:
     scheduler_next2current();
     void
     scheduler_prepare_next();
+    void
+    db_idle(std::unique_ptr<Block_data_reader> &reader);
 
     bool
     sfilter_match(uint16_t sid, uint32_t odid);
 
+    /// Shared context of worker threads of read_scan()
+    struct scan_ctx;
+    void
+    scan_worker(struct scan_ctx &ctx, size_t idx);
+
 };
 
 } // namespace
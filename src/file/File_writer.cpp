@@ -20,9 +20,10 @@
 
 using namespace fds_file;
 
-File_writer::File_writer(const char *path, fds_file_alg calg, bool append, Io_factory::Type io_type)
+File_writer::File_writer(const char *path, fds_file_alg calg, bool append, Io_factory::Type io_type,
+        bool direct)
     : File_base(path, append ? File_base::CF_APPEND : File_base::CF_TRUNC, File_base::DEF_MODE, calg),
-      m_io_type(io_type)
+      m_io_type(io_type), m_direct(direct)
 {
     /*
      * Lock the whole file for writing (only this process must be able to write to the file)
@@ -338,6 +339,7 @@ File_writer::select_ctx(fds_file_sid_t sid, uint32_t odid, uint32_t exp_time)
     // Create a new ODID
     auto ptr = std::unique_ptr<struct odid_info>(new odid_info(sid, odid, file_hdr_get_calg()));
     ptr->m_tblock_data.ie_source(m_iemgr);
+    ptr->m_data.set_nocache(m_direct);
     sinfo->m_odids[odid] = std::move(ptr);
     m_selected = sinfo->m_odids[odid].get();
     m_selected->m_data.set_etime(exp_time);
@@ -61,9 +61,10 @@ public:
      * @param[in] calg    Selected compression algorithm
      * @param[in] append  Open in append mode (do not overwrite if the file already exists)
      * @param[in] io_type I/0 method used for writing large blocks (i.e. Data Blocks, etc.)
+     * @param[in] direct  Drop written large blocks from the page cache
      */
     File_writer(const char *path, fds_file_alg calg, bool append = false,
-        Io_factory::Type io_type = Io_factory::Type::IO_DEFAULT);
+        Io_factory::Type io_type = Io_factory::Type::IO_DEFAULT, bool direct = false);
     /**
      * @brief Class destructor
      *
@@ -148,6 +149,8 @@ private:
 
     /// Type of I/O used for writing large file blocks
     Io_factory::Type m_io_type;
+    /// Drop written large file blocks from the page cache
+    bool m_direct;
 
     /// List of all Transport Sessions (identified by internal Transport Session ID)
     std::map<uint16_t, std::unique_ptr<struct session_info>> m_sessions;
@@ -15,7 +15,9 @@
 #include <libfds/file.h>
 
 
+#include "Buffer_pool.hpp"
 #include "File_base.hpp"
+#include "File_compactor.hpp"
 #include "File_exception.hpp"
 #include "File_reader.hpp"
 #include "File_writer.hpp"
@@ -101,12 +103,13 @@ error_reset(struct fds_file_s *inst)
  * @param[out] mode  Extracted operation mode
  * @param[out] alg   Extracted compression algorithm
  * @param[out] io    Extracted I/O method
+ * @param[out] direct Bypass the page cache during transfers of Data Blocks
  * @return #FDS_OK on success
  * @return #FDS_ERR_ARG on error and the error buffer is filled
  */
 static int
 flags_parse(struct fds_file_s *file, uint32_t flags, file_mode &mode, enum fds_file_alg &alg,
-    Io_factory::Type &io)
+    Io_factory::Type &io, bool &direct)
 {
     // Check operation mode flags
     std::bitset<32> bset_mode(flags & FMASK_MODE);
@@ -149,6 +152,7 @@ flags_parse(struct fds_file_s *file, uint32_t flags, file_mode &mode, enum fds_f
     io = ((flags & FDS_FILE_NOASYNC) != 0)
         ? Io_factory::Type::IO_SYNC
         : Io_factory::Type::IO_DEFAULT;
+    direct = (flags & FDS_FILE_DIRECT) != 0;
 
     return FDS_OK;
 }
@@ -235,8 +239,9 @@ fds_file_open(fds_file_t *file, const char *path, uint32_t flags)
     file_mode new_mode;
     enum fds_file_alg new_alg;
     Io_factory::Type new_io_type;
+    bool new_direct;
 
-    int rc = flags_parse(file, flags, new_mode, new_alg, new_io_type);
+    int rc = flags_parse(file, flags, new_mode, new_alg, new_io_type, new_direct);
     if (rc != FDS_OK) {
         return rc;
     }
@@ -245,11 +250,11 @@ fds_file_open(fds_file_t *file, const char *path, uint32_t flags)
     API_WRAPPER(file, {
         if (new_mode == file_mode::READER) {
             // File reader
-            new_file = new File_reader(path, new_io_type);
+            new_file = new File_reader(path, new_io_type, new_direct);
         } else {
             // File writer/appender
             bool append = (new_mode == file_mode::APPENDER) ? true : false;
-            new_file = new File_writer(path, new_alg, append, new_io_type);
+            new_file = new File_writer(path, new_alg, append, new_io_type, new_direct);
         }
     })
 
@@ -391,6 +396,23 @@ fds_file_read_rec(fds_file_t *file, struct fds_drec *rec, struct fds_file_read_c
     return FDS_OK;
 }
 
+int
+fds_file_scan(fds_file_t *file, const char *filter, unsigned int nthreads,
+    fds_file_scan_map_cb map_cb, fds_file_scan_merge_cb merge_cb, void *user)
+{
+    FATAL_TEST(file);
+
+    if (!map_cb) {
+        error_set(file, "Invalid argument");
+        return FDS_ERR_ARG;
+    }
+
+    API_WRAPPER(file, {
+        return file->m_handler->read_scan(filter, nthreads, map_cb, merge_cb, user);
+    });
+    return FDS_OK;
+}
+
 int
 fds_file_write_ctx(fds_file_t *file, fds_file_sid_t sid, uint32_t odid, uint32_t exp_time)
 {
@@ -444,3 +466,60 @@ fds_file_write_rec(fds_file_t *file, uint16_t tid, const uint8_t *rec_data, uint
     API_WRAPPER(file, file->m_handler->write_rec(tid, rec_data, rec_size));
     return FDS_OK;
 }
+
+int
+fds_file_compact(const char *src, const char *dst, const struct fds_file_compact_opts *opts)
+{
+    if (!src || !dst) {
+        return FDS_ERR_ARG;
+    }
+
+    uint32_t flags = FDS_FILE_ZSTD;
+    int level = FDS_FILE_COMPACT_LEVEL_DEF;
+    unsigned int threads = 0;
+    if (opts != nullptr) {
+        flags = opts->flags;
+        level = (opts->level != 0) ? opts->level : FDS_FILE_COMPACT_LEVEL_DEF;
+        threads = opts->threads;
+    }
+
+    // Check flags (only compression and I/O flags are allowed)
+    if ((flags & ~(FMASK_COMP | FDS_FILE_NOASYNC)) != 0
+            || std::bitset<32>(flags & FMASK_COMP).count() > 1) {
+        return FDS_ERR_ARG;
+    }
+
+    enum fds_file_alg alg = FDS_FILE_CALG_NONE;
+    if ((flags & FDS_FILE_LZ4) != 0) {
+        alg = FDS_FILE_CALG_LZ4;
+    } else if ((flags & FDS_FILE_ZSTD) != 0) {
+        alg = FDS_FILE_CALG_ZSTD;
+    }
+
+    Io_factory::Type io_type = ((flags & FDS_FILE_NOASYNC) != 0)
+        ? Io_factory::Type::IO_SYNC
+        : Io_factory::Type::IO_DEFAULT;
+
+    try {
+        File_compactor compactor(src, dst, alg, level, threads, io_type);
+        compactor.run();
+    } catch (File_exception &ex) {
+        return ex.code();
+    } catch (...) {
+        return FDS_ERR_INTERNAL;
+    }
+
+    return FDS_OK;
+}
+
+int
+fds_file_buffers_cfg(size_t idle_max, uint32_t flags)
+{
+    if ((flags & ~uint32_t(FDS_FILE_BUFFERS_HUGEPAGES)) != 0) {
+        return FDS_ERR_ARG;
+    }
+
+    bool hugepages = (flags & FDS_FILE_BUFFERS_HUGEPAGES) != 0;
+    Buffer_pool::instance().configure(idle_max, hugepages);
+    return FDS_OK;
+}
@@ -60,6 +60,8 @@ struct ipxfil_lookup_item {
         const struct fds_iemgr_alias *alias;
         int64_t constant;
     };
+    // Field accessors (forward and reverse) of the element or each source of the alias
+    struct fds_drec_accessor *accessors;
 };
 
 struct ipxfil_lookup_table {
@@ -67,9 +69,24 @@ struct ipxfil_lookup_table {
     struct ipxfil_lookup_item *items;
 };
 
+enum ipxfil_offsets_state {
+    IPXFIL_OFFSETS_NONE,        // not created yet for the evaluated record
+    IPXFIL_OFFSETS_READY,
+    IPXFIL_OFFSETS_UNAVAILABLE  // the record is malformed
+};
+
+/** Number of recently evaluated Biflow Templates with known symmetry of the filter */
+#define IPXFIL_SYMMETRY_CACHE 4
+
+struct ipxfil_symmetry {
+    uint64_t uid;   // unique identifier of the template (0 = unused entry)
+    bool symmetric; // all looked up fields are the same from both points of view
+};
+
 struct ipxfil_lookup_state {
     size_t source_idx;
     uint16_t find_flags; // 0, FDS_DREC_BIFLOW_FWD or FDS_DREC_BIFLOW_REV
+    enum ipxfil_offsets_state offsets_state;
 };
 
 struct fds_ipfix_filter {
@@ -80,27 +97,112 @@ struct fds_ipfix_filter {
 
     struct ipxfil_lookup_table lookup_tab;
     struct ipxfil_lookup_state lookup_state;
+
+    // Per-record offsets of the evaluated record (shared by all lookups of the record)
+    struct fds_drec_offsets offsets;
+
+    // Symmetry of the filter for recently evaluated Biflow templates
+    struct ipxfil_symmetry symmetry[IPXFIL_SYMMETRY_CACHE];
+    size_t symmetry_replace;
 };
 
 /**
- * Same as fds_drec_find, but with flags (see fds_drec_iter_init documentation).
+ * Get per-record offsets of the evaluated record (created on the first use)
+ *
+ * Returns NULL if the record is malformed.
+ */
+static const struct fds_drec_offsets *
+get_record_offsets(struct fds_ipfix_filter *ipxfil, struct fds_drec *drec)
+{
+    if (ipxfil->lookup_state.offsets_state == IPXFIL_OFFSETS_NONE) {
+        ipxfil->lookup_state.offsets_state = (fds_drec_index(drec, &ipxfil->offsets) == FDS_OK)
+            ? IPXFIL_OFFSETS_READY : IPXFIL_OFFSETS_UNAVAILABLE;
+    }
+
+    return (ipxfil->lookup_state.offsets_state == IPXFIL_OFFSETS_READY) ? &ipxfil->offsets : NULL;
+}
+
+/**
+ * Create field accessors (forward and reverse) for each of the elements
+ */
+static struct fds_drec_accessor *
+create_accessors(const struct fds_iemgr_elem *const *elems, size_t elems_cnt)
+{
+    struct fds_drec_accessor *accessors = malloc(2 * elems_cnt * sizeof(*accessors));
+    if (accessors == NULL) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < elems_cnt; i++) {
+        const struct fds_iemgr_elem *elem = elems[i];
+        fds_drec_accessor_init(&accessors[2 * i], elem->scope->pen, elem->id, FDS_DREC_BIFLOW_FWD);
+        fds_drec_accessor_init(&accessors[2 * i + 1], elem->scope->pen, elem->id, FDS_DREC_BIFLOW_REV);
+    }
+    return accessors;
+}
+
+/**
+ * Same as fds_drec_find, but using a pair of field accessors (forward and reverse) and the
+ * direction of the current lookup
  */
 static int
-fds_drec_find_with_flags(struct fds_drec *drec, uint32_t pen, uint16_t id, uint16_t flags, struct fds_drec_field *field)
+find_record_field(struct fds_ipfix_filter *ipxfil, struct fds_drec *drec, struct fds_drec_accessor *accessors,
+                  struct fds_drec_field *field)
 {
-    if (flags == 0) {
-        return fds_drec_find(drec, pen, id, field);
+    struct fds_drec_accessor *acc = &accessors[(ipxfil->lookup_state.find_flags == FDS_DREC_BIFLOW_REV) ? 1 : 0];
+    if ((drec->tmplt->flags & FDS_TEMPLATE_DYNAMIC) == 0) {
+        return fds_drec_accessor_get(acc, drec, field);
+    }
 
-    } else {
-        struct fds_drec_iter iter;
-        fds_drec_iter_init(&iter, drec, flags);
+    // Offsets of the record are shared by all lookups
+    return fds_drec_accessor_find(acc, drec, get_record_offsets(ipxfil, drec), field);
+}
 
-        int ret = fds_drec_iter_find(&iter, pen, id);
-        if (ret != FDS_EOC) {
-            *field = iter.field;
+/**
+ * Check if all fields looked up by the filter are the same from the forward and the reverse
+ * point of view of a Biflow record (e.g. only non-directional fields are used), so the filter
+ * gives the same result for both directions. The result is cached per template.
+ */
+static bool
+is_symmetric(struct fds_ipfix_filter *ipxfil, struct fds_drec *drec)
+{
+    const uint64_t uid = drec->tmplt->index.uid;
+    for (size_t i = 0; uid != 0 && i < IPXFIL_SYMMETRY_CACHE; i++) {
+        if (ipxfil->symmetry[i].uid == uid) {
+            return ipxfil->symmetry[i].symmetric;
+        }
+    }
+
+    const struct fds_drec_offsets *offsets = NULL;
+    if (drec->tmplt->flags & FDS_TEMPLATE_DYNAMIC) {
+        offsets = get_record_offsets(ipxfil, drec);
+    }
+
+    bool symmetric = true;
+    for (size_t i = 0; symmetric && i < ipxfil->lookup_tab.cnt; i++) {
+        const struct ipxfil_lookup_item *item = &ipxfil->lookup_tab.items[i];
+        if (item->accessors == NULL) {
+            continue;
+        }
+
+        const size_t sources_cnt = (item->kind == IPXFIL_ALIAS_LOOKUP) ? item->alias->sources_cnt : 1;
+        for (size_t source = 0; symmetric && source < sources_cnt; source++) {
+            struct fds_drec_field field;
+            struct fds_drec_accessor *accessors = &item->accessors[2 * source];
+
+            // Both directions share positions of fields in the record
+            int idx_fwd = fds_drec_accessor_find(&accessors[0], drec, offsets, &field);
+            int idx_rev = fds_drec_accessor_find(&accessors[1], drec, offsets, &field);
+            symmetric = (idx_fwd == idx_rev);
         }
-        return ret;
     }
+
+    if (uid != 0) {
+        ipxfil->symmetry[ipxfil->symmetry_replace].uid = uid;
+        ipxfil->symmetry[ipxfil->symmetry_replace].symmetric = symmetric;
+        ipxfil->symmetry_replace = (ipxfil->symmetry_replace + 1) % IPXFIL_SYMMETRY_CACHE;
+    }
+    return symmetric;
 }
 
 /**
@@ -127,6 +229,7 @@ add_lookup_item(struct ipxfil_lookup_table *tab)
     }
     tab->cnt++;
     tab->items = tmp;
+    memset(&tab->items[tab->cnt - 1], 0, sizeof(struct ipxfil_lookup_item));
     return &tab->items[tab->cnt - 1];
 }
 
@@ -241,6 +344,11 @@ lookup_callback(void *user_ctx, const char *name, const char *other_name,
         item->name = name;
         item->kind = IPXFIL_ALIAS_LOOKUP;
         item->alias = alias;
+        item->accessors = create_accessors((const struct fds_iemgr_elem *const *) alias->sources, alias->sources_cnt);
+        if (item->accessors == NULL) {
+            ipxfil->error = MEMORY_ERROR;
+            return ipxfil->error->code;
+        }
         *out_data_type = item->filter_data_type;
         *out_id = get_item_index(&ipxfil->lookup_tab, item);
         return FDS_OK;
@@ -262,6 +370,11 @@ lookup_callback(void *user_ctx, const char *name, const char *other_name,
         item->name = name;
         item->kind = IPXFIL_FIELD_LOOKUP;
         item->elem = elem;
+        item->accessors = create_accessors(&elem, 1);
+        if (item->accessors == NULL) {
+            ipxfil->error = MEMORY_ERROR;
+            return ipxfil->error->code;
+        }
         *out_data_type = item->filter_data_type;
         *out_id = get_item_index(&ipxfil->lookup_tab, item);
         return FDS_OK;
@@ -316,13 +429,12 @@ set_default_value(fds_filter_value_u *out_value)
  * Try to read the desired field from a record into a filter value
  */
 static int
-read_record_field(struct fds_drec *record, const struct fds_iemgr_elem *field_def, uint16_t find_flags,
-                  fds_filter_value_u *out_value)
+read_record_field(struct fds_ipfix_filter *ipxfil, struct fds_drec *record, const struct fds_iemgr_elem *field_def,
+                  struct fds_drec_accessor *accessors, fds_filter_value_u *out_value)
 {
     struct fds_drec_field field;
-
     // The wanted field does not exist in the record
-    if (fds_drec_find_with_flags(record, field_def->scope->pen, field_def->id, find_flags, &field) == FDS_EOC) {
+    if (find_record_field(ipxfil, record, accessors, &field) == FDS_EOC) {
         return FDS_ERR_NOTFOUND;
     }
 
@@ -414,13 +526,15 @@ read_record_field(struct fds_drec *record, const struct fds_iemgr_elem *field_de
  * Read the first source that is found in the record
  */
 static bool
-read_first_of(struct fds_drec *record, const struct fds_iemgr_alias *alias, size_t *source_idx, uint16_t find_flags,
-              fds_filter_value_u *out_value)
+read_first_of(struct fds_ipfix_filter *ipxfil, struct fds_drec *record, const struct fds_iemgr_alias *alias,
+              struct fds_drec_accessor *accessors, fds_filter_value_u *out_value)
 {
+    size_t *source_idx = &ipxfil->lookup_state.source_idx;
     while (*source_idx < alias->sources_cnt) {
         const struct fds_iemgr_elem *field_def = alias->sources[*source_idx];
+        struct fds_drec_accessor *field_accessors = &accessors[2 * (*source_idx)];
         (*source_idx)++;
-        if (read_record_field(record, field_def, find_flags, out_value) == FDS_OK) {
+        if (read_record_field(ipxfil, record, field_def, field_accessors, out_value) == FDS_OK) {
             return true;
         }
     }
@@ -451,8 +565,7 @@ data_callback(void *user_ctx, bool reset_ctx, int id, void *data, fds_filter_val
         case FDS_ALIAS_FIRST_OF:
             if (reset_ctx) {
                 ipxfil->lookup_state.source_idx = 0;
-                return read_first_of(rec, item->alias, &ipxfil->lookup_state.source_idx, ipxfil->lookup_state.find_flags, out_value)
-                    ? FDS_OK : FDS_ERR_NOTFOUND;
+                return read_first_of(ipxfil, rec, item->alias, item->accessors, out_value) ? FDS_OK : FDS_ERR_NOTFOUND;
             }
             set_default_value(out_value);
             return FDS_ERR_NOTFOUND;
@@ -461,15 +574,14 @@ data_callback(void *user_ctx, bool reset_ctx, int id, void *data, fds_filter_val
             if (reset_ctx) {
                 ipxfil->lookup_state.source_idx = 0;
             }
-            return read_first_of(rec, item->alias, &ipxfil->lookup_state.source_idx, ipxfil->lookup_state.find_flags, out_value)
-                ? FDS_OK_MORE : FDS_ERR_NOTFOUND;
+            return read_first_of(ipxfil, rec, item->alias, item->accessors, out_value) ? FDS_OK_MORE : FDS_ERR_NOTFOUND;
         default:
             assert(0);
         }
         break;
 
     case IPXFIL_FIELD_LOOKUP: {
-        int rc = read_record_field(rec, item->elem, ipxfil->lookup_state.find_flags, out_value);
+        int rc = read_record_field(ipxfil, rec, item->elem, item->accessors, out_value);
         if (rc != FDS_OK) {
             set_default_value(out_value);
         }
@@ -516,13 +628,27 @@ fds_ipfix_filter_eval(struct fds_ipfix_filter *ipxfil, struct fds_drec *record)
 {
     ipxfil->lookup_state.source_idx = 0;
     ipxfil->lookup_state.find_flags = 0;
+    ipxfil->lookup_state.offsets_state = IPXFIL_OFFSETS_NONE;
     return fds_filter_eval(ipxfil->filter, record);
 }
 
 enum fds_ipfix_filter_match
 fds_ipfix_filter_eval_biflow(struct fds_ipfix_filter *ipxfil, struct fds_drec *record)
 {
-    if (record->tmplt->flags & FDS_TEMPLATE_BIFLOW) {
+    // Offsets of the record are shared by evaluations of both directions
+    ipxfil->lookup_state.offsets_state = IPXFIL_OFFSETS_NONE;
+
+    if ((record->tmplt->flags & FDS_TEMPLATE_BIFLOW) && is_symmetric(ipxfil, record)) {
+        // The filter gives the same result for both directions
+        ipxfil->lookup_state.source_idx = 0;
+        ipxfil->lookup_state.find_flags = FDS_DREC_BIFLOW_FWD;
+        if (fds_filter_eval(ipxfil->filter, record)) {
+            return FDS_IPFIX_FILTER_MATCH_BOTH;
+        } else {
+            return FDS_IPFIX_FILTER_NO_MATCH;
+        }
+
+    } else if (record->tmplt->flags & FDS_TEMPLATE_BIFLOW) {
         int result = 0;
 
         ipxfil->lookup_state.source_idx = 0;
@@ -555,6 +681,9 @@ void
 fds_ipfix_filter_destroy(struct fds_ipfix_filter *ipxfil)
 {
     fds_filter_destroy(ipxfil->filter);
+    for (size_t i = 0; i < ipxfil->lookup_tab.cnt; i++) {
+        free(ipxfil->lookup_tab.items[i].accessors);
+    }
     free(ipxfil->lookup_tab.items);
     free(ipxfil);
 }
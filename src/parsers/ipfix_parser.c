@@ -40,6 +40,7 @@
  */
 
 #include <inttypes.h>
+#include <limits.h>
 #include <stdio.h>
 #include <libfds.h>
 
@@ -51,6 +52,10 @@ enum error_codes {
     ERR_SETS_UNEXP_END,
     ERR_SETS_SET_SHORT,
     ERR_SETS_SET_LONG,
+    // IPFIX Message index
+    ERR_MSG_SHORT,
+    ERR_MSG_LONG,
+    ERR_MSG_VERSION,
     // IPFIX Data record iterator
     ERR_DSET_VAR_LONG,
     ERR_DSET_EMPTY,
@@ -78,6 +83,11 @@ static const char *err_msg[] = {
     [ERR_SETS_SET_SHORT] = "Total length of the Set is shorter than a length of an IPFIX Set "
         "header.",
     [ERR_SETS_SET_LONG]  = "Total length of the Set is longer than its enclosing IPFIX Message.",
+    // IPFIX Message index
+    [ERR_MSG_SHORT]      = "Total length of the IPFIX Message is shorter than a length of an IPFIX "
+        "Message header.",
+    [ERR_MSG_LONG]       = "Total length of the IPFIX Message exceeds the size of its buffer.",
+    [ERR_MSG_VERSION]    = "Version of the IPFIX Message is not supported.",
     // IPFIX Data record iterator
     [ERR_DSET_VAR_LONG]  = "A variable-length Data Record is longer than its enclosing Data Set.",
     [ERR_DSET_EMPTY]     = "A Data Set must not be empty. At least one record must be present.",
@@ -159,6 +169,101 @@ fds_sets_iter_err(const struct fds_sets_iter *it)
 
 // -------------------------------------------------------------------------------------------------
 
+int
+fds_msg_index(const struct fds_ipfix_msg_hdr *msg, size_t msg_len, struct fds_msg_index *idx)
+{
+    idx->flags = 0;
+    idx->tsets_cnt = 0;
+    idx->dsets_cnt = 0;
+    idx->sets_cnt = 0;
+    idx->err_msg = err_msg[ERR_OK];
+
+    // Check the Message header
+    if (msg_len < FDS_IPFIX_MSG_HDR_LEN) {
+        idx->err_msg = err_msg[ERR_MSG_SHORT];
+        return FDS_ERR_FORMAT;
+    }
+
+    const uint16_t total_len = ntohs(msg->length);
+    if (total_len < FDS_IPFIX_MSG_HDR_LEN) {
+        idx->err_msg = err_msg[ERR_MSG_SHORT];
+        return FDS_ERR_FORMAT;
+    }
+
+    if ((size_t) total_len > msg_len) {
+        // The Message length in the header exceeds the buffer
+        idx->err_msg = err_msg[ERR_MSG_LONG];
+        return FDS_ERR_FORMAT;
+    }
+
+    if (ntohs(msg->version) != FDS_IPFIX_VERSION) {
+        idx->err_msg = err_msg[ERR_MSG_VERSION];
+        return FDS_ERR_FORMAT;
+    }
+
+    const uint8_t *msg_start = (const uint8_t *) msg;
+    uint16_t offset = FDS_IPFIX_MSG_HDR_LEN;
+
+    while (offset != total_len) {
+        assert(offset < total_len);
+        if (total_len - offset < FDS_IPFIX_SET_HDR_LEN) {
+            // Unexpected end of the IPFIX Message
+            idx->err_msg = err_msg[ERR_SETS_UNEXP_END];
+            return FDS_ERR_FORMAT;
+        }
+
+        const struct fds_ipfix_set_hdr *set =
+            (const struct fds_ipfix_set_hdr *) (msg_start + offset);
+        const uint16_t set_len = ntohs(set->length);
+        const uint16_t set_id = ntohs(set->flowset_id);
+
+        if (set_len < FDS_IPFIX_SET_HDR_LEN) {
+            // Length of a Set is shorter than an IPFIX Set header.
+            idx->err_msg = err_msg[ERR_SETS_SET_SHORT];
+            return FDS_ERR_FORMAT;
+        }
+
+        if (set_len > total_len - offset) {
+            // Length of the Set is longer than its enclosing IPFIX Message
+            idx->err_msg = err_msg[ERR_SETS_SET_LONG];
+            return FDS_ERR_FORMAT;
+        }
+
+        uint16_t set_flags = 0;
+        if (set_id >= FDS_IPFIX_SET_MIN_DSET) {
+            set_flags = FDS_MSG_INDEX_DSET;
+            idx->dsets_cnt++;
+        } else if (set_id == FDS_IPFIX_SET_TMPLT || set_id == FDS_IPFIX_SET_OPTS_TMPLT) {
+            set_flags = (set_id == FDS_IPFIX_SET_TMPLT) ? FDS_MSG_INDEX_TSET : FDS_MSG_INDEX_OTSET;
+            idx->tsets_cnt++;
+
+            // Withdrawals cannot be mixed with definitions, so the first record is enough
+            const uint16_t rec_min = FDS_IPFIX_SET_HDR_LEN + FDS_IPFIX_WDRL_TREC_LEN;
+            const struct fds_ipfix_wdrl_trec *rec = (const struct fds_ipfix_wdrl_trec *) (set + 1);
+            if (set_len >= rec_min && ntohs(rec->count) == 0) {
+                set_flags |= FDS_MSG_INDEX_WDRL;
+            }
+        }
+
+        idx->flags |= set_flags;
+        if (idx->sets_cnt < FDS_MSG_INDEX_MAX) {
+            struct fds_msg_index_set *info = &idx->sets[idx->sets_cnt++];
+            info->offset = offset;
+            info->id = set_id;
+            info->length = set_len;
+            info->flags = set_flags;
+        } else {
+            idx->flags |= FDS_MSG_INDEX_TRUNC;
+        }
+
+        offset += set_len;
+    }
+
+    return FDS_OK;
+}
+
+// -------------------------------------------------------------------------------------------------
+
 /** \brief Internal iterator flags      */
 enum fds_dset_iter_flags {
     /** Initialization fail and an error message is set */
@@ -189,6 +294,57 @@ fds_dset_iter_init(struct fds_dset_iter *it, struct fds_ipfix_set_hdr *set,
     }
 }
 
+/**
+ * \brief Determine the length of a Data Record based on a Template with variable-length fields
+ *
+ * Only length prefixes of variable-length fields are read. Lengths of fixed-length fields
+ * between them are precomputed in the Template (see fds_template_index#dyn_runs).
+ * \param[in]  rec     Start of the Data Record
+ * \param[in]  set_end First byte after the end of the Data Set
+ * \param[in]  tmplt   Template of the Data Record
+ * \param[out] size    Length of the Data Record
+ * \return True on success. False if the Data Record is longer than its enclosing Data Set.
+ */
+static inline bool
+dset_rec_size(const uint8_t *rec, const uint8_t *set_end, const struct fds_template *tmplt,
+    uint32_t *size)
+{
+    const uint16_t *runs = tmplt->index.dyn_runs;
+    const uint16_t dyn_cnt = tmplt->index.dyn_cnt;
+    const size_t avail = (size_t) (set_end - rec);
+    size_t pos = 0;
+    assert(runs != NULL && "Runs of fixed-length fields are not defined!");
+
+    for (uint16_t i = 0; i < dyn_cnt; ++i) {
+        // Skip fixed-length fields and read the length prefix of the variable-length field
+        pos += runs[i];
+        if (pos + 1U > avail) {
+            return false;
+        }
+
+        uint16_t field_size = rec[pos];
+        pos += 1U;
+        if (field_size == 255U) {
+            if (pos + 2U > avail) {
+                return false;
+            }
+
+            field_size = ntohs(*(const uint16_t *) &rec[pos]);
+            pos += 2U;
+        }
+
+        pos += field_size;
+    }
+
+    pos += runs[dyn_cnt];
+    if (pos > avail) {
+        return false;
+    }
+
+    *size = (uint32_t) pos;
+    return true;
+}
+
 int
 fds_dset_iter_next(struct fds_dset_iter *it)
 {
@@ -222,49 +378,127 @@ fds_dset_iter_next(struct fds_dset_iter *it)
     }
 
     // Processing a dynamic record
-    size = 0;
-    uint16_t idx;
+    if (!dset_rec_size(it->_private.rec_next, it->_private.set_end, tmplt, &size)) {
+        // A variable-length Data Record is longer than its enclosing Data Set.
+        it->_private.err_msg = err_msg[ERR_DSET_VAR_LONG];
+        return FDS_ERR_FORMAT;
+    }
 
-    for (idx = 0; idx < tmplt->fields_cnt_total; ++idx) {
-        uint16_t field_size = tmplt->fields[idx].length;
-        if (field_size != FDS_IPFIX_VAR_IE_LEN) {
-            size += field_size;
-            continue;
-        }
+    it->rec = it->_private.rec_next;
+    it->size = (uint16_t) size;
+    it->_private.rec_next += size;
+    return FDS_OK;
+}
 
-        // This is a field with variable-length encoding
-        if (&it->_private.rec_next[size + 1] > it->_private.set_end) {
-            // The memory is beyond the end of the Data Set
-            break;
+/**
+ * \brief Locate consecutive Data Records in a Data Set
+ *
+ * Records are located until the end of the Data Set (the rest can be padding), the capacity of
+ * the arrays is reached or a malformed record is found.
+ * \param[in,out] rec     [in] Start of the first record / [out] Start of the next record
+ * \param[in]     set_end First byte after the end of the Data Set
+ * \param[in]     tmplt   Template of Data Records
+ * \param[out]    recs    Array of pointers to the start of Data Records
+ * \param[out]    sizes   Array of sizes of Data Records
+ * \param[in,out] cnt     [in] Capacity of the arrays / [out] Number of filled Data Records
+ * \return #FDS_OK if the end of the Data Set has been reached.
+ * \return #FDS_ERR_BUFFER if the capacity has been reached and more records might follow.
+ * \return #FDS_ERR_FORMAT if a variable-length Data Record is longer than the Data Set.
+ */
+static int
+dset_records_get(uint8_t **rec, const uint8_t *set_end, const struct fds_template *tmplt,
+    uint8_t **recs, uint16_t *sizes, size_t *cnt)
+{
+    const uint32_t rec_min = tmplt->data_length;
+    const size_t capacity = *cnt;
+    uint8_t *rec_next = *rec;
+    assert(rec_min > 0);
+
+    if ((tmplt->flags & FDS_TEMPLATE_DYNAMIC) == 0) {
+        // All records have the same size (the rest of the Data Set is padding)
+        const size_t rec_total = (size_t) (set_end - rec_next) / rec_min;
+        const size_t rec_cnt = (rec_total < capacity) ? rec_total : capacity;
+        for (size_t i = 0; i < rec_cnt; ++i) {
+            recs[i] = rec_next + i * rec_min;
+            sizes[i] = (uint16_t) rec_min;
         }
 
+        *rec = rec_next + rec_cnt * rec_min;
+        *cnt = rec_cnt;
+        return (rec_cnt == rec_total) ? FDS_OK : FDS_ERR_BUFFER;
+    }
 
-        field_size = it->_private.rec_next[size];
-        size += 1U;
-        if (field_size != 255U) {
-            size += field_size;
-            continue;
+    size_t rec_cnt = 0;
+    int ret = FDS_OK;
+    while (rec_next + rec_min <= set_end) {
+        if (rec_cnt == capacity) {
+            ret = FDS_ERR_BUFFER;
+            break;
         }
 
-        if (&it->_private.rec_next[size + 2] > it->_private.set_end) {
-            // The memory is beyond the end of the Data Set
+        uint32_t size;
+        if (!dset_rec_size(rec_next, set_end, tmplt, &size)) {
+            ret = FDS_ERR_FORMAT;
             break;
         }
 
-        field_size = ntohs(*(uint16_t *) &it->_private.rec_next[size]);
-        size += 2U + field_size;
+        recs[rec_cnt] = rec_next;
+        sizes[rec_cnt] = (uint16_t) size;
+        rec_cnt++;
+        rec_next += size;
     }
 
-    if (idx != tmplt->fields_cnt_total || &it->_private.rec_next[size] > it->_private.set_end) {
-        // A variable-length Data Record is longer than its enclosing Data Set.
-        it->_private.err_msg = err_msg[ERR_DSET_VAR_LONG];
+    *rec = rec_next;
+    *cnt = rec_cnt;
+    return ret;
+}
+
+int
+fds_dset_iter_next_batch(struct fds_dset_iter *it, uint8_t **recs, uint16_t *sizes, size_t max)
+{
+    if ((it->_private.flags & FDS_DSET_ITER_FAILED) != 0) {
+        // Initialization failed, error code is properly set
         return FDS_ERR_FORMAT;
     }
 
-    it->rec = it->_private.rec_next;
-    it->size = (uint16_t) size;
-    it->_private.rec_next += size;
-    return FDS_OK;
+    // The number of records is returned as a positive integer
+    size_t cnt = (max < INT_MAX) ? max : INT_MAX;
+    if (cnt == 0) {
+        return FDS_ERR_ARG;
+    }
+
+    int ret = dset_records_get(&it->_private.rec_next, it->_private.set_end, it->_private.tmplt,
+        recs, sizes, &cnt);
+    if (cnt == 0) {
+        if (ret == FDS_ERR_FORMAT) {
+            // A variable-length Data Record is longer than its enclosing Data Set.
+            it->_private.err_msg = err_msg[ERR_DSET_VAR_LONG];
+            return FDS_ERR_FORMAT;
+        }
+        return FDS_EOC;
+    }
+
+    // If a malformed record follows, the error is reported by the next call
+    it->rec = recs[cnt - 1];
+    it->size = sizes[cnt - 1];
+    return (int) cnt;
+}
+
+int
+fds_dset_split(struct fds_ipfix_set_hdr *set, const struct fds_template *tmplt, uint8_t **recs,
+    uint16_t *sizes, size_t *cnt)
+{
+    assert(ntohs(set->flowset_id) == tmplt->id);
+    uint8_t *rec = ((uint8_t *) set) + FDS_IPFIX_SET_HDR_LEN;
+    const uint8_t *set_end = ((uint8_t *) set) + ntohs(set->length);
+
+    if (tmplt->data_length == 0 || rec + tmplt->data_length > set_end) {
+        // Empty set is not valid (see RFC 7011, Section 2, Data Set)
+        *cnt = 0;
+        return FDS_ERR_FORMAT;
+    }
+
+    return dset_records_get(&rec, set_end, tmplt, recs, sizes, cnt);
 }
 
 const char *
@@ -136,6 +136,12 @@ garbage_empty(const fds_tgarbage_t *gc)
     return (gc->cnt_used == 0);
 }
 
+size_t
+garbage_size(const fds_tgarbage_t *gc)
+{
+    return gc->cnt_used;
+}
+
 void
 garbage_remove(fds_tgarbage_t *gc)
 {
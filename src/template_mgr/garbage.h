@@ -44,6 +44,7 @@
 #define IPFIXCOL_GARBAGE_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <libfds/template_mgr.h>
 
 /**
@@ -94,5 +95,13 @@ garbage_remove(fds_tgarbage_t *gc);
 bool
 garbage_empty(const fds_tgarbage_t *gc);
 
+/**
+ * \brief Get the number of garbage records
+ * \param[in] gc Garbage collection
+ * \return Number of records
+ */
+size_t
+garbage_size(const fds_tgarbage_t *gc);
+
 
 #endif //IPFIXCOL_GARBAGE_H
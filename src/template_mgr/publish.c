@@ -0,0 +1,197 @@
+/**
+ * \file src/template_mgr/publish.c
+ * \author agent <agent@local>
+ * \brief Publishing of snapshots to concurrent readers (source file)
+ * \date October 2026
+ *
+ * Copyright(c) 2026 CESNET z.s.p.o.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include "garbage.h"
+#include "publish.h"
+
+void
+publish_init(struct publish *pub)
+{
+    atomic_init(&pub->snap, NULL);
+    atomic_init(&pub->epoch, 1);
+    atomic_init(&pub->readers, NULL);
+    pub->retired_head = pub->retired_tail = NULL;
+    pub->spare = NULL;
+    pub->rcl = NULL;
+}
+
+void
+publish_deinit(struct publish *pub)
+{
+    struct publish_retired *item = pub->retired_head;
+    while (item) {
+        struct publish_retired *next = item->next;
+        garbage_destroy(item->gc);
+        free(item);
+        item = next;
+    }
+
+    free(pub->spare);
+
+    struct fds_treader *reader = atomic_load(&pub->readers);
+    while (reader) {
+        struct fds_treader *next = reader->next;
+        assert(!atomic_load(&reader->used) && "All readers must be destroyed");
+        free(reader);
+        reader = next;
+    }
+
+    pub->retired_head = pub->retired_tail = pub->spare = NULL;
+    atomic_store(&pub->readers, NULL);
+    atomic_store(&pub->snap, NULL);
+}
+
+void
+publish_snapshot(struct publish *pub, const struct fds_tsnapshot *snap)
+{
+    atomic_store(&pub->snap, snap);
+}
+
+/**
+ * \brief Get the oldest epoch in which an active reader entered its critical section
+ * \param[in] pub Publisher
+ * \return Epoch or UINT64_MAX (no reader is in its critical section)
+ */
+static uint64_t
+publish_epoch_min(struct publish *pub)
+{
+    uint64_t result = UINT64_MAX;
+    for (struct fds_treader *reader = atomic_load(&pub->readers); reader; reader = reader->next) {
+        const uint64_t epoch = atomic_load(&reader->epoch);
+        if (epoch != 0 && epoch < result) {
+            result = epoch;
+        }
+    }
+
+    return result;
+}
+
+void
+publish_reclaim(struct publish *pub)
+{
+    if (!pub->retired_head) {
+        return;
+    }
+
+    // Readers that entered in a newer epoch cannot access the garbage
+    const uint64_t epoch_min = publish_epoch_min(pub);
+    while (pub->retired_head && pub->retired_head->epoch < epoch_min) {
+        struct publish_retired *item = pub->retired_head;
+        pub->retired_head = item->next;
+        if (!pub->rcl || fds_tmgr_reclaimer_add(pub->rcl, item->gc) != FDS_OK) {
+            garbage_destroy(item->gc);
+        }
+
+        if (!pub->spare) {
+            // Keep the item for the next retirement
+            pub->spare = item;
+        } else {
+            free(item);
+        }
+    }
+
+    if (!pub->retired_head) {
+        pub->retired_tail = NULL;
+    }
+}
+
+int
+publish_reserve(struct publish *pub)
+{
+    if (!pub->spare && !(pub->spare = malloc(sizeof(*pub->spare)))) {
+        return FDS_ERR_NOMEM;
+    }
+
+    return FDS_OK;
+}
+
+void
+publish_retire(struct publish *pub, fds_tgarbage_t *gc)
+{
+    if (gc != NULL) {
+        struct publish_retired *item = pub->spare;
+        assert(item != NULL && "publish_reserve() must be called first");
+        pub->spare = NULL;
+
+        // Readers that see the new epoch also see the new snapshot
+        item->next = NULL;
+        item->epoch = atomic_fetch_add(&pub->epoch, 1);
+        item->gc = gc;
+        if (pub->retired_tail) {
+            pub->retired_tail->next = item;
+        } else {
+            pub->retired_head = item;
+        }
+        pub->retired_tail = item;
+    }
+
+    publish_reclaim(pub);
+}
+
+fds_treader_t *
+publish_reader_create(struct publish *pub)
+{
+    // Try to reuse a slot of a destroyed reader
+    for (struct fds_treader *reader = atomic_load(&pub->readers); reader; reader = reader->next) {
+        bool expected = false;
+        if (!atomic_load(&reader->used)
+                && atomic_compare_exchange_strong(&reader->used, &expected, true)) {
+            return reader;
+        }
+    }
+
+    struct fds_treader *reader = malloc(sizeof(*reader));
+    if (!reader) {
+        return NULL;
+    }
+
+    reader->pub = pub;
+    atomic_init(&reader->used, true);
+    atomic_init(&reader->epoch, 0);
+
+    // Insert the reader at the beginning of the list (lock-free)
+    struct fds_treader *head = atomic_load(&pub->readers);
+    do {
+        reader->next = head;
+    } while (!atomic_compare_exchange_weak(&pub->readers, &head, reader));
+    return reader;
+}
+
+void
+fds_treader_destroy(fds_treader_t *reader)
+{
+    if (!reader) {
+        return;
+    }
+
+    assert(atomic_load(&reader->epoch) == 0 && "The reader must not be in the critical section");
+    atomic_store(&reader->used, false);
+}
+
+const fds_tsnapshot_t *
+fds_treader_lock(fds_treader_t *reader)
+{
+    struct publish *pub = reader->pub;
+    assert(atomic_load_explicit(&reader->epoch, memory_order_relaxed) == 0);
+
+    /* The announcement of the epoch must be visible to the writer before the snapshot is loaded
+     * (sequentially consistent operations), otherwise the writer could destroy the snapshot.
+     */
+    atomic_store(&reader->epoch, atomic_load(&pub->epoch));
+    return atomic_load(&pub->snap);
+}
+
+void
+fds_treader_unlock(fds_treader_t *reader)
+{
+    atomic_store_explicit(&reader->epoch, 0, memory_order_release);
+}
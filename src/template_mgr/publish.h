@@ -0,0 +1,145 @@
+/**
+ * \file src/template_mgr/publish.h
+ * \author agent <agent@local>
+ * \brief Publishing of snapshots to concurrent readers (internal header file)
+ * \date October 2026
+ *
+ * Copyright(c) 2026 CESNET z.s.p.o.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef PUBLISH_H
+#define PUBLISH_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <libfds.h>
+
+/**
+ * \defgroup publish_aux_func Publishing of snapshots
+ * \ingroup template_manager
+ *
+ * \brief Lock-free distribution of snapshots to reader threads
+ *
+ * A single writer (the thread that owns the template manager) publishes a pointer to the
+ * current snapshot and readers in other threads atomically load it. Snapshots and templates
+ * that are no longer accessible from the manager are not destroyed immediately. They are
+ * retired with the current epoch and destroyed when all readers have left their critical
+ * sections started in this or any older epoch (epoch-based reclamation).
+ *
+ * All functions except the reader API (see fds_treader_lock()) and publish_reader_create() MUST
+ * be called by the writer.
+ * @{
+ */
+
+/** Snapshot reader (a slot in a list of readers) */
+struct fds_treader {
+    /** Next reader in the list (never changed after insertion) */
+    struct fds_treader *next;
+    /** Publisher to which the reader belongs                     */
+    struct publish *pub;
+    /** The slot is used by a reader                              */
+    atomic_bool used;
+    /** Epoch in which the reader entered the critical section (0 = not in the section) */
+    atomic_uint_fast64_t epoch;
+};
+
+/** Garbage retired in a specific epoch */
+struct publish_retired {
+    /** Next (i.e. newer) retired garbage */
+    struct publish_retired *next;
+    /** Epoch in which the garbage has been retired */
+    uint64_t epoch;
+    /** Garbage to destroy                          */
+    fds_tgarbage_t *gc;
+};
+
+/** Publisher of snapshots */
+struct publish {
+    /** Published snapshot (can be NULL)                      */
+    _Atomic(const struct fds_tsnapshot *) snap;
+    /** Global epoch (starts from 1)                          */
+    atomic_uint_fast64_t epoch;
+    /** List of registered readers                            */
+    _Atomic(struct fds_treader *) readers;
+
+    /** The oldest retired garbage (accessed only by the writer) */
+    struct publish_retired *retired_head;
+    /** The newest retired garbage (accessed only by the writer) */
+    struct publish_retired *retired_tail;
+    /** Preallocated item for the next retirement (can be NULL, accessed only by the writer) */
+    struct publish_retired *spare;
+    /** Reclaimer of unreachable garbage (can be NULL, accessed only by the writer) */
+    fds_tmgr_reclaimer_t *rcl;
+};
+
+/**
+ * \brief Initialize a publisher
+ * \param[in] pub Publisher
+ */
+void
+publish_init(struct publish *pub);
+
+/**
+ * \brief Destroy all retired garbage and reader slots of a publisher
+ * \warning All readers MUST be destroyed before the call.
+ * \param[in] pub Publisher
+ */
+void
+publish_deinit(struct publish *pub);
+
+/**
+ * \brief Publish a snapshot
+ * \param[in] pub  Publisher
+ * \param[in] snap Snapshot (can be NULL)
+ */
+void
+publish_snapshot(struct publish *pub, const struct fds_tsnapshot *snap);
+
+/**
+ * \brief Prepare resources for the next call of publish_retire()
+ *
+ * Items of destroyed garbage are reused, so memory is usually allocated only if garbage
+ * is retired more often than it can be destroyed.
+ * \param[in] pub Publisher
+ * \return #FDS_OK on success. Otherwise #FDS_ERR_NOMEM.
+ */
+int
+publish_reserve(struct publish *pub);
+
+/**
+ * \brief Retire garbage and destroy garbage that is not accessible by readers anymore
+ *
+ * The garbage MUST NOT contain the published snapshot, i.e. it must be collected after
+ * the snapshot has been replaced by publish_snapshot().
+ * \warning If the garbage is not NULL, publish_reserve() MUST be successfully called first.
+ * \param[in] pub Publisher
+ * \param[in] gc  Garbage to retire (can be NULL)
+ */
+void
+publish_retire(struct publish *pub, fds_tgarbage_t *gc);
+
+/**
+ * \brief Destroy garbage that is not accessible by readers anymore
+ *
+ * If a reclaimer is set, the garbage is passed to the reclaimer instead. If the reclaimer
+ * fails to accept it, the garbage is destroyed immediately.
+ * \param[in] pub Publisher
+ */
+void
+publish_reclaim(struct publish *pub);
+
+/**
+ * \brief Create a new reader or reuse a slot of a destroyed reader
+ * \note Unlike other functions, the function can be called by any thread.
+ * \param[in] pub Publisher
+ * \return Pointer to the reader or NULL (memory allocation error)
+ */
+fds_treader_t *
+publish_reader_create(struct publish *pub);
+
+/**
+ * @}
+ */
+
+#endif // PUBLISH_H
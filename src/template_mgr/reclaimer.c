@@ -0,0 +1,238 @@
+/**
+ * \file src/template_mgr/reclaimer.c
+ * \author agent <agent@local>
+ * \brief Background destruction of template garbage (source file)
+ * \date October 2026
+ *
+ * Copyright(c) 2026 CESNET z.s.p.o.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
+#include <libfds.h>
+#include "garbage.h"
+
+struct fds_tmgr_reclaimer {
+    /** Background thread                                          */
+    pthread_t thread;
+    /** Minimal interval between batches (in milliseconds)         */
+    uint32_t interval;
+
+    /** Lock of all following members                              */
+    pthread_mutex_t lock;
+    /** Condition signaled when garbage is added or the thread should stop */
+    pthread_cond_t cond_add;
+    /** Condition signaled when a batch has been destroyed         */
+    pthread_cond_t cond_done;
+    /** The thread should destroy all garbage and stop             */
+    bool stop;
+    /** Number of threads waiting for destruction of garbage (see fds_tmgr_reclaimer_flush()) */
+    unsigned int flush_waiting;
+
+    /** Garbage waiting for destruction (can be NULL)              */
+    fds_tgarbage_t *pending;
+    /** Number of garbage collections in the pending garbage       */
+    uint64_t pending_gc;
+    /** Statistics                                                 */
+    struct fds_tmgr_reclaimer_stats stats;
+};
+
+/**
+ * \brief Wait until the end of the interval between batches
+ *
+ * The wait is interrupted if the thread should stop or a thread waits for destruction of
+ * garbage (see fds_tmgr_reclaimer_flush()).
+ * \warning The reclaimer MUST be locked.
+ * \param[in] rcl Reclaimer
+ */
+static void
+reclaimer_interval_wait(struct fds_tmgr_reclaimer *rcl)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += rcl->interval / 1000U;
+    deadline.tv_nsec += (long) (rcl->interval % 1000U) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    while (!rcl->stop && rcl->flush_waiting == 0) {
+        if (pthread_cond_timedwait(&rcl->cond_add, &rcl->lock, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+}
+
+/**
+ * \brief Main function of the background thread
+ * \param[in] arg Reclaimer
+ * \return Always NULL
+ */
+static void *
+reclaimer_thread(void *arg)
+{
+    struct fds_tmgr_reclaimer *rcl = arg;
+
+    pthread_mutex_lock(&rcl->lock);
+    while (true) {
+        while (!rcl->stop && !rcl->pending) {
+            pthread_cond_wait(&rcl->cond_add, &rcl->lock);
+        }
+
+        if (!rcl->pending) {
+            // Stop and nothing to destroy
+            break;
+        }
+
+        if (rcl->interval != 0) {
+            // Let more garbage to accumulate
+            reclaimer_interval_wait(rcl);
+        }
+
+        // Take all pending garbage and destroy it without the lock
+        fds_tgarbage_t *gc = rcl->pending;
+        const uint64_t gc_cnt = rcl->pending_gc;
+        const uint64_t rec_cnt = rcl->stats.rec_pending;
+        rcl->pending = NULL;
+        rcl->pending_gc = 0;
+        pthread_mutex_unlock(&rcl->lock);
+
+        garbage_destroy(gc);
+
+        pthread_mutex_lock(&rcl->lock);
+        rcl->stats.gc_destroyed += gc_cnt;
+        rcl->stats.rec_destroyed += rec_cnt;
+        rcl->stats.rec_pending -= rec_cnt;
+        rcl->stats.batches++;
+        pthread_cond_broadcast(&rcl->cond_done);
+    }
+    pthread_mutex_unlock(&rcl->lock);
+
+    return NULL;
+}
+
+fds_tmgr_reclaimer_t *
+fds_tmgr_reclaimer_create(uint32_t interval)
+{
+    struct fds_tmgr_reclaimer *rcl = calloc(1, sizeof(*rcl));
+    if (!rcl) {
+        return NULL;
+    }
+
+    rcl->interval = interval;
+    if (pthread_mutex_init(&rcl->lock, NULL) != 0) {
+        free(rcl);
+        return NULL;
+    }
+
+    // The interval is measured using a monotonic clock
+    pthread_condattr_t attr;
+    if (pthread_condattr_init(&attr) != 0) {
+        pthread_mutex_destroy(&rcl->lock);
+        free(rcl);
+        return NULL;
+    }
+
+    bool failed = (pthread_condattr_setclock(&attr, CLOCK_MONOTONIC) != 0);
+    if (failed || pthread_cond_init(&rcl->cond_add, &attr) != 0) {
+        pthread_condattr_destroy(&attr);
+        pthread_mutex_destroy(&rcl->lock);
+        free(rcl);
+        return NULL;
+    }
+    pthread_condattr_destroy(&attr);
+
+    if (pthread_cond_init(&rcl->cond_done, NULL) != 0) {
+        pthread_cond_destroy(&rcl->cond_add);
+        pthread_mutex_destroy(&rcl->lock);
+        free(rcl);
+        return NULL;
+    }
+
+    if (pthread_create(&rcl->thread, NULL, &reclaimer_thread, rcl) != 0) {
+        pthread_cond_destroy(&rcl->cond_done);
+        pthread_cond_destroy(&rcl->cond_add);
+        pthread_mutex_destroy(&rcl->lock);
+        free(rcl);
+        return NULL;
+    }
+
+    return rcl;
+}
+
+void
+fds_tmgr_reclaimer_destroy(fds_tmgr_reclaimer_t *rcl)
+{
+    if (!rcl) {
+        return;
+    }
+
+    // Stop the thread (all pending garbage is destroyed first)
+    pthread_mutex_lock(&rcl->lock);
+    rcl->stop = true;
+    pthread_cond_signal(&rcl->cond_add);
+    pthread_mutex_unlock(&rcl->lock);
+    pthread_join(rcl->thread, NULL);
+
+    pthread_cond_destroy(&rcl->cond_done);
+    pthread_cond_destroy(&rcl->cond_add);
+    pthread_mutex_destroy(&rcl->lock);
+    free(rcl);
+}
+
+int
+fds_tmgr_reclaimer_add(fds_tmgr_reclaimer_t *rcl, fds_tgarbage_t *gc)
+{
+    if (!gc) {
+        return FDS_OK;
+    }
+
+    const size_t rec_cnt = garbage_size(gc);
+    int ret_code = FDS_OK;
+
+    pthread_mutex_lock(&rcl->lock);
+    if (!rcl->pending) {
+        // Use the garbage directly
+        rcl->pending = gc;
+    } else {
+        ret_code = garbage_append(rcl->pending, gc, (garbage_fn_t) &garbage_destroy);
+    }
+
+    if (ret_code == FDS_OK) {
+        rcl->pending_gc++;
+        rcl->stats.gc_added++;
+        rcl->stats.rec_pending += rec_cnt;
+        pthread_cond_signal(&rcl->cond_add);
+    }
+    pthread_mutex_unlock(&rcl->lock);
+    return ret_code;
+}
+
+void
+fds_tmgr_reclaimer_flush(fds_tmgr_reclaimer_t *rcl)
+{
+    pthread_mutex_lock(&rcl->lock);
+    const uint64_t target = rcl->stats.gc_added;
+    rcl->flush_waiting++;
+    pthread_cond_signal(&rcl->cond_add); // Interrupt the interval between batches
+
+    while (rcl->stats.gc_destroyed < target) {
+        pthread_cond_wait(&rcl->cond_done, &rcl->lock);
+    }
+
+    rcl->flush_waiting--;
+    pthread_mutex_unlock(&rcl->lock);
+}
+
+void
+fds_tmgr_reclaimer_stats(fds_tmgr_reclaimer_t *rcl, struct fds_tmgr_reclaimer_stats *stats)
+{
+    pthread_mutex_lock(&rcl->lock);
+    *stats = rcl->stats;
+    pthread_mutex_unlock(&rcl->lock);
+}
@@ -0,0 +1,580 @@
+/**
+ * \file src/template_mgr/registry.c
+ * \author agent <agent@local>
+ * \brief Registry of template managers (source file)
+ * \date October 2026
+ *
+ * Copyright(c) 2026 CESNET z.s.p.o.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <libfds.h>
+#include "garbage.h"
+#include "tmgr_iemgr.h"
+
+/** Default number of shards of the registry         */
+#define REGISTRY_SHARDS_DEF 16U
+/** Maximal number of shards of the registry         */
+#define REGISTRY_SHARDS_MAX 1024U
+/** Minimal number of buckets of a shard (must be a power of two) */
+#define REGISTRY_BUCKETS_MIN 16U
+
+/** Template manager in the registry */
+struct registry_entry {
+    /** Next entry in the same bucket           */
+    struct registry_entry *next;
+    /** Hash of the key                         */
+    uint64_t hash;
+    /** Transport Session (the first part of the key) */
+    const void *session;
+    /** Observation Domain ID (the second part of the key) */
+    uint32_t odid;
+    /** The last time the manager has been used */
+    uint32_t last_used;
+    /** Generation of the IE manager requested from the template manager (see tmgr_iemgr_request()) */
+    uint64_t ies_gen;
+    /** Template manager                        */
+    fds_tmgr_t *tmgr;
+};
+
+/** Shard of the registry (an independently locked hash table) */
+struct registry_shard {
+    /** Lock of the shard                                   */
+    pthread_mutex_t lock;
+    /** Hash table of entries (separate chaining)           */
+    struct registry_entry **buckets;
+    /** Number of buckets (always a power of two)           */
+    size_t bucket_cnt;
+    /** Number of entries in the shard                      */
+    size_t entry_cnt;
+};
+
+struct fds_tmgr_registry {
+    /** Array of shards                                     */
+    struct registry_shard *shards;
+    /** Number of shards                                    */
+    unsigned int shard_cnt;
+
+    /** Position of the next timeout sweep (protected by the lock of sweeps) */
+    struct {
+        /** Lock of sweeps        */
+        pthread_mutex_t lock;
+        /** Index of the shard    */
+        unsigned int shard;
+        /** Index of the bucket   */
+        size_t bucket;
+    } sweep;
+
+    /** Shared garbage (protected by the lock of garbage) */
+    struct {
+        /** Lock of garbage       */
+        pthread_mutex_t lock;
+        /** Collected garbage (can be NULL) */
+        fds_tgarbage_t *gc;
+        /** Reclaimer of the collected garbage (can be NULL) */
+        fds_tmgr_reclaimer_t *rcl;
+    } garbage;
+
+    /** IE manager of all template managers (protected by the lock of IE managers) */
+    struct {
+        /** Lock of IE managers   */
+        pthread_mutex_t lock;
+        /** The IE manager (can be NULL) */
+        const fds_iemgr_t *iemgr;
+        /** Generation of the IE manager (incremented on every change, 0 = not set) */
+        uint64_t gen;
+        /** Copy of the generation for checks without the lock */
+        atomic_uint_fast64_t gen_now;
+    } ies;
+};
+
+/**
+ * \brief Calculate a hash of the key
+ * \param[in] session Transport Session
+ * \param[in] odid    Observation Domain ID
+ * \return Hash value
+ */
+static inline uint64_t
+registry_hash(const void *session, uint32_t odid)
+{
+    // Mixing function of SplitMix64
+    uint64_t hash = ((uint64_t) (uintptr_t) session) ^ ((uint64_t) odid << 32) ^ odid;
+    hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBULL;
+    return hash ^ (hash >> 31);
+}
+
+/**
+ * \brief Get a shard of the key
+ * \param[in] reg  Registry
+ * \param[in] hash Hash of the key
+ * \return Shard (the lower bits of the hash are reserved for buckets)
+ */
+static inline struct registry_shard *
+registry_shard_get(const fds_tmgr_registry_t *reg, uint64_t hash)
+{
+    return &reg->shards[(hash >> 32) % reg->shard_cnt];
+}
+
+/**
+ * \brief Find an entry in a shard
+ * \warning The shard MUST be locked.
+ * \param[in] shard   Shard
+ * \param[in] hash    Hash of the key
+ * \param[in] session Transport Session
+ * \param[in] odid    Observation Domain ID
+ * \return Pointer to the pointer to the entry (i.e. the entry can be removed from the chain).
+ *   If the entry is not present, the pointed value is NULL.
+ */
+static struct registry_entry **
+registry_shard_find(struct registry_shard *shard, uint64_t hash, const void *session,
+    uint32_t odid)
+{
+    struct registry_entry **ptr = &shard->buckets[hash & (shard->bucket_cnt - 1U)];
+    for (; *ptr != NULL; ptr = &(*ptr)->next) {
+        const struct registry_entry *entry = *ptr;
+        if (entry->hash == hash && entry->session == session && entry->odid == odid) {
+            break;
+        }
+    }
+
+    return ptr;
+}
+
+/**
+ * \brief Double the number of buckets of a shard
+ * \warning The shard MUST be locked.
+ * \param[in] shard Shard
+ * \return #FDS_OK or #FDS_ERR_NOMEM (the shard is unchanged)
+ */
+static int
+registry_shard_grow(struct registry_shard *shard)
+{
+    const size_t new_cnt = 2U * shard->bucket_cnt;
+    struct registry_entry **new_buckets = calloc(new_cnt, sizeof(*new_buckets));
+    if (!new_buckets) {
+        return FDS_ERR_NOMEM;
+    }
+
+    for (size_t i = 0; i < shard->bucket_cnt; ++i) {
+        struct registry_entry *entry = shard->buckets[i];
+        while (entry) {
+            struct registry_entry *next = entry->next;
+            struct registry_entry **bucket = &new_buckets[entry->hash & (new_cnt - 1U)];
+            entry->next = *bucket;
+            *bucket = entry;
+            entry = next;
+        }
+    }
+
+    free(shard->buckets);
+    shard->buckets = new_buckets;
+    shard->bucket_cnt = new_cnt;
+    return FDS_OK;
+}
+
+/**
+ * \brief Move a template manager to the shared garbage
+ *
+ * The manager is destroyed together with the garbage, so a thread that still uses the manager
+ * is not affected until the garbage is destroyed by the user.
+ * \param[in] reg  Registry
+ * \param[in] tmgr Template manager
+ * \return #FDS_OK or #FDS_ERR_NOMEM (the manager is not moved)
+ */
+static int
+registry_garbage_tmgr(fds_tmgr_registry_t *reg, fds_tmgr_t *tmgr)
+{
+    int ret_code = FDS_OK;
+    pthread_mutex_lock(&reg->garbage.lock);
+    if (!reg->garbage.gc && (reg->garbage.gc = garbage_create()) == NULL) {
+        ret_code = FDS_ERR_NOMEM;
+    } else {
+        ret_code = garbage_append(reg->garbage.gc, tmgr, (garbage_fn_t) &fds_tmgr_destroy);
+    }
+    pthread_mutex_unlock(&reg->garbage.lock);
+    return ret_code;
+}
+
+fds_tmgr_registry_t *
+fds_tmgr_registry_create(unsigned int shards)
+{
+    if (shards == 0) {
+        shards = REGISTRY_SHARDS_DEF;
+    } else if (shards > REGISTRY_SHARDS_MAX) {
+        shards = REGISTRY_SHARDS_MAX;
+    }
+
+    fds_tmgr_registry_t *reg = calloc(1, sizeof(*reg));
+    if (!reg) {
+        return NULL;
+    }
+
+    if (pthread_mutex_init(&reg->sweep.lock, NULL) != 0) {
+        free(reg);
+        return NULL;
+    }
+
+    if (pthread_mutex_init(&reg->garbage.lock, NULL) != 0) {
+        pthread_mutex_destroy(&reg->sweep.lock);
+        free(reg);
+        return NULL;
+    }
+
+    if (pthread_mutex_init(&reg->ies.lock, NULL) != 0) {
+        pthread_mutex_destroy(&reg->garbage.lock);
+        pthread_mutex_destroy(&reg->sweep.lock);
+        free(reg);
+        return NULL;
+    }
+    atomic_init(&reg->ies.gen_now, 0);
+
+    reg->shards = calloc(shards, sizeof(*reg->shards));
+    if (!reg->shards) {
+        fds_tmgr_registry_destroy(reg);
+        return NULL;
+    }
+
+    for (; reg->shard_cnt < shards; reg->shard_cnt++) {
+        struct registry_shard *shard = &reg->shards[reg->shard_cnt];
+        shard->buckets = calloc(REGISTRY_BUCKETS_MIN, sizeof(*shard->buckets));
+        if (!shard->buckets || pthread_mutex_init(&shard->lock, NULL) != 0) {
+            free(shard->buckets);
+            fds_tmgr_registry_destroy(reg);
+            return NULL;
+        }
+
+        shard->bucket_cnt = REGISTRY_BUCKETS_MIN;
+    }
+
+    return reg;
+}
+
+void
+fds_tmgr_registry_destroy(fds_tmgr_registry_t *reg)
+{
+    if (!reg) {
+        return;
+    }
+
+    for (unsigned int idx = 0; idx < reg->shard_cnt; ++idx) {
+        struct registry_shard *shard = &reg->shards[idx];
+        for (size_t i = 0; i < shard->bucket_cnt; ++i) {
+            struct registry_entry *entry = shard->buckets[i];
+            while (entry) {
+                struct registry_entry *next = entry->next;
+                fds_tmgr_destroy(entry->tmgr);
+                free(entry);
+                entry = next;
+            }
+        }
+
+        pthread_mutex_destroy(&shard->lock);
+        free(shard->buckets);
+    }
+
+    if (reg->garbage.gc) {
+        garbage_destroy(reg->garbage.gc);
+    }
+
+    pthread_mutex_destroy(&reg->sweep.lock);
+    pthread_mutex_destroy(&reg->garbage.lock);
+    pthread_mutex_destroy(&reg->ies.lock);
+    free(reg->shards);
+    free(reg);
+}
+
+int
+fds_tmgr_registry_add(fds_tmgr_registry_t *reg, const void *session, uint32_t odid,
+    fds_tmgr_t *tmgr, uint32_t now)
+{
+    const uint64_t hash = registry_hash(session, odid);
+    struct registry_shard *shard = registry_shard_get(reg, hash);
+    int ret_code = FDS_OK;
+
+    pthread_mutex_lock(&shard->lock);
+    if (*registry_shard_find(shard, hash, session, odid) != NULL) {
+        ret_code = FDS_ERR_DENIED;
+        goto unlock;
+    }
+
+    // Keep on average at most 2 entries per bucket (failure to grow is not fatal)
+    if (shard->entry_cnt >= 2U * shard->bucket_cnt) {
+        registry_shard_grow(shard);
+    }
+
+    struct registry_entry *entry = malloc(sizeof(*entry));
+    if (!entry) {
+        ret_code = FDS_ERR_NOMEM;
+        goto unlock;
+    }
+
+    entry->hash = hash;
+    entry->session = session;
+    entry->odid = odid;
+    entry->last_used = now;
+    entry->ies_gen = 0; // Nothing has been requested yet (see registry_entry_iemgr())
+    entry->tmgr = tmgr;
+
+    struct registry_entry **bucket = &shard->buckets[hash & (shard->bucket_cnt - 1U)];
+    entry->next = *bucket;
+    *bucket = entry;
+    shard->entry_cnt++;
+
+unlock:
+    pthread_mutex_unlock(&shard->lock);
+    return ret_code;
+}
+
+/**
+ * \brief Request redefinition of templates of a manager if its IE manager is out of date
+ *
+ * The templates are not redefined immediately, but by the thread that uses the manager
+ * (see tmgr_iemgr_apply()).
+ * \warning The shard of the entry MUST be locked.
+ * \param[in] reg   Registry
+ * \param[in] entry Entry of the manager
+ */
+static inline void
+registry_entry_iemgr(fds_tmgr_registry_t *reg, struct registry_entry *entry)
+{
+    if (entry->ies_gen == atomic_load_explicit(&reg->ies.gen_now, memory_order_acquire)) {
+        return;
+    }
+
+    pthread_mutex_lock(&reg->ies.lock);
+    tmgr_iemgr_request(entry->tmgr, reg->ies.iemgr, reg->ies.gen);
+    entry->ies_gen = reg->ies.gen;
+    pthread_mutex_unlock(&reg->ies.lock);
+}
+
+fds_tmgr_t *
+fds_tmgr_registry_find(fds_tmgr_registry_t *reg, const void *session, uint32_t odid,
+    uint32_t now)
+{
+    const uint64_t hash = registry_hash(session, odid);
+    struct registry_shard *shard = registry_shard_get(reg, hash);
+    fds_tmgr_t *result = NULL;
+
+    pthread_mutex_lock(&shard->lock);
+    struct registry_entry *entry = *registry_shard_find(shard, hash, session, odid);
+    if (entry != NULL) {
+        registry_entry_iemgr(reg, entry);
+        entry->last_used = now;
+        result = entry->tmgr;
+    }
+    pthread_mutex_unlock(&shard->lock);
+    return result;
+}
+
+int
+fds_tmgr_registry_remove(fds_tmgr_registry_t *reg, const void *session, uint32_t odid)
+{
+    const uint64_t hash = registry_hash(session, odid);
+    struct registry_shard *shard = registry_shard_get(reg, hash);
+    int ret_code;
+
+    pthread_mutex_lock(&shard->lock);
+    struct registry_entry **ptr = registry_shard_find(shard, hash, session, odid);
+    struct registry_entry *entry = *ptr;
+    if (!entry) {
+        ret_code = FDS_ERR_NOTFOUND;
+    } else if ((ret_code = registry_garbage_tmgr(reg, entry->tmgr)) == FDS_OK) {
+        *ptr = entry->next;
+        shard->entry_cnt--;
+        free(entry);
+    }
+    pthread_mutex_unlock(&shard->lock);
+    return ret_code;
+}
+
+int
+fds_tmgr_registry_remove_session(fds_tmgr_registry_t *reg, const void *session)
+{
+    int ret_code = FDS_OK;
+
+    // Managers of the session can be in any shard
+    for (unsigned int idx = 0; idx < reg->shard_cnt; ++idx) {
+        struct registry_shard *shard = &reg->shards[idx];
+        pthread_mutex_lock(&shard->lock);
+
+        for (size_t i = 0; i < shard->bucket_cnt; ++i) {
+            struct registry_entry **ptr = &shard->buckets[i];
+            while (*ptr != NULL) {
+                struct registry_entry *entry = *ptr;
+                if (entry->session != session) {
+                    ptr = &entry->next;
+                    continue;
+                }
+
+                if (registry_garbage_tmgr(reg, entry->tmgr) != FDS_OK) {
+                    // Keep the manager in the registry
+                    ret_code = FDS_ERR_NOMEM;
+                    ptr = &entry->next;
+                    continue;
+                }
+
+                *ptr = entry->next;
+                shard->entry_cnt--;
+                free(entry);
+            }
+        }
+
+        pthread_mutex_unlock(&shard->lock);
+    }
+
+    return ret_code;
+}
+
+size_t
+fds_tmgr_registry_sweep(fds_tmgr_registry_t *reg, uint32_t now, uint32_t timeout, size_t batch)
+{
+    size_t removed = 0;
+    size_t visited = 0;
+
+    // Only one sweep at time, so each call continues where the previous one has finished
+    pthread_mutex_lock(&reg->sweep.lock);
+    unsigned int shard_idx = reg->sweep.shard;
+    size_t bucket_idx = reg->sweep.bucket;
+
+    for (unsigned int cnt = 0; cnt <= reg->shard_cnt && visited < batch; ++cnt) {
+        struct registry_shard *shard = &reg->shards[shard_idx];
+        pthread_mutex_lock(&shard->lock);
+
+        // The shard could have been resized since the previous sweep
+        for (; bucket_idx < shard->bucket_cnt && visited < batch; ++bucket_idx) {
+            struct registry_entry **ptr = &shard->buckets[bucket_idx];
+            while (*ptr != NULL) {
+                struct registry_entry *entry = *ptr;
+                visited++;
+
+                if ((uint32_t) (now - entry->last_used) <= timeout
+                        || registry_garbage_tmgr(reg, entry->tmgr) != FDS_OK) {
+                    ptr = &entry->next;
+                    continue;
+                }
+
+                *ptr = entry->next;
+                shard->entry_cnt--;
+                free(entry);
+                removed++;
+            }
+        }
+
+        const bool shard_done = (bucket_idx >= shard->bucket_cnt);
+        pthread_mutex_unlock(&shard->lock);
+        if (!shard_done) {
+            break;
+        }
+
+        shard_idx = (shard_idx + 1U) % reg->shard_cnt;
+        bucket_idx = 0;
+    }
+
+    reg->sweep.shard = shard_idx;
+    reg->sweep.bucket = bucket_idx;
+    pthread_mutex_unlock(&reg->sweep.lock);
+    return removed;
+}
+
+int
+fds_tmgr_registry_garbage_add(fds_tmgr_registry_t *reg, fds_tgarbage_t *gc)
+{
+    if (!gc) {
+        return FDS_OK;
+    }
+
+    int ret_code = FDS_OK;
+    pthread_mutex_lock(&reg->garbage.lock);
+    if (!reg->garbage.gc) {
+        // Use the garbage directly
+        reg->garbage.gc = gc;
+    } else {
+        ret_code = garbage_append(reg->garbage.gc, gc, (garbage_fn_t) &garbage_destroy);
+    }
+    pthread_mutex_unlock(&reg->garbage.lock);
+    return ret_code;
+}
+
+void
+fds_tmgr_registry_garbage_get(fds_tmgr_registry_t *reg, fds_tgarbage_t **gc)
+{
+    pthread_mutex_lock(&reg->garbage.lock);
+    fds_tgarbage_t *result = reg->garbage.gc;
+    fds_tmgr_reclaimer_t *rcl = reg->garbage.rcl;
+    reg->garbage.gc = NULL;
+    pthread_mutex_unlock(&reg->garbage.lock);
+
+    if (result != NULL && rcl != NULL && fds_tmgr_reclaimer_add(rcl, result) == FDS_OK) {
+        // The reclaimer takes responsibility for the garbage
+        result = NULL;
+    }
+
+    *gc = result;
+}
+
+void
+fds_tmgr_registry_set_reclaimer(fds_tmgr_registry_t *reg, fds_tmgr_reclaimer_t *rcl)
+{
+    pthread_mutex_lock(&reg->garbage.lock);
+    reg->garbage.rcl = rcl;
+    pthread_mutex_unlock(&reg->garbage.lock);
+}
+
+void
+fds_tmgr_registry_set_iemgr(fds_tmgr_registry_t *reg, const fds_iemgr_t *iemgr)
+{
+    pthread_mutex_lock(&reg->ies.lock);
+    reg->ies.iemgr = iemgr;
+    reg->ies.gen++;
+    atomic_store_explicit(&reg->ies.gen_now, reg->ies.gen, memory_order_release);
+    pthread_mutex_unlock(&reg->ies.lock);
+}
+
+int
+fds_tmgr_registry_redefine(fds_tmgr_registry_t *reg)
+{
+    int ret_code = FDS_OK;
+    for (unsigned int idx = 0; idx < reg->shard_cnt; ++idx) {
+        struct registry_shard *shard = &reg->shards[idx];
+        pthread_mutex_lock(&shard->lock);
+        for (size_t i = 0; i < shard->bucket_cnt; ++i) {
+            for (struct registry_entry *entry = shard->buckets[i]; entry; entry = entry->next) {
+                registry_entry_iemgr(reg, entry);
+                if (tmgr_iemgr_apply(entry->tmgr) != FDS_OK) {
+                    // The manager remains pending (see fds_tmgr_registry_iemgr_pending())
+                    ret_code = FDS_ERR_NOMEM;
+                }
+            }
+        }
+        pthread_mutex_unlock(&shard->lock);
+    }
+
+    return ret_code;
+}
+
+size_t
+fds_tmgr_registry_iemgr_pending(fds_tmgr_registry_t *reg)
+{
+    const uint64_t gen = atomic_load_explicit(&reg->ies.gen_now, memory_order_acquire);
+    size_t cnt = 0;
+
+    for (unsigned int idx = 0; idx < reg->shard_cnt; ++idx) {
+        struct registry_shard *shard = &reg->shards[idx];
+        pthread_mutex_lock(&shard->lock);
+        for (size_t i = 0; i < shard->bucket_cnt; ++i) {
+            for (const struct registry_entry *entry = shard->buckets[i]; entry; entry = entry->next) {
+                if (tmgr_iemgr_gen(entry->tmgr) != gen) {
+                    cnt++;
+                }
+            }
+        }
+        pthread_mutex_unlock(&shard->lock);
+    }
+
+    return cnt;
+}
@@ -80,7 +80,7 @@ snapshot_bit_clear(snapshot_bitset_t *set, uint16_t bit)
  * \return #FDS_OK or #FDS_ERR_NOTFOUND
  */
 static inline int
-snapshot_bit_next(snapshot_bitset_t *set, uint16_t start, uint16_t *bit)
+snapshot_bit_next(const snapshot_bitset_t *set, uint16_t start, uint16_t *bit)
 {
     if (start >= SNAPSHOT_TABLE_SIZE) {
         return FDS_ERR_NOTFOUND;
@@ -120,6 +120,113 @@ snapshot_bit_next(snapshot_bitset_t *set, uint16_t start, uint16_t *bit)
     return FDS_OK;
 }
 
+/**
+ * \brief Release a reference to an L2 table
+ *
+ * The table is freed when its last reference is released.
+ * \param[in] table L2 table
+ */
+static inline void
+snapshot_l2_release(struct snapshot_l2_table *table)
+{
+    if (atomic_fetch_sub_explicit(&table->refcnt, 1, memory_order_acq_rel) == 1) {
+        free(table);
+    }
+}
+
+/**
+ * \brief Make sure that an L2 table replaced in a snapshot can be retired
+ *
+ * Space for the reference is allocated before the table is replaced, so the retirement itself
+ * cannot fail (see snapshot_l2_retire()).
+ * \param[in] snap Snapshot
+ * \return #FDS_OK on success. Otherwise #FDS_ERR_NOMEM.
+ */
+static int
+snapshot_l2_retire_reserve(struct fds_tsnapshot *snap)
+{
+    if (snap->editable) {
+        return FDS_OK;
+    }
+
+    const size_t new_size = (snap->retired.cnt + 1U) * sizeof(*snap->retired.tables);
+    struct snapshot_l2_table **new_array = realloc(snap->retired.tables, new_size);
+    if (!new_array) {
+        return FDS_ERR_NOMEM;
+    }
+
+    snap->retired.tables = new_array;
+    return FDS_OK;
+}
+
+/**
+ * \brief Release an L2 table replaced in a snapshot
+ *
+ * Frozen snapshots could be accessed by readers in other threads (see fds_tmgr_publish()), so
+ * the table is released together with the snapshot. The reference also prevents other snapshots
+ * from modifying the table in place.
+ * \warning Space for the reference MUST be reserved by snapshot_l2_retire_reserve() first.
+ * \param[in] snap  Snapshot
+ * \param[in] table L2 table
+ */
+static void
+snapshot_l2_retire(struct fds_tsnapshot *snap, struct snapshot_l2_table *table)
+{
+    if (snap->editable) {
+        snapshot_l2_release(table);
+        return;
+    }
+
+    snap->retired.tables[snap->retired.cnt++] = table;
+}
+
+/**
+ * \brief Prepare an L2 table of a snapshot for modification
+ *
+ * If the table is shared with other snapshots, a private copy of the table is created and
+ * replaces the original table in the snapshot. Flags cleared in the snapshot are applied to
+ * records of the table, so records can be modified directly.
+ * \param[in] snap   Snapshot
+ * \param[in] l1_idx Index of the L2 table (the table must exist)
+ * \return Pointer to the table or NULL (memory allocation error)
+ */
+static struct snapshot_l2_table *
+snapshot_l2_edit(struct fds_tsnapshot *snap, uint16_t l1_idx)
+{
+    struct snapshot_l2_table *l2_table = snap->l1_table.tables[l1_idx];
+    assert(l2_table != NULL);
+
+    if (atomic_load_explicit(&l2_table->refcnt, memory_order_acquire) > 1) {
+        if (snapshot_l2_retire_reserve(snap) != FDS_OK) {
+            return NULL;
+        }
+
+        struct snapshot_l2_table *new_l2 = malloc(sizeof(*new_l2));
+        if (!new_l2) {
+            return NULL;
+        }
+
+        memcpy(new_l2, l2_table, sizeof(*new_l2));
+        atomic_init(&new_l2->refcnt, 1);
+        atomic_store_explicit(&snap->l1_table.tables[l1_idx], new_l2, memory_order_release);
+        snapshot_l2_retire(snap, l2_table);
+        l2_table = new_l2;
+    }
+
+    const uint16_t flags_off = snap->l1_table.flags_off[l1_idx];
+    if (flags_off != 0) {
+        uint16_t l2_idx = 0;
+        while (snapshot_bit_next(&l2_table->bitset, l2_idx, &l2_idx) == FDS_OK) {
+            l2_table->recs[l2_idx].flags &= ~flags_off;
+            l2_idx++;
+        }
+
+        snap->l1_table.flags_off[l1_idx] = 0;
+    }
+
+    return l2_table;
+}
+
 fds_tsnapshot_t *
 snapshot_create() {
     struct fds_tsnapshot *snap = calloc(1, sizeof(*snap));
@@ -134,13 +241,18 @@ snapshot_create() {
 void
 snapshot_destroy(struct fds_tsnapshot *snap)
 {
-    // Delete all L2 tables
+    // Release all L2 tables
     uint16_t idx = 0;
     while (snapshot_bit_next(&snap->l1_table.bitset, idx, &idx) == FDS_OK) {
-        free(snap->l1_table.tables[idx]);
+        snapshot_l2_release(snap->l1_table.tables[idx]);
         idx++;
     }
 
+    for (uint16_t i = 0; i < snap->retired.cnt; ++i) {
+        snapshot_l2_release(snap->retired.tables[i]);
+    }
+    free(snap->retired.tables);
+
     // Delete the snapshot itself
     free(snap);
 }
@@ -155,45 +267,60 @@ snapshot_copy(const struct fds_tsnapshot *snap)
     }
 
     memcpy(new_snap, snap, sizeof(*new_snap));
+    new_snap->shared = false;
+    new_snap->retired.tables = NULL;
+    new_snap->retired.cnt = 0;
 
-    // Copy all L2 tables
-    uint16_t copy_idx = 0;
-    bool failed = false;
-
+    // Share all L2 tables (a table is copied when it is modified for the first time)
+    uint16_t idx = 0;
     snapshot_bitset_t *bitset = &new_snap->l1_table.bitset;
-    while (snapshot_bit_next(bitset, copy_idx, &copy_idx) == FDS_OK) {
-        const struct snapshot_l2_table *old_l2 = snap->l1_table.tables[copy_idx];
-        if (old_l2->rec_cnt == 0) {
-            // Do not copy empty tables
-            new_snap->l1_table.tables[copy_idx] = NULL;
-            snapshot_bit_clear(bitset, copy_idx);
-            copy_idx++;
+    while (snapshot_bit_next(bitset, idx, &idx) == FDS_OK) {
+        struct snapshot_l2_table *l2_table = new_snap->l1_table.tables[idx];
+        if (l2_table->rec_cnt == 0) {
+            // Do not share empty tables
+            new_snap->l1_table.tables[idx] = NULL;
+            new_snap->l1_table.flags_off[idx] = 0;
+            snapshot_bit_clear(bitset, idx);
+            idx++;
             continue;
         }
 
-        struct snapshot_l2_table *new_l2 = malloc(sizeof(*new_l2));
-        if (!new_l2) {
-            failed = true;
+        atomic_fetch_add_explicit(&l2_table->refcnt, 1, memory_order_relaxed);
+        idx++;
+    }
+
+    return new_snap;
+}
+
+int
+snapshot_unshare(struct fds_tsnapshot *snap)
+{
+    // The snapshot is not accessible by readers, so original tables can be released immediately
+    const bool editable = snap->editable;
+    snap->editable = true;
+
+    int ret_code = FDS_OK;
+    uint16_t idx = 0;
+    while (snapshot_bit_next(&snap->l1_table.bitset, idx, &idx) == FDS_OK) {
+        if (!snapshot_l2_edit(snap, idx)) {
+            ret_code = FDS_ERR_NOMEM;
             break;
         }
-        memcpy(new_l2, old_l2, sizeof(*new_l2));
-        new_snap->l1_table.tables[copy_idx] = new_l2;
-        copy_idx++;
+        idx++;
     }
 
-    if (failed) {
-        // Free successfully copied tables
-        uint16_t idx = 0;
-        while (snapshot_bit_next(bitset, idx, &idx) == FDS_OK && idx < copy_idx) {
-            free(new_snap->l1_table.tables[idx]);
-            idx++;
-        }
+    snap->editable = editable;
+    return ret_code;
+}
 
-        free(new_snap);
-        return NULL;
+void
+snapshot_flags_clear(struct fds_tsnapshot *snap, uint16_t flags)
+{
+    uint16_t idx = 0;
+    while (snapshot_bit_next(&snap->l1_table.bitset, idx, &idx) == FDS_OK) {
+        snap->l1_table.flags_off[idx] |= flags;
+        idx++;
     }
-
-    return new_snap;
 }
 
 int
@@ -210,8 +337,12 @@ snapshot_rec_add(struct fds_tsnapshot *snap, struct snapshot_rec *rec)
             return FDS_ERR_NOMEM;
         }
 
+        atomic_init(&l2_table->refcnt, 1);
         snap->l1_table.tables[l1_idx] = l2_table;
+        snap->l1_table.flags_off[l1_idx] = 0;
         snapshot_bit_set(&snap->l1_table.bitset, l1_idx);
+    } else if ((l2_table = snapshot_l2_edit(snap, l1_idx)) == NULL) {
+        return FDS_ERR_NOMEM;
     }
 
     const uint16_t l2_idx = rec->id % SNAPSHOT_TABLE_SIZE;
@@ -233,19 +364,19 @@ snapshot_rec_remove(struct fds_tsnapshot *snap, uint16_t id)
     assert(id >= FDS_IPFIX_SET_MIN_DSET);
 
     // Find the record
-    const uint16_t l1_idx = id / SNAPSHOT_TABLE_SIZE;
-    struct snapshot_l2_table *l2_table = snap->l1_table.tables[l1_idx];
-    if (!l2_table) {
+    if (snapshot_rec_cfind(snap, id) == NULL) {
         return FDS_ERR_NOTFOUND;
     }
 
-    const uint16_t l2_idx = id % SNAPSHOT_TABLE_SIZE;
-    struct snapshot_rec *l2_rec = &l2_table->recs[l2_idx];
-    if (l2_rec->id == 0) {
-        return FDS_ERR_NOTFOUND;
+    const uint16_t l1_idx = id / SNAPSHOT_TABLE_SIZE;
+    struct snapshot_l2_table *l2_table = snapshot_l2_edit(snap, l1_idx);
+    if (!l2_table) {
+        return FDS_ERR_NOMEM;
     }
 
     // Remove it
+    const uint16_t l2_idx = id % SNAPSHOT_TABLE_SIZE;
+    struct snapshot_rec *l2_rec = &l2_table->recs[l2_idx];
     assert(l2_rec->id == id);
     assert(l2_table->rec_cnt > 0);
     assert(snap->rec_cnt > 0);
@@ -263,12 +394,29 @@ snapshot_rec_remove(struct fds_tsnapshot *snap, uint16_t id)
     return FDS_OK;
 }
 
+int
+snapshot_rec_edit(struct fds_tsnapshot *snap, uint16_t id, struct snapshot_rec **rec)
+{
+    if (snapshot_rec_cfind(snap, id) == NULL) {
+        return FDS_ERR_NOTFOUND;
+    }
+
+    struct snapshot_l2_table *l2_table = snapshot_l2_edit(snap, id / SNAPSHOT_TABLE_SIZE);
+    if (!l2_table) {
+        return FDS_ERR_NOMEM;
+    }
+
+    *rec = &l2_table->recs[id % SNAPSHOT_TABLE_SIZE];
+    return FDS_OK;
+}
+
 const struct snapshot_rec *
 snapshot_rec_cfind(const struct fds_tsnapshot *snap, uint16_t id)
 {
     // Find the record
     const uint16_t l1_idx = id / SNAPSHOT_TABLE_SIZE;
-    struct snapshot_l2_table *l2_table = snap->l1_table.tables[l1_idx];
+    struct snapshot_l2_table *l2_table =
+        atomic_load_explicit(&snap->l1_table.tables[l1_idx], memory_order_acquire);
     if (!l2_table) {
         return NULL;
     }
@@ -282,29 +430,29 @@ snapshot_rec_cfind(const struct fds_tsnapshot *snap, uint16_t id)
     return l2_rec;
 }
 
-struct snapshot_rec *
-snapshot_rec_find(struct fds_tsnapshot *snap, uint16_t id)
-{
-    return (struct snapshot_rec *) snapshot_rec_cfind(snap, id);
-}
-
 void
-snapshot_rec_for(struct fds_tsnapshot *snap, snapshot_rec_cb cb, void *data)
+snapshot_rec_for(const struct fds_tsnapshot *snap, snapshot_rec_cb cb, void *data)
 {
     uint16_t l1_idx = 0;
-    snapshot_bitset_t *l1_bitset = &snap->l1_table.bitset;
+    const snapshot_bitset_t *l1_bitset = &snap->l1_table.bitset;
 
     // For each L2 table
     while (snapshot_bit_next(l1_bitset, l1_idx, &l1_idx) == FDS_OK) {
-        struct snapshot_l2_table *l2_table = snap->l1_table.tables[l1_idx];
-        snapshot_bitset_t *l2_bitset = &l2_table->bitset;
-
         // For each record in the L2 table
         uint16_t l2_idx = 0;
-        while (snapshot_bit_next(l2_bitset, l2_idx, &l2_idx) == FDS_OK) {
+        while (true) {
+            /* The callback can modify the snapshot and the L2 table can be replaced by its copy,
+             * so the table and the mask of flags must be always loaded again.
+             */
+            const struct snapshot_l2_table *l2_table = snap->l1_table.tables[l1_idx];
+            if (snapshot_bit_next(&l2_table->bitset, l2_idx, &l2_idx) != FDS_OK) {
+                break;
+            }
+
             // Call user defined function
-            struct snapshot_rec *l2_rec = &l2_table->recs[l2_idx];
-            if (!cb(l2_rec, data)) {
+            struct snapshot_rec l2_rec = l2_table->recs[l2_idx];
+            l2_rec.flags &= ~snap->l1_table.flags_off[l1_idx];
+            if (!cb(&l2_rec, data)) {
                 return;
             }
             l2_idx++;
@@ -314,3 +462,23 @@ snapshot_rec_for(struct fds_tsnapshot *snap, snapshot_rec_cb cb, void *data)
     }
 }
 
+void
+snapshot_tmplt_for(const struct fds_tsnapshot *snap, fds_tsnapshot_for_cb cb, void *data)
+{
+    uint16_t l1_idx = 0;
+    while (snapshot_bit_next(&snap->l1_table.bitset, l1_idx, &l1_idx) == FDS_OK) {
+        // A replaced table stays valid until the snapshot is destroyed
+        const struct snapshot_l2_table *l2_table =
+            atomic_load_explicit(&snap->l1_table.tables[l1_idx], memory_order_acquire);
+
+        uint16_t l2_idx = 0;
+        while (snapshot_bit_next(&l2_table->bitset, l2_idx, &l2_idx) == FDS_OK) {
+            if (!cb(l2_table->recs[l2_idx].ptr, data)) {
+                return;
+            }
+            l2_idx++;
+        }
+
+        l1_idx++;
+    }
+}
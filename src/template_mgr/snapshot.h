@@ -42,6 +42,7 @@
 #ifndef SNAPSHOT_H
 #define SNAPSHOT_H
 
+#include <stdatomic.h>
 #include <libfds.h>
 
 /**
@@ -74,6 +75,13 @@
  *    +----------+      +-------+        +--------+
  * \endverbatim
  *
+ * L2 tables are reference counted and shared among copies of the snapshot (copy-on-write).
+ * A table is copied only when a snapshot that shares it is modified. Because flags of snapshot
+ * records can differ among snapshots that share the same table, each snapshot also keeps a mask
+ * of flags that are cleared in its view of the table (see snapshot_flags_clear()). Therefore,
+ * flags of records must be always read using snapshot_rec_flags_get() or the record must be
+ * obtained by snapshot_rec_edit() or snapshot_rec_for().
+ *
  * @{
  */
 
@@ -145,14 +153,22 @@ struct snapshot_rec {
 
 /** Snapshot L1 table */
 struct snapshot_l1_table {
-    /** Array of L2 tables        */
-    struct snapshot_l2_table *tables[SNAPSHOT_TABLE_SIZE];
+    /**
+     * \brief Array of L2 tables (can be shared with other snapshots)
+     * \note Tables of a frozen snapshot can be replaced while readers in other threads
+     *   access them (see fds_tmgr_publish()), therefore, the pointers are atomic.
+     */
+    _Atomic(struct snapshot_l2_table *) tables[SNAPSHOT_TABLE_SIZE];
+    /** Flags of records cleared in this snapshot (a mask for each L2 table)    */
+    uint16_t flags_off[SNAPSHOT_TABLE_SIZE];
     /** Bitset of used L2 tables  */
     snapshot_bitset_t bitset;
 };
 
 /** Snapshot L2 table */
 struct snapshot_l2_table {
+    /** Number of snapshots that use the table (if greater than 1, it must NOT be modified) */
+    atomic_uint refcnt;
     /** Bitset of valid records   */
     snapshot_bitset_t bitset;
     /** Records in the array      */
@@ -201,6 +217,14 @@ struct fds_tsnapshot {
      */
     bool editable;
 
+    /**
+     * \brief The snapshot has been passed to the user or readers (see fds_tmgr_snapshot_get())
+     *
+     * If the snapshot is not shared, templates created in the snapshot are not accessible
+     * outside of the manager and their timestamps can be updated even if the snapshot is frozen.
+     */
+    bool shared;
+
     /** Number of records in the snapshot */
     uint16_t rec_cnt;
 
@@ -209,6 +233,19 @@ struct fds_tsnapshot {
      * \warning Do NOT use directly.
      */
     struct snapshot_l1_table l1_table;
+
+    /**
+     * \brief L2 tables replaced in the snapshot after it has been frozen
+     *
+     * Readers of the snapshot in other threads could still access these tables, therefore,
+     * they are released together with the snapshot.
+     */
+    struct {
+        /** Array of tables (can be NULL) */
+        struct snapshot_l2_table **tables;
+        /** Number of tables in the array */
+        uint16_t cnt;
+    } retired;
 };
 
 
@@ -226,7 +263,7 @@ snapshot_create();
  * \brief Destroy a snapshot
  *
  * Referenced templates will NOT be freed. If you need to free them, manually iterate over
- * the reference array first.
+ * the reference array first. L2 tables shared with other snapshots are only released.
  * \param[in] snap Snapshot
  */
 void
@@ -235,14 +272,37 @@ snapshot_destroy(struct fds_tsnapshot *snap);
 /**
  * \brief Make a copy of a snapshot
  *
- * The new copy of the snapshot will have its own copy of the array of template references, but the
- * templates will NOT be copied.
+ * The new copy of the snapshot shares L2 tables with the original snapshot. A table is copied
+ * when any of the snapshots modifies it for the first time. The templates will NOT be copied.
  * \param[in] snap Snapshot
  * \return Pointer or NULL (in case of memory error)
  */
 struct fds_tsnapshot *
 snapshot_copy(const struct fds_tsnapshot *snap);
 
+/**
+ * \brief Make sure that a snapshot doesn't share any L2 table with other snapshots
+ *
+ * After successful call, modifications of the snapshot never fail due to a memory allocation
+ * error.
+ * \warning The snapshot must not be accessible by readers in other threads (e.g. a new copy),
+ *   because the original tables are released immediately.
+ * \param[in] snap Snapshot
+ * \return #FDS_OK or #FDS_ERR_NOMEM
+ */
+int
+snapshot_unshare(struct fds_tsnapshot *snap);
+
+/**
+ * \brief Clear flags of all snapshot records in a snapshot
+ *
+ * The operation doesn't depend on the number of records and doesn't modify shared L2 tables.
+ * \param[in] snap  Snapshot
+ * \param[in] flags Bitwise OR of flags to clear (see ::snapshot_rec_flags)
+ */
+void
+snapshot_flags_clear(struct fds_tsnapshot *snap, uint16_t flags);
+
 /**
  * \brief Add a snapshot record
  *
@@ -263,49 +323,84 @@ snapshot_rec_add(struct fds_tsnapshot *snap, struct snapshot_rec *rec);
  * will not be freed)
  * \param[in] snap Snapshot
  * \param[in] id   Template ID (from the snapshot record)
- * \return #FDS_OK or #FDS_ERR_NOTFOUND
+ * \return #FDS_OK or #FDS_ERR_NOTFOUND. If the record is in an L2 table shared with other
+ *   snapshots and the table cannot be copied, returns #FDS_ERR_NOMEM.
  */
 int
 snapshot_rec_remove(struct fds_tsnapshot *snap, uint16_t id);
 
 /**
- * \brief Get a snapshot record of a template
+ * \brief Get a snapshot record of a template for modification
  *
+ * If the record is in an L2 table shared with other snapshots, the table is copied first.
+ * The pointer is valid until the snapshot is copied or destroyed.
+ * \param[in]  snap Snapshot
+ * \param[in]  id   Template ID (from the snapshot record)
+ * \param[out] rec  Pointer to the record
+ * \return #FDS_OK on success. #FDS_ERR_NOTFOUND, if the template doesn't exist in the snapshot.
+ *   #FDS_ERR_NOMEM, if a memory allocation error has occurred.
+ */
+int
+snapshot_rec_edit(struct fds_tsnapshot *snap, uint16_t id, struct snapshot_rec **rec);
+
+/**
+ * \brief Get a snapshot record of a template (read-only)
+ *
+ * \warning Flags of the record might not be valid in context of the snapshot.
+ *   Use snapshot_rec_flags_get() to get them.
  * \param[in] snap Snapshot
  * \param[in] id   Template ID (from the snapshot record)
  * \return Pointer of NULL (if template doesn't exist in the snapshot)
  */
-struct snapshot_rec *
-snapshot_rec_find(struct fds_tsnapshot *snap, uint16_t id);
+const struct snapshot_rec *
+snapshot_rec_cfind(const struct fds_tsnapshot *snap, uint16_t id);
 
 /**
- * \brief Const alternative of snapshot_rec_find()
- * \copydetails snapshot_rec_find
+ * \brief Get flags of a snapshot record in context of a snapshot
+ * \param[in] snap Snapshot
+ * \param[in] rec  Snapshot record (from snapshot_rec_cfind())
+ * \return Flags
  */
-const struct snapshot_rec *
-snapshot_rec_cfind(const struct fds_tsnapshot *snap, uint16_t id);
+static inline uint16_t
+snapshot_rec_flags_get(const struct fds_tsnapshot *snap, const struct snapshot_rec *rec)
+{
+    return rec->flags & ~snap->l1_table.flags_off[rec->id / SNAPSHOT_TABLE_SIZE];
+}
 
 /**
  * \brief Function callback for a snapshot record
  *
- * \param[in] snap Snapshot
+ * \param[in] rec  Copy of the snapshot record (with flags valid in context of the snapshot)
  * \param[in] data User defined data for the callback (optional)
  * \return Continue iteration
  */
-typedef bool (*snapshot_rec_cb)(struct snapshot_rec *rec, void *data);
+typedef bool (*snapshot_rec_cb)(const struct snapshot_rec *rec, void *data);
 
 /**
  * \brief Call a function on each snapshot record in a snapshot
  *
  * It is guaranteed that records will be processed in the order given by their Template ID
- * in ascending order. It is also safe to call snapshot_rec_remove() from the callback on
- * this record.
+ * in ascending order. It is also safe to modify the snapshot from the callback (for example,
+ * to call snapshot_rec_remove() or snapshot_rec_edit() on this record).
+ * \param[in] snap Snapshot
+ * \param[in] cb   Callback function
+ * \param[in] data User defined data that will be passed to the callback
+ */
+void
+snapshot_rec_for(const struct fds_tsnapshot *snap, snapshot_rec_cb cb, void *data);
+
+/**
+ * \brief Call a function on each template in a snapshot
+ *
+ * Unlike snapshot_rec_for(), flags of records are not accessed, so the function can be used
+ * by readers in other threads while the manager modifies flags of the (frozen) snapshot.
+ * Templates are processed in the order given by their Template ID in ascending order.
  * \param[in] snap Snapshot
  * \param[in] cb   Callback function
  * \param[in] data User defined data that will be passed to the callback
  */
 void
-snapshot_rec_for(struct fds_tsnapshot *snap, snapshot_rec_cb cb, void *data);
+snapshot_tmplt_for(const struct fds_tsnapshot *snap, fds_tsnapshot_for_cb cb, void *data);
 
 /** @} */ // end of the group
 
@@ -45,9 +45,11 @@
 #include <strings.h>   // strcasecmp
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdatomic.h>
 #include <assert.h>
 
 #include <libfds.h>
+#include "template_pool.h"
 
 /**
  * Calculate size of template structure (based on number of fields)
@@ -584,6 +586,7 @@ template_calc_features(struct fds_template *tmplt)
     const uint16_t fields_total = tmplt->fields_cnt_total;
     uint32_t data_len = 0; // Get (minimum) data length of a record referenced by this template
     uint16_t field_offset = 0;
+    tmplt->index.dyn_start = fields_total;
 
     for (uint16_t i = 0; i < fields_total; ++i) {
         struct fds_tfield *field_ptr = &tmplt->fields[i];
@@ -596,6 +599,9 @@ template_calc_features(struct fds_template *tmplt)
         const uint16_t field_len = field_ptr->length;
         if (field_len == FDS_IPFIX_VAR_IE_LEN) {
             // Variable length Information Element must be at least 1 byte long
+            if ((tmplt->flags & FDS_TEMPLATE_DYNAMIC) == 0) {
+                tmplt->index.dyn_start = i;
+            }
             tmplt->flags |= FDS_TEMPLATE_DYNAMIC;
             data_len += 1;
             field_offset = FDS_IPFIX_VAR_IE_LEN;
@@ -626,6 +632,50 @@ template_calc_features(struct fds_template *tmplt)
     return FDS_OK;
 }
 
+/**
+ * \brief Build runs of fixed-length fields between variable-length fields
+ *
+ * The runs allows to determine length of a Data Record by reading only length prefixes of
+ * variable-length fields (see fds_template_index#dyn_runs).
+ * \param[in] tmplt Template structure (with already calculated features)
+ * \return #FDS_OK or #FDS_ERR_NOMEM
+ */
+static int
+template_runs_build(struct fds_template *tmplt)
+{
+    if ((tmplt->flags & FDS_TEMPLATE_DYNAMIC) == 0) {
+        return FDS_OK;
+    }
+
+    const uint16_t fields_total = tmplt->fields_cnt_total;
+    uint16_t dyn_cnt = 0;
+    for (uint16_t i = 0; i < fields_total; ++i) {
+        if (tmplt->fields[i].length == FDS_IPFIX_VAR_IE_LEN) {
+            dyn_cnt++;
+        }
+    }
+
+    uint16_t *runs = calloc(dyn_cnt + 1U, sizeof(*runs));
+    if (!runs) {
+        return FDS_ERR_NOMEM;
+    }
+
+    // Total length of fixed fields fits into 16 bits (checked by template_calc_features())
+    uint16_t run_idx = 0;
+    for (uint16_t i = 0; i < fields_total; ++i) {
+        const uint16_t field_len = tmplt->fields[i].length;
+        if (field_len == FDS_IPFIX_VAR_IE_LEN) {
+            run_idx++;
+            continue;
+        }
+        runs[run_idx] += field_len;
+    }
+
+    tmplt->index.dyn_cnt = dyn_cnt;
+    tmplt->index.dyn_runs = runs;
+    return FDS_OK;
+}
+
 /**
  * \brief Create a copy of a raw template and assign the copy to a template structure
  * \param[in] tmplt Template structure
@@ -646,6 +696,84 @@ template_raw_copy(struct fds_template *tmplt, const void *ptr, uint16_t len)
     return FDS_OK;
 }
 
+/**
+ * \brief Calculate a hash of a field identification for the field lookup index
+ * \param[in] en Enterprise Number
+ * \param[in] id Information Element ID
+ * \return Hash value (must be masked by the size of the hash table)
+ */
+static inline uint32_t
+template_index_hash(uint32_t en, uint16_t id)
+{
+    uint32_t hash = ((uint32_t) id * 0x9E3779B1U) ^ (en * 0x85EBCA77U);
+    return hash ^ (hash >> 16);
+}
+
+/** The last assigned unique template identifier (see fds_template_index#uid)                 */
+static _Atomic uint64_t template_uid_last = 0;
+
+/**
+ * \brief Get a new unique template identifier
+ * \note The function is thread-safe.
+ * \return Identifier (never zero)
+ */
+static inline uint64_t
+template_uid_next()
+{
+    return atomic_fetch_add_explicit(&template_uid_last, 1U, memory_order_relaxed) + 1U;
+}
+
+/**
+ * \brief Build the field lookup index of a template
+ *
+ * The index is an open-addressing hash table (with linear probing) that is at most half full.
+ * If a field occurs multiple times in the template, only its first occurrence is indexed.
+ * \param[in] tmplt Template structure (with already parsed fields)
+ * \return #FDS_OK or #FDS_ERR_NOMEM
+ */
+static int
+template_index_build(struct fds_template *tmplt)
+{
+    const uint16_t fields_cnt = tmplt->fields_cnt_total;
+    if (fields_cnt == 0) {
+        return FDS_OK;
+    }
+
+    // Number of fields is limited by the maximum size of an IPFIX Message
+    uint32_t table_size = 8U;
+    while (table_size < 2U * fields_cnt) {
+        table_size <<= 1;
+    }
+    assert(table_size - 1U <= UINT16_MAX);
+
+    uint16_t *table = calloc(table_size, sizeof(*table));
+    if (!table) {
+        return FDS_ERR_NOMEM;
+    }
+
+    const uint16_t mask = (uint16_t) (table_size - 1U);
+    for (uint16_t i = 0; i < fields_cnt; ++i) {
+        const struct fds_tfield *field = &tmplt->fields[i];
+        uint32_t pos = template_index_hash(field->en, field->id) & mask;
+
+        while (table[pos] != 0) {
+            const struct fds_tfield *other = &tmplt->fields[table[pos] - 1U];
+            if (other->id == field->id && other->en == field->en) {
+                break; // Only the first occurrence is indexed
+            }
+            pos = (pos + 1U) & mask;
+        }
+
+        if (table[pos] == 0) {
+            table[pos] = i + 1U;
+        }
+    }
+
+    tmplt->index.table = table;
+    tmplt->index.mask = mask;
+    return FDS_OK;
+}
+
 int
 fds_template_parse(enum fds_template_type type, const void *ptr, uint16_t *len,
     struct fds_template **tmplt)
@@ -662,6 +790,7 @@ fds_template_parse(enum fds_template_type type, const void *ptr, uint16_t *len,
         return ret_code;
     }
 
+    template->index.uid = template_uid_next();
     if (template->fields_cnt_total == 0) {
         // No fields... just copy the raw template
         ret_code = template_raw_copy(template, ptr, len_header);
@@ -684,6 +813,13 @@ fds_template_parse(enum fds_template_type type, const void *ptr, uint16_t *len,
         return ret_code;
     }
 
+    // Build the field lookup index
+    ret_code = template_index_build(template);
+    if (ret_code != FDS_OK) {
+        fds_template_destroy(template);
+        return ret_code;
+    }
+
     // Copy raw template
     len_real = len_header + len_fields;
     ret_code = template_raw_copy(template, ptr, len_real);
@@ -699,44 +835,112 @@ fds_template_parse(enum fds_template_type type, const void *ptr, uint16_t *len,
         return ret_code;
     }
 
+    ret_code = template_runs_build(template);
+    if (ret_code != FDS_OK) {
+        fds_template_destroy(template);
+        return ret_code;
+    }
+
     *len = len_real;
     *tmplt = template;
     return FDS_OK;
 }
 
+/**
+ * \brief Create a copy of an array of a template
+ *
+ * Arrays shared with identical templates (see fds_tpool_template()) are not copied.
+ * \param[in]  tmplt Template
+ * \param[in]  src   Array to copy (can be NULL)
+ * \param[in]  size  Size of the array to copy (in bytes)
+ * \param[in]  alloc Size of the new array (in bytes, must be at least \p size)
+ * \param[out] dst   Copy of the array (NULL if \p src is NULL)
+ * \return #FDS_OK or #FDS_ERR_NOMEM
+ */
+static int
+template_array_copy(const struct fds_template *tmplt, const void *src, size_t size, size_t alloc,
+    void **dst)
+{
+    if (!src || template_shared_has(tmplt, src)) {
+        *dst = (void *) src;
+        return FDS_OK;
+    }
+
+    *dst = malloc(alloc);
+    if (!*dst) {
+        return FDS_ERR_NOMEM;
+    }
+
+    memcpy(*dst, src, size);
+    return FDS_OK;
+}
+
+/**
+ * \brief Free an array of a template (unless the array is shared)
+ * \param[in] tmplt Template
+ * \param[in] ptr   Array (can be NULL)
+ */
+static inline void
+template_array_free(const struct fds_template *tmplt, void *ptr)
+{
+    if (!template_shared_has(tmplt, ptr)) {
+        free(ptr);
+    }
+}
+
 struct fds_template *
 fds_template_copy(const struct fds_template *tmplt)
 {
     const size_t size_main = TEMPLATE_STRUCT_SIZE(tmplt->fields_cnt_total);
     const size_t size_raw = tmplt->raw.length;
     const size_t size_rev = tmplt->fields_cnt_total * sizeof(*(tmplt->fields_rev));
+    const size_t size_idx = (tmplt->index.mask + 1U) * sizeof(*(tmplt->index.table));
+    const size_t size_runs = (tmplt->index.dyn_cnt + 1U) * sizeof(*(tmplt->index.dyn_runs));
+    const size_t size_views = (tmplt->index.view_fwd_cnt + tmplt->index.view_rev_cnt)
+        * sizeof(*(tmplt->index.views));
+    const size_t size_views_alloc = 2U * tmplt->fields_cnt_total * sizeof(*(tmplt->index.views));
 
     struct fds_template *cpy_main = malloc(size_main);
-    uint8_t *cpy_raw = malloc(size_raw);
-    struct fds_tfield *cpy_rev = (tmplt->fields_rev) ? malloc(size_rev) : NULL;
-    if (!cpy_main || !cpy_raw || (tmplt->fields_rev && !cpy_rev)) {
-        free(cpy_main);
-        free(cpy_raw);
-        free(cpy_rev);
+    if (!cpy_main) {
         return NULL;
     }
 
     memcpy(cpy_main, tmplt, size_main);
-    memcpy(cpy_raw, tmplt->raw.data, size_raw);
-    if (tmplt->fields_rev) {
-        memcpy(cpy_rev, tmplt->fields_rev, size_rev);
+    cpy_main->raw.data = NULL;
+    cpy_main->fields_rev = NULL;
+    cpy_main->index.table = NULL;
+    cpy_main->index.dyn_runs = NULL;
+    cpy_main->index.views = NULL;
+    if (cpy_main->index.shared) {
+        template_shared_acquire(cpy_main->index.shared);
+    }
+
+    if (template_array_copy(tmplt, tmplt->raw.data, size_raw, size_raw,
+                (void **) &cpy_main->raw.data) != FDS_OK
+            || template_array_copy(tmplt, tmplt->fields_rev, size_rev, size_rev,
+                (void **) &cpy_main->fields_rev) != FDS_OK
+            || template_array_copy(tmplt, tmplt->index.table, size_idx, size_idx,
+                (void **) &cpy_main->index.table) != FDS_OK
+            || template_array_copy(tmplt, tmplt->index.dyn_runs, size_runs, size_runs,
+                (void **) &cpy_main->index.dyn_runs) != FDS_OK
+            || template_array_copy(tmplt, tmplt->index.views, size_views, size_views_alloc,
+                (void **) &cpy_main->index.views) != FDS_OK) {
+        fds_template_destroy(cpy_main);
+        return NULL;
     }
 
-    cpy_main->raw.data = cpy_raw;
-    cpy_main->fields_rev = cpy_rev;
     return cpy_main;
 }
 
 void
 fds_template_destroy(struct fds_template *tmplt)
 {
-    free(tmplt->raw.data);
-    free(tmplt->fields_rev);
+    template_array_free(tmplt, tmplt->raw.data);
+    template_array_free(tmplt, tmplt->fields_rev);
+    template_array_free(tmplt, tmplt->index.table);
+    template_array_free(tmplt, tmplt->index.dyn_runs);
+    template_array_free(tmplt, tmplt->index.views);
+    template_shared_release(tmplt->index.shared);
     free(tmplt);
 }
 
@@ -762,6 +966,23 @@ is_structured(const struct fds_iemgr_elem *elem)
 const struct fds_tfield *
 fds_template_cfind(const struct fds_template *tmplt, uint32_t en, uint16_t id)
 {
+    const uint16_t *table = tmplt->index.table;
+    if (table != NULL) {
+        // Use the lookup index
+        const uint16_t mask = tmplt->index.mask;
+        uint32_t pos = template_index_hash(en, id) & mask;
+
+        while (table[pos] != 0) {
+            const struct fds_tfield *ptr = &tmplt->fields[table[pos] - 1U];
+            if (ptr->id == id && ptr->en == en) {
+                return ptr;
+            }
+            pos = (pos + 1U) & mask;
+        }
+
+        return NULL;
+    }
+
     const uint16_t field_cnt = tmplt->fields_cnt_total;
     for (uint16_t i = 0; i < field_cnt; ++i) {
         const struct fds_tfield *ptr = &tmplt->fields[i];
@@ -892,6 +1113,65 @@ template_ies_biflow_src2dst(const fds_iemgr_t *iemgr, uint32_t pen, uint16_t *id
     return FDS_OK;
 }
 
+/**
+ * \brief Check if a template field is a padding field (PEN: 0 or 29305, IE: 210)
+ * \param[in] field Template field
+ * \return True or false
+ */
+static inline bool
+template_field_is_padding(const struct fds_tfield *field)
+{
+    return field->id == 210U && (field->en == 0U || field->en == 29305U);
+}
+
+/**
+ * \brief Build forward and reverse views of Biflow template fields
+ *
+ * Each view consists of indexes of fields that are not reverse (from the point of view of the
+ * direction) and not padding. Previously created views are replaced. See
+ * fds_template_index#views for more information.
+ * \param[in] tmplt Template (with already created reverse template fields, if Biflow)
+ * \return #FDS_OK or #FDS_ERR_NOMEM
+ */
+static int
+template_views_build(struct fds_template *tmplt)
+{
+    template_array_free(tmplt, tmplt->index.views);
+    tmplt->index.views = NULL;
+    tmplt->index.view_fwd_cnt = 0;
+    tmplt->index.view_rev_cnt = 0;
+
+    if ((tmplt->flags & FDS_TEMPLATE_BIFLOW) == 0 || !tmplt->fields_rev) {
+        return FDS_OK;
+    }
+
+    const uint16_t fields_cnt = tmplt->fields_cnt_total;
+    uint16_t *views = malloc(2U * fields_cnt * sizeof(*views));
+    if (!views) {
+        return FDS_ERR_NOMEM;
+    }
+
+    const struct fds_tfield *directions[] = {tmplt->fields, tmplt->fields_rev};
+    uint16_t cnts[2] = {0, 0};
+    uint16_t pos = 0;
+    for (size_t dir = 0; dir < 2U; ++dir) {
+        const struct fds_tfield *fields = directions[dir];
+        for (uint16_t i = 0; i < fields_cnt; ++i) {
+            const struct fds_tfield *field = &fields[i];
+            if ((field->flags & FDS_TFIELD_REVERSE) != 0 || template_field_is_padding(field)) {
+                continue;
+            }
+            views[pos++] = i;
+            cnts[dir]++;
+        }
+    }
+
+    tmplt->index.views = views;
+    tmplt->index.view_fwd_cnt = cnts[0];
+    tmplt->index.view_rev_cnt = cnts[1];
+    return FDS_OK;
+}
+
 /**
  * \brief Recalculate Biflow template fields
  *
@@ -1074,7 +1354,11 @@ fds_template_ies_define(struct fds_template *tmplt, const fds_iemgr_t *iemgr, bo
         tmplt->flags |= FDS_TEMPLATE_STRUCT;
     }
 
-    return template_ies_biflow(tmplt, iemgr);
+    // Definitions and the reverse view of fields have been changed
+    tmplt->index.uid = template_uid_next();
+    int ret_biflow = template_ies_biflow(tmplt, iemgr);
+    int ret_views = template_views_build(tmplt);
+    return (ret_biflow != FDS_OK) ? ret_biflow : ret_views;
 }
 
 int
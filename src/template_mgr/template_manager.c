@@ -40,13 +40,19 @@
  *
  */
 
+#include <stdatomic.h>
 #include <stdint.h>
 #include <libfds.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
+#include <arpa/inet.h>
 
 #include "garbage.h"
+#include "publish.h"
 #include "snapshot.h"
+#include "template_pool.h"
+#include "tmgr_iemgr.h"
 
 /** Default snapshot lifetime if the history mod is enabled */
 #define SNAPSHOT_DEF_LIFETIME 15
@@ -149,6 +155,12 @@ struct fds_tmgr {
          *   (fds_tmgr#cfg#en_history_access), only the last snapshot is accessible and valid.
          */
         uint16_t lifetime_snapshot;
+        /**
+         * \brief Maximal number of snapshots
+         * \note If the value is zero, the number of snapshots is limited only by the lifetime of
+         *   historical snapshots (fds_tmgr#limits#lifetime_snapshot).
+         */
+        uint16_t snapshot_cnt;
     } limits; /**< Timeouts */
 
     struct {
@@ -161,8 +173,26 @@ struct fds_tmgr {
          *  fds_tmgr#time_now)
          */
         struct fds_tsnapshot *current;
+        /**
+         * History older than the oldest snapshot has been removed due to the limit of snapshots
+         * (fds_tmgr#limits#snapshot_cnt) and it is not accessible anymore
+         */
+        bool trimmed;
     } list; /**< Link to snapshots in a linked-list */
 
+    struct {
+        /** Array of snapshots sorted by start time (from the oldest to the newest)      */
+        struct fds_tsnapshot **snaps;
+        /** Position of the oldest snapshot in the array                                 */
+        size_t first;
+        /** Number of snapshots in the array                                             */
+        size_t cnt;
+        /** Size of the array                                                            */
+        size_t size;
+        /** The array corresponds to the linked-list (otherwise it must be rebuilt first) */
+        bool valid;
+    } index; /**< Index of snapshots for fast backward seeks (see mgr_seek_backwards()) */
+
     struct {
         /** Type of session */
         enum fds_session_type session_type;
@@ -176,9 +206,20 @@ struct fds_tmgr {
 
     /** Database of IPFIX Information Elements  */
     const fds_iemgr_t *ies_db;
+    /** Requested redefinition of templates (see tmgr_iemgr_request()) */
+    struct {
+        /** New IE manager (can be NULL)                                */
+        const fds_iemgr_t *iemgr;
+        /** Generation of the new IE manager (0 = never requested)      */
+        uint64_t gen;
+        /** Generation of the IE manager used by templates (any thread can read it) */
+        atomic_uint_fast64_t gen_done;
+    } ies_req;
 
     /** Garbage ready to throw away (old unreachable templates/snapshots/etc.) */
     fds_tgarbage_t *garbage;
+    /** Publisher of snapshots to readers in other threads */
+    struct publish pub;
 };
 
 /**
@@ -260,6 +301,231 @@ mgr_time_cmp(uint32_t t1, uint32_t t2)
 #define TIME_GT(t1, t2) (mgr_time_cmp((t1), (t2)) > 0)
 
 
+/**
+ * \brief Initial size of the index of snapshots
+ */
+#define MGR_INDEX_DEF_SIZE 8U
+
+/**
+ * \brief Invalidate the index of snapshots
+ *
+ * The index will be rebuilt when a backward seek needs it.
+ * \param[in] mgr Template manager
+ */
+static inline void
+mgr_index_invalidate(struct fds_tmgr *mgr)
+{
+    mgr->index.valid = false;
+}
+
+/**
+ * \brief Find the position of a snapshot in the index of snapshots (binary search)
+ * \warning The index MUST be valid.
+ * \param[in]  mgr  Template manager
+ * \param[in]  snap Snapshot
+ * \param[out] pos  Position of the snapshot (relative to the oldest snapshot in the index)
+ * \return True if the snapshot has been found. Otherwise false.
+ */
+static bool
+mgr_index_locate(const struct fds_tmgr *mgr, const struct fds_tsnapshot *snap, size_t *pos)
+{
+    assert(mgr->index.valid);
+    struct fds_tsnapshot **snaps = &mgr->index.snaps[mgr->index.first];
+    size_t lo = 0;
+    size_t hi = mgr->index.cnt;
+
+    // Find the first snapshot that starts after the snapshot
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2U;
+        if (TIME_LE(snaps[mid]->start_time, snap->start_time)) {
+            lo = mid + 1U;
+        } else {
+            hi = mid;
+        }
+    }
+
+    // Multiple snapshots can start at the same time
+    while (lo > 0 && TIME_EQ(snaps[lo - 1U]->start_time, snap->start_time)) {
+        if (snaps[--lo] == snap) {
+            *pos = lo;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * \brief Insert a snapshot into the index of snapshots
+ *
+ * If the snapshot cannot be inserted (memory allocation error), the index is invalidated.
+ * \param[in] mgr  Template manager
+ * \param[in] pos  Position of the new snapshot (relative to the oldest snapshot in the index)
+ * \param[in] snap New snapshot
+ */
+static void
+mgr_index_insert(struct fds_tmgr *mgr, size_t pos, struct fds_tsnapshot *snap)
+{
+    if (!mgr->index.valid) {
+        return;
+    }
+
+    assert(pos <= mgr->index.cnt);
+    if (pos == 0 && mgr->index.first > 0) {
+        // There is space before the oldest snapshot
+        mgr->index.first--;
+        mgr->index.cnt++;
+        mgr->index.snaps[mgr->index.first] = snap;
+        return;
+    }
+
+    if (mgr->index.first + mgr->index.cnt == mgr->index.size) {
+        if (mgr->index.first >= mgr->index.size / 2U) {
+            // At least half of the array is unused -> move snapshots to the beginning
+            memmove(mgr->index.snaps, &mgr->index.snaps[mgr->index.first],
+                mgr->index.cnt * sizeof(*mgr->index.snaps));
+            mgr->index.first = 0;
+        } else {
+            const size_t new_size = 2U * mgr->index.size;
+            struct fds_tsnapshot **new_snaps =
+                realloc(mgr->index.snaps, new_size * sizeof(*new_snaps));
+            if (!new_snaps) {
+                mgr_index_invalidate(mgr);
+                return;
+            }
+
+            mgr->index.snaps = new_snaps;
+            mgr->index.size = new_size;
+        }
+    }
+
+    struct fds_tsnapshot **snaps = &mgr->index.snaps[mgr->index.first];
+    memmove(&snaps[pos + 1U], &snaps[pos], (mgr->index.cnt - pos) * sizeof(*snaps));
+    snaps[pos] = snap;
+    mgr->index.cnt++;
+}
+
+/**
+ * \brief Insert a new snapshot into the index of snapshots next to a snapshot in the index
+ *
+ * If the position of the anchor cannot be determined, the index is invalidated.
+ * \param[in] mgr    Template manager
+ * \param[in] anchor Snapshot in the index
+ * \param[in] snap   New snapshot
+ * \param[in] newer  Insert the new snapshot as a successor (true) or predecessor (false)
+ */
+static void
+mgr_index_insert_next(struct fds_tmgr *mgr, const struct fds_tsnapshot *anchor,
+    struct fds_tsnapshot *snap, bool newer)
+{
+    if (!mgr->index.valid) {
+        return;
+    }
+
+    size_t pos;
+    if (!mgr_index_locate(mgr, anchor, &pos)) {
+        mgr_index_invalidate(mgr);
+        return;
+    }
+
+    mgr_index_insert(mgr, newer ? pos + 1U : pos, snap);
+}
+
+/**
+ * \brief Remove a snapshot from the index of snapshots
+ * \param[in] mgr  Template manager
+ * \param[in] snap Snapshot to remove
+ */
+static void
+mgr_index_remove(struct fds_tmgr *mgr, const struct fds_tsnapshot *snap)
+{
+    if (!mgr->index.valid) {
+        return;
+    }
+
+    size_t pos;
+    if (!mgr_index_locate(mgr, snap, &pos)) {
+        mgr_index_invalidate(mgr);
+        return;
+    }
+
+    struct fds_tsnapshot **snaps = &mgr->index.snaps[mgr->index.first];
+    if (pos == 0) {
+        mgr->index.first++;
+    } else {
+        memmove(&snaps[pos], &snaps[pos + 1U], (mgr->index.cnt - pos - 1U) * sizeof(*snaps));
+    }
+
+    mgr->index.cnt--;
+}
+
+/**
+ * \brief Rebuild the index of snapshots from the linked-list of snapshots
+ * \param[in] mgr Template manager
+ * \return #FDS_OK or #FDS_ERR_NOMEM (the index remains invalid)
+ */
+static int
+mgr_index_rebuild(struct fds_tmgr *mgr)
+{
+    size_t cnt = 0;
+    for (const struct fds_tsnapshot *ptr = mgr->list.oldest; ptr != NULL; ptr = ptr->link.newer) {
+        cnt++;
+    }
+
+    if (cnt > mgr->index.size || mgr->index.size == 0) {
+        size_t new_size = MGR_INDEX_DEF_SIZE;
+        while (new_size < cnt) {
+            new_size *= 2U;
+        }
+
+        struct fds_tsnapshot **new_snaps = realloc(mgr->index.snaps, new_size * sizeof(*new_snaps));
+        if (!new_snaps) {
+            return FDS_ERR_NOMEM;
+        }
+
+        mgr->index.snaps = new_snaps;
+        mgr->index.size = new_size;
+    }
+
+    size_t idx = 0;
+    for (struct fds_tsnapshot *ptr = mgr->list.oldest; ptr != NULL; ptr = ptr->link.newer) {
+        mgr->index.snaps[idx++] = ptr;
+    }
+
+    mgr->index.first = 0;
+    mgr->index.cnt = cnt;
+    mgr->index.valid = true;
+    return FDS_OK;
+}
+
+/**
+ * \brief Find the newest snapshot that starts at the given time or before (binary search)
+ * \warning The index MUST be valid.
+ * \param[in] mgr  Template manager
+ * \param[in] time Time
+ * \return Pointer to the snapshot or NULL (all snapshots start later)
+ */
+static struct fds_tsnapshot *
+mgr_index_find(const struct fds_tmgr *mgr, uint32_t time)
+{
+    assert(mgr->index.valid);
+    struct fds_tsnapshot **snaps = &mgr->index.snaps[mgr->index.first];
+    size_t lo = 0;
+    size_t hi = mgr->index.cnt;
+
+    // Find the first snapshot that starts after the time
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2U;
+        if (TIME_LE(snaps[mid]->start_time, time)) {
+            lo = mid + 1U;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return (lo > 0) ? snaps[lo - 1U] : NULL;
+}
+
 /**
  * \brief Insert a new snapshot into hierarchy (as a newer snapshot)
  *
@@ -293,6 +559,8 @@ mgr_link_newer(struct fds_tsnapshot *anchor, struct fds_tsnapshot *new)
         mgr->list.newest = new;
     }
 
+    mgr_index_insert_next(anchor->link.mgr, anchor, new, true);
+
     anchor->link.newer = new;
     new->link.older = anchor;
 }
@@ -330,6 +598,8 @@ mgr_link_older(struct fds_tsnapshot *anchor, struct fds_tsnapshot *new)
         mgr->list.oldest = new;
     }
 
+    mgr_index_insert_next(anchor->link.mgr, anchor, new, false);
+
     new->link.newer = anchor;
     anchor->link.older = new;
 }
@@ -365,6 +635,7 @@ mgr_snap_create(struct fds_tmgr *mgr, uint32_t time)
         mgr->list.oldest = snap;
         mgr->list.newest = snap;
         snap->link.mgr = mgr;
+        mgr_index_invalidate(mgr);
     }
 
     return snap;
@@ -377,7 +648,7 @@ mgr_snap_create(struct fds_tmgr *mgr, uint32_t time)
  * \return Always true.
  */
 static bool
-mgr_snap_destroy_cb(struct snapshot_rec *rec, void *data)
+mgr_snap_destroy_cb(const struct snapshot_rec *rec, void *data)
 {
     (void) data; // Not used...
     if (rec->flags & SNAPSHOT_TF_DESTROY) {
@@ -411,24 +682,26 @@ mgr_snap_destroy(struct fds_tsnapshot *snap)
  * \param[in] snap Snapshot
  * \param[in] id   Template ID
  * \return On success returns #FDS_OK. If the other snapshot is not found, the function will
- *   return #FDS_ERR_NOTFOUND and the flag will not be changed.
+ *   return #FDS_ERR_NOTFOUND and the flag will not be changed. If a memory allocation error has
+ *   occurred, returns #FDS_ERR_NOMEM and the flag will not be changed.
  */
 static int
 mgr_snap_dflag_move(struct fds_tsnapshot *snap, uint16_t id)
 {
     // Make sure that the snapshot has the "Delete" flag
-    struct snapshot_rec *snap_rec = snapshot_rec_find(snap, id);
-    assert((snap_rec->flags & SNAPSHOT_TF_DESTROY) != 0);
+    const struct snapshot_rec *snap_rec = snapshot_rec_cfind(snap, id);
+    const uint16_t snap_flags = snapshot_rec_flags_get(snap, snap_rec);
+    assert((snap_flags & SNAPSHOT_TF_DESTROY) != 0);
 
-    if (snap_rec->flags & SNAPSHOT_TF_CREATE) {
+    if (snap_flags & SNAPSHOT_TF_CREATE) {
         // No one in the past can have a reference to this template
         return FDS_ERR_NOTFOUND;
     }
 
     struct fds_tsnapshot *ancestor = snap->link.older;
-    struct snapshot_rec *ancestor_rec;
+    const struct snapshot_rec *ancestor_rec;
     while (ancestor != NULL) {
-        ancestor_rec = snapshot_rec_find(ancestor, id);
+        ancestor_rec = snapshot_rec_cfind(ancestor, id);
         if (!ancestor_rec || ancestor_rec->ptr != snap_rec->ptr) {
             /* This snapshot doesn't have a pointer to the template or the pointer is different
              * due to history modification. We have to skip to the next ancestor.
@@ -446,9 +719,15 @@ mgr_snap_dflag_move(struct fds_tsnapshot *snap, uint16_t id)
         return FDS_ERR_NOTFOUND;
     }
 
-    // Transfer the flag
-    snap_rec->flags &= ~SNAPSHOT_TF_DESTROY;
-    ancestor_rec->flags |= SNAPSHOT_TF_DESTROY;
+    // Transfer the flag (L2 tables shared with other snapshots are copied first)
+    struct snapshot_rec *src_rec, *dst_rec;
+    if (snapshot_rec_edit(snap, id, &src_rec) != FDS_OK
+            || snapshot_rec_edit(ancestor, id, &dst_rec) != FDS_OK) {
+        return FDS_ERR_NOMEM;
+    }
+
+    src_rec->flags &= ~SNAPSHOT_TF_DESTROY;
+    dst_rec->flags |= SNAPSHOT_TF_DESTROY;
     return FDS_OK;
 }
 
@@ -461,17 +740,22 @@ mgr_snap_dflag_move(struct fds_tsnapshot *snap, uint16_t id)
  * \return Always true
  */
 static bool
-mgr_snap_remove_cb(struct snapshot_rec *rec, void *data)
+mgr_snap_remove_cb(const struct snapshot_rec *rec, void *data)
 {
     struct fds_tsnapshot *snap = data;
-    assert(snapshot_rec_find(snap, rec->id) == rec);
 
     // Process only records with "Delete" flag
     if (rec->flags & SNAPSHOT_TF_DESTROY) {
         /* Try to move the flag. It can remain here, if this is the last reference among snapshots
          * in the template manager and the template will be destroyed together with this snapshot.
          */
-        mgr_snap_dflag_move(snap, rec->id);
+        if (mgr_snap_dflag_move(snap, rec->id) == FDS_ERR_NOMEM) {
+            /* The flag cannot be moved, but the template must not be destroyed together with
+             * this snapshot. Remaining templates of the snapshot are rather leaked.
+             */
+            snapshot_flags_clear(snap, SNAPSHOT_TF_DESTROY);
+            return false;
+        }
     }
 
     return true;
@@ -495,6 +779,7 @@ mgr_snap_remove(struct fds_tsnapshot *snap)
 
     // Update local and global pointers
     struct fds_tmgr *mgr = snap->link.mgr;
+    mgr_index_remove(mgr, snap);
 
     if (snap->link.newer) {
         snap->link.newer->link.older = snap->link.older;
@@ -525,34 +810,6 @@ mgr_snap_remove(struct fds_tsnapshot *snap)
     garbage_append(mgr->garbage, snap, delete_fn);
 }
 
-/**
- * \brief Clear "Create flag" of a snapshot record (callback function)
- * \param[in] rec  Snapshot record
- * \param[in] data Not used
- * \return Always true
- */
-static bool
-mgr_snap_clone_cflag_cb(struct snapshot_rec *rec, void *data)
-{
-    (void) data;
-    rec->flags &= ~SNAPSHOT_TF_CREATE;
-    return true;
-}
-
-/**
- * \brief Clear "Delete flag" of a snapshot record (callback function)
- * \param[in] rec  Snapshot record
- * \param[in] data Not used
- * \return Always true
- */
-static bool
-mgr_snap_clone_dflag_cb(struct snapshot_rec *rec, void *data)
-{
-    (void) data;
-    rec->flags &= ~SNAPSHOT_TF_DESTROY;
-    return true;
-}
-
 /** Auxiliary structure for mgr_snap_clone_remove_exp_cb() callback function */
 struct mgr_snap_clone_remove_exp {
     /** Old snapshot         */
@@ -564,6 +821,8 @@ struct mgr_snap_clone_remove_exp {
     uint32_t lifetime_min;
     /** True, if at least one template has enabled timeout   */
     bool lifetime_enabled;
+    /** Operation result                                     */
+    int ret_code;
 };
 
 /**
@@ -573,10 +832,10 @@ struct mgr_snap_clone_remove_exp {
  * sure that "Delete" flag will be moved back to the old snapshot.
  * \param[in] rec  Snapshot record
  * \param[in] data Structure mgr_snap_clone_remove_exp
- * \return Always true
+ * \return True on success. On error returns false and a new return code is set.
  */
 static bool
-mgr_snap_clone_remove_exp_cb(struct snapshot_rec *rec, void *data)
+mgr_snap_clone_remove_exp_cb(const struct snapshot_rec *rec, void *data)
 {
     struct mgr_snap_clone_remove_exp *info = data;
 
@@ -586,8 +845,6 @@ mgr_snap_clone_remove_exp_cb(struct snapshot_rec *rec, void *data)
         return true;
     }
 
-    // The record is from the new snapshot
-    assert(snapshot_rec_find(info->new, rec->id) == rec);
     // Check that lifetime is really enabled
     assert(TIME_NE(rec->ptr->time.last_seen, rec->ptr->time.end_of_life)); // Must be different
 
@@ -602,13 +859,24 @@ mgr_snap_clone_remove_exp_cb(struct snapshot_rec *rec, void *data)
     }
 
     // Remove the record
+    int ret_code;
+    if ((ret_code = snapshot_rec_remove(info->new, rec->id)) != FDS_OK) {
+        info->ret_code = ret_code;
+        return false;
+    }
+
     if (rec->flags & SNAPSHOT_TF_DESTROY) {
         // Move "Delete" flag back
-        struct snapshot_rec *old_rec = snapshot_rec_find(info->old, rec->id);
-        assert(old_rec != NULL);
+        struct snapshot_rec *old_rec;
+        if ((ret_code = snapshot_rec_edit(info->old, rec->id, &old_rec)) != FDS_OK) {
+            // The template is rather leaked than destroyed while it is still referenced
+            info->ret_code = ret_code;
+            return false;
+        }
+
         old_rec->flags |= SNAPSHOT_TF_DESTROY;
     }
-    snapshot_rec_remove(info->new, rec->id);
+
     return true;
 }
 
@@ -658,10 +926,11 @@ mgr_snap_clone(struct fds_tsnapshot *src, struct fds_tsnapshot **dst, uint32_t s
 
     /*
      * Transfer ownership of templates i.e. old snapshot records will not have "Delete" flag
-     * anymore. Also remove "Create" flags that must remain in the parent.
+     * anymore. Also remove "Create" flags that must remain in the parent. Both snapshots still
+     * share all L2 tables, so only masks of flags are modified.
      */
-    snapshot_rec_for(src, &mgr_snap_clone_dflag_cb, NULL);
-    snapshot_rec_for(new_snap,  &mgr_snap_clone_cflag_cb, NULL);
+    snapshot_flags_clear(src, SNAPSHOT_TF_DESTROY);
+    snapshot_flags_clear(new_snap, SNAPSHOT_TF_CREATE);
 
     // Check if there is a template that has expired...
     fds_tmgr_t *mgr = src->link.mgr;
@@ -671,11 +940,14 @@ mgr_snap_clone(struct fds_tsnapshot *src, struct fds_tsnapshot **dst, uint32_t s
         const uint32_t max_timeout = MAX(mgr->limits.lifetime_normal, mgr->limits.lifetime_opts);
         const uint32_t max_lifetime = new_snap->start_time + max_timeout;
 
-        struct mgr_snap_clone_remove_exp data = {src, new_snap, max_lifetime, false};
+        struct mgr_snap_clone_remove_exp data = {src, new_snap, max_lifetime, false, FDS_OK};
         snapshot_rec_for(new_snap, mgr_snap_clone_remove_exp_cb, &data);
 
         new_snap->lifetime.enabled = data.lifetime_enabled;
         new_snap->lifetime.min_value = data.lifetime_min + 1;
+        if (data.ret_code != FDS_OK) {
+            return data.ret_code;
+        }
     }
 
     /* TODO: optimization enable/disable???
@@ -750,7 +1022,7 @@ static int
 mgr_snap_template_add_ref(struct fds_tsnapshot *snap, struct fds_template *tmplt, uint16_t flags)
 {
     // Do NOT overwrite template references
-    assert(snapshot_rec_find(snap, tmplt->id) == NULL);
+    assert(snapshot_rec_cfind(snap, tmplt->id) == NULL);
 
     // This flag should be set only by this function
     assert((flags & SNAPSHOT_TF_TIMEOUT) == 0);
@@ -787,6 +1059,114 @@ mgr_snap_template_add_ref(struct fds_tsnapshot *snap, struct fds_template *tmplt
 static int
 mgr_snap_template_remove(struct fds_tsnapshot *snap, uint16_t id);
 
+/**
+ * \brief Update timestamps of a template in a snapshot record
+ *
+ * The template MUST NOT be accessible outside of the snapshot i.e. the snapshot has not been
+ * passed to the user or readers and the record has "Create" flag. The minimal lifetime of the
+ * snapshot is never increased here, as other templates might expire at the same time. Instead,
+ * it is recalculated before the snapshot is considered expired (see mgr_snap_lifetime_update()).
+ * \param[in] snap Snapshot
+ * \param[in] rec  Snapshot record of the template
+ */
+static void
+mgr_snap_template_touch(struct fds_tsnapshot *snap, struct snapshot_rec *rec)
+{
+    const struct fds_tmgr *mgr = snap->link.mgr;
+    struct fds_template *tmplt = rec->ptr;
+    assert(!snap->shared && (rec->flags & SNAPSHOT_TF_CREATE));
+
+    const uint32_t lifetime = (tmplt->type == FDS_TYPE_TEMPLATE)
+        ? mgr->limits.lifetime_normal
+        : mgr->limits.lifetime_opts;
+    tmplt->time.last_seen = mgr->time_now;
+    tmplt->time.end_of_life = mgr->time_now + lifetime;
+    rec->lifetime = tmplt->time.end_of_life;
+
+    if (TIME_EQ(tmplt->time.last_seen, tmplt->time.end_of_life)) {
+        rec->flags &= ~SNAPSHOT_TF_TIMEOUT;
+        return;
+    }
+
+    rec->flags |= SNAPSHOT_TF_TIMEOUT;
+    const uint32_t invalid_time = tmplt->time.end_of_life + 1;
+    if (!snap->lifetime.enabled) {
+        snap->lifetime.enabled = true;
+        snap->lifetime.min_value = invalid_time;
+    } else if (TIME_LT(invalid_time, snap->lifetime.min_value)) {
+        snap->lifetime.min_value = invalid_time;
+    }
+}
+
+/**
+ * \brief Refresh a template in a snapshot (i.e. the same template has been received again)
+ *
+ * If the template has been added to the snapshot and it is not accessible outside of the
+ * snapshot, only its timestamps are updated. Otherwise, the template might be used by other
+ * snapshots (or their readers) and it must not be modified, therefore, it is replaced with
+ * a copy with new timestamps. In both cases, the first seen timestamp, Flow key and other
+ * settings are preserved.
+ *
+ * \warning The snapshot MUST be editable!
+ * \param[in] snap Snapshot
+ * \param[in] id   Template ID (the template must be in the snapshot)
+ * \return #FDS_OK on success. Otherwise #FDS_ERR_NOMEM and the snapshot is not modified.
+ */
+static int
+mgr_snap_template_refresh(struct fds_tsnapshot *snap, uint16_t id)
+{
+    assert(snap->editable == true);
+    const struct snapshot_rec *snap_rec = snapshot_rec_cfind(snap, id);
+    assert(snap_rec != NULL);
+
+    int ret_code;
+    if (snapshot_rec_flags_get(snap, snap_rec) & SNAPSHOT_TF_CREATE) {
+        // Fast path: the template is private to this snapshot
+        struct snapshot_rec *rec;
+        if ((ret_code = snapshot_rec_edit(snap, id, &rec)) != FDS_OK) {
+            return ret_code;
+        }
+
+        mgr_snap_template_touch(snap, rec);
+        return FDS_OK;
+    }
+
+    const struct fds_tmgr *mgr = snap->link.mgr;
+    struct fds_template *tmplt2add = fds_template_copy(snap_rec->ptr);
+    if (!tmplt2add) {
+        return FDS_ERR_NOMEM;
+    }
+
+    if (!tmplt2add->index.shared) {
+        /* Templates are usually refreshed periodically, so let the following copies share
+         * immutable arrays with this one (optional, i.e. a failure is not an error)
+         */
+        template_shared_create(tmplt2add, mgr->ies_db);
+    }
+
+    // Remove the old template from the snapshot. This can eventually move "Delete flag"...
+    if ((ret_code = mgr_snap_template_remove(snap, id)) != FDS_OK) {
+        fds_template_destroy(tmplt2add);
+        return ret_code;
+    }
+
+    // Update timestamp info
+    uint32_t lifetime = (tmplt2add->type == FDS_TYPE_TEMPLATE)
+        ? mgr->limits.lifetime_normal
+        : mgr->limits.lifetime_opts;
+    tmplt2add->time.last_seen = mgr->time_now;
+    tmplt2add->time.end_of_life = mgr->time_now + lifetime;
+
+    // Add a reference of the template to the snapshot
+    const uint16_t flags = SNAPSHOT_TF_CREATE | SNAPSHOT_TF_DESTROY; // First owner of the template
+    if ((ret_code = mgr_snap_template_add_ref(snap, tmplt2add, flags)) != FDS_OK) {
+        fds_template_destroy(tmplt2add);
+        return ret_code;
+    }
+
+    return FDS_OK;
+}
+
 /**
  * \brief Add a template to a snapshot
  *
@@ -822,11 +1202,22 @@ mgr_snap_template_add(struct fds_tsnapshot *snap, struct fds_template *tmplt)
     struct fds_tmgr *mgr = snap->link.mgr;
 
     // Is a template with the same ID already in the snapshot?
-    bool is_refresh = false;
-    struct snapshot_rec *snap_rec = snapshot_rec_find(snap, tmplt->id);
+    const struct snapshot_rec *snap_rec = snapshot_rec_cfind(snap, tmplt->id);
     if (snap_rec != NULL) {
-        is_refresh = (fds_template_cmp(snap_rec->ptr, tmplt) == 0);
-        if (!is_refresh && mgr->cfg.withdraw_mod == WITHDRAW_REQUIRED) {
+        if (fds_template_cmp(snap_rec->ptr, tmplt) == 0) {
+            /* We received exactly the same template, so we can just refresh the old one and
+             * preserve first seen timestamp, Flow key and other settings...
+             */
+            if ((ret_code = mgr_snap_template_refresh(snap, tmplt->id)) != FDS_OK) {
+                return ret_code;
+            }
+
+            // Now everything is OK and we can safely free the copy of the refreshed template
+            fds_template_destroy(tmplt);
+            return FDS_OK;
+        }
+
+        if (mgr->cfg.withdraw_mod == WITHDRAW_REQUIRED) {
            /* The template tries to replace a different template with the same ID, but a template
             * withdrawal is required first.
             */
@@ -834,55 +1225,32 @@ mgr_snap_template_add(struct fds_tsnapshot *snap, struct fds_template *tmplt)
         }
     }
 
-    struct fds_template *tmplt2add;
-    if (is_refresh) {
-        /* We received exactly the same template, so we can just copy the old one and preserve
-         * first seen timestamp, Flow key and other settings...
-         */
-        tmplt2add = fds_template_copy(snap_rec->ptr);
-        if (!tmplt2add) {
-            return FDS_ERR_NOMEM;
-        }
-    } else {
-        // We received a new template or a template that is different then the previous one
-        tmplt2add = tmplt;
-        tmplt2add->time.first_seen = mgr->time_now;
+    // We received a new template or a template that is different then the previous one
+    tmplt->time.first_seen = mgr->time_now;
 
-        // Update IE definitions
-        if ((ret_code = fds_template_ies_define(tmplt2add, mgr->ies_db, false)) != FDS_OK) {
-            return ret_code;
-        }
+    // Update IE definitions (unless already defined by a pool of shared templates)
+    if (!template_shared_defined(tmplt, mgr->ies_db)
+            && (ret_code = fds_template_ies_define(tmplt, mgr->ies_db, false)) != FDS_OK) {
+        return ret_code;
     }
 
     if (snap_rec != NULL) {
         // Remove the old template from the snapshot. This can eventually move "Delete flag"...
-        mgr_snap_template_remove(snap, tmplt2add->id);
+        if ((ret_code = mgr_snap_template_remove(snap, tmplt->id)) != FDS_OK) {
+            return ret_code;
+        }
     }
 
     // Update timestamp info
-    uint32_t lifetime = (tmplt2add->type == FDS_TYPE_TEMPLATE)
+    uint32_t lifetime = (tmplt->type == FDS_TYPE_TEMPLATE)
         ? mgr->limits.lifetime_normal
         : mgr->limits.lifetime_opts;
-    tmplt2add->time.last_seen = mgr->time_now;
-    tmplt2add->time.end_of_life = mgr->time_now + lifetime;
+    tmplt->time.last_seen = mgr->time_now;
+    tmplt->time.end_of_life = mgr->time_now + lifetime;
 
     // Add a reference of the template to the snapshot
     const uint16_t flags = SNAPSHOT_TF_CREATE | SNAPSHOT_TF_DESTROY; // First owner of the template
-    if ((ret_code = mgr_snap_template_add_ref(snap, tmplt2add, flags)) != FDS_OK) {
-        // Failed to add the record
-        if (is_refresh) {
-            fds_template_destroy(tmplt2add);
-        }
-
-        return ret_code;
-    }
-
-    if (is_refresh) {
-        // Now everything is OK and we can safely free the copy of the refreshed template
-        fds_template_destroy(tmplt);
-    }
-
-    return FDS_OK;
+    return mgr_snap_template_add_ref(snap, tmplt, flags);
 }
 
 /**
@@ -894,12 +1262,13 @@ mgr_snap_template_add(struct fds_tsnapshot *snap, struct fds_template *tmplt)
  * \param[in] snap Snapshot
  * \param[in] id   Template ID to remove
  * \return On success returns #FDS_OK. #FDS_ERR_NOTFOUND if the template is not present.
+ *   #FDS_ERR_NOMEM if a memory allocation error has occurred (the snapshot is not modified).
  */
 static int
 mgr_snap_template_remove(struct fds_tsnapshot *snap, uint16_t id)
 {
     // Is the template is the snapshot
-    struct snapshot_rec *snap_rec = snapshot_rec_find(snap, id);
+    const struct snapshot_rec *snap_rec = snapshot_rec_cfind(snap, id);
     if (!snap_rec) {
         return FDS_ERR_NOTFOUND;
     }
@@ -907,38 +1276,58 @@ mgr_snap_template_remove(struct fds_tsnapshot *snap, uint16_t id)
     // Make sure that the snapshot is editable
     assert(snap->editable);
 
-    if (snap->lifetime.enabled && snap->rec_cnt == 1) {
+    int ret_code;
+    struct fds_template *tmplt = snap_rec->ptr;
+    const uint16_t flags = snapshot_rec_flags_get(snap, snap_rec);
+    bool is_owner = false;
+
+    if ((flags & SNAPSHOT_TF_DESTROY) != 0 && (flags & SNAPSHOT_TF_CREATE) == 0) {
+        /* Let's try to move the delete flag to the first snapshot in the past that also has
+         * a reference to this snapshot.
+         */
+        ret_code = mgr_snap_dflag_move(snap, id);
+        if (ret_code != FDS_OK && ret_code != FDS_ERR_NOTFOUND) {
+            return ret_code;
+        }
+
+        // If not found, this snapshot has the last reference to the template
+        is_owner = (ret_code == FDS_ERR_NOTFOUND);
+    }
+
+    // Remove the record first (it can fail if the L2 table is shared and cannot be copied)
+    if ((ret_code = snapshot_rec_remove(snap, id)) != FDS_OK) {
+        return ret_code;
+    }
+
+    if (snap->lifetime.enabled && snap->rec_cnt == 0) {
         // The last record in the snapshot -> disable lifetime
         snap->lifetime.enabled = false;
     }
 
-    if ((snap_rec->flags & SNAPSHOT_TF_DESTROY) == 0) {
-        // The snapshot is not responsible for destruction of the template -> remove the record
-        return snapshot_rec_remove(snap, id);
+    if ((flags & SNAPSHOT_TF_DESTROY) == 0) {
+        // The snapshot is not responsible for destruction of the template
+        return FDS_OK;
     }
 
     // We have the "Delete" flag
-    if (snap_rec->flags & SNAPSHOT_TF_CREATE) {
+    if (flags & SNAPSHOT_TF_CREATE) {
         /* We have the "Create" and "Delete" flags at the same time.
          * The template has been added to this snapshot and immediately we want to remove it.
          * In other words, this snapshot hasn't been frozen yet, thus, no one can have a reference
          * to the template (we can directly free the template).
          */
-        fds_template_destroy(snap_rec->ptr);
-        return snapshot_rec_remove(snap, id);
+        fds_template_destroy(tmplt);
+        return FDS_OK;
     }
 
-    /* Let's try to move the delete flag to the first snapshot in the past that also has
-     * a reference to this snapshot.
-     */
-    if (mgr_snap_dflag_move(snap, id) == FDS_ERR_NOTFOUND) {
+    if (is_owner) {
         // This snapshot has the last reference -> move the template to the garbage
         fds_tgarbage_t *gc = snap->link.mgr->garbage;
         garbage_fn_t delete_fn = (garbage_fn_t) &fds_template_destroy;
-        garbage_append(gc, snap_rec->ptr, delete_fn);
+        garbage_append(gc, tmplt, delete_fn);
     }
 
-    return snapshot_rec_remove(snap, id);
+    return FDS_OK;
 }
 
 /**
@@ -970,7 +1359,7 @@ mgr_snap_template_withdraw(struct fds_tsnapshot *snap, uint16_t id, enum fds_tem
         return FDS_ERR_DENIED;
     }
 
-    struct snapshot_rec *snap_rec = snapshot_rec_find(snap, id);
+    const struct snapshot_rec *snap_rec = snapshot_rec_cfind(snap, id);
     if (!snap_rec) {
         // The template not found
         return FDS_ERR_NOTFOUND;
@@ -989,7 +1378,7 @@ mgr_snap_template_withdraw(struct fds_tsnapshot *snap, uint16_t id, enum fds_tem
     int ret_code;
 
     for (struct fds_tsnapshot *ptr = snap; ptr != NULL; ptr = ptr->link.newer) {
-        struct snapshot_rec *rec = snapshot_rec_find(ptr, id);
+        const struct snapshot_rec *rec = snapshot_rec_cfind(ptr, id);
         if (!rec) {
             /* Snapshot doesn't have a reference to the template, but there can be still anyone
              * else in the future due to history modification that caused this "gap".
@@ -1044,11 +1433,10 @@ struct mgr_snap_freeze {
  * \return True on success. On error returns false and a new return code is set.
  */
 static bool
-mgr_snap_freeze_cb(struct snapshot_rec *rec, void *data)
+mgr_snap_freeze_cb(const struct snapshot_rec *rec, void *data)
 {
     struct mgr_snap_freeze *info = data;
     struct fds_tmgr *mgr = info->snap->link.mgr;
-    assert(snapshot_rec_find(info->snap, rec->id) == rec);
 
     /* We are only interested into records that has been added into this snapshot (i.e. with
      * "Create" flag)
@@ -1076,7 +1464,7 @@ mgr_snap_freeze_cb(struct snapshot_rec *rec, void *data)
         }
 
         // Does the descent's snapshot has a template with the same ID?
-        struct snapshot_rec *dsc_rec = snapshot_rec_find(dsc, rec->id);
+        const struct snapshot_rec *dsc_rec = snapshot_rec_cfind(dsc, rec->id);
         if (dsc_rec != NULL) {
             const uint32_t dsc_seen = dsc_rec->ptr->time.last_seen;
             const uint32_t rec_seen = rec->ptr->time.last_seen;
@@ -1104,7 +1492,7 @@ mgr_snap_freeze_cb(struct snapshot_rec *rec, void *data)
             return false;
         }
 
-        if (dsc_rec != NULL && (ret_code = mgr_snap_template_remove(dsc, dsc_rec->id)) != FDS_OK) {
+        if (dsc_rec != NULL && (ret_code = mgr_snap_template_remove(dsc, rec->id)) != FDS_OK) {
             // Failed to remove the template
             info->ret_code = ret_code;
             return false;
@@ -1123,12 +1511,19 @@ mgr_snap_freeze_cb(struct snapshot_rec *rec, void *data)
         /* Move the "Delete" flag (responsibility to destroy the template) to the last modified
          * snapshot.
          */
-        struct snapshot_rec *last_rec = snapshot_rec_find(last_insert, rec->id);
+        struct snapshot_rec *last_rec, *snap_rec;
+        int ret_code;
+        if ((ret_code = snapshot_rec_edit(last_insert, rec->id, &last_rec)) != FDS_OK
+                || (ret_code = snapshot_rec_edit(info->snap, rec->id, &snap_rec)) != FDS_OK) {
+            info->ret_code = ret_code;
+            return false;
+        }
+
         assert(last_rec->ptr == rec->ptr);
         assert((last_rec->flags & (SNAPSHOT_TF_CREATE | SNAPSHOT_TF_DESTROY)) == 0);
 
         last_rec->flags |= SNAPSHOT_TF_DESTROY;
-        rec->flags &= ~SNAPSHOT_TF_DESTROY;
+        snap_rec->flags &= ~SNAPSHOT_TF_DESTROY;
     }
 
     return true;
@@ -1215,9 +1610,21 @@ mgr_cleanup(struct fds_tmgr *mgr)
         // Modify global pointers
         mgr->list.oldest = mgr->list.newest;
         mgr->list.current = NULL;
+        if (mgr->index.valid) {
+            // Only the newest snapshot remains
+            mgr->index.snaps[0] = mgr->list.newest;
+            mgr->index.first = 0;
+            mgr->index.cnt = 1;
+        }
         return;
     }
 
+    // Number of snapshots (to enforce the limit of snapshots)
+    size_t snap_cnt = 0;
+    for (const struct fds_tsnapshot *ptr = mgr->list.oldest; ptr; ptr = ptr->link.newer) {
+        snap_cnt++;
+    }
+
     // Proceed from the oldest to the newest snapshot
     struct fds_tsnapshot *next = mgr->list.oldest;
     const uint32_t newest_time = mgr->list.newest->start_time;
@@ -1231,24 +1638,101 @@ mgr_cleanup(struct fds_tmgr *mgr)
             break;
         }
 
-        // Is this snapshot reachable for seek operation? (i.e. remove duplicities)
-        if (TIME_EQ(ptr->start_time, ptr->link.newer->start_time)) {
-            // No, it isn't because it is hidden by the newer with the same start time
-            mgr_snap_remove(ptr);
-            continue;
-        }
+        // Is this snapshot reachable for seek operation? (i.e. remove duplicities)
+        if (TIME_EQ(ptr->start_time, ptr->link.newer->start_time)) {
+            // No, it isn't because it is hidden by the newer with the same start time
+            mgr_snap_remove(ptr);
+            snap_cnt--;
+            continue;
+        }
+
+        // Get the end time of validity of this snapshot
+        assert(TIME_NE(ptr->start_time, ptr->link.newer->start_time));
+        uint32_t end_time = ptr->link.newer->start_time - 1U;
+        if (TIME_LT(end_time + mgr->limits.lifetime_snapshot, newest_time)) {
+            // Historical snapshot is not valid anymore
+            mgr_snap_remove(ptr);
+            snap_cnt--;
+            continue;
+        }
+
+        if (mgr->limits.snapshot_cnt != 0 && snap_cnt > mgr->limits.snapshot_cnt) {
+            // Too many snapshots -> the oldest history is not accessible anymore
+            mgr_snap_remove(ptr);
+            snap_cnt--;
+            mgr->list.trimmed = true;
+            continue;
+        }
+    }
+
+    mgr->list.current = NULL;
+}
+
+/** \brief Auxiliary structure for mgr_snap_lifetime_update_cb() */
+struct mgr_snap_lifetime_update {
+    /** Minimal lifetime of templates with enabled timeout */
+    uint32_t lifetime_min;
+    /** True, if at least one template has enabled timeout */
+    bool lifetime_enabled;
+};
+
+/**
+ * \brief Find the minimal lifetime of templates (callback function)
+ * \param[in] rec  Snapshot record
+ * \param[in] data Structure mgr_snap_lifetime_update
+ * \return Always true
+ */
+static bool
+mgr_snap_lifetime_update_cb(const struct snapshot_rec *rec, void *data)
+{
+    struct mgr_snap_lifetime_update *info = data;
+
+    if ((rec->flags & SNAPSHOT_TF_TIMEOUT) == 0) {
+        return true;
+    }
+
+    if (!info->lifetime_enabled || TIME_LT(rec->lifetime, info->lifetime_min)) {
+        info->lifetime_min = rec->lifetime;
+    }
+
+    info->lifetime_enabled = true;
+    return true;
+}
+
+/**
+ * \brief Recalculate the minimal lifetime of a snapshot
+ *
+ * Refreshed templates (see mgr_snap_template_touch()) do not increase the minimal lifetime of
+ * the snapshot immediately, therefore, the lifetime must be recalculated before the snapshot
+ * is considered expired.
+ * \param[in] snap Snapshot
+ */
+static void
+mgr_snap_lifetime_update(struct fds_tsnapshot *snap)
+{
+    struct mgr_snap_lifetime_update data = {0, false};
+    snapshot_rec_for(snap, &mgr_snap_lifetime_update_cb, &data);
+
+    snap->lifetime.enabled = data.lifetime_enabled;
+    snap->lifetime.min_value = data.lifetime_min + 1;
+}
 
-        // Get the end time of validity of this snapshot
-        assert(TIME_NE(ptr->start_time, ptr->link.newer->start_time));
-        uint32_t end_time = ptr->link.newer->start_time - 1U;
-        if (TIME_LT(end_time + mgr->limits.lifetime_snapshot, newest_time)) {
-            // Historical snapshot is not valid anymore
-            mgr_snap_remove(ptr);
-            continue;
-        }
+/**
+ * \brief Check if at least one template of a snapshot is not valid at a given time
+ * \param[in] snap Snapshot
+ * \param[in] time Time
+ * \return True or false
+ */
+static bool
+mgr_snap_expired(struct fds_tsnapshot *snap, uint32_t time)
+{
+    if (!snap->lifetime.enabled || TIME_GT(snap->lifetime.min_value, time)) {
+        return false;
     }
 
-    mgr->list.current = NULL;
+    // The minimal lifetime might be outdated
+    mgr_snap_lifetime_update(snap);
+    return snap->lifetime.enabled && TIME_LE(snap->lifetime.min_value, time);
 }
 
 /**
@@ -1304,7 +1788,7 @@ mgr_seek_forwards(fds_tmgr_t *tmgr, uint32_t time)
         return ret_code;
     }
 
-    if (snap->lifetime.enabled && TIME_LE(snap->lifetime.min_value, time)) {
+    if (mgr_snap_expired(snap, time)) {
         // At least one template will expire -> create a new snapshot without these templates
         if ((ret_code = mgr_snap_clone(snap, &snap, time)) != FDS_OK) {
             tmgr->list.current = NULL;
@@ -1335,19 +1819,24 @@ mgr_seek_backwards(struct fds_tmgr *tmgr, uint32_t time)
     assert(tmgr->list.current && TIME_GT(tmgr->list.current->start_time, time));
 
     // Find a snapshot where "start time" >= time and "end time" <= time
-    struct fds_tsnapshot *snap = tmgr->list.current->link.older; // Start from the previous snap
-    while (snap) {
-        // Because we are in the past, all snapshots must be frozen
-        assert(snap->editable == false);
-
-        // Is it the required snapshot?
-        if (TIME_LE(snap->start_time, time)) {
-            // This is the first snapshot in required range
-            assert(TIME_GT(snap->link.newer->start_time, time));
-            break;
+    struct fds_tsnapshot *snap;
+    if (tmgr->index.valid || mgr_index_rebuild(tmgr) == FDS_OK) {
+        // Binary search (all snapshots newer than the current one start after the time)
+        snap = mgr_index_find(tmgr, time);
+        assert(!snap || snap != tmgr->list.current);
+    } else {
+        // Linear search (the index is not available due to a memory allocation error)
+        snap = tmgr->list.current->link.older; // Start from the previous snap
+        while (snap && TIME_GT(snap->start_time, time)) {
+            snap = snap->link.older;
         }
+    }
 
-        snap = snap->link.older;
+    if (snap) {
+        // Because we are in the past, all snapshots must be frozen
+        assert(snap->editable == false);
+        // This is the first snapshot in required range
+        assert(TIME_LE(snap->start_time, time) && TIME_GT(snap->link.newer->start_time, time));
     }
 
     if (!snap) {
@@ -1363,7 +1852,7 @@ mgr_seek_backwards(struct fds_tmgr *tmgr, uint32_t time)
     }
 
     // Snapshot found...
-    if (snap->lifetime.enabled && TIME_LE(snap->lifetime.min_value, time)) {
+    if (mgr_snap_expired(snap, time)) {
         // At least one template will expire -> create a new snapshot without these templates
         assert(TIME_LT(snap->start_time, time));
 
@@ -1386,6 +1875,8 @@ fds_tmgr_create(enum fds_session_type type)
         return NULL;
     }
 
+    publish_init(&mgr->pub);
+    atomic_init(&mgr->ies_req.gen_done, 0);
     mgr->garbage = garbage_create();
     if (!mgr->garbage) {
         fds_tmgr_destroy(mgr);
@@ -1444,6 +1935,8 @@ fds_tmgr_destroy(fds_tmgr_t *tmgr)
     if (tmgr->garbage) {
         garbage_destroy(tmgr->garbage);
     }
+    publish_deinit(&tmgr->pub);
+    free(tmgr->index.snaps);
 
     // Finally destroy the manager
     free(tmgr);
@@ -1463,7 +1956,9 @@ fds_tmgr_clear(fds_tmgr_t *tmgr)
 
     // Modify global pointers
     tmgr->list.oldest = tmgr->list.newest = tmgr->list.current = NULL;
+    tmgr->list.trimmed = false;
     tmgr->time_newest = tmgr->time_now = 0;
+    mgr_index_invalidate(tmgr);
 }
 
 int
@@ -1499,9 +1994,53 @@ fds_tmgr_garbage_destroy(fds_tgarbage_t *gc)
     garbage_destroy(gc);
 }
 
+int
+fds_tmgr_publish(fds_tmgr_t *tmgr)
+{
+    // Reserve resources first, so garbage stays in the manager if the allocation fails
+    int ret_code = publish_reserve(&tmgr->pub);
+    if (ret_code != FDS_OK) {
+        return ret_code;
+    }
+
+    // Collect garbage first, so it cannot contain the snapshot to publish
+    fds_tgarbage_t *gc;
+    if ((ret_code = fds_tmgr_garbage_get(tmgr, &gc)) != FDS_OK) {
+        return ret_code;
+    }
+
+    const fds_tsnapshot_t *snap = NULL;
+    if (tmgr->list.current != NULL && (ret_code = fds_tmgr_snapshot_get(tmgr, &snap)) != FDS_OK) {
+        // The previous snapshot could be in the garbage, so it cannot stay published
+        snap = NULL;
+    }
+
+    publish_snapshot(&tmgr->pub, snap);
+    publish_retire(&tmgr->pub, gc);
+    return ret_code;
+}
+
+void
+fds_tmgr_set_reclaimer(fds_tmgr_t *tmgr, fds_tmgr_reclaimer_t *rcl)
+{
+    tmgr->pub.rcl = rcl;
+}
+
+fds_treader_t *
+fds_treader_create(fds_tmgr_t *tmgr)
+{
+    return publish_reader_create(&tmgr->pub);
+}
+
 int
 fds_tmgr_set_time(fds_tmgr_t *tmgr, uint32_t exp_time)
 {
+    // Redefine templates on the first use after a change of the IE manager (see registry.c)
+    int ret_code;
+    if ((ret_code = tmgr_iemgr_apply(tmgr)) != FDS_OK) {
+        return ret_code;
+    }
+
     // Let's go to the past, but...
     if (TIME_LT(exp_time, tmgr->time_now)) {
         if (tmgr->list.newest != NULL) {
@@ -1514,6 +2053,11 @@ fds_tmgr_set_time(fds_tmgr_t *tmgr, uint32_t exp_time)
                 // Do not allow going back more that snapshot lifetime
                 return FDS_ERR_NOTFOUND;
             }
+
+            if (tmgr->list.trimmed && TIME_LT(exp_time, tmgr->list.oldest->start_time)) {
+                // Do not allow going back before the oldest snapshot (the limit of snapshots)
+                return FDS_ERR_NOTFOUND;
+            }
         } else {
             // The manager is empty (no snapshots)
             tmgr->time_newest = exp_time;
@@ -1556,6 +2100,24 @@ fds_tmgr_set_time(fds_tmgr_t *tmgr, uint32_t exp_time)
     }
 }
 
+/**
+ * \brief Check if a raw template is the same as the definition of the template in a snapshot
+ * \param[in] snap Snapshot
+ * \param[in] type Type of the template
+ * \param[in] ptr  Pointer to the raw template (i.e. the header of the Template Record)
+ * \param[in] len  Length of the raw template
+ * \return True if the template is present and its type and raw definition match.
+ */
+static inline bool
+mgr_template_raw_eq(const struct fds_tsnapshot *snap, enum fds_template_type type,
+    const void *ptr, uint16_t len)
+{
+    const struct fds_ipfix_trec *trec = ptr;
+    const struct snapshot_rec *rec = snapshot_rec_cfind(snap, ntohs(trec->template_id));
+    return rec != NULL && rec->ptr->type == type && rec->ptr->raw.length == len
+        && memcmp(rec->ptr->raw.data, ptr, len) == 0;
+}
+
 /**
  * \brief Prepare the current snapshot for modification
  *
@@ -1603,6 +2165,57 @@ mgr_modify_prepare(struct fds_tmgr *tmgr)
     return FDS_OK;
 }
 
+/**
+ * \brief Check if a template can be refreshed without modification of the snapshot hierarchy
+ *
+ * If history of the manager is not accessible (e.g. TCP session or zero snapshot lifetime) and
+ * the current snapshot has not been passed to the user or readers (see fds_tmgr_snapshot_get()),
+ * templates created in the snapshot are not accessible outside of the manager. Therefore, only
+ * their timestamps can be updated and no new snapshot has to be created even if the Export Time
+ * has changed (see mgr_template_touch()).
+ *
+ * \note If history is accessible, the refresh must be represented by a new snapshot, as it could
+ *   be later compared with a refresh of the template in the history (see mgr_snap_freeze()).
+ *   However, the copy of the template shares immutable arrays with the refreshed one (see
+ *   mgr_snap_template_refresh()).
+ * \param[in] tmgr Template manager
+ * \param[in] id   Template ID
+ * \return True or false
+ */
+static bool
+mgr_template_touchable(const struct fds_tmgr *tmgr, uint16_t id)
+{
+    const struct fds_tsnapshot *snap = tmgr->list.current;
+    const bool history = tmgr->cfg.en_history_access && tmgr->limits.lifetime_snapshot != 0;
+    if (history || snap->shared || snap->link.newer != NULL) {
+        return false;
+    }
+
+    const struct snapshot_rec *snap_rec = snapshot_rec_cfind(snap, id);
+    return snap_rec != NULL && (snapshot_rec_flags_get(snap, snap_rec) & SNAPSHOT_TF_CREATE);
+}
+
+/**
+ * \brief Refresh a template without modification of the snapshot hierarchy
+ * \warning The template MUST be touchable (see mgr_template_touchable()).
+ * \param[in] tmgr Template manager
+ * \param[in] id   Template ID
+ * \return #FDS_OK on success. Otherwise #FDS_ERR_NOMEM and the template is not modified.
+ */
+static int
+mgr_template_touch(struct fds_tmgr *tmgr, uint16_t id)
+{
+    assert(mgr_template_touchable(tmgr, id));
+
+    struct snapshot_rec *rec;
+    int ret_code;
+    if ((ret_code = snapshot_rec_edit(tmgr->list.current, id, &rec)) != FDS_OK) {
+        return ret_code;
+    }
+
+    mgr_snap_template_touch(tmgr->list.current, rec);
+    return FDS_OK;
+}
 
 int
 fds_tmgr_template_add(fds_tmgr_t *tmgr, struct fds_template *tmplt)
@@ -1618,6 +2231,17 @@ fds_tmgr_template_add(fds_tmgr_t *tmgr, struct fds_template *tmplt)
     }
 
     int ret_code;
+    if (mgr_template_touchable(tmgr, tmplt->id)) {
+        const struct snapshot_rec *snap_rec = snapshot_rec_cfind(tmgr->list.current, tmplt->id);
+        if (fds_template_cmp(snap_rec->ptr, tmplt) == 0) {
+            // The same template has been received again -> just refresh it
+            if ((ret_code = mgr_template_touch(tmgr, tmplt->id)) == FDS_OK) {
+                fds_template_destroy(tmplt);
+            }
+            return ret_code;
+        }
+    }
+
     if ((ret_code = mgr_modify_prepare(tmgr)) != FDS_OK) {
         return ret_code;
     }
@@ -1626,6 +2250,204 @@ fds_tmgr_template_add(fds_tmgr_t *tmgr, struct fds_template *tmplt)
     return mgr_snap_template_add(snap, tmplt);
 }
 
+int
+fds_tmgr_template_refresh(fds_tmgr_t *tmgr, enum fds_template_type type, const void *ptr,
+    uint16_t len)
+{
+    if (!tmgr->list.current) {
+        // Undefined snapshot
+        return FDS_ERR_ARG;
+    }
+
+    if ((type != FDS_TYPE_TEMPLATE && type != FDS_TYPE_TEMPLATE_OPTS)
+            || len < sizeof(struct fds_ipfix_trec)) {
+        return FDS_ERR_ARG;
+    }
+
+    // Compare the raw template with the current definition (the template is not parsed)
+    const struct fds_ipfix_trec *trec = ptr;
+    const uint16_t id = ntohs(trec->template_id);
+    if (!mgr_template_raw_eq(tmgr->list.current, type, ptr, len)) {
+        return FDS_ERR_NOTFOUND;
+    }
+
+    if (mgr_template_touchable(tmgr, id)) {
+        return mgr_template_touch(tmgr, id);
+    }
+
+    int ret_code;
+    if ((ret_code = mgr_modify_prepare(tmgr)) != FDS_OK) {
+        return ret_code;
+    }
+
+    return mgr_snap_template_refresh(tmgr->list.current, id);
+}
+
+/** \brief Template Record of an (Options) Template Set to add (see fds_tmgr_template_add_set()) */
+struct mgr_set_rec {
+    /** Parsed template (NULL, if the current definition is the same and should be refreshed) */
+    struct fds_template *tmplt;
+    /** Template ID                                                                          */
+    uint16_t id;
+};
+
+/**
+ * \brief Destroy parsed templates of (Options) Template Set records
+ * \param[in] recs Array of records
+ * \param[in] cnt  Number of records
+ */
+static void
+mgr_set_recs_destroy(struct mgr_set_rec *recs, size_t cnt)
+{
+    for (size_t i = 0; i < cnt; ++i) {
+        if (recs[i].tmplt != NULL) {
+            fds_template_destroy(recs[i].tmplt);
+        }
+    }
+}
+
+/**
+ * \brief Check if a new template of an (Options) Template Set can replace the previous
+ *   definition with the same ID
+ *
+ * The previous definition is the last record with the same ID in the Set or, if there is no
+ * such record, the template in the snapshot.
+ * \param[in] snap  Current snapshot
+ * \param[in] recs  Records of the Set preceding the new template
+ * \param[in] cnt   Number of the records
+ * \param[in] tmplt New template
+ * \return True if the template can be added. False if a withdrawal of the previous definition
+ *   is required first.
+ */
+static bool
+mgr_set_rec_allowed(const struct fds_tsnapshot *snap, const struct mgr_set_rec *recs, size_t cnt,
+    const struct fds_template *tmplt)
+{
+    for (size_t i = cnt; i-- > 0;) {
+        if (recs[i].id != tmplt->id) {
+            continue;
+        }
+
+        if (recs[i].tmplt != NULL) {
+            return fds_template_cmp(recs[i].tmplt, tmplt) == 0;
+        }
+
+        break; // Refresh of the template in the snapshot
+    }
+
+    const struct snapshot_rec *snap_rec = snapshot_rec_cfind(snap, tmplt->id);
+    return snap_rec == NULL || fds_template_cmp(snap_rec->ptr, tmplt) == 0;
+}
+
+int
+fds_tmgr_template_add_set(fds_tmgr_t *tmgr, struct fds_tset_iter *it)
+{
+    if (!tmgr->list.current) {
+        // Undefined snapshot
+        return FDS_ERR_ARG;
+    }
+
+    const struct fds_ipfix_set_hdr *set = it->_private.set_begin;
+    const enum fds_template_type type = (ntohs(set->flowset_id) == FDS_IPFIX_SET_TMPLT)
+        ? FDS_TYPE_TEMPLATE : FDS_TYPE_TEMPLATE_OPTS;
+    // Maximal number of records (the smallest definition is a Template header with one field)
+    const size_t rec_max = (ntohs(set->length) - FDS_IPFIX_SET_HDR_LEN) / 8U;
+
+    struct mgr_set_rec *recs = NULL;
+    if (rec_max > 0 && (recs = malloc(rec_max * sizeof(*recs))) == NULL) {
+        return FDS_ERR_NOMEM;
+    }
+
+    // Parse all templates first (nothing is modified if the Set is not valid)
+    struct fds_tsnapshot *snap = tmgr->list.current;
+    size_t rec_cnt = 0;
+    int ret_code;
+
+    while ((ret_code = fds_tset_iter_next(it)) == FDS_OK) {
+        if (it->field_cnt == 0) {
+            // Template Withdrawals are not supported
+            ret_code = FDS_ERR_ARG;
+            break;
+        }
+
+        assert(rec_cnt < rec_max);
+        struct mgr_set_rec *rec = &recs[rec_cnt];
+        rec->id = ntohs(it->ptr.trec->template_id);
+        rec->tmplt = NULL;
+
+        bool redefined = false;
+        for (size_t i = 0; i < rec_cnt && !redefined; ++i) {
+            redefined = (recs[i].id == rec->id);
+        }
+
+        if (!redefined && mgr_template_raw_eq(snap, type, it->ptr.trec, it->size)) {
+            // The same template as in the snapshot -> just refresh it
+            rec_cnt++;
+            continue;
+        }
+
+        uint16_t len = it->size;
+        if ((ret_code = fds_template_parse(type, it->ptr.trec, &len, &rec->tmplt)) != FDS_OK) {
+            break;
+        }
+
+        rec_cnt++;
+        if (tmgr->cfg.withdraw_mod == WITHDRAW_REQUIRED
+                && !mgr_set_rec_allowed(snap, recs, rec_cnt - 1, rec->tmplt)) {
+            // The template tries to replace a different template without a withdrawal
+            ret_code = FDS_ERR_DENIED;
+            break;
+        }
+    }
+
+    if (ret_code != FDS_EOC) {
+        mgr_set_recs_destroy(recs, rec_cnt);
+        free(recs);
+        return ret_code;
+    }
+
+    // If all templates are just refreshed, the snapshot hierarchy might not be modified
+    bool touch = true;
+    for (size_t i = 0; i < rec_cnt && touch; ++i) {
+        touch = (recs[i].tmplt == NULL && mgr_template_touchable(tmgr, recs[i].id));
+    }
+
+    if (touch) {
+        ret_code = FDS_OK;
+        for (size_t i = 0; i < rec_cnt && ret_code == FDS_OK; ++i) {
+            ret_code = mgr_template_touch(tmgr, recs[i].id);
+        }
+
+        free(recs);
+        return ret_code;
+    }
+
+    // Add all templates to the snapshot
+    if ((ret_code = mgr_modify_prepare(tmgr)) != FDS_OK) {
+        mgr_set_recs_destroy(recs, rec_cnt);
+        free(recs);
+        return ret_code;
+    }
+
+    snap = tmgr->list.current;
+    size_t idx;
+    for (idx = 0; idx < rec_cnt; ++idx) {
+        struct mgr_set_rec *rec = &recs[idx];
+        ret_code = (rec->tmplt != NULL)
+            ? mgr_snap_template_add(snap, rec->tmplt)
+            : mgr_snap_template_refresh(snap, rec->id);
+        if (ret_code != FDS_OK) {
+            break;
+        }
+
+        rec->tmplt = NULL; // The template is owned by the manager now
+    }
+
+    mgr_set_recs_destroy(&recs[idx], rec_cnt - idx);
+    free(recs);
+    return ret_code;
+}
+
 
 int
 fds_tmgr_template_withdraw(fds_tmgr_t *tmgr, uint16_t id, enum fds_template_type type)
@@ -1666,10 +2488,9 @@ struct mgr_template_withdrawal_all {
  * \return On success returns true. Otherwise returns false and sets an error code appropriately.
  */
 static bool
-mgr_template_withdraw_all_cb(struct snapshot_rec *rec, void *data)
+mgr_template_withdraw_all_cb(const struct snapshot_rec *rec, void *data)
 {
     struct mgr_template_withdrawal_all *info = data;
-    assert(snapshot_rec_find(info->snap, rec->id) == rec);
 
     if (info->type != FDS_TYPE_TEMPLATE_UNDEF && info->type != rec->ptr->type) {
         // Skip this template (we are removing a different type of templates)
@@ -1726,7 +2547,7 @@ fds_tmgr_template_remove(fds_tmgr_t *tmgr, uint16_t id, enum fds_template_type t
         // Check history consistency
         assert(!ptr->link.newer || TIME_LE(ptr->start_time, ptr->link.newer->start_time));
 
-        struct snapshot_rec *rec = snapshot_rec_find(ptr, id);
+        const struct snapshot_rec *rec = snapshot_rec_cfind(ptr, id);
         if (!rec) {
             // Not found -> skip
             continue;
@@ -1797,6 +2618,7 @@ fds_tmgr_snapshot_get(const fds_tmgr_t *tmgr, const fds_tsnapshot_t **snap)
         }
     }
 
+    current->shared = true;
     *snap = current;
     return FDS_OK;
 }
@@ -1809,39 +2631,10 @@ fds_tsnapshot_template_get(const fds_tsnapshot_t *snap, uint16_t id)
     return (rec != NULL) ? rec->ptr : NULL;
 }
 
-/// Auxiliary internal data structure for public snapshot iterator
-struct tsnapshot_cb_data {
-    /// User defined callback
-    fds_tsnapshot_for_cb cb;
-    /// User data for the user callback
-    void *data;
-};
-
-/**
- * @brief Auxiliary callback wrapper for public snapshot iterator
- *
- * The wrapper makes sure that the user defined callback gets only access to the
- * IPFIX (Options) Template. Other internal structures of the snapshot are hidden
- * for users.
- * @param[in] rec  Snapshot record to process
- * @param[in] data Internal data structure of the public snapshot iterator
- * @return Return value of the user defined callback after its execution
- */
-static bool
-tsnapshot_cb_aux(struct snapshot_rec *rec, void *data)
-{
-    struct tsnapshot_cb_data *for_data = (struct tsnapshot_cb_data *) data;
-    return for_data->cb(rec->ptr, for_data->data);
-}
-
 void
 fds_tsnapshot_for(const fds_tsnapshot_t *snap, fds_tsnapshot_for_cb cb, void *data)
 {
-    // Ugly, but the callback cannot modify the snapshot, so it should be OK
-    fds_tsnapshot_t *snap_orig = (fds_tsnapshot_t *) snap;
-
-    struct tsnapshot_cb_data for_data = {cb, data};
-    snapshot_rec_for(snap_orig, &tsnapshot_cb_aux, &for_data);
+    snapshot_tmplt_for(snap, cb, data);
 }
 
 /// Auxiliary internal data structure for template snapshot comparison
@@ -1988,6 +2781,12 @@ fds_tmgr_set_snapshot_timeout(fds_tmgr_t *tmgr, uint16_t timeout)
     tmgr->limits.lifetime_snapshot = timeout;
 }
 
+void
+fds_tmgr_set_snapshot_limit(fds_tmgr_t *tmgr, uint16_t limit)
+{
+    tmgr->limits.snapshot_cnt = limit;
+}
+
 /** \brief Auxiliary data structure for fds_tmgr_set_iemgr_cb() */
 struct fds_tmgr_set_iemgr_data {
     /** Snapshot that is modified      */
@@ -2009,19 +2808,23 @@ struct fds_tmgr_set_iemgr_data {
  * will be removed. Therefore, if this callback function is called on all snapshot records in
  * a snapshot and an error has occurred during processing, in the snapshot will remain only
  * successfully copied templates.
+ * \warning All snapshots in the hierarchy MUST NOT share L2 tables with other snapshots
+ *   (see snapshot_unshare()), so the modifications cannot fail.
  * \param[in] rec  Snapshot record
  * \param[in] data Auxiliary data structure
  * \return Always true
  */
 static bool
-fds_tmgr_set_iemgr_cb(struct snapshot_rec *rec, void *data)
+fds_tmgr_set_iemgr_cb(const struct snapshot_rec *rec, void *data)
 {
     struct fds_tmgr_set_iemgr_data *info = data;
-    assert(snapshot_rec_find(info->snap, rec->id) == rec);
+    int ret_code;
 
     // Something went wrong -> we have to remove all remaining references
     if (info->ret_code != FDS_OK) {
-        snapshot_rec_remove(info->snap, rec->id);
+        ret_code = snapshot_rec_remove(info->snap, rec->id);
+        assert(ret_code == FDS_OK);
+        (void) ret_code;
         return true;
     }
 
@@ -2047,17 +2850,20 @@ fds_tmgr_set_iemgr_cb(struct snapshot_rec *rec, void *data)
         return true;
     }
 
-    rec->ptr = ptr_new;
+    struct snapshot_rec *snap_rec;
+    ret_code = snapshot_rec_edit(info->snap, rec->id, &snap_rec);
+    assert(ret_code == FDS_OK);
+    snap_rec->ptr = ptr_new;
 
     // Now propagate the pointer to predecessors
     struct fds_tsnapshot *snap_ptr = info->snap->link.older;
-    struct snapshot_rec *snap_rec;
 
     while (snap_ptr) {
-        snap_rec = snapshot_rec_find(snap_ptr, rec->id);
+        struct fds_tsnapshot *snap_now = snap_ptr;
         snap_ptr = snap_ptr->link.older; // For the next iteration
 
-        if (!snap_rec || snap_rec->ptr != ptr_old) {
+        if (snapshot_rec_edit(snap_now, rec->id, &snap_rec) != FDS_OK
+                || snap_rec->ptr != ptr_old) {
             continue;
         }
 
@@ -2072,8 +2878,17 @@ fds_tmgr_set_iemgr_cb(struct snapshot_rec *rec, void *data)
     return true;
 }
 
-int
-fds_tmgr_set_iemgr(fds_tmgr_t *tmgr, const fds_iemgr_t *iemgr)
+/**
+ * \brief Redefine all templates of the manager using a new IE manager
+ *
+ * \note The current snapshot is unknown after the call.
+ * \param[in] tmgr      Template manager
+ * \param[in] iemgr     IE manager (can be NULL)
+ * \param[in] keep_time Preserve the time context (i.e. the current and the newest Export Time)
+ * \return #FDS_OK on success, otherwise #FDS_ERR_NOMEM and the manager is not changed.
+ */
+static int
+mgr_set_iemgr(fds_tmgr_t *tmgr, const fds_iemgr_t *iemgr, bool keep_time)
 {
     // To make it faster, first clean up hierarchy
     mgr_cleanup(tmgr);
@@ -2092,7 +2907,13 @@ fds_tmgr_set_iemgr(fds_tmgr_t *tmgr, const fds_iemgr_t *iemgr)
 
     tmp_old = tmgr->list.newest;
     while (tmp_old) {
+        // Copy also all L2 tables, so following modifications cannot fail
         tmp_new = snapshot_copy(tmp_old);
+        if (tmp_new && snapshot_unshare(tmp_new) != FDS_OK) {
+            snapshot_destroy(tmp_new);
+            tmp_new = NULL;
+        }
+
         if (!tmp_new) {
             failed = true;
             break;
@@ -2167,11 +2988,59 @@ fds_tmgr_set_iemgr(fds_tmgr_t *tmgr, const fds_iemgr_t *iemgr)
     }
 
     // Ufff, everything is ready -> replace whole hierarchy
+    const uint32_t time_now = tmgr->time_now;
+    const uint32_t time_newest = tmgr->time_newest;
+    const bool trimmed = tmgr->list.trimmed;
+
     fds_tmgr_clear(tmgr);
     tmgr->list.oldest = new_tail;
     tmgr->list.newest = new_head;
     tmgr->ies_db = iemgr;
 
+    if (keep_time) {
+        tmgr->list.trimmed = trimmed;
+        tmgr->time_now = time_now;
+        tmgr->time_newest = time_newest;
+    }
+
+    return FDS_OK;
+}
+
+int
+fds_tmgr_set_iemgr(fds_tmgr_t *tmgr, const fds_iemgr_t *iemgr)
+{
+    return mgr_set_iemgr(tmgr, iemgr, false);
+}
+
+void
+tmgr_iemgr_request(fds_tmgr_t *tmgr, const fds_iemgr_t *iemgr, uint64_t gen)
+{
+    tmgr->ies_req.iemgr = iemgr;
+    tmgr->ies_req.gen = gen;
+}
+
+uint64_t
+tmgr_iemgr_gen(const fds_tmgr_t *tmgr)
+{
+    return atomic_load_explicit(&tmgr->ies_req.gen_done, memory_order_acquire);
+}
+
+int
+tmgr_iemgr_apply(fds_tmgr_t *tmgr)
+{
+    const uint64_t gen = tmgr->ies_req.gen;
+    if (gen == atomic_load_explicit(&tmgr->ies_req.gen_done, memory_order_relaxed)) {
+        // Nothing to do
+        return FDS_OK;
+    }
+
+    int ret_code = mgr_set_iemgr(tmgr, tmgr->ies_req.iemgr, true);
+    if (ret_code != FDS_OK) {
+        // The request remains pending
+        return ret_code;
+    }
+
+    atomic_store_explicit(&tmgr->ies_req.gen_done, gen, memory_order_release);
     return FDS_OK;
 }
 
@@ -2184,7 +3053,7 @@ fds_tmgr_template_set_fkey(fds_tmgr_t *tmgr, uint16_t id, uint64_t key)
         return FDS_ERR_ARG;
     }
 
-    struct snapshot_rec *snap_rec = snapshot_rec_find(snap, id);
+    const struct snapshot_rec *snap_rec = snapshot_rec_cfind(snap, id);
     if (!snap_rec) {
         return FDS_ERR_NOTFOUND;
     }
@@ -2217,10 +3086,10 @@ fds_tmgr_template_set_fkey(fds_tmgr_t *tmgr, uint16_t id, uint64_t key)
 
     const struct fds_template *tmplt_orig = NULL;
     struct fds_template *tmplt_new = NULL;
-    struct snapshot_rec *rec_last_modif = NULL;
+    struct fds_tsnapshot *snap_last_modif = NULL;
 
     for (struct fds_tsnapshot *it = snap; it != NULL; it = it->link.newer) {
-        struct snapshot_rec *rec = snapshot_rec_find(it, id);
+        const struct snapshot_rec *rec = snapshot_rec_cfind(it, id);
         if (!rec) {
             /* Snapshot doesn't have a reference to the template, but there can be still anyone
              * else in the future due to history modification that caused this "gap".
@@ -2252,7 +3121,7 @@ fds_tmgr_template_set_fkey(fds_tmgr_t *tmgr, uint16_t id, uint64_t key)
             }
 
             // We have to find the new snapshot record
-            rec = snapshot_rec_find(it, id);
+            rec = snapshot_rec_cfind(it, id);
             assert(rec != NULL);
         }
 
@@ -2289,12 +3158,18 @@ fds_tmgr_template_set_fkey(fds_tmgr_t *tmgr, uint16_t id, uint64_t key)
                 return ret_code;
             }
 
-            // We have to find the record again because remove/add operation can change address
-            rec_last_modif = snapshot_rec_find(it, id);
+            snap_last_modif = it;
             tmplt_orig = old_ptr;
         } else {
             // Just replace the old one with the new one
-            assert(snapshot_rec_find(it, id)->ptr == tmplt_orig);
+            assert(snapshot_rec_cfind(it, id)->ptr == tmplt_orig);
+
+            // The previous record will lose the destroy flag (prepare it before any changes)
+            struct snapshot_rec *rec_last_modif;
+            if ((ret_code = snapshot_rec_edit(snap_last_modif, id, &rec_last_modif)) != FDS_OK) {
+                return ret_code;
+            }
+
             if ((ret_code = mgr_snap_template_remove(it, id)) != FDS_OK) {
                 return ret_code;
             }
@@ -2307,9 +3182,7 @@ fds_tmgr_template_set_fkey(fds_tmgr_t *tmgr, uint16_t id, uint64_t key)
             // Remove the destroy flag from the previous record
             assert(rec_last_modif->flags & SNAPSHOT_TF_DESTROY);
             rec_last_modif->flags &= ~SNAPSHOT_TF_DESTROY;
-
-            // We have to find the record again because remove/add operation can change address
-            rec_last_modif = snapshot_rec_find(it, id);
+            snap_last_modif = it;
         }
     }
 
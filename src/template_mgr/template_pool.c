@@ -0,0 +1,398 @@
+/**
+ * \file src/template_mgr/template_pool.c
+ * \author agent <agent@local>
+ * \brief Pool of shared templates (source file)
+ * \date October 2026
+ *
+ * Copyright(c) 2026 CESNET z.s.p.o.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <arpa/inet.h>
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "template_pool.h"
+
+/** Minimal size of the hash table of templates (must be a power of two) */
+#define TPOOL_TABLE_MIN 16U
+
+/** Template in the pool (an item of the hash table) */
+struct tpool_item {
+    /** Hash of the raw template and the IE manager           */
+    uint64_t hash;
+    /** Parsed template with shared arrays (NULL = empty slot) */
+    struct fds_template *proto;
+};
+
+struct fds_tpool {
+    /** Lock of the pool                                      */
+    pthread_mutex_t lock;
+    /** Hash table of templates (open addressing with linear probing) */
+    struct tpool_item *table;
+    /** Size of the hash table (always a power of two)        */
+    size_t table_size;
+    /** Number of templates in the hash table                 */
+    size_t table_cnt;
+};
+
+void
+template_shared_release(struct fds_template_shared *shared)
+{
+    if (!shared || atomic_fetch_sub_explicit(&shared->refcnt, 1, memory_order_acq_rel) != 1) {
+        return;
+    }
+
+    free(shared->raw);
+    free(shared->table);
+    free(shared->dyn_runs);
+    free(shared->views);
+    free(shared);
+}
+
+int
+template_shared_create(struct fds_template *tmplt, const fds_iemgr_t *iemgr)
+{
+    assert(tmplt->index.shared == NULL);
+    struct fds_template_shared *shared = malloc(sizeof(*shared));
+    if (!shared) {
+        return FDS_ERR_NOMEM;
+    }
+
+    atomic_init(&shared->refcnt, 1U);
+    shared->iemgr = iemgr;
+    shared->uid = tmplt->index.uid;
+    shared->raw = tmplt->raw.data;
+    shared->table = tmplt->index.table;
+    shared->dyn_runs = tmplt->index.dyn_runs;
+    shared->views = tmplt->index.views;
+    tmplt->index.shared = shared;
+    return FDS_OK;
+}
+
+fds_tpool_t *
+fds_tpool_create()
+{
+    fds_tpool_t *pool = calloc(1, sizeof(*pool));
+    if (!pool) {
+        return NULL;
+    }
+
+    pool->table = calloc(TPOOL_TABLE_MIN, sizeof(*pool->table));
+    if (!pool->table || pthread_mutex_init(&pool->lock, NULL) != 0) {
+        free(pool->table);
+        free(pool);
+        return NULL;
+    }
+
+    pool->table_size = TPOOL_TABLE_MIN;
+    return pool;
+}
+
+void
+fds_tpool_destroy(fds_tpool_t *pool)
+{
+    if (!pool) {
+        return;
+    }
+
+    // Templates created by the pool hold their own references to shared arrays
+    for (size_t i = 0; i < pool->table_size; ++i) {
+        if (pool->table[i].proto != NULL) {
+            fds_template_destroy(pool->table[i].proto);
+        }
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->table);
+    free(pool);
+}
+
+/**
+ * \brief Get the length of a raw template without parsing
+ * \param[in]  type    Type of template
+ * \param[in]  ptr     Pointer to the header of the template
+ * \param[in]  max_len Maximal length of the raw template
+ * \param[out] len     Real length of the raw template
+ * \return #FDS_OK on success. Otherwise (Template Withdrawal or a malformed template)
+ *   #FDS_ERR_FORMAT.
+ */
+static int
+tpool_raw_length(enum fds_template_type type, const uint8_t *ptr, uint16_t max_len,
+    uint16_t *len)
+{
+    uint16_t value;
+    if (max_len < 4U) {
+        return FDS_ERR_FORMAT;
+    }
+
+    memcpy(&value, ptr + 2U, sizeof(value));
+    const uint16_t fields_cnt = ntohs(value);
+    if (fields_cnt == 0) {
+        return FDS_ERR_FORMAT;
+    }
+
+    uint32_t pos = (type == FDS_TYPE_TEMPLATE_OPTS) ? 6U : 4U;
+    for (uint16_t i = 0; i < fields_cnt; ++i) {
+        if (pos + 4U > max_len) {
+            return FDS_ERR_FORMAT;
+        }
+
+        memcpy(&value, ptr + pos, sizeof(value));
+        pos += (ntohs(value) & 0x8000U) ? 8U : 4U;
+    }
+
+    if (pos > max_len) {
+        return FDS_ERR_FORMAT;
+    }
+
+    *len = (uint16_t) pos;
+    return FDS_OK;
+}
+
+/**
+ * \brief Calculate a hash of a raw template and its IE manager (FNV-1a)
+ * \param[in] type  Type of template
+ * \param[in] iemgr IE manager
+ * \param[in] ptr   Raw template
+ * \param[in] len   Length of the raw template
+ * \return Hash value (must be masked by the size of the hash table)
+ */
+static uint64_t
+tpool_hash(enum fds_template_type type, const fds_iemgr_t *iemgr, const uint8_t *ptr,
+    uint16_t len)
+{
+    uint64_t hash = 0xCBF29CE484222325ULL ^ (uint64_t) type ^ (uint64_t) (uintptr_t) iemgr;
+    for (uint16_t i = 0; i < len; ++i) {
+        hash ^= ptr[i];
+        hash *= 0x100000001B3ULL;
+    }
+
+    return hash ^ (hash >> 32);
+}
+
+/**
+ * \brief Find a template in the pool
+ * \param[in] pool  Pool
+ * \param[in] hash  Hash of the template (see tpool_hash())
+ * \param[in] type  Type of template
+ * \param[in] iemgr IE manager
+ * \param[in] ptr   Raw template
+ * \param[in] len   Length of the raw template
+ * \return Pointer to the template or NULL
+ */
+static const struct fds_template *
+tpool_find(const fds_tpool_t *pool, uint64_t hash, enum fds_template_type type,
+    const fds_iemgr_t *iemgr, const uint8_t *ptr, uint16_t len)
+{
+    const size_t mask = pool->table_size - 1U;
+    size_t pos = hash & mask;
+
+    for (; pool->table[pos].proto != NULL; pos = (pos + 1U) & mask) {
+        const struct fds_template *proto = pool->table[pos].proto;
+        if (pool->table[pos].hash != hash || proto->type != type || proto->raw.length != len
+                || proto->index.shared->iemgr != iemgr || memcmp(proto->raw.data, ptr, len) != 0) {
+            continue;
+        }
+
+        return proto;
+    }
+
+    return NULL;
+}
+
+/**
+ * \brief Insert a template into the hash table (the template must not be present)
+ * \param[in] table      Hash table
+ * \param[in] table_size Size of the hash table
+ * \param[in] item       Item to insert
+ */
+static void
+tpool_table_insert(struct tpool_item *table, size_t table_size, const struct tpool_item *item)
+{
+    const size_t mask = table_size - 1U;
+    size_t pos = item->hash & mask;
+    while (table[pos].proto != NULL) {
+        pos = (pos + 1U) & mask;
+    }
+
+    table[pos] = *item;
+}
+
+/**
+ * \brief Remove unused templates from the hash table and adjust its size
+ *
+ * Templates which are not referenced by any template created by the pool are destroyed.
+ * \param[in] pool     Pool
+ * \param[in] reserve  Number of templates that will be inserted
+ * \return #FDS_OK or #FDS_ERR_NOMEM (the table is unchanged)
+ */
+static int
+tpool_table_rebuild(fds_tpool_t *pool, size_t reserve)
+{
+    size_t live_cnt = 0;
+    for (size_t i = 0; i < pool->table_size; ++i) {
+        const struct fds_template *proto = pool->table[i].proto;
+        if (proto != NULL && atomic_load(&proto->index.shared->refcnt) > 1U) {
+            live_cnt++;
+        }
+    }
+
+    // Keep the table at most half full (including new templates)
+    size_t new_size = TPOOL_TABLE_MIN;
+    while (new_size < 4U * (live_cnt + reserve)) {
+        new_size <<= 1;
+    }
+
+    struct tpool_item *new_table = calloc(new_size, sizeof(*new_table));
+    if (!new_table) {
+        return FDS_ERR_NOMEM;
+    }
+
+    for (size_t i = 0; i < pool->table_size; ++i) {
+        struct tpool_item *item = &pool->table[i];
+        if (item->proto == NULL) {
+            continue;
+        }
+
+        if (atomic_load(&item->proto->index.shared->refcnt) == 1U) {
+            fds_template_destroy(item->proto);
+            continue;
+        }
+
+        tpool_table_insert(new_table, new_size, item);
+    }
+
+    free(pool->table);
+    pool->table = new_table;
+    pool->table_size = new_size;
+    pool->table_cnt = live_cnt;
+    return FDS_OK;
+}
+
+void
+fds_tpool_purge(fds_tpool_t *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    tpool_table_rebuild(pool, 0);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * \brief Parse a template and define its fields
+ * \param[in]     type  Type of template
+ * \param[in]     ptr   Pointer to the header of the template
+ * \param[in,out] len   Maximal length / real length of the template
+ * \param[in]     iemgr IE manager
+ * \param[out]    tmplt Parsed template
+ * \return Same as fds_template_parse()
+ */
+static int
+tpool_parse(enum fds_template_type type, const void *ptr, uint16_t *len,
+    const fds_iemgr_t *iemgr, struct fds_template **tmplt)
+{
+    uint16_t len_real = *len;
+    struct fds_template *result;
+    int ret_code = fds_template_parse(type, ptr, &len_real, &result);
+    if (ret_code != FDS_OK) {
+        return ret_code;
+    }
+
+    if (iemgr != NULL && (ret_code = fds_template_ies_define(result, iemgr, false)) != FDS_OK) {
+        fds_template_destroy(result);
+        return ret_code;
+    }
+
+    *len = len_real;
+    *tmplt = result;
+    return FDS_OK;
+}
+
+int
+fds_tpool_template(fds_tpool_t *pool, enum fds_template_type type, const void *ptr,
+    uint16_t *len, const fds_iemgr_t *iemgr, struct fds_template **tmplt)
+{
+    uint16_t raw_len;
+    if (tpool_raw_length(type, ptr, *len, &raw_len) != FDS_OK) {
+        // Template Withdrawal or a malformed template (the parser will report the error)
+        return tpool_parse(type, ptr, len, iemgr, tmplt);
+    }
+
+    const uint64_t hash = tpool_hash(type, iemgr, ptr, raw_len);
+    const struct fds_template *proto;
+    struct fds_template *result = NULL;
+
+    pthread_mutex_lock(&pool->lock);
+    proto = tpool_find(pool, hash, type, iemgr, ptr, raw_len);
+    if (proto != NULL) {
+        // The copy shares immutable arrays with the template in the pool
+        result = fds_template_copy(proto);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    if (proto != NULL) {
+        if (!result) {
+            return FDS_ERR_NOMEM;
+        }
+
+        *len = raw_len;
+        *tmplt = result;
+        return FDS_OK;
+    }
+
+    // Parse the template without holding the lock
+    struct fds_template *new_proto;
+    uint16_t new_len = *len;
+    int ret_code = tpool_parse(type, ptr, &new_len, iemgr, &new_proto);
+    if (ret_code != FDS_OK) {
+        return ret_code;
+    }
+
+    assert(new_len == raw_len);
+    if ((ret_code = template_shared_create(new_proto, iemgr)) != FDS_OK) {
+        fds_template_destroy(new_proto);
+        return ret_code;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    proto = tpool_find(pool, hash, type, iemgr, ptr, raw_len);
+    if (proto == NULL) {
+        // Insert the new template (another thread could have inserted it in the meantime)
+        if (2U * (pool->table_cnt + 1U) > pool->table_size
+                && tpool_table_rebuild(pool, 1U) != FDS_OK) {
+            ret_code = FDS_ERR_NOMEM;
+        } else {
+            struct tpool_item item = {hash, new_proto};
+            tpool_table_insert(pool->table, pool->table_size, &item);
+            pool->table_cnt++;
+            proto = new_proto;
+            new_proto = NULL;
+        }
+    }
+
+    if (proto != NULL) {
+        result = fds_template_copy(proto);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    if (new_proto != NULL) {
+        // The template is not part of the pool
+        if (ret_code != FDS_OK) {
+            // ... but it can be still used by the user
+            *len = new_len;
+            *tmplt = new_proto;
+            return FDS_OK;
+        }
+
+        fds_template_destroy(new_proto);
+    }
+
+    if (!result) {
+        return FDS_ERR_NOMEM;
+    }
+
+    *len = raw_len;
+    *tmplt = result;
+    return FDS_OK;
+}
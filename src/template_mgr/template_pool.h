@@ -0,0 +1,104 @@
+/**
+ * \file src/template_mgr/template_pool.h
+ * \author agent <agent@local>
+ * \brief Pool of shared templates (internal header file)
+ * \date October 2026
+ *
+ * Copyright(c) 2026 CESNET z.s.p.o.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef TEMPLATE_POOL_H
+#define TEMPLATE_POOL_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <libfds.h>
+
+/**
+ * \brief Immutable parts of a template shared by identical templates
+ *
+ * The block owns all arrays it refers to. A template uses the arrays only if its pointers
+ * are equal to the pointers in the block (see template_shared_has()).
+ */
+struct fds_template_shared {
+    /** Number of templates that refer to the block */
+    atomic_uint refcnt;
+    /** IE manager used to define fields of the templates               */
+    const fds_iemgr_t *iemgr;
+    /** Identifier of the template layout with the definitions (see fds_template_index#uid) */
+    uint64_t uid;
+
+    /** Raw copy of the template                  */
+    uint8_t *raw;
+    /** Field lookup index                        */
+    uint16_t *table;
+    /** Lengths of fixed-length runs (or NULL)    */
+    uint16_t *dyn_runs;
+    /** Forward and reverse views (or NULL)       */
+    uint16_t *views;
+};
+
+/**
+ * \brief Check if an array of a template is shared
+ * \param[in] tmplt Template
+ * \param[in] ptr   Array of the template
+ * \return True if the array belongs to the shared block of the template
+ */
+static inline bool
+template_shared_has(const struct fds_template *tmplt, const void *ptr)
+{
+    const struct fds_template_shared *shared = tmplt->index.shared;
+    if (!shared || !ptr) {
+        return false;
+    }
+
+    return ptr == shared->raw || ptr == shared->table || ptr == shared->dyn_runs
+        || ptr == shared->views;
+}
+
+/**
+ * \brief Check if fields of a template have been defined by the pool using a given IE manager
+ *
+ * If true, definition of the fields (i.e. fds_template_ies_define()) can be skipped.
+ * \param[in] tmplt Template
+ * \param[in] iemgr IE manager (can be NULL)
+ * \return True or false
+ */
+static inline bool
+template_shared_defined(const struct fds_template *tmplt, const fds_iemgr_t *iemgr)
+{
+    const struct fds_template_shared *shared = tmplt->index.shared;
+    return shared != NULL && shared->iemgr == iemgr && shared->uid == tmplt->index.uid;
+}
+
+/**
+ * \brief Add a reference to a shared block
+ * \param[in] shared Shared block
+ */
+static inline void
+template_shared_acquire(struct fds_template_shared *shared)
+{
+    atomic_fetch_add_explicit(&shared->refcnt, 1, memory_order_relaxed);
+}
+
+/**
+ * \brief Move immutable arrays of a template into a new shared block
+ *
+ * Copies of the template (see fds_template_copy()) will share the arrays instead of copying them.
+ * \warning The template MUST NOT have a shared block yet.
+ * \param[in] tmplt Template
+ * \param[in] iemgr IE manager used to define fields of the template (can be NULL)
+ * \return #FDS_OK or #FDS_ERR_NOMEM (the template is not modified)
+ */
+int
+template_shared_create(struct fds_template *tmplt, const fds_iemgr_t *iemgr);
+
+/**
+ * \brief Remove a reference to a shared block (the block is destroyed by the last reference)
+ * \param[in] shared Shared block (can be NULL)
+ */
+void
+template_shared_release(struct fds_template_shared *shared);
+
+#endif // TEMPLATE_POOL_H
@@ -0,0 +1,72 @@
+/**
+ * \file src/template_mgr/tmgr_iemgr.h
+ * \author agent <agent@local>
+ * \brief Deferred redefinition of templates of a template manager (internal header file)
+ * \date October 2026
+ *
+ * Copyright(c) 2026 CESNET z.s.p.o.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef TMGR_IEMGR_H
+#define TMGR_IEMGR_H
+
+#include <stdint.h>
+#include <libfds.h>
+
+/**
+ * \defgroup tmgr_iemgr_func Deferred redefinition of templates
+ * \ingroup template_manager
+ *
+ * \brief Change of an IE manager postponed to the first use of a template manager
+ *
+ * A registry of template managers (see fds_tmgr_registry_set_iemgr()) cannot redefine templates
+ * of managers that are used by other threads. Instead, it requests the redefinition from
+ * the thread that looks the manager up and the templates are redefined by the next call of
+ * fds_tmgr_set_time(), i.e. before the manager is used in the context of the next message.
+ * Unlike fds_tmgr_set_iemgr(), the time context of the manager is preserved.
+ *
+ * Each request is identified by a generation number. The generation of the applied request can
+ * be read by any thread, so it is possible to find out whether the previous IE manager is still
+ * used by the manager.
+ * @{
+ */
+
+/**
+ * \brief Request redefinition of templates using an IE manager
+ *
+ * The previous request (if any) is replaced.
+ * \warning The manager MUST NOT be used by any other thread during the call.
+ * \param[in] tmgr  Template manager
+ * \param[in] iemgr IE manager (can be NULL)
+ * \param[in] gen   Generation of the request (must be non-zero and different for every request)
+ */
+void
+tmgr_iemgr_request(fds_tmgr_t *tmgr, const fds_iemgr_t *iemgr, uint64_t gen);
+
+/**
+ * \brief Get the generation of the last applied request
+ * \note The function can be called by any thread.
+ * \param[in] tmgr Template manager
+ * \return Generation (0 = no request has been applied yet)
+ */
+uint64_t
+tmgr_iemgr_gen(const fds_tmgr_t *tmgr);
+
+/**
+ * \brief Apply the pending request (if any)
+ *
+ * All templates and snapshots are replaced with redefined copies and the old ones are moved to
+ * the garbage of the manager (see fds_tmgr_garbage_get()). The time context is preserved,
+ * however, the current snapshot must be selected again by fds_tmgr_set_time().
+ * \warning The manager MUST NOT be used by any other thread during the call.
+ * \param[in] tmgr Template manager
+ * \return #FDS_OK on success or if there is no pending request. Otherwise returns
+ *   #FDS_ERR_NOMEM, the manager is not changed and the request remains pending.
+ */
+int
+tmgr_iemgr_apply(fds_tmgr_t *tmgr);
+
+/**@}*/
+
+#endif // TMGR_IEMGR_H
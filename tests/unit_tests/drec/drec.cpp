@@ -245,6 +245,33 @@ TEST_F(drecFind, varAfterVar)
     // Cannot check empty string!
 }
 
+// Result of the find function must match the first occurrence of each field in the record
+TEST_F(drecFind, matchIterator)
+{
+    struct fds_drec_iter iter;
+    fds_drec_iter_init(&iter, &rec, FDS_DREC_PADDING_SHOW);
+
+    int idx;
+    while ((idx = fds_drec_iter_next(&iter)) != FDS_EOC) {
+        const struct fds_tfield *info = iter.field.info;
+        SCOPED_TRACE("Field index: " + std::to_string(idx));
+
+        struct fds_drec_field field;
+        int find_idx = fds_drec_find(&rec, info->en, info->id, &field);
+        ASSERT_GE(find_idx, 0);
+        if ((info->flags & FDS_TFIELD_MULTI_IE) != 0 && find_idx != idx) {
+            // Not the first occurrence
+            EXPECT_LT(find_idx, idx);
+            continue;
+        }
+
+        EXPECT_EQ(find_idx, idx);
+        EXPECT_EQ(field.data, iter.field.data);
+        EXPECT_EQ(field.size, iter.field.size);
+        EXPECT_EQ(field.info, iter.field.info);
+    }
+}
+
 // ITERATOR -------------------------------------------------------------------------------------
 // Iterate over whole record
 TEST_F(drecIter, overWholeRec) // Automatically skip padding
@@ -1177,3 +1204,704 @@ TEST_F(drecIter, findMultipleOccurrences)
         EXPECT_EQ(fds_drec_iter_next(&iter), FDS_EOC);
     }
 }
+
+// PER-RECORD OFFSETS ------------------------------------------------------------------------------
+// Lookups using the table of offsets must match lookups without the table
+TEST_F(drecFind, offsetsFind)
+{
+    struct fds_drec_offsets offs;
+    ASSERT_EQ(fds_drec_index(&rec, &offs), FDS_OK);
+    EXPECT_EQ(offs.cnt, rec.tmplt->fields_cnt_total);
+    EXPECT_EQ(offs.next, rec.size);
+
+    for (uint16_t i = 0; i < rec.tmplt->fields_cnt_total; ++i) {
+        const struct fds_tfield *info = &rec.tmplt->fields[i];
+        SCOPED_TRACE("Field index: " + std::to_string(i));
+
+        struct fds_drec_field field_exp, field_idx;
+        int ret_exp = fds_drec_find(&rec, info->en, info->id, &field_exp);
+        int ret_idx = fds_drec_find_indexed(&rec, &offs, info->en, info->id, &field_idx);
+        ASSERT_GE(ret_exp, 0);
+        EXPECT_EQ(ret_exp, ret_idx);
+        EXPECT_EQ(field_exp.data, field_idx.data);
+        EXPECT_EQ(field_exp.size, field_idx.size);
+        EXPECT_EQ(field_exp.info, field_idx.info);
+    }
+
+    struct fds_drec_field field;
+    EXPECT_EQ(fds_drec_find_indexed(&rec, &offs, 0, 1000, &field), FDS_EOC);
+    EXPECT_EQ(fds_drec_find_indexed(&rec, &offs, 8888, 100, &field), FDS_EOC);
+}
+
+// Iterators with the table of offsets must return the same fields as without the table
+TEST_F(drecIter, offsetsIterator)
+{
+    std::vector<uint16_t> flags{
+        0,
+        FDS_DREC_PADDING_SHOW,
+        FDS_DREC_BIFLOW_FWD | FDS_DREC_UNKNOWN_SKIP,
+        FDS_DREC_BIFLOW_REV,
+        FDS_DREC_BIFLOW_REV | FDS_DREC_REVERSE_SKIP
+    };
+
+    struct fds_drec_offsets offs;
+    ASSERT_EQ(fds_drec_index(&rec, &offs), FDS_OK);
+
+    for (uint16_t iter_flags : flags) {
+        SCOPED_TRACE("Flags: " + std::to_string(iter_flags));
+        struct fds_drec_iter iter_exp, iter_idx;
+        fds_drec_iter_init(&iter_exp, &rec, iter_flags);
+        fds_drec_iter_init(&iter_idx, &rec, iter_flags);
+        ASSERT_EQ(fds_drec_iter_offsets(&iter_idx, &offs), FDS_OK);
+
+        // Iterate over all fields
+        int ret_exp, ret_idx;
+        do {
+            ret_exp = fds_drec_iter_next(&iter_exp);
+            ret_idx = fds_drec_iter_next(&iter_idx);
+            ASSERT_EQ(ret_exp, ret_idx);
+            if (ret_exp == FDS_EOC) {
+                break;
+            }
+
+            EXPECT_EQ(iter_exp.field.data, iter_idx.field.data);
+            EXPECT_EQ(iter_exp.field.size, iter_idx.field.size);
+            EXPECT_EQ(iter_exp.field.info, iter_idx.field.info);
+        } while (true);
+
+        // Find all occurrences of selected fields (the first lookup goes after the end)
+        for (uint16_t id : {82, 1, 96, 7, 210}) {
+            fds_drec_iter_rewind(&iter_exp);
+            fds_drec_iter_rewind(&iter_idx);
+            do {
+                ret_exp = fds_drec_iter_find(&iter_exp, 0, id);
+                ret_idx = fds_drec_iter_find(&iter_idx, 0, id);
+                ASSERT_EQ(ret_exp, ret_idx);
+                if (ret_exp == FDS_EOC) {
+                    break;
+                }
+
+                EXPECT_EQ(iter_exp.field.data, iter_idx.field.data);
+                EXPECT_EQ(iter_exp.field.size, iter_idx.field.size);
+                EXPECT_EQ(iter_exp.field.info, iter_idx.field.info);
+
+                // Mix with iteration over the following field
+                ret_exp = fds_drec_iter_next(&iter_exp);
+                ret_idx = fds_drec_iter_next(&iter_idx);
+                ASSERT_EQ(ret_exp, ret_idx);
+            } while (ret_exp != FDS_EOC);
+        }
+    }
+}
+
+// Iterators use offsets precomputed by the Template without any table of offsets
+TEST_F(drecIter, templateOffsets)
+{
+    ASSERT_NE(rec.tmplt->index.table, nullptr);
+    for (uint16_t id : {82, 1, 96, 7, 210, 152, 94}) {
+        SCOPED_TRACE("ID: " + std::to_string(id));
+        struct fds_drec_field field_exp;
+        int ret_exp = fds_drec_find(&rec, 0, id, &field_exp);
+
+        // The first lookup jumps directly to the field
+        struct fds_drec_iter iter;
+        fds_drec_iter_init(&iter, &rec, FDS_DREC_PADDING_SHOW);
+        ASSERT_EQ(fds_drec_iter_find(&iter, 0, id), ret_exp);
+        if (ret_exp == FDS_EOC) {
+            continue;
+        }
+
+        EXPECT_EQ(iter.field.data, field_exp.data);
+        EXPECT_EQ(iter.field.size, field_exp.size);
+        EXPECT_EQ(iter.field.info, field_exp.info);
+
+        // The iterator continues behind the field (the same as a sequential iterator)
+        struct fds_drec_iter iter_seq;
+        fds_drec_iter_init(&iter_seq, &rec, FDS_DREC_PADDING_SHOW);
+        while (fds_drec_iter_next(&iter_seq) != ret_exp) {}
+        const int ret_next = fds_drec_iter_next(&iter);
+        ASSERT_EQ(ret_next, fds_drec_iter_next(&iter_seq));
+        if (ret_next != FDS_EOC) {
+            EXPECT_EQ(iter.field.data, iter_seq.field.data);
+            EXPECT_EQ(iter.field.size, iter_seq.field.size);
+        }
+    }
+}
+
+// Iterate over precomputed views of Biflow fields (reverse fields are skipped)
+TEST_F(drecIter, biflowViews)
+{
+    const fds_template *tmplt = rec.tmplt;
+    ASSERT_NE(tmplt->index.views, nullptr);
+    EXPECT_EQ(tmplt->index.view_fwd_cnt, 14);
+    EXPECT_EQ(tmplt->index.view_rev_cnt, 14);
+
+    // Expected fields (i.e. the reverse fields are skipped manually)
+    auto next_exp = [](struct fds_drec_iter *iter) {
+        int ret;
+        while ((ret = fds_drec_iter_next(iter)) != FDS_EOC) {
+            if ((iter->field.info->flags & FDS_TFIELD_REVERSE) == 0) {
+                break;
+            }
+        }
+        return ret;
+    };
+
+    struct fds_drec_offsets offs;
+    ASSERT_EQ(fds_drec_index(&rec, &offs), FDS_OK);
+
+    const std::vector<uint16_t> flags{
+        FDS_DREC_REVERSE_SKIP,
+        FDS_DREC_BIFLOW_FWD | FDS_DREC_REVERSE_SKIP,
+        FDS_DREC_BIFLOW_FWD | FDS_DREC_REVERSE_SKIP | FDS_DREC_UNKNOWN_SKIP,
+        FDS_DREC_BIFLOW_REV | FDS_DREC_REVERSE_SKIP,
+        FDS_DREC_BIFLOW_REV | FDS_DREC_REVERSE_SKIP | FDS_DREC_UNKNOWN_SKIP
+    };
+
+    for (uint16_t iter_flags : flags) {
+        for (bool with_offsets : {false, true}) {
+            SCOPED_TRACE("Flags: " + std::to_string(iter_flags) + ", offsets: "
+                + std::to_string(with_offsets));
+            struct fds_drec_iter iter_exp, iter_view;
+            fds_drec_iter_init(&iter_exp, &rec, iter_flags & ~FDS_DREC_REVERSE_SKIP);
+            fds_drec_iter_init(&iter_view, &rec, iter_flags);
+            if (with_offsets) {
+                ASSERT_EQ(fds_drec_iter_offsets(&iter_view, &offs), FDS_OK);
+            }
+
+            int ret_exp, ret_view;
+            size_t cnt = 0;
+            do {
+                ret_exp = next_exp(&iter_exp);
+                ret_view = fds_drec_iter_next(&iter_view);
+                ASSERT_EQ(ret_exp, ret_view);
+                if (ret_exp == FDS_EOC) {
+                    break;
+                }
+
+                cnt++;
+                EXPECT_EQ(iter_exp.field.data, iter_view.field.data);
+                EXPECT_EQ(iter_exp.field.size, iter_view.field.size);
+                EXPECT_EQ(iter_exp.field.info, iter_view.field.info);
+            } while (true);
+            EXPECT_GT(cnt, 10U);
+
+            // Mix search (it doesn't skip reverse fields) with iteration over following fields
+            for (uint16_t id : {82, 1, 96, 7, 152}) {
+                fds_drec_iter_rewind(&iter_exp);
+                fds_drec_iter_rewind(&iter_view);
+                for (uint32_t pen : {0U, 29305U}) {
+                    ret_exp = fds_drec_iter_find(&iter_exp, pen, id);
+                    ret_view = fds_drec_iter_find(&iter_view, pen, id);
+                    ASSERT_EQ(ret_exp, ret_view);
+
+                    ret_exp = next_exp(&iter_exp);
+                    ret_view = fds_drec_iter_next(&iter_view);
+                    ASSERT_EQ(ret_exp, ret_view);
+                    if (ret_exp != FDS_EOC) {
+                        EXPECT_EQ(iter_exp.field.data, iter_view.field.data);
+                        EXPECT_EQ(iter_exp.field.info, iter_view.field.info);
+                    }
+                }
+            }
+        }
+    }
+
+    // Views are preserved by a copy of the template
+    fds_template *tmplt_cpy = fds_template_copy(tmplt);
+    ASSERT_NE(tmplt_cpy, nullptr);
+    ASSERT_NE(tmplt_cpy->index.views, nullptr);
+    ASSERT_NE(tmplt_cpy->index.views, tmplt->index.views);
+    const size_t views_cnt = tmplt->index.view_fwd_cnt + tmplt->index.view_rev_cnt;
+    for (size_t i = 0; i < views_cnt; ++i) {
+        EXPECT_EQ(tmplt_cpy->index.views[i], tmplt->index.views[i]);
+    }
+    fds_template_destroy(tmplt_cpy);
+}
+
+// Malformed records and tables of other records
+TEST_F(drecFind, offsetsInvalid)
+{
+    struct fds_drec_offsets offs;
+    struct fds_drec rec_short = rec;
+
+    // Missing the last byte of the last field
+    rec_short.size = rec.size - 1;
+    EXPECT_EQ(fds_drec_index(&rec_short, &offs), FDS_ERR_FORMAT);
+
+    // Missing the length prefix of the first variable-length field (applicationName)
+    const struct fds_tfield *app_name = fds_template_cfind(rec.tmplt, 0, 96);
+    ASSERT_NE(app_name, nullptr);
+    rec_short.size = app_name->offset;
+    EXPECT_EQ(fds_drec_index(&rec_short, &offs), FDS_ERR_FORMAT);
+
+    // The table belongs to another record (a copy of the record)
+    std::vector<uint8_t> rec_copy(rec.data, rec.data + rec.size);
+    rec_short.size = rec.size;
+    rec_short.data = rec_copy.data();
+    ASSERT_EQ(fds_drec_index(&rec_short, &offs), FDS_OK);
+
+    struct fds_drec_iter iter;
+    fds_drec_iter_init(&iter, &rec, 0);
+    EXPECT_EQ(fds_drec_iter_offsets(&iter, &offs), FDS_ERR_ARG);
+}
+
+// FIELD ACCESSORS ---------------------------------------------------------------------------------
+// Accessors must return the same fields as the iterator search (in all directions)
+TEST_F(drecFind, accessorMatchIterator)
+{
+    const std::vector<std::pair<uint32_t, uint16_t>> ies{
+        {0, 7}, {0, 8}, {0, 11}, {0, 12}, {0, 4}, {0, 152}, {0, 153}, {29305, 152},
+        {29305, 153}, {0, 96}, {0, 94}, {0, 1}, {0, 2}, {10000, 100}, {29305, 1}, {29305, 2},
+        {0, 82}, {0, 210}, {0, 1000}, {8888, 100}
+    };
+    const std::vector<uint16_t> flags{0, FDS_DREC_BIFLOW_FWD, FDS_DREC_BIFLOW_REV};
+
+    struct fds_drec_offsets offs;
+    ASSERT_EQ(fds_drec_index(&rec, &offs), FDS_OK);
+
+    for (uint16_t acc_flags : flags) {
+        for (const auto &ie : ies) {
+            SCOPED_TRACE("Flags: " + std::to_string(acc_flags) + ", PEN: "
+                + std::to_string(ie.first) + ", ID: " + std::to_string(ie.second));
+            struct fds_drec_iter iter;
+            fds_drec_iter_init(&iter, &rec, acc_flags);
+            int ret_exp = fds_drec_iter_find(&iter, ie.first, ie.second);
+
+            struct fds_drec_accessor acc;
+            fds_drec_accessor_init(&acc, ie.first, ie.second, acc_flags);
+
+            // The first lookup resolves the field, the following ones use the cache
+            for (int i = 0; i < 3; ++i) {
+                struct fds_drec_field field;
+                int ret = (i != 2)
+                    ? fds_drec_accessor_get(&acc, &rec, &field)
+                    : fds_drec_accessor_find(&acc, &rec, &offs, &field);
+                ASSERT_EQ(ret, ret_exp);
+                if (ret_exp == FDS_EOC) {
+                    continue;
+                }
+
+                EXPECT_EQ(field.data, iter.field.data);
+                EXPECT_EQ(field.size, iter.field.size);
+                EXPECT_EQ(field.info, iter.field.info);
+            }
+        }
+    }
+}
+
+// Accessors must distinguish different Templates and their copies
+TEST_F(drecFind, accessorTemplates)
+{
+    struct fds_drec_accessor acc_bytes, acc_bytes_rev, acc_name;
+    fds_drec_accessor_init(&acc_bytes, 0, 1, 0);
+    fds_drec_accessor_init(&acc_bytes_rev, 0, 1, FDS_DREC_BIFLOW_REV);
+    fds_drec_accessor_init(&acc_name, 0, 96, 0);
+
+    struct fds_drec_field field;
+    uint64_t value;
+    ASSERT_GE(fds_drec_accessor_get(&acc_bytes, &rec, &field), 0);
+    ASSERT_EQ(fds_get_uint_be(field.data, field.size, &value), FDS_OK);
+    EXPECT_EQ(value, VALUE_BYTES);
+    ASSERT_GE(fds_drec_accessor_get(&acc_bytes_rev, &rec, &field), 0);
+    ASSERT_EQ(fds_get_uint_be(field.data, field.size, &value), FDS_OK);
+    EXPECT_EQ(value, VALUE_BYTES_R);
+
+    // Copy of the Template shares the layout, however, field info must point to the copy
+    struct fds_template *tmplt_cpy = fds_template_copy(rec.tmplt);
+    ASSERT_NE(tmplt_cpy, nullptr);
+    EXPECT_EQ(tmplt_cpy->index.uid, rec.tmplt->index.uid);
+    struct fds_drec rec_cpy = rec;
+    rec_cpy.tmplt = tmplt_cpy;
+    ASSERT_GE(fds_drec_accessor_get(&acc_bytes_rev, &rec_cpy, &field), 0);
+    EXPECT_GE(field.info, tmplt_cpy->fields_rev);
+    EXPECT_LT(field.info, tmplt_cpy->fields_rev + tmplt_cpy->fields_cnt_total);
+    ASSERT_EQ(fds_get_uint_be(field.data, field.size, &value), FDS_OK);
+    EXPECT_EQ(value, VALUE_BYTES_R);
+
+    // Without definitions of IEs the Template is not Biflow -> the reverse accessor is forward
+    ASSERT_EQ(fds_template_ies_define(tmplt_cpy, nullptr, false), FDS_OK);
+    EXPECT_NE(tmplt_cpy->index.uid, rec.tmplt->index.uid);
+    ASSERT_GE(fds_drec_accessor_get(&acc_bytes_rev, &rec_cpy, &field), 0);
+    ASSERT_EQ(fds_get_uint_be(field.data, field.size, &value), FDS_OK);
+    EXPECT_EQ(value, VALUE_BYTES);
+    fds_template_destroy(tmplt_cpy);
+
+    // More Templates than the size of the cache (the record has a different layout each time)
+    std::vector<struct fds_template *> tmplts;
+    std::vector<std::vector<uint8_t>> recs;
+    for (uint16_t i = 0; i < 2 * FDS_DREC_ACCESSOR_CACHE; ++i) {
+        ipfix_trec trec {uint16_t(300 + i)};
+        trec.add_field(210, i + 1);                // -- paddingOctets
+        trec.add_field(  1, 8);                    // octetDeltaCount
+        trec.add_field( 96, ipfix_trec::SIZE_VAR); // applicationName
+
+        uint16_t tmplt_size = trec.size();
+        uint8_t *tmplt_raw = trec.release();
+        struct fds_template *tmplt;
+        ASSERT_EQ(fds_template_parse(FDS_TYPE_TEMPLATE, tmplt_raw, &tmplt_size, &tmplt), FDS_OK);
+        free(tmplt_raw);
+        tmplts.push_back(tmplt);
+
+        ipfix_drec drec {};
+        drec.append_uint(0, i + 1);
+        drec.append_uint(i, 8);
+        drec.append_string(VALUE_APP_NAME);
+        const uint16_t drec_size = drec.size();
+        uint8_t *drec_raw = drec.release();
+        recs.emplace_back(drec_raw, drec_raw + drec_size);
+        free(drec_raw);
+    }
+
+    for (int round = 0; round < 3; ++round) {
+        for (size_t i = 0; i < tmplts.size(); ++i) {
+            struct fds_drec rec_other = {recs[i].data(), uint16_t(recs[i].size()), tmplts[i], nullptr};
+            ASSERT_EQ(fds_drec_accessor_get(&acc_bytes, &rec_other, &field), 1);
+            ASSERT_EQ(fds_get_uint_be(field.data, field.size, &value), FDS_OK);
+            EXPECT_EQ(value, i);
+            ASSERT_EQ(fds_drec_accessor_get(&acc_name, &rec_other, &field), 2);
+            EXPECT_EQ(std::string(reinterpret_cast<char *>(field.data), field.size), VALUE_APP_NAME);
+        }
+    }
+
+    for (auto tmplt : tmplts) {
+        fds_template_destroy(tmplt);
+    }
+}
+
+// BATCH EXTRACTION --------------------------------------------------------------------------------
+// Extract fields of multiple records (based on different Templates) into columns
+TEST_F(drecFind, extractBatch)
+{
+    // Non-Biflow Template with the same fields, but without the variable-length fields
+    ipfix_trec trec {300};
+    trec.add_field(  1, 4);                    // octetDeltaCount (reduced size)
+    trec.add_field(  8, 4);                    // sourceIPv4Address
+    trec.add_field( 27, 16);                   // sourceIPv6Address
+    trec.add_field(152, 8);                    // flowStartMilliseconds
+    trec.add_field( 82, ipfix_trec::SIZE_VAR); // interfaceName
+    trec.add_field(100, 4, 10000);             // -- field with unknown definition --
+    uint16_t tmplt_size = trec.size();
+    uint8_t *tmplt_raw = trec.release();
+    struct fds_template *tmplt;
+    ASSERT_EQ(fds_template_parse(FDS_TYPE_TEMPLATE, tmplt_raw, &tmplt_size, &tmplt), FDS_OK);
+    free(tmplt_raw);
+    ASSERT_EQ(fds_template_ies_define(tmplt, ie_mgr, false), FDS_OK);
+
+    ipfix_drec drec {};
+    drec.append_uint(VALUE_BYTES, 4);
+    drec.append_ip("10.0.0.1");
+    drec.append_ip("fd00::1");
+    drec.append_datetime(VALUE_TS_FST_R, FDS_ET_DATE_TIME_MILLISECONDS);
+    drec.append_string(VALUE_IFC2);
+    drec.append_uint(1U << 31, 4);
+    const uint16_t drec_size = drec.size();
+    std::unique_ptr<uint8_t, decltype(&free)> drec_raw(drec.release(), &free);
+    struct fds_drec rec_other = {drec_raw.get(), drec_size, tmplt, nullptr};
+
+    // Two groups of the same Template and one record of the other Template
+    std::vector<struct fds_drec> recs{rec, rec, rec_other, rec_other, rec};
+    const std::vector<struct fds_extract_field> fields{
+        {0, 1, 0, FDS_EXTRACT_UINT},
+        {0, 1, FDS_DREC_BIFLOW_REV, FDS_EXTRACT_UINT},
+        {0, 8, 0, FDS_EXTRACT_IP},
+        {0, 152, FDS_DREC_BIFLOW_REV, FDS_EXTRACT_TIME_MS},
+        {0, 82, 0, FDS_EXTRACT_PRESENT},
+        {10000, 100, 0, FDS_EXTRACT_INT},
+        {10000, 100, 0, FDS_EXTRACT_DOUBLE},
+        {0, 94, 0, FDS_EXTRACT_UINT}, // invalid size
+        {0, 7, 0, FDS_EXTRACT_UINT}
+    };
+    struct fds_extract_spec spec = {fields.data(), fields.size()};
+
+    const size_t n = recs.size();
+    std::vector<uint64_t> col_bytes(n), col_bytes_rev(n), col_ts_rev(n), col_name(n), col_port(n);
+    std::vector<int64_t> col_unknown_int(n);
+    std::vector<double> col_unknown_dbl(n);
+    std::vector<uint8_t> col_ip(16 * n), col_ifc(n);
+    void *columns[] = {
+        col_bytes.data(), col_bytes_rev.data(), col_ip.data(), col_ts_rev.data(), col_ifc.data(),
+        col_unknown_int.data(), col_unknown_dbl.data(), col_name.data(), col_port.data()
+    };
+    ASSERT_EQ(fds_drec_extract_batch(recs.data(), n, &spec, columns), FDS_OK);
+
+    const uint8_t ip_mapped[16] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF, 10, 0, 0, 1};
+    const uint8_t ip_rec[16] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF, 127, 0, 0, 1};
+    for (size_t i = 0; i < n; ++i) {
+        SCOPED_TRACE("Record: " + std::to_string(i));
+        const bool other = (recs[i].tmplt == tmplt);
+        EXPECT_EQ(col_bytes[i], VALUE_BYTES);
+        EXPECT_EQ(col_bytes_rev[i], other ? VALUE_BYTES : VALUE_BYTES_R);
+        EXPECT_EQ(memcmp(&col_ip[16 * i], other ? ip_mapped : ip_rec, 16), 0);
+        EXPECT_EQ(col_ts_rev[i], VALUE_TS_FST_R);
+        EXPECT_EQ(col_ifc[i], 1);
+        EXPECT_EQ(col_unknown_int[i], other ? INT32_MIN : 1078530041); // 3.1416f as int32
+        EXPECT_EQ(col_name[i], 0U);
+        EXPECT_EQ(col_port[i], other ? 0U : VALUE_SRC_PORT);
+        if (!other) {
+            EXPECT_FLOAT_EQ(col_unknown_dbl[i], VALUE_UNKNOWN);
+        }
+    }
+
+    // Invalid column type
+    const struct fds_extract_field field_invalid = {0, 1, 0, (enum fds_extract_type) 100};
+    spec = {&field_invalid, 1};
+    EXPECT_EQ(fds_drec_extract_batch(recs.data(), n, &spec, columns), FDS_ERR_ARG);
+    fds_template_destroy(tmplt);
+}
+
+// Copy records into an arena, reset it and reuse it
+TEST_F(drecFind, arenaCopy)
+{
+    std::unique_ptr<fds_drec_arena_t, decltype(&fds_drec_arena_destroy)>
+        arena(fds_drec_arena_create(), &fds_drec_arena_destroy);
+    ASSERT_NE(arena, nullptr);
+
+    // Enough records to fill multiple memory blocks
+    constexpr size_t REC_CNT = 20000;
+    std::vector<struct fds_drec *> copies;
+    for (size_t i = 0; i < REC_CNT; ++i) {
+        struct fds_drec *cpy = fds_drec_copy(arena.get(), &rec);
+        ASSERT_NE(cpy, nullptr);
+        copies.push_back(cpy);
+    }
+
+    const struct fds_template *tmplt_cpy = copies[0]->tmplt;
+    EXPECT_NE(tmplt_cpy, rec.tmplt);
+    EXPECT_EQ(tmplt_cpy->index.uid, rec.tmplt->index.uid);
+    for (const struct fds_drec *cpy : copies) {
+        ASSERT_EQ(cpy->size, rec.size);
+        EXPECT_NE(cpy->data, rec.data);
+        EXPECT_EQ(memcmp(cpy->data, rec.data, rec.size), 0);
+        EXPECT_EQ(cpy->tmplt, tmplt_cpy); // Shared copy of the Template
+        EXPECT_EQ(cpy->snap, nullptr);
+    }
+
+    // The copy is independent of the original record
+    struct fds_drec_field field;
+    uint64_t value;
+    rec.data[0] = ~rec.data[0];
+    ASSERT_GE(fds_drec_find(copies.back(), 0, 7, &field), 0);
+    ASSERT_EQ(fds_get_uint_be(field.data, field.size, &value), FDS_OK);
+    EXPECT_EQ(value, VALUE_SRC_PORT);
+    ASSERT_GE(fds_drec_find(copies.back(), 0, 82, &field), 0);
+    EXPECT_EQ(field.size, VALUE_IFC1.length());
+
+    // Records based on other Templates get own copies
+    std::vector<std::unique_ptr<fds_template, decltype(&fds_template_destroy)>> tmplts;
+    for (size_t i = 0; i < 50; ++i) {
+        fds_template *tmplt = fds_template_copy(rec.tmplt);
+        ASSERT_NE(tmplt, nullptr);
+        ASSERT_EQ(fds_template_ies_define(tmplt, ie_mgr, false), FDS_OK); // changes the uid
+        tmplts.emplace_back(tmplt, &fds_template_destroy);
+    }
+
+    for (size_t round = 0; round < 3; ++round) {
+        fds_drec_arena_reset(arena.get());
+        struct fds_drec *first = fds_drec_copy(arena.get(), &rec);
+        ASSERT_NE(first, nullptr);
+        EXPECT_EQ(first, copies[0]); // Memory is reused
+
+        std::vector<const struct fds_template *> shared;
+        for (size_t i = 0; i < 3 * tmplts.size(); ++i) {
+            struct fds_drec rec_other = rec;
+            rec_other.tmplt = tmplts[i % tmplts.size()].get();
+            struct fds_drec *cpy = fds_drec_copy(arena.get(), &rec_other);
+            ASSERT_NE(cpy, nullptr);
+            ASSERT_NE(cpy->tmplt, tmplt_cpy);
+            EXPECT_EQ(cpy->tmplt->index.uid, rec_other.tmplt->index.uid);
+            if (i < tmplts.size()) {
+                shared.push_back(cpy->tmplt);
+            } else {
+                EXPECT_EQ(cpy->tmplt, shared[i % tmplts.size()]);
+            }
+        }
+
+        // The original Template is still shared
+        EXPECT_EQ(fds_drec_copy(arena.get(), &rec)->tmplt, first->tmplt);
+    }
+}
+
+// Copies of a Template with the same identifier but different flow keys or timestamps
+TEST_F(drecFind, arenaTemplateModified)
+{
+    std::unique_ptr<fds_drec_arena_t, decltype(&fds_drec_arena_destroy)>
+        arena(fds_drec_arena_create(), &fds_drec_arena_destroy);
+    ASSERT_NE(arena, nullptr);
+
+    // The same modifications as done by the template manager (the identifier is preserved)
+    auto modify = [&](uint64_t flowkey, uint32_t last_seen) {
+        fds_template *tmplt = fds_template_copy(rec.tmplt);
+        EXPECT_NE(tmplt, nullptr);
+        EXPECT_EQ(fds_template_flowkey_define(tmplt, flowkey), FDS_OK);
+        tmplt->time.last_seen = last_seen;
+        return std::unique_ptr<fds_template, decltype(&fds_template_destroy)>(
+            tmplt, &fds_template_destroy);
+    };
+
+    auto tmplt_orig = modify(0, rec.tmplt->time.last_seen);
+    auto tmplt_fkey1 = modify(0x1, rec.tmplt->time.last_seen);
+    auto tmplt_fkey2 = modify(0x2, rec.tmplt->time.last_seen);
+    auto tmplt_fkey1_same = modify(0x1, rec.tmplt->time.last_seen);
+    auto tmplt_time = modify(0x1, rec.tmplt->time.last_seen + 10);
+    ASSERT_EQ(tmplt_fkey1->index.uid, rec.tmplt->index.uid);
+
+    auto copy = [&](const struct fds_template *tmplt) {
+        struct fds_drec rec_tmp = rec;
+        rec_tmp.tmplt = tmplt;
+        struct fds_drec *cpy = fds_drec_copy(arena.get(), &rec_tmp);
+        EXPECT_NE(cpy, nullptr);
+        return (cpy != nullptr) ? cpy->tmplt : nullptr;
+    };
+
+    const struct fds_template *cpy_orig = copy(rec.tmplt);
+    const struct fds_template *cpy_fkey1 = copy(tmplt_fkey1.get());
+    const struct fds_template *cpy_fkey2 = copy(tmplt_fkey2.get());
+    const struct fds_template *cpy_time = copy(tmplt_time.get());
+
+    // Flow key flags and timestamps are preserved
+    EXPECT_EQ(cpy_orig->flags & FDS_TEMPLATE_FKEY, 0);
+    EXPECT_NE(cpy_fkey1->flags & FDS_TEMPLATE_FKEY, 0);
+    EXPECT_NE(cpy_fkey1->fields[0].flags & FDS_TFIELD_FKEY, 0);
+    EXPECT_EQ(cpy_fkey1->fields[1].flags & FDS_TFIELD_FKEY, 0);
+    EXPECT_EQ(cpy_fkey2->fields[0].flags & FDS_TFIELD_FKEY, 0);
+    EXPECT_NE(cpy_fkey2->fields[1].flags & FDS_TFIELD_FKEY, 0);
+    EXPECT_EQ(cpy_time->time.last_seen, tmplt_time->time.last_seen);
+    EXPECT_NE(cpy_time, cpy_fkey1);
+    EXPECT_NE(cpy_fkey1, cpy_orig);
+
+    // Identical Templates still share the same copy
+    EXPECT_EQ(copy(tmplt_orig.get()), cpy_orig);
+    EXPECT_EQ(copy(tmplt_fkey1_same.get()), cpy_fkey1);
+    EXPECT_EQ(copy(tmplt_fkey2.get()), cpy_fkey2);
+    EXPECT_EQ(copy(rec.tmplt), cpy_orig);
+}
+
+// Decode records into a user-defined structure
+struct shape_flow {
+    uint64_t ts_first;
+    uint64_t bytes;
+    uint64_t bytes_rev;
+    float unknown;
+    uint32_t bytes_short;
+    int64_t proto;
+    uint16_t src_port;
+    uint8_t pkts_short;
+    uint8_t src_ip[4];
+    char app_name[16];
+    uint32_t missing;
+};
+
+static const std::vector<struct fds_shape_member> shape_members{
+    {0,     152, 0, FDS_SHAPE_UINT,  offsetof(shape_flow, ts_first),    8},
+    {0,       1, 0, FDS_SHAPE_UINT,  offsetof(shape_flow, bytes),       8},
+    {0,       1, FDS_DREC_BIFLOW_REV, FDS_SHAPE_UINT, offsetof(shape_flow, bytes_rev), 8},
+    {10000, 100, 0, FDS_SHAPE_FLOAT, offsetof(shape_flow, unknown),     4},
+    {0,       1, 0, FDS_SHAPE_UINT,  offsetof(shape_flow, bytes_short), 4},
+    {0,       4, 0, FDS_SHAPE_INT,   offsetof(shape_flow, proto),       8},
+    {0,       7, 0, FDS_SHAPE_UINT,  offsetof(shape_flow, src_port),    2},
+    {0,       2, 0, FDS_SHAPE_UINT,  offsetof(shape_flow, pkts_short),  1},
+    {0,       8, 0, FDS_SHAPE_BYTES, offsetof(shape_flow, src_ip),      4},
+    {0,      96, 0, FDS_SHAPE_BYTES, offsetof(shape_flow, app_name),    16},
+    {0,    1000, 0, FDS_SHAPE_UINT,  offsetof(shape_flow, missing),     4}
+};
+
+TEST_F(drecFind, shapeDecode)
+{
+    fds_drec_shape_t *shape_ptr;
+    ASSERT_EQ(fds_drec_shape_create(&shape_ptr, shape_members.data(), shape_members.size(),
+        sizeof(shape_flow)), FDS_OK);
+    std::unique_ptr<fds_drec_shape_t, decltype(&fds_drec_shape_destroy)>
+        shape(shape_ptr, &fds_drec_shape_destroy);
+
+    // The first decode compiles the shape, the second one uses it
+    for (int i = 0; i < 2; ++i) {
+        shape_flow flow;
+        memset(&flow, 0xFF, sizeof(flow));
+        ASSERT_EQ(fds_drec_shape_decode(shape.get(), &rec, &flow), FDS_OK);
+        EXPECT_EQ(flow.ts_first, VALUE_TS_FST);
+        EXPECT_EQ(flow.bytes, VALUE_BYTES);
+        EXPECT_EQ(flow.bytes_rev, VALUE_BYTES_R);
+        EXPECT_FLOAT_EQ(flow.unknown, VALUE_UNKNOWN);
+        EXPECT_EQ(flow.bytes_short, VALUE_BYTES);
+        EXPECT_EQ(flow.proto, VALUE_PROTO);
+        EXPECT_EQ(flow.src_port, VALUE_SRC_PORT);
+        EXPECT_EQ(flow.pkts_short, UINT8_MAX); // saturated
+        EXPECT_EQ(flow.src_ip[0], 127);
+        EXPECT_EQ(flow.src_ip[3], 1);
+        EXPECT_EQ(std::string(flow.app_name), VALUE_APP_NAME);
+        EXPECT_EQ(flow.missing, 0U);
+    }
+
+    // Malformed record (cut in the middle of variable-length fields)
+    struct fds_drec rec_short = rec;
+    rec_short.size = 60;
+    shape_flow flow;
+    EXPECT_EQ(fds_drec_shape_decode(shape.get(), &rec_short, &flow), FDS_ERR_FORMAT);
+    EXPECT_EQ(flow.bytes, 0U);
+
+    // Invalid members
+    std::vector<struct fds_shape_member> invalid{
+        {0, 1, 0, FDS_SHAPE_UINT,  0, 3},
+        {0, 1, 0, FDS_SHAPE_FLOAT, 0, 2},
+        {0, 1, 0, FDS_SHAPE_UINT,  sizeof(shape_flow) - 4, 8}
+    };
+    for (const auto &member : invalid) {
+        EXPECT_EQ(fds_drec_shape_create(&shape_ptr, &member, 1, sizeof(shape_flow)), FDS_ERR_ARG);
+    }
+}
+
+// Decode records of a Template without variable-length fields
+TEST(drecShape, staticTemplate)
+{
+    ipfix_trec trec {256};
+    trec.add_field(  7, 2);      // sourceTransportPort
+    trec.add_field(  8, 4);      // sourceIPv4Address
+    trec.add_field(  4, 1);      // protocolIdentifier
+    trec.add_field(  1, 4);      // octetDeltaCount (reduced size)
+    trec.add_field(152, 8);      // flowStartMilliseconds
+
+    uint16_t tmplt_size = trec.size();
+    std::unique_ptr<uint8_t, decltype(&free)> tmplt_raw(trec.release(), &free);
+    struct fds_template *tmplt_ptr;
+    ASSERT_EQ(fds_template_parse(FDS_TYPE_TEMPLATE, tmplt_raw.get(), &tmplt_size, &tmplt_ptr), FDS_OK);
+    std::unique_ptr<fds_template, decltype(&fds_template_destroy)>
+        tmplt(tmplt_ptr, &fds_template_destroy);
+
+    fds_drec_shape_t *shape_ptr;
+    ASSERT_EQ(fds_drec_shape_create(&shape_ptr, shape_members.data(), shape_members.size(),
+        sizeof(shape_flow)), FDS_OK);
+    std::unique_ptr<fds_drec_shape_t, decltype(&fds_drec_shape_destroy)>
+        shape(shape_ptr, &fds_drec_shape_destroy);
+
+    for (uint16_t i = 0; i < 100; ++i) {
+        ipfix_drec drec {};
+        drec.append_uint(1000U + i, 2);
+        drec.append_ip("10.0.0." + std::to_string(i));
+        drec.append_uint(17, 1);
+        drec.append_uint(100000U * i, 4);
+        drec.append_uint(1522670362000ULL + i, 8);
+
+        struct fds_drec rec;
+        rec.size = drec.size();
+        std::unique_ptr<uint8_t, decltype(&free)> rec_data(drec.release(), &free);
+        rec.data = rec_data.get();
+        rec.tmplt = tmplt.get();
+        rec.snap = nullptr;
+
+        shape_flow flow;
+        ASSERT_EQ(fds_drec_shape_decode(shape.get(), &rec, &flow), FDS_OK);
+        EXPECT_EQ(flow.src_port, 1000U + i);
+        EXPECT_EQ(flow.src_ip[3], i);
+        EXPECT_EQ(flow.proto, 17);
+        EXPECT_EQ(flow.bytes, 100000U * i);
+        EXPECT_EQ(flow.bytes_short, 100000U * i);
+        EXPECT_EQ(flow.bytes_rev, 100000U * i); // Direction flag ignored (not Biflow)
+        EXPECT_EQ(flow.ts_first, 1522670362000ULL + i);
+        EXPECT_EQ(flow.app_name[0], 0);
+
+        // Too short record
+        rec.size = 10;
+        EXPECT_EQ(fds_drec_shape_decode(shape.get(), &rec, &flow), FDS_ERR_FORMAT);
+    }
+}
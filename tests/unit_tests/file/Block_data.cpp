@@ -425,6 +425,45 @@ TEST_P(DBlock, writeSingleRecord)
     rec_cmp(r1_tuple, drec.data, drec.size);
 }
 
+// Buffers are borrowed from the pool only while a Data Block is being filled or processed
+TEST_P(DBlock, buffersPerBlock)
+{
+    Buffer_pool &pool = Buffer_pool::instance();
+    const size_t borrowed = pool.borrowed_size();
+
+    // Empty reader and writer don't hold any buffer
+    Block_data_writer writer(1, m_param_alg);
+    Block_data_reader reader(m_param_alg);
+    EXPECT_EQ(pool.borrowed_size(), borrowed);
+
+    uint16_t tid = 256;
+    tmplt_tuple_t t1_tuple = gen_t1_tmplt(tid);
+    Block_templates tmgr;
+    tmgr.add(FDS_TYPE_TEMPLATE, std::get<0>(t1_tuple).get(), std::get<1>(t1_tuple));
+    const struct fds_template *tmplt = tmgr.get(tid);
+    ASSERT_NE(tmplt, nullptr);
+
+    rec_tuple_t r1_tuple = gen_t1_rec();
+    writer.add(std::get<0>(r1_tuple).get(), std::get<1>(r1_tuple), tmplt);
+    EXPECT_GT(pool.borrowed_size(), borrowed);
+    EXPECT_GT(writer.write_to_file(m_fd, 0, 1, 0, m_param_io), 0U);
+    writer.write_wait();
+    EXPECT_EQ(pool.borrowed_size(), borrowed);
+
+    // Only the decompressed block is held by the reader
+    reader.set_templates(tmgr.snapshot());
+    reader.load_from_file(m_fd, 0, 0, m_param_io);
+    struct fds_drec drec;
+    ASSERT_EQ(reader.next_rec(&drec, nullptr), FDS_OK);
+    rec_cmp(r1_tuple, drec.data, drec.size);
+    EXPECT_GT(pool.borrowed_size(), borrowed);
+    EXPECT_LT(pool.borrowed_size(), borrowed + 2 * FDS_FILE_DBLOCK_SIZE);
+
+    reader.release();
+    EXPECT_EQ(pool.borrowed_size(), borrowed);
+    EXPECT_THROW(reader.next_rec(&drec, nullptr), File_exception);
+}
+
 // Write multiple different Data Records with different Export Times
 TEST_P(DBlock, writeDifferentRecords)
 {
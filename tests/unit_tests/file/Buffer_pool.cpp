@@ -0,0 +1,98 @@
+
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+#include <libfds.h>
+
+#include "../../../src/file/Buffer_pool.hpp"
+
+using namespace fds_file;
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+// Size of buffers used in tests
+static constexpr size_t BSIZE = 1024U * 1024U;
+
+// Restore the default configuration after each test
+class Pool : public ::testing::Test {
+protected:
+    void SetUp() override {
+        Buffer_pool::instance().configure(Buffer_pool::IDLE_MAX_DEF, false);
+    }
+    void TearDown() override {
+        Buffer_pool::instance().configure(Buffer_pool::IDLE_MAX_DEF, false);
+    }
+};
+
+// Returned buffer must be reused by the next request of the same size
+TEST_F(Pool, reuse)
+{
+    Buffer_pool &pool = Buffer_pool::instance();
+    Buffer_pool::Buffer buffer = pool.get(BSIZE);
+    ASSERT_NE(buffer, nullptr);
+    EXPECT_GE(buffer.get_deleter().size(), BSIZE);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(buffer.get()) % sysconf(_SC_PAGESIZE), 0U);
+    memset(buffer.get(), 0xAB, BSIZE);
+
+    uint8_t *ptr = buffer.get();
+    buffer.reset();
+    EXPECT_GE(pool.idle_size(), BSIZE);
+
+    buffer = pool.get(BSIZE);
+    EXPECT_EQ(buffer.get(), ptr);
+}
+
+// Buffers of slightly different sizes share the same size class
+TEST_F(Pool, sizeClass)
+{
+    Buffer_pool &pool = Buffer_pool::instance();
+    Buffer_pool::Buffer buffer = pool.get(BSIZE + 8);
+    uint8_t *ptr = buffer.get();
+    buffer.reset();
+
+    buffer = pool.get(BSIZE + 16);
+    EXPECT_EQ(buffer.get(), ptr);
+}
+
+// Idle buffers over the limit must be released
+TEST_F(Pool, idleLimit)
+{
+    Buffer_pool &pool = Buffer_pool::instance();
+    pool.configure(2 * BSIZE, false);
+
+    std::vector<Buffer_pool::Buffer> buffers;
+    for (size_t i = 0; i < 8; ++i) {
+        buffers.emplace_back(pool.get(BSIZE));
+    }
+
+    buffers.clear();
+    EXPECT_LE(pool.idle_size(), 2 * BSIZE);
+
+    // No caching at all
+    pool.configure(0, false);
+    EXPECT_EQ(pool.idle_size(), 0U);
+    Buffer_pool::Buffer buffer = pool.get(BSIZE);
+    buffer.reset();
+    EXPECT_EQ(pool.idle_size(), 0U);
+}
+
+// Hugepage backed buffers (fallback to transparent huge pages must always work)
+TEST_F(Pool, hugepages)
+{
+    ASSERT_EQ(fds_file_buffers_cfg(FDS_FILE_BUFFERS_IDLE_DEF, FDS_FILE_BUFFERS_HUGEPAGES), FDS_OK);
+    EXPECT_EQ(fds_file_buffers_cfg(FDS_FILE_BUFFERS_IDLE_DEF, ~0U), FDS_ERR_ARG);
+
+    Buffer_pool &pool = Buffer_pool::instance();
+    Buffer_pool::Buffer buffer = pool.get(3 * BSIZE);
+    ASSERT_NE(buffer, nullptr);
+    memset(buffer.get(), 0xCD, 3 * BSIZE);
+    buffer.reset();
+
+    // Mapped buffers must be released correctly
+    pool.configure(0, false);
+    EXPECT_EQ(pool.idle_size(), 0U);
+}
@@ -134,6 +134,72 @@ TEST_P(FileAPI, appendEmptyFile)
     free(list_data);
 }
 
+
+/*
+ * Append the file many times, so it contains more Template Blocks than the reader is able to
+ * keep parsed at the same time. Most of the Template Blocks are identical and the rest contains
+ * unique Templates. Data Records must be always interpreted using the proper Template.
+ */
+TEST_P(FileAPI, appendManyTemplateBlocks)
+{
+    Session session2write{"192.168.0.1", "1.1.1.1", 5000, 10000, FDS_FILE_SESSION_UDP};
+    const uint32_t append_flags = write2append_flag(m_flags_write);
+    const size_t append_cnt = 200;
+    std::vector<std::unique_ptr<DRec_base>> recs;
+
+    for (size_t i = 0; i < append_cnt; ++i) {
+        SCOPED_TRACE("i: " + std::to_string(i));
+        std::unique_ptr<fds_file_t, decltype(&fds_file_close)> file(fds_file_init(), &fds_file_close);
+        ASSERT_EQ(fds_file_open(file.get(), m_filename.c_str(), append_flags), FDS_OK);
+        if (m_load_iemgr) {
+            EXPECT_EQ(fds_file_set_iemgr(file.get(), m_iemgr), FDS_OK);
+        }
+
+        fds_file_sid_t sid;
+        ASSERT_EQ(fds_file_session_add(file.get(), session2write.get(), &sid), FDS_OK);
+        ASSERT_EQ(fds_file_write_ctx(file.get(), sid, 1, uint32_t(i)), FDS_OK);
+
+        // Every 4th Template Block has unique Template, otherwise only 2 variants are used
+        std::unique_ptr<DRec_base> rec;
+        if (i % 4 == 3) {
+            rec.reset(new DRec_opts(uint16_t(256 + i), uint32_t(i)));
+        } else if (i % 2 == 0) {
+            rec.reset(new DRec_simple(256, uint16_t(i)));
+        } else {
+            rec.reset(new DRec_biflow(256, "ipfixcol2", "eth" + std::to_string(i)));
+        }
+
+        ASSERT_EQ(fds_file_write_tmplt_add(file.get(), rec->tmplt_type(), rec->tmplt_data(),
+            rec->tmplt_size()), FDS_OK);
+        ASSERT_EQ(fds_file_write_rec(file.get(), rec->tmptl_id(), rec->rec_data(),
+            rec->rec_size()), FDS_OK);
+        recs.emplace_back(std::move(rec));
+    }
+
+    // Read all Data Records twice (after rewind, evicted Template Blocks must be parsed again)
+    std::unique_ptr<fds_file_t, decltype(&fds_file_close)> file(fds_file_init(), &fds_file_close);
+    ASSERT_EQ(fds_file_open(file.get(), m_filename.c_str(), m_flags_read), FDS_OK);
+    if (m_load_iemgr) {
+        EXPECT_EQ(fds_file_set_iemgr(file.get(), m_iemgr), FDS_OK);
+    }
+
+    for (size_t round = 0; round < 2; ++round) {
+        struct fds_file_read_ctx rec_ctx;
+        struct fds_drec rec_data;
+
+        for (size_t i = 0; i < append_cnt; ++i) {
+            SCOPED_TRACE("i: " + std::to_string(i));
+            ASSERT_EQ(fds_file_read_rec(file.get(), &rec_data, &rec_ctx), FDS_OK);
+            EXPECT_EQ(rec_ctx.exp_time, i);
+            EXPECT_TRUE(recs[i]->cmp_template(rec_data.tmplt->raw.data, rec_data.tmplt->raw.length));
+            EXPECT_TRUE(recs[i]->cmp_record(rec_data.data, rec_data.size));
+        }
+
+        ASSERT_EQ(fds_file_read_rec(file.get(), &rec_data, &rec_ctx), FDS_EOC);
+        ASSERT_EQ(fds_file_read_rewind(file.get()), FDS_OK);
+    }
+}
+
 /*
  * Try to append empty with a Transport Session and add the same Transport Session defintion again.
  * Only on Transport Session must be defined.
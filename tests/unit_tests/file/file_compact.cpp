@@ -0,0 +1,237 @@
+/**
+ * @file file_compact.cpp
+ * @author agent (agent@local)
+ * @date October 2026
+ * @brief
+ *   Test cases of offline file compaction using FDS File API
+ *
+ * The tests create a file (usually appended multiple times, so Template Blocks are duplicated),
+ * compact it and check that both files contain the same Transport Sessions, statistics and
+ * Data Records in the same order within each Transport Session and ODID.
+ *
+ * Copyright(c) 2026 CESNET z.s.p.o.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <map>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "wr_env.hpp"
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+// Run all tests independently for all following combinations of compression algorithms and I/Os
+uint32_t flags_comp[] = {0, FDS_FILE_LZ4, FDS_FILE_ZSTD};
+uint32_t flags_io[] = {0, FDS_FILE_NOASYNC};
+bool with_ie_mgr[] = {false, true};
+auto product = ::testing::Combine(::testing::ValuesIn(flags_comp), ::testing::ValuesIn(flags_io),
+    ::testing::ValuesIn(with_ie_mgr));
+INSTANTIATE_TEST_CASE_P(Compact, FileAPI, product, &product_name);
+
+// Data Records of a file (Template + Data Record) grouped by Transport Session and ODID
+using stream_key = std::pair<fds_file_sid_t, uint32_t>;
+using stream_recs = std::vector<std::pair<std::vector<uint8_t>, std::vector<uint8_t>>>;
+using file_content = std::map<stream_key, stream_recs>;
+
+/**
+ * @brief Load all Data Records and statistics of a file
+ * @param[in]  path    Path to the file
+ * @param[in]  flags   Reader flags
+ * @param[in]  iemgr   Manager of Information Elements (can be nullptr)
+ * @param[out] content Data Records of the file
+ * @param[out] stats   Statistics of the file
+ * @param[out] sids    Number of Transport Sessions
+ */
+static void
+file_load(const std::string &path, uint32_t flags, const fds_iemgr_t *iemgr,
+    file_content &content, struct fds_file_stats &stats, size_t &sids)
+{
+    std::unique_ptr<fds_file_t, decltype(&fds_file_close)> file(fds_file_init(), &fds_file_close);
+    ASSERT_EQ(fds_file_open(file.get(), path.c_str(), flags), FDS_OK);
+    if (iemgr != nullptr) {
+        ASSERT_EQ(fds_file_set_iemgr(file.get(), iemgr), FDS_OK);
+    }
+
+    struct fds_file_read_ctx ctx;
+    struct fds_drec rec;
+    int rc;
+
+    while ((rc = fds_file_read_rec(file.get(), &rec, &ctx)) == FDS_OK) {
+        std::vector<uint8_t> tmplt(rec.tmplt->raw.data, rec.tmplt->raw.data + rec.tmplt->raw.length);
+        std::vector<uint8_t> data(rec.data, rec.data + rec.size);
+        content[{ctx.sid, ctx.odid}].emplace_back(std::move(tmplt), std::move(data));
+    }
+    ASSERT_EQ(rc, FDS_EOC);
+
+    const struct fds_file_stats *file_stats = fds_file_stats_get(file.get());
+    ASSERT_NE(file_stats, nullptr);
+    stats = *file_stats;
+
+    fds_file_sid_t *list_data;
+    size_t list_size;
+    ASSERT_EQ(fds_file_session_list(file.get(), &list_data, &list_size), FDS_OK);
+    sids = list_size;
+    free(list_data);
+}
+
+/**
+ * @brief Compare content of two files
+ * @param[in] src   Path to the original file
+ * @param[in] dst   Path to the compacted file
+ * @param[in] flags Reader flags
+ * @param[in] iemgr Manager of Information Elements (can be nullptr)
+ */
+static void
+file_cmp(const std::string &src, const std::string &dst, uint32_t flags, const fds_iemgr_t *iemgr)
+{
+    file_content src_content, dst_content;
+    struct fds_file_stats src_stats, dst_stats;
+    size_t src_sids, dst_sids;
+
+    ASSERT_NO_FATAL_FAILURE(file_load(src, flags, iemgr, src_content, src_stats, src_sids));
+    ASSERT_NO_FATAL_FAILURE(file_load(dst, flags, iemgr, dst_content, dst_stats, dst_sids));
+
+    EXPECT_EQ(src_sids, dst_sids);
+    EXPECT_EQ(memcmp(&src_stats, &dst_stats, sizeof(src_stats)), 0);
+    ASSERT_EQ(src_content.size(), dst_content.size());
+    for (const auto &stream : src_content) {
+        auto it = dst_content.find(stream.first);
+        ASSERT_NE(it, dst_content.end());
+        EXPECT_TRUE(stream.second == it->second);
+    }
+}
+
+// Compact a file appended multiple times (i.e. with many small blocks and duplicate Templates)
+TEST_P(FileAPI, compactAppendedFile)
+{
+    Session session1{"192.168.0.1", "204.152.189.116", 80, 10000, FDS_FILE_SESSION_TCP};
+    Session session2{"10.10.0.1", "10.10.0.2", 4739, 4739, FDS_FILE_SESSION_UDP};
+    const uint32_t odids[] = {0, 10, 20};
+    const uint32_t append_flags = write2append_flag(m_flags_write);
+    constexpr size_t APPENDS = 5;
+    constexpr size_t RECS = 100;
+
+    for (size_t i = 0; i < APPENDS; ++i) {
+        std::unique_ptr<fds_file_t, decltype(&fds_file_close)> file(fds_file_init(), &fds_file_close);
+        ASSERT_EQ(fds_file_open(file.get(), m_filename.c_str(), append_flags), FDS_OK);
+        if (m_load_iemgr) {
+            EXPECT_EQ(fds_file_set_iemgr(file.get(), m_iemgr), FDS_OK);
+        }
+
+        fds_file_sid_t sids[2];
+        ASSERT_EQ(fds_file_session_add(file.get(), session1.get(), &sids[0]), FDS_OK);
+        ASSERT_EQ(fds_file_session_add(file.get(), session2.get(), &sids[1]), FDS_OK);
+
+        for (size_t r = 0; r < RECS; ++r) {
+            DRec_simple rec_simple(256, uint16_t(i), uint16_t(r));
+            DRec_biflow rec_biflow(257, "ipfixcol2", "eth" + std::to_string(r));
+            DRec_opts rec_opts(258, uint32_t(i), uint32_t(r));
+            const fds_file_sid_t sid = sids[r % 2];
+            const uint32_t odid = odids[r % 3];
+
+            ASSERT_EQ(fds_file_write_ctx(file.get(), sid, odid, uint32_t(i * RECS + r)), FDS_OK);
+            for (DRec_base *rec : std::vector<DRec_base *>{&rec_simple, &rec_biflow, &rec_opts}) {
+                ASSERT_EQ(fds_file_write_tmplt_add(file.get(), rec->tmplt_type(),
+                    rec->tmplt_data(), rec->tmplt_size()), FDS_OK);
+                ASSERT_EQ(fds_file_write_rec(file.get(), rec->tmptl_id(), rec->rec_data(),
+                    rec->rec_size()), FDS_OK);
+            }
+        }
+    }
+
+    // Compact the file using the default options and different number of threads
+    const std::string dst_default = m_filename + ".compact";
+    ASSERT_EQ(fds_file_compact(m_filename.c_str(), dst_default.c_str(), nullptr), FDS_OK);
+    file_cmp(m_filename, dst_default, m_flags_read, m_load_iemgr ? m_iemgr : nullptr);
+
+    struct stat st_src, st_dst;
+    ASSERT_EQ(stat(m_filename.c_str(), &st_src), 0);
+    ASSERT_EQ(stat(dst_default.c_str(), &st_dst), 0);
+    EXPECT_LT(st_dst.st_size, st_src.st_size);
+
+    for (unsigned int threads : {1U, 4U}) {
+        struct fds_file_compact_opts opts;
+        memset(&opts, 0, sizeof(opts));
+        opts.flags = m_flags_write & ~FDS_FILE_WRITE;
+        opts.threads = threads;
+
+        const std::string dst = m_filename + ".compact" + std::to_string(threads);
+        ASSERT_EQ(fds_file_compact(m_filename.c_str(), dst.c_str(), &opts), FDS_OK);
+        file_cmp(m_filename, dst, m_flags_read, m_load_iemgr ? m_iemgr : nullptr);
+    }
+}
+
+// Compact a file where the same Template ID is redefined between appends
+TEST_P(FileAPI, compactTemplateRedefinition)
+{
+    Session session{"192.168.0.1", "204.152.189.116", 80, 10000, FDS_FILE_SESSION_TCP};
+    const uint32_t append_flags = write2append_flag(m_flags_write);
+
+    for (size_t i = 0; i < 4; ++i) {
+        std::unique_ptr<fds_file_t, decltype(&fds_file_close)> file(fds_file_init(), &fds_file_close);
+        ASSERT_EQ(fds_file_open(file.get(), m_filename.c_str(), append_flags), FDS_OK);
+        if (m_load_iemgr) {
+            EXPECT_EQ(fds_file_set_iemgr(file.get(), m_iemgr), FDS_OK);
+        }
+
+        fds_file_sid_t sid;
+        ASSERT_EQ(fds_file_session_add(file.get(), session.get(), &sid), FDS_OK);
+        ASSERT_EQ(fds_file_write_ctx(file.get(), sid, 1, uint32_t(i)), FDS_OK);
+
+        // Template ID 256 is alternately defined as a simple and an Options Template
+        std::unique_ptr<DRec_base> rec;
+        if (i % 2 == 0) {
+            rec.reset(new DRec_simple(256));
+        } else {
+            rec.reset(new DRec_opts(256));
+        }
+
+        ASSERT_EQ(fds_file_write_tmplt_add(file.get(), rec->tmplt_type(), rec->tmplt_data(),
+            rec->tmplt_size()), FDS_OK);
+        for (size_t r = 0; r < 10; ++r) {
+            ASSERT_EQ(fds_file_write_rec(file.get(), rec->tmptl_id(), rec->rec_data(),
+                rec->rec_size()), FDS_OK);
+        }
+    }
+
+    const std::string dst = m_filename + ".compact";
+    ASSERT_EQ(fds_file_compact(m_filename.c_str(), dst.c_str(), nullptr), FDS_OK);
+    file_cmp(m_filename, dst, m_flags_read, m_load_iemgr ? m_iemgr : nullptr);
+}
+
+// Compact an empty file and try invalid arguments
+TEST_P(FileAPI, compactInvalid)
+{
+    std::unique_ptr<fds_file_t, decltype(&fds_file_close)> file(fds_file_init(), &fds_file_close);
+    ASSERT_EQ(fds_file_open(file.get(), m_filename.c_str(), m_flags_write), FDS_OK);
+    file.reset();
+
+    const std::string dst = m_filename + ".compact";
+    struct fds_file_compact_opts opts;
+    memset(&opts, 0, sizeof(opts));
+
+    // The same source and destination
+    EXPECT_EQ(fds_file_compact(m_filename.c_str(), m_filename.c_str(), nullptr), FDS_ERR_ARG);
+    // Multiple compression algorithms
+    opts.flags = FDS_FILE_LZ4 | FDS_FILE_ZSTD;
+    EXPECT_EQ(fds_file_compact(m_filename.c_str(), dst.c_str(), &opts), FDS_ERR_ARG);
+    // Operation mode flags are not allowed
+    opts.flags = FDS_FILE_READ;
+    EXPECT_EQ(fds_file_compact(m_filename.c_str(), dst.c_str(), &opts), FDS_ERR_ARG);
+    // Non-existing source file (the destination file must not be created)
+    struct stat st_dst;
+    unlink(dst.c_str());
+    EXPECT_NE(fds_file_compact("data/nonexisting_file.fds", dst.c_str(), nullptr), FDS_OK);
+    EXPECT_NE(stat(dst.c_str(), &st_dst), 0);
+
+    // Empty file
+    opts.flags = m_flags_write & ~FDS_FILE_WRITE;
+    ASSERT_EQ(fds_file_compact(m_filename.c_str(), dst.c_str(), &opts), FDS_OK);
+    file_cmp(m_filename, dst, m_flags_read, m_load_iemgr ? m_iemgr : nullptr);
+}
@@ -23,7 +23,7 @@ int main(int argc, char **argv)
 
 // Run all tests independently for all following combinations of compression algorithms and I/Os
 uint32_t flags_comp[] = {0, FDS_FILE_LZ4, FDS_FILE_ZSTD};
-uint32_t flags_io[] = {0, FDS_FILE_NOASYNC};
+uint32_t flags_io[] = {0, FDS_FILE_NOASYNC, FDS_FILE_DIRECT, FDS_FILE_NOASYNC | FDS_FILE_DIRECT};
 bool with_ie_mgr[] = {false, true};
 auto product = ::testing::Combine(::testing::ValuesIn(flags_comp), ::testing::ValuesIn(flags_io),
     ::testing::ValuesIn(with_ie_mgr));
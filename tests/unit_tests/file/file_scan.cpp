@@ -0,0 +1,230 @@
+/**
+ * @file file_scan.cpp
+ * @author agent (agent@local)
+ * @date October 2026
+ * @brief
+ *   Test cases of parallel scan and aggregation using FDS File API
+ *
+ * Copyright(c) 2026 CESNET z.s.p.o.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <map>
+
+#include "wr_env.hpp"
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+// Run all tests independently for all following combinations of compression algorithms and I/Os
+uint32_t flags_comp[] = {0, FDS_FILE_LZ4, FDS_FILE_ZSTD};
+uint32_t flags_io[] = {0, FDS_FILE_NOASYNC, FDS_FILE_DIRECT, FDS_FILE_NOASYNC | FDS_FILE_DIRECT};
+bool with_ie_mgr[] = {false, true};
+auto product = ::testing::Combine(::testing::ValuesIn(flags_comp), ::testing::ValuesIn(flags_io),
+    ::testing::ValuesIn(with_ie_mgr));
+INSTANTIATE_TEST_CASE_P(Scan, FileAPI, product, &product_name);
+
+// Aggregated result (number of records and sum of bytes per ODID)
+struct scan_result {
+    std::map<uint32_t, std::pair<uint64_t, uint64_t>> odids;
+    size_t merges = 0;
+    size_t abort_after = 0;
+};
+
+// Map callback (private accumulator has the same type as the result)
+static int
+scan_map(struct fds_drec *rec, const struct fds_file_read_ctx *ctx, void **acc, void *user)
+{
+    auto result = reinterpret_cast<struct scan_result *>(user);
+    if (*acc == nullptr) {
+        *acc = new scan_result();
+    }
+
+    auto acc_result = reinterpret_cast<struct scan_result *>(*acc);
+    struct fds_drec_field field;
+    uint64_t bytes = 0;
+    if (fds_drec_find(rec, 0, 1, &field) != FDS_EOC) {
+        EXPECT_EQ(fds_get_uint_be(field.data, field.size, &bytes), FDS_OK);
+    }
+
+    auto &odid_rec = acc_result->odids[ctx->odid];
+    odid_rec.first++;
+    odid_rec.second += bytes;
+
+    if (result->abort_after != 0 && odid_rec.first >= result->abort_after) {
+        return FDS_ERR_NOTFOUND;
+    }
+    return FDS_OK;
+}
+
+// Merge callback
+static int
+scan_merge(void *acc, void *user)
+{
+    auto result = reinterpret_cast<struct scan_result *>(user);
+    auto acc_result = reinterpret_cast<struct scan_result *>(acc);
+    result->merges++;
+    if (!acc_result) {
+        return FDS_OK;
+    }
+
+    for (const auto &odid_rec : acc_result->odids) {
+        auto &dst = result->odids[odid_rec.first];
+        dst.first += odid_rec.second.first;
+        dst.second += odid_rec.second.second;
+    }
+
+    delete acc_result;
+    return FDS_OK;
+}
+
+// Auxiliary class that creates a file with Data Records of multiple Transport Sessions and ODIDs
+class Scan_file {
+public:
+    static constexpr size_t RECS = 50000;
+
+    Scan_file(const std::string &path, uint32_t flags, fds_iemgr_t *iemgr)
+    {
+        Session session1{"192.168.0.1", "204.152.189.116", 80, 10000, FDS_FILE_SESSION_TCP};
+        Session session2{"10.10.0.1", "10.10.0.2", 4739, 4739, FDS_FILE_SESSION_UDP};
+        const uint32_t odids[] = {1, 2, 3, 4};
+
+        std::unique_ptr<fds_file_t, decltype(&fds_file_close)> file(fds_file_init(), &fds_file_close);
+        EXPECT_EQ(fds_file_open(file.get(), path.c_str(), flags), FDS_OK);
+        if (iemgr) {
+            EXPECT_EQ(fds_file_set_iemgr(file.get(), iemgr), FDS_OK);
+        }
+
+        fds_file_sid_t sids[2];
+        EXPECT_EQ(fds_file_session_add(file.get(), session1.get(), &sids[0]), FDS_OK);
+        EXPECT_EQ(fds_file_session_add(file.get(), session2.get(), &sids[1]), FDS_OK);
+        m_sid = sids[1];
+
+        for (size_t i = 0; i < RECS; ++i) {
+            const uint32_t odid = odids[i % 4];
+            const uint64_t bytes = i % 2000;
+            DRec_simple rec(256, 80, 10000, 6, bytes, 1);
+
+            EXPECT_EQ(fds_file_write_ctx(file.get(), sids[i % 2], odid, 0), FDS_OK);
+            EXPECT_EQ(fds_file_write_tmplt_add(file.get(), rec.tmplt_type(), rec.tmplt_data(),
+                rec.tmplt_size()), FDS_OK);
+            EXPECT_EQ(fds_file_write_rec(file.get(), rec.tmptl_id(), rec.rec_data(),
+                rec.rec_size()), FDS_OK);
+
+            auto &odid_rec = m_all[odid];
+            odid_rec.first++;
+            odid_rec.second += bytes;
+            if (sids[i % 2] == m_sid) {
+                auto &sid_rec = m_session[odid];
+                sid_rec.first++;
+                sid_rec.second += bytes;
+            }
+            if (bytes > 1000) {
+                auto &flt_rec = m_filtered[odid];
+                flt_rec.first++;
+                flt_rec.second += bytes;
+            }
+        }
+    }
+
+    /// Expected results of all Data Records
+    std::map<uint32_t, std::pair<uint64_t, uint64_t>> m_all;
+    /// Expected results of the Data Records with more than 1000 bytes
+    std::map<uint32_t, std::pair<uint64_t, uint64_t>> m_filtered;
+    /// Expected results of the second Transport Session
+    std::map<uint32_t, std::pair<uint64_t, uint64_t>> m_session;
+    /// The second Transport Session
+    fds_file_sid_t m_sid;
+};
+
+// Scan all Data Records using different number of threads
+TEST_P(FileAPI, scanAll)
+{
+    Scan_file data(m_filename, m_flags_write, m_load_iemgr ? m_iemgr : nullptr);
+
+    std::unique_ptr<fds_file_t, decltype(&fds_file_close)> file(fds_file_init(), &fds_file_close);
+    ASSERT_EQ(fds_file_open(file.get(), m_filename.c_str(), m_flags_read), FDS_OK);
+    if (m_load_iemgr) {
+        EXPECT_EQ(fds_file_set_iemgr(file.get(), m_iemgr), FDS_OK);
+    }
+
+    for (unsigned int threads : {0U, 1U, 2U, 8U}) {
+        SCOPED_TRACE("threads: " + std::to_string(threads));
+        struct scan_result result;
+        ASSERT_EQ(fds_file_scan(file.get(), nullptr, threads, &scan_map, &scan_merge, &result),
+            FDS_OK);
+        EXPECT_EQ(result.odids, data.m_all);
+        EXPECT_GE(result.merges, 1U);
+        if (threads != 0) {
+            EXPECT_LE(result.merges, threads);
+        }
+    }
+
+    // The position of the sequential reader is not affected
+    struct fds_drec rec;
+    size_t rec_cnt = 0;
+    while (fds_file_read_rec(file.get(), &rec, nullptr) == FDS_OK) {
+        rec_cnt++;
+    }
+    EXPECT_EQ(rec_cnt, size_t(Scan_file::RECS));
+}
+
+// Scan with the expression filter and the Transport Session filter
+TEST_P(FileAPI, scanFiltered)
+{
+    Scan_file data(m_filename, m_flags_write, m_load_iemgr ? m_iemgr : nullptr);
+
+    std::unique_ptr<fds_file_t, decltype(&fds_file_close)> file(fds_file_init(), &fds_file_close);
+    ASSERT_EQ(fds_file_open(file.get(), m_filename.c_str(), m_flags_read), FDS_OK);
+
+    struct scan_result result;
+    const char *expr = "octetDeltaCount > 1000";
+    if (!m_load_iemgr) {
+        // The filter cannot be used without definitions of Information Elements
+        EXPECT_EQ(fds_file_scan(file.get(), expr, 4, &scan_map, &scan_merge, &result), FDS_ERR_ARG);
+        EXPECT_EQ(result.merges, 0U);
+        return;
+    }
+
+    EXPECT_EQ(fds_file_set_iemgr(file.get(), m_iemgr), FDS_OK);
+    EXPECT_EQ(fds_file_scan(file.get(), "invalid expression ((", 4, &scan_map, &scan_merge,
+        &result), FDS_ERR_ARG);
+
+    ASSERT_EQ(fds_file_scan(file.get(), expr, 4, &scan_map, &scan_merge, &result), FDS_OK);
+    EXPECT_EQ(result.odids, data.m_filtered);
+
+    // Only the second Transport Session
+    ASSERT_EQ(fds_file_read_sfilter(file.get(), &data.m_sid, nullptr), FDS_OK);
+    result = scan_result();
+    ASSERT_EQ(fds_file_scan(file.get(), nullptr, 4, &scan_map, &scan_merge, &result), FDS_OK);
+    EXPECT_EQ(result.odids, data.m_session);
+}
+
+// Stop the scan from the map callback and try the scan in the writer mode
+TEST_P(FileAPI, scanAbort)
+{
+    Scan_file data(m_filename, m_flags_write, m_load_iemgr ? m_iemgr : nullptr);
+
+    std::unique_ptr<fds_file_t, decltype(&fds_file_close)> file(fds_file_init(), &fds_file_close);
+    ASSERT_EQ(fds_file_open(file.get(), m_filename.c_str(), m_flags_read), FDS_OK);
+
+    struct scan_result result;
+    result.abort_after = 10;
+    EXPECT_EQ(fds_file_scan(file.get(), nullptr, 4, &scan_map, &scan_merge, &result),
+        FDS_ERR_NOTFOUND);
+    EXPECT_GE(result.merges, 1U);
+
+    // The file is still usable
+    result = scan_result();
+    EXPECT_EQ(fds_file_scan(file.get(), nullptr, 4, &scan_map, &scan_merge, &result), FDS_OK);
+    EXPECT_EQ(result.odids, data.m_all);
+
+    // Writer
+    file.reset(fds_file_init());
+    ASSERT_EQ(fds_file_open(file.get(), m_filename.c_str(), m_flags_write), FDS_OK);
+    EXPECT_EQ(fds_file_scan(file.get(), nullptr, 4, &scan_map, &scan_merge, &result),
+        FDS_ERR_DENIED);
+}
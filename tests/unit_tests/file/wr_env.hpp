@@ -144,6 +144,12 @@ product_name(::testing::TestParamInfo<product_type> product)
     case FDS_FILE_NOASYNC:
         str += "SyncIOonly";
         break;
+    case FDS_FILE_DIRECT:
+        str += "DirectIO";
+        break;
+    case FDS_FILE_NOASYNC | FDS_FILE_DIRECT:
+        str += "SyncDirectIO";
+        break;
     default:
         throw std::runtime_error("Undefined I/O flag");
     }
@@ -677,3 +677,234 @@ TEST(dsetIterMalformed, tooLongVar)
         fds_template_destroy(tmplt);
     }
 }
+
+// Split of Data Sets ----------------------------------------------------------------------------
+
+// Split a Data Set with static and variable-length fields into records
+TEST(dsetSplit, mixVarAndFixed)
+{
+    // Prepare a template (fixed-length fields between variable-length fields)
+    ipfix_trec tmplt_raw {256};
+    tmplt_raw.add_field(10, 4);
+    tmplt_raw.add_field(15, 2);
+    tmplt_raw.add_field(20, ipfix_trec::SIZE_VAR);
+    tmplt_raw.add_field(30, ipfix_trec::SIZE_VAR);
+    tmplt_raw.add_field(40, 8);
+
+    uint16_t tmplt_size = tmplt_raw.size();
+    uint8_uniq tmplt_data(tmplt_raw.release(), &free);
+    struct fds_template *tmplt;
+    ASSERT_EQ(fds_template_parse(FDS_TYPE_TEMPLATE, tmplt_data.get(), &tmplt_size, &tmplt), FDS_OK);
+    ASSERT_EQ(tmplt->index.dyn_cnt, 2);
+    ASSERT_NE(tmplt->index.dyn_runs, nullptr);
+    EXPECT_EQ(tmplt->index.dyn_runs[0], 6);
+    EXPECT_EQ(tmplt->index.dyn_runs[1], 0);
+    EXPECT_EQ(tmplt->index.dyn_runs[2], 8);
+
+    std::string str1 = "";
+    std::string str2 = "Ultra Mega Giga . . . string";
+    std::vector<uint16_t> rec_sizes;
+    ipfix_set set {256};
+    for (int i = 0; i < 10; ++i) {
+        ipfix_drec rec {};
+        rec.append_uint(i, 4);
+        rec.append_uint(i, 2);
+        if (i % 2) {
+            rec.var_header(str1.length()); // empty string (only header)
+        } else {
+            rec.append_string(str2);
+        }
+        rec.var_header(str2.length(), (i % 3) == 0);
+        rec.append_string(str2, str2.length());
+        rec.append_uint(i, 8);
+        rec_sizes.push_back(rec.size());
+        set.add_rec(rec);
+    }
+    set.add_padding(4);
+    set_uniq hdr_set(set.release(), &free);
+
+    // The result must be the same as the result of the iterator
+    std::vector<uint8_t *> recs(rec_sizes.size());
+    std::vector<uint16_t> sizes(rec_sizes.size());
+    size_t cnt = recs.size();
+    ASSERT_EQ(fds_dset_split(hdr_set.get(), tmplt, recs.data(), sizes.data(), &cnt), FDS_OK);
+    ASSERT_EQ(cnt, rec_sizes.size());
+
+    fds_dset_iter iter;
+    fds_dset_iter_init(&iter, hdr_set.get(), tmplt);
+    for (size_t i = 0; i < cnt; ++i) {
+        ASSERT_EQ(fds_dset_iter_next(&iter), FDS_OK);
+        EXPECT_EQ(iter.rec, recs[i]);
+        EXPECT_EQ(iter.size, sizes[i]);
+        EXPECT_EQ(sizes[i], rec_sizes[i]);
+    }
+    EXPECT_EQ(fds_dset_iter_next(&iter), FDS_EOC);
+
+    // Insufficient capacity
+    cnt = 3;
+    EXPECT_EQ(fds_dset_split(hdr_set.get(), tmplt, recs.data(), sizes.data(), &cnt), FDS_ERR_BUFFER);
+    EXPECT_EQ(cnt, 3U);
+
+    // The last record is longer than the Data Set
+    const uint16_t set_len = ntohs(hdr_set->length);
+    hdr_set->length = htons(set_len - 4 - 10);
+    cnt = recs.size();
+    EXPECT_EQ(fds_dset_split(hdr_set.get(), tmplt, recs.data(), sizes.data(), &cnt), FDS_ERR_FORMAT);
+    EXPECT_EQ(cnt, rec_sizes.size() - 1);
+
+    // Empty Data Set
+    hdr_set->length = htons(FDS_IPFIX_SET_HDR_LEN);
+    cnt = recs.size();
+    EXPECT_EQ(fds_dset_split(hdr_set.get(), tmplt, recs.data(), sizes.data(), &cnt), FDS_ERR_FORMAT);
+    EXPECT_EQ(cnt, 0U);
+    fds_template_destroy(tmplt);
+}
+
+// Split a Data Set with static fields only (with padding)
+TEST(dsetSplit, staticFields)
+{
+    ipfix_trec tmplt_raw {256};
+    tmplt_raw.add_field(10, 4);
+    tmplt_raw.add_field(20, 3);
+
+    uint16_t tmplt_size = tmplt_raw.size();
+    uint8_uniq tmplt_data(tmplt_raw.release(), &free);
+    struct fds_template *tmplt;
+    ASSERT_EQ(fds_template_parse(FDS_TYPE_TEMPLATE, tmplt_data.get(), &tmplt_size, &tmplt), FDS_OK);
+    EXPECT_EQ(tmplt->index.dyn_runs, nullptr);
+
+    ipfix_set set {256};
+    for (int i = 0; i < 5; ++i) {
+        ipfix_drec rec {};
+        rec.append_uint(i, 4);
+        rec.append_uint(i, 3);
+        set.add_rec(rec);
+    }
+    set.add_padding(6);
+    set_uniq hdr_set(set.release(), &free);
+    uint8_t *first = reinterpret_cast<uint8_t *>(hdr_set.get() + 1);
+
+    uint8_t *recs[8];
+    uint16_t sizes[8];
+    size_t cnt = 8;
+    ASSERT_EQ(fds_dset_split(hdr_set.get(), tmplt, recs, sizes, &cnt), FDS_OK);
+    ASSERT_EQ(cnt, 5U);
+    for (size_t i = 0; i < cnt; ++i) {
+        EXPECT_EQ(recs[i], first + i * 7);
+        EXPECT_EQ(sizes[i], 7);
+    }
+
+    cnt = 2;
+    EXPECT_EQ(fds_dset_split(hdr_set.get(), tmplt, recs, sizes, &cnt), FDS_ERR_BUFFER);
+    EXPECT_EQ(cnt, 2U);
+    fds_template_destroy(tmplt);
+}
+
+// Batch iterator --------------------------------------------------------------------------------
+
+// Iterate over a Data Set with static fields in batches (combined with the single-record iterator)
+TEST(dsetIterBatch, staticFields)
+{
+    ipfix_trec tmplt_raw {256};
+    tmplt_raw.add_field(10, 4);
+    tmplt_raw.add_field(20, 3);
+
+    uint16_t tmplt_size = tmplt_raw.size();
+    uint8_uniq tmplt_data(tmplt_raw.release(), &free);
+    struct fds_template *tmplt;
+    ASSERT_EQ(fds_template_parse(FDS_TYPE_TEMPLATE, tmplt_data.get(), &tmplt_size, &tmplt), FDS_OK);
+
+    ipfix_set set {256};
+    for (int i = 0; i < 10; ++i) {
+        ipfix_drec rec {};
+        rec.append_uint(i, 4);
+        rec.append_uint(i, 3);
+        set.add_rec(rec);
+    }
+    set.add_padding(5);
+    set_uniq hdr_set(set.release(), &free);
+    uint8_t *first = reinterpret_cast<uint8_t *>(hdr_set.get() + 1);
+
+    uint8_t *recs[4];
+    uint16_t sizes[4];
+    fds_dset_iter iter;
+    fds_dset_iter_init(&iter, hdr_set.get(), tmplt);
+    EXPECT_EQ(fds_dset_iter_next_batch(&iter, recs, sizes, 0), FDS_ERR_ARG);
+
+    // 4 + 1 (single) + 4 + 1 records
+    ASSERT_EQ(fds_dset_iter_next_batch(&iter, recs, sizes, 4), 4);
+    for (size_t i = 0; i < 4; ++i) {
+        EXPECT_EQ(recs[i], first + i * 7);
+        EXPECT_EQ(sizes[i], 7);
+    }
+    EXPECT_EQ(iter.rec, recs[3]);
+    EXPECT_EQ(iter.size, 7);
+
+    ASSERT_EQ(fds_dset_iter_next(&iter), FDS_OK);
+    EXPECT_EQ(iter.rec, first + 4 * 7);
+
+    ASSERT_EQ(fds_dset_iter_next_batch(&iter, recs, sizes, 4), 4);
+    EXPECT_EQ(recs[0], first + 5 * 7);
+    ASSERT_EQ(fds_dset_iter_next_batch(&iter, recs, sizes, 4), 1);
+    EXPECT_EQ(recs[0], first + 9 * 7);
+    EXPECT_EQ(fds_dset_iter_next_batch(&iter, recs, sizes, 4), FDS_EOC);
+    EXPECT_EQ(fds_dset_iter_next(&iter), FDS_EOC);
+    fds_template_destroy(tmplt);
+}
+
+// Iterate over a Data Set with variable-length fields in batches (the last record is malformed)
+TEST(dsetIterBatch, varFieldsMalformed)
+{
+    ipfix_trec tmplt_raw {256};
+    tmplt_raw.add_field(10, 4);
+    tmplt_raw.add_field(20, ipfix_trec::SIZE_VAR);
+    tmplt_raw.add_field(40, 8);
+
+    uint16_t tmplt_size = tmplt_raw.size();
+    uint8_uniq tmplt_data(tmplt_raw.release(), &free);
+    struct fds_template *tmplt;
+    ASSERT_EQ(fds_template_parse(FDS_TYPE_TEMPLATE, tmplt_data.get(), &tmplt_size, &tmplt), FDS_OK);
+
+    std::string str = "Ultra Mega Giga . . . string";
+    ipfix_set set {256};
+    for (int i = 0; i < 5; ++i) {
+        ipfix_drec rec {};
+        rec.append_uint(i, 4);
+        rec.append_string(str.substr(0, 1 + i * 3)); // with a variable-length header
+        rec.append_uint(i, 8);
+        set.add_rec(rec);
+    }
+    set_uniq hdr_set(set.release(), &free);
+
+    // All records are valid
+    std::vector<uint8_t *> recs_iter;
+    std::vector<uint16_t> sizes_iter;
+    fds_dset_iter iter;
+    fds_dset_iter_init(&iter, hdr_set.get(), tmplt);
+    while (fds_dset_iter_next(&iter) == FDS_OK) {
+        recs_iter.push_back(iter.rec);
+        sizes_iter.push_back(iter.size);
+    }
+    ASSERT_EQ(recs_iter.size(), 5U);
+
+    uint8_t *recs[3];
+    uint16_t sizes[3];
+    fds_dset_iter_init(&iter, hdr_set.get(), tmplt);
+    ASSERT_EQ(fds_dset_iter_next_batch(&iter, recs, sizes, 3), 3);
+    ASSERT_EQ(fds_dset_iter_next_batch(&iter, recs, sizes, 3), 2);
+    EXPECT_EQ(recs[0], recs_iter[3]);
+    EXPECT_EQ(sizes[1], sizes_iter[4]);
+    EXPECT_EQ(iter.rec, recs_iter[4]);
+    EXPECT_EQ(fds_dset_iter_next_batch(&iter, recs, sizes, 3), FDS_EOC);
+
+    // Cut the last record, the previous records are returned before the error
+    const uint16_t set_len = ntohs(hdr_set->length);
+    hdr_set->length = htons(set_len - 4);
+    fds_dset_iter_init(&iter, hdr_set.get(), tmplt);
+    ASSERT_EQ(fds_dset_iter_next_batch(&iter, recs, sizes, 3), 3);
+    ASSERT_EQ(fds_dset_iter_next_batch(&iter, recs, sizes, 3), 1);
+    EXPECT_EQ(recs[0], recs_iter[3]);
+    EXPECT_EQ(fds_dset_iter_next_batch(&iter, recs, sizes, 3), FDS_ERR_FORMAT);
+    EXPECT_NE(fds_dset_iter_err(&iter), nullptr);
+    fds_template_destroy(tmplt);
+}
@@ -1,6 +1,8 @@
 #include <string>
 #include <memory>
 #include <cstdlib>
+#include <cstring>
+#include <vector>
 #include <gtest/gtest.h>
 #include <libfds.h>
 #include <MsgGen.h>
@@ -163,3 +165,149 @@ TEST(setIterMalformed, paddingAfterLastSet)
     EXPECT_EQ(fds_sets_iter_next(&iter), FDS_ERR_FORMAT);
     EXPECT_NE(fds_sets_iter_err(&iter), NO_ERR_STRING);
 }
+
+// Message index ----------------------------------------------------------------------------------
+
+// Message with (Options) Template Sets, a withdrawal and Data Sets
+TEST(msgIndex, mixedSets)
+{
+    ipfix_trec trec{256};
+    trec.add_field(8, 4);
+    ipfix_set set_tmplt {FDS_IPFIX_SET_TMPLT};
+    set_tmplt.add_rec(trec);
+    ipfix_set set_wdrl {FDS_IPFIX_SET_OPTS_TMPLT};
+    set_wdrl.add_rec(ipfix_trec{257});
+    ipfix_set set_data1 {256};
+    set_data1.add_padding(120);
+    ipfix_set set_data2 {300};
+    set_data2.add_padding(8);
+    ipfix_set set_reserved {100};
+
+    ipfix_msg msg;
+    msg.add_set(set_tmplt);
+    msg.add_set(set_data1);
+    msg.add_set(set_wdrl);
+    msg.add_set(set_reserved);
+    msg.add_set(set_data2);
+    const uint16_t msg_size = msg.size();
+    msg_uniq hdr_msg(msg.release(), &free);
+
+    struct fds_msg_index idx;
+    ASSERT_EQ(fds_msg_index(hdr_msg.get(), msg_size, &idx), FDS_OK);
+    EXPECT_EQ(idx.err_msg, NO_ERR_STRING);
+    EXPECT_EQ(idx.flags, FDS_MSG_INDEX_TSET | FDS_MSG_INDEX_OTSET | FDS_MSG_INDEX_DSET
+        | FDS_MSG_INDEX_WDRL);
+    EXPECT_EQ(idx.tsets_cnt, 2);
+    EXPECT_EQ(idx.dsets_cnt, 2);
+    ASSERT_EQ(idx.sets_cnt, 5);
+
+    const uint16_t exp_ids[] = {FDS_IPFIX_SET_TMPLT, 256, FDS_IPFIX_SET_OPTS_TMPLT, 100, 300};
+    const uint16_t exp_flags[] = {FDS_MSG_INDEX_TSET, FDS_MSG_INDEX_DSET,
+        FDS_MSG_INDEX_OTSET | FDS_MSG_INDEX_WDRL, 0, FDS_MSG_INDEX_DSET};
+    uint16_t offset = FDS_IPFIX_MSG_HDR_LEN;
+    for (uint16_t i = 0; i < idx.sets_cnt; ++i) {
+        SCOPED_TRACE("Set index: " + std::to_string(i));
+        EXPECT_EQ(idx.sets[i].offset, offset);
+        EXPECT_EQ(idx.sets[i].id, exp_ids[i]);
+        EXPECT_EQ(idx.sets[i].flags, exp_flags[i]);
+
+        // Compare with the real Set header
+        auto set = reinterpret_cast<fds_ipfix_set_hdr *>(
+            reinterpret_cast<uint8_t *>(hdr_msg.get()) + offset);
+        EXPECT_EQ(ntohs(set->flowset_id), idx.sets[i].id);
+        EXPECT_EQ(ntohs(set->length), idx.sets[i].length);
+        offset += idx.sets[i].length;
+    }
+    EXPECT_EQ(offset, msg_size);
+}
+
+// Empty message (no sets, only valid header)
+TEST(msgIndex, msgHeaderOnly)
+{
+    ipfix_msg msg{};
+    msg_uniq hdr_msg(msg.release(), &free);
+
+    struct fds_msg_index idx;
+    ASSERT_EQ(fds_msg_index(hdr_msg.get(), FDS_IPFIX_MSG_HDR_LEN, &idx), FDS_OK);
+    EXPECT_EQ(idx.flags, 0);
+    EXPECT_EQ(idx.sets_cnt, 0);
+}
+
+// More Sets than the capacity of the index
+TEST(msgIndex, truncated)
+{
+    const uint16_t set_cnt = FDS_MSG_INDEX_MAX + 10U;
+    ipfix_set set_data {256};
+    set_data.add_padding(4);
+
+    ipfix_msg msg;
+    for (uint16_t i = 0; i < set_cnt; ++i) {
+        msg.add_set(set_data);
+    }
+    const uint16_t msg_size = msg.size();
+    msg_uniq hdr_msg(msg.release(), &free);
+
+    struct fds_msg_index idx;
+    ASSERT_EQ(fds_msg_index(hdr_msg.get(), msg_size, &idx), FDS_OK);
+    EXPECT_EQ(idx.flags, FDS_MSG_INDEX_DSET | FDS_MSG_INDEX_TRUNC);
+    EXPECT_EQ(idx.sets_cnt, FDS_MSG_INDEX_MAX);
+    EXPECT_EQ(idx.dsets_cnt, set_cnt);
+}
+
+// Invalid Message header and Sets
+TEST(msgIndexMalformed, invalidMessages)
+{
+    ipfix_set set {256};
+    set.add_padding(100);
+
+    // Message length exceeds the buffer
+    ipfix_msg msg_long;
+    msg_long.add_set(set);
+    uint16_t msg_size = msg_long.size();
+    msg_uniq hdr_long(msg_long.release(), &free);
+    struct fds_msg_index idx;
+    EXPECT_EQ(fds_msg_index(hdr_long.get(), msg_size - 1U, &idx), FDS_ERR_FORMAT);
+    EXPECT_NE(idx.err_msg, NO_ERR_STRING);
+    EXPECT_EQ(fds_msg_index(hdr_long.get(), FDS_IPFIX_MSG_HDR_LEN - 1U, &idx), FDS_ERR_FORMAT);
+
+    // The buffer can be bigger than the Message (its size must not be truncated to 16 bits)
+    std::vector<uint8_t> buffer(UINT16_MAX + 2U, 0);
+    memcpy(buffer.data(), hdr_long.get(), msg_size);
+    const auto hdr_buffer = reinterpret_cast<const struct fds_ipfix_msg_hdr *>(buffer.data());
+    EXPECT_EQ(fds_msg_index(hdr_buffer, buffer.size(), &idx), FDS_OK);
+    EXPECT_EQ(fds_msg_index(hdr_buffer, msg_size, &idx), FDS_OK);
+
+    // Message length is shorter than the header
+    ipfix_msg msg_short;
+    msg_short.set_len(FDS_IPFIX_MSG_HDR_LEN - 1U);
+    msg_uniq hdr_short(msg_short.release(), &free);
+    EXPECT_EQ(fds_msg_index(hdr_short.get(), FDS_IPFIX_MSG_HDR_LEN, &idx), FDS_ERR_FORMAT);
+
+    // Unsupported version
+    ipfix_msg msg_ver;
+    msg_ver.set_version(9);
+    msg_uniq hdr_ver(msg_ver.release(), &free);
+    EXPECT_EQ(fds_msg_index(hdr_ver.get(), FDS_IPFIX_MSG_HDR_LEN, &idx), FDS_ERR_FORMAT);
+    EXPECT_NE(idx.err_msg, NO_ERR_STRING);
+
+    // Set exceeds the Message
+    ipfix_set set_long {256};
+    set_long.add_padding(10);
+    set_long.overwrite_len(100);
+    ipfix_msg msg_set;
+    msg_set.add_set(set_long);
+    msg_size = msg_set.size();
+    msg_uniq hdr_set(msg_set.release(), &free);
+    EXPECT_EQ(fds_msg_index(hdr_set.get(), msg_size, &idx), FDS_ERR_FORMAT);
+    EXPECT_NE(idx.err_msg, NO_ERR_STRING);
+
+    // Padding after the last Set
+    ipfix_msg msg_pad;
+    msg_pad.add_set(set);
+    msg_pad.add_set(set);
+    msg_pad.set_len(msg_pad.size() - set.size() + FDS_IPFIX_SET_HDR_LEN - 1U);
+    msg_size = msg_pad.size();
+    msg_uniq hdr_pad(msg_pad.release(), &free);
+    EXPECT_EQ(fds_msg_index(hdr_pad.get(), msg_size, &idx), FDS_ERR_FORMAT);
+    EXPECT_NE(idx.err_msg, NO_ERR_STRING);
+}
@@ -793,6 +793,51 @@ TEST(Parse, OptionsIEType)
     }
 }
 
+// Find fields in a template with many fields (including multiple occurrences of the same IE)
+TEST(Parse, FindManyFields)
+{
+    constexpr uint16_t FIELDS_CNT = 200;
+    TGenerator tdata(256, FIELDS_CNT);
+    for (uint16_t i = 0; i < FIELDS_CNT; ++i) {
+        // Every IE ID is used twice, every 4th IE has Enterprise Number
+        const uint16_t ie_id = i / 2;
+        const uint32_t ie_en = (ie_id % 4 == 0) ? 10000 : 0;
+        tdata.append(ie_id, (i % 7 == 6) ? VAR_IE : 4, ie_en);
+    }
+
+    struct fds_template *tmplt;
+    uint16_t len = tdata.length();
+    ASSERT_EQ(fds_template_parse(FDS_TYPE_TEMPLATE, tdata.get(), &len, &tmplt), FDS_OK);
+    ASSERT_EQ(tmplt->fields_cnt_total, FIELDS_CNT);
+
+    for (uint16_t ie_id = 0; ie_id < FIELDS_CNT / 2; ++ie_id) {
+        SCOPED_TRACE("IE ID: " + std::to_string(ie_id));
+        const uint32_t ie_en = (ie_id % 4 == 0) ? 10000 : 0;
+
+        // Only the first occurrence is returned
+        const struct fds_tfield *field = fds_template_cfind(tmplt, ie_en, ie_id);
+        ASSERT_NE(field, nullptr);
+        EXPECT_EQ(field, &tmplt->fields[2 * ie_id]);
+        EXPECT_EQ(fds_template_find(tmplt, ie_en, ie_id), field);
+
+        // Different Enterprise Number
+        EXPECT_EQ(fds_template_cfind(tmplt, ie_en + 1, ie_id), nullptr);
+    }
+
+    EXPECT_EQ(fds_template_cfind(tmplt, 0, FIELDS_CNT), nullptr);
+
+    // The copy of the template behaves the same way
+    struct fds_template *copy = fds_template_copy(tmplt);
+    ASSERT_NE(copy, nullptr);
+    for (uint16_t ie_id = 0; ie_id < FIELDS_CNT / 2; ++ie_id) {
+        const uint32_t ie_en = (ie_id % 4 == 0) ? 10000 : 0;
+        EXPECT_EQ(fds_template_cfind(copy, ie_en, ie_id), &copy->fields[2 * ie_id]);
+    }
+
+    fds_template_destroy(copy);
+    fds_template_destroy(tmplt);
+}
+
 // INVALID TEMPLATES ===============================================================================
 
 // Invalid header ID
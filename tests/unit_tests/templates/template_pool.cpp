@@ -0,0 +1,331 @@
+/**
+ * \brief Test cases for the pool of shared templates
+ */
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include <libfds.h>
+#include <TGenerator.h>
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+// Template created by the pool
+using uniq_fds_tmplt = std::unique_ptr<struct fds_template, decltype(&::fds_template_destroy)>;
+
+class Pool : public ::testing::Test {
+protected:
+    fds_iemgr_t *iemgr = nullptr;
+    fds_tpool_t *pool = nullptr;
+
+    /** \brief Prepare IE DB and a pool */
+    void SetUp() override {
+        iemgr = fds_iemgr_create();
+        if (!iemgr) {
+            throw std::runtime_error("IPFIX IE Manager is not ready!");
+        }
+
+        if (fds_iemgr_read_file(iemgr, "data/iana.xml", true) != FDS_OK) {
+            throw std::runtime_error("Failed to load Information Elements: "
+                + std::string(fds_iemgr_last_err(iemgr)));
+        }
+
+        pool = fds_tpool_create();
+        if (!pool) {
+            throw std::runtime_error("Failed to create a pool of templates!");
+        }
+    }
+
+    /** \brief Destroy the pool and IE DB */
+    void TearDown() override {
+        fds_tpool_destroy(pool);
+        fds_iemgr_destroy(iemgr);
+    }
+
+    /** \brief Create a biflow template */
+    static void
+    biflow(TGenerator &gen) {
+        gen.append(8, 4);          // sourceIPv4Address
+        gen.append(12, 4);         // destinationIPv4Address
+        gen.append(7, 2);          // sourceTransportPort
+        gen.append(11, 2);         // destinationTransportPort
+        gen.append(2, 8);          // packetDeltaCount
+        gen.append(2, 8, 29305);   // packetDeltaCount (reverse)
+        gen.append(82, 65535);     // interfaceName
+    }
+
+    /** \brief Get a template from the pool */
+    uniq_fds_tmplt
+    get(TGenerator &gen, const fds_iemgr_t *mgr, enum fds_template_type type = FDS_TYPE_TEMPLATE) {
+        uint16_t len = gen.length();
+        struct fds_template *tmplt = nullptr;
+        EXPECT_EQ(fds_tpool_template(pool, type, gen.get(), &len, mgr, &tmplt), FDS_OK);
+        EXPECT_EQ(len, gen.length());
+        return uniq_fds_tmplt(tmplt, &::fds_template_destroy);
+    }
+};
+
+// Identical templates share immutable arrays
+TEST_F(Pool, shared)
+{
+    TGenerator gen(256, 7);
+    biflow(gen);
+
+    uniq_fds_tmplt t1 = get(gen, iemgr);
+    uniq_fds_tmplt t2 = get(gen, iemgr);
+    ASSERT_NE(t1, nullptr);
+    ASSERT_NE(t2, nullptr);
+    EXPECT_NE(t1.get(), t2.get());
+
+    EXPECT_EQ(t1->raw.data, t2->raw.data);
+    EXPECT_EQ(t1->index.uid, t2->index.uid);
+    EXPECT_EQ(t1->index.views, t2->index.views);
+    EXPECT_NE(t1->index.shared, nullptr);
+    EXPECT_EQ(t1->index.shared, t2->index.shared);
+
+    // Fields are defined and not shared
+    ASSERT_EQ(t1->fields_cnt_total, 7);
+    EXPECT_NE(&t1->fields[0], &t2->fields[0]);
+    for (uint16_t i = 0; i < t1->fields_cnt_total; ++i) {
+        EXPECT_NE(t1->fields[i].def, nullptr);
+        EXPECT_EQ(t1->fields[i].def, t2->fields[i].def);
+        EXPECT_EQ(t1->fields[i].flags, t2->fields[i].flags);
+    }
+    EXPECT_NE(t1->fields_rev, nullptr);
+    EXPECT_NE(t1->fields_rev, t2->fields_rev);
+    EXPECT_TRUE(t1->flags & FDS_TEMPLATE_BIFLOW);
+
+    // Lookup of fields works as usual
+    EXPECT_EQ(fds_template_cfind(t2.get(), 0, 8), &t2->fields[0]);
+    EXPECT_EQ(fds_template_cfind(t2.get(), 29305, 2), &t2->fields[5]);
+
+    // Different template or type
+    TGenerator gen_other(256, 2);
+    gen_other.append(8, 4);
+    gen_other.append(12, 4);
+    uniq_fds_tmplt t3 = get(gen_other, iemgr);
+    ASSERT_NE(t3, nullptr);
+    EXPECT_NE(t3->index.shared, t1->index.shared);
+    EXPECT_NE(t3->raw.data, t1->raw.data);
+
+    TGenerator gen_opts(256, 2, 1);
+    gen_opts.append(8, 4);
+    gen_opts.append(12, 4);
+    uniq_fds_tmplt t4 = get(gen_opts, iemgr, FDS_TYPE_TEMPLATE_OPTS);
+    ASSERT_NE(t4, nullptr);
+    EXPECT_EQ(t4->type, FDS_TYPE_TEMPLATE_OPTS);
+    EXPECT_EQ(t4->fields_cnt_scope, 1);
+    EXPECT_NE(t4->index.shared, t3->index.shared);
+}
+
+// Templates defined by different IE managers are not shared
+TEST_F(Pool, differentManagers)
+{
+    TGenerator gen(256, 7);
+    biflow(gen);
+
+    uniq_fds_tmplt t1 = get(gen, iemgr);
+    uniq_fds_tmplt t2 = get(gen, nullptr);
+    ASSERT_NE(t1, nullptr);
+    ASSERT_NE(t2, nullptr);
+    EXPECT_NE(t1->index.shared, t2->index.shared);
+    EXPECT_NE(t1->raw.data, t2->raw.data);
+    EXPECT_NE(t1->fields[0].def, nullptr);
+    EXPECT_EQ(t2->fields[0].def, nullptr);
+    EXPECT_EQ(t2->fields_rev, nullptr);
+}
+
+// Template Withdrawals and malformed templates are not shared
+TEST_F(Pool, withdrawalAndMalformed)
+{
+    TGenerator gen_withdrawal(256, 0);
+    uint16_t len = gen_withdrawal.length();
+    struct fds_template *tmplt = nullptr;
+    ASSERT_EQ(fds_tpool_template(pool, FDS_TYPE_TEMPLATE, gen_withdrawal.get(), &len, iemgr,
+        &tmplt), FDS_OK);
+    ASSERT_NE(tmplt, nullptr);
+    EXPECT_EQ(tmplt->fields_cnt_total, 0);
+    EXPECT_EQ(tmplt->index.shared, nullptr);
+    fds_template_destroy(tmplt);
+
+    // Too short template
+    TGenerator gen(256, 7);
+    biflow(gen);
+    len = gen.length() - 2U;
+    tmplt = nullptr;
+    EXPECT_EQ(fds_tpool_template(pool, FDS_TYPE_TEMPLATE, gen.get(), &len, iemgr, &tmplt),
+        FDS_ERR_FORMAT);
+    EXPECT_EQ(tmplt, nullptr);
+
+    // Invalid ID
+    TGenerator gen_id(10, 1);
+    gen_id.append(8, 4);
+    len = gen_id.length();
+    EXPECT_EQ(fds_tpool_template(pool, FDS_TYPE_TEMPLATE, gen_id.get(), &len, iemgr, &tmplt),
+        FDS_ERR_FORMAT);
+    EXPECT_EQ(tmplt, nullptr);
+}
+
+// Templates remain valid after the pool is purged or destroyed
+TEST_F(Pool, purgeAndDestroy)
+{
+    TGenerator gen(256, 7);
+    biflow(gen);
+
+    const struct fds_template_shared *shared;
+    {
+        uniq_fds_tmplt t1 = get(gen, iemgr);
+        ASSERT_NE(t1, nullptr);
+        shared = t1->index.shared;
+
+        // The template is used, so it must stay in the pool
+        fds_tpool_purge(pool);
+        uniq_fds_tmplt t2 = get(gen, iemgr);
+        ASSERT_NE(t2, nullptr);
+        EXPECT_EQ(t2->index.shared, shared);
+    }
+
+    // Unused templates are removed (a new block is created)
+    fds_tpool_purge(pool);
+    uniq_fds_tmplt t3 = get(gen, iemgr);
+    ASSERT_NE(t3, nullptr);
+
+    // Many different templates (the table is rebuilt)
+    std::vector<uniq_fds_tmplt> tmplts;
+    for (uint16_t i = 0; i < 100; ++i) {
+        TGenerator gen_tmp(256 + i, 2);
+        gen_tmp.append(8, 4);
+        gen_tmp.append(1 + i, 8);
+        tmplts.push_back(get(gen_tmp, iemgr));
+        ASSERT_NE(tmplts.back(), nullptr);
+    }
+
+    fds_tpool_destroy(pool);
+    pool = nullptr;
+    EXPECT_EQ(t3->id, 256);
+    EXPECT_EQ(t3->fields_cnt_total, 7);
+    EXPECT_EQ(fds_template_cfind(t3.get(), 0, 12), &t3->fields[1]);
+    for (uint16_t i = 0; i < 100; ++i) {
+        EXPECT_EQ(tmplts[i]->id, 256 + i);
+        EXPECT_EQ(tmplts[i]->fields[1].id, 1 + i);
+    }
+}
+
+// Copies of shared templates share the arrays and modifications are private
+TEST_F(Pool, copyAndRedefine)
+{
+    TGenerator gen(256, 7);
+    biflow(gen);
+
+    uniq_fds_tmplt t1 = get(gen, iemgr);
+    ASSERT_NE(t1, nullptr);
+    uniq_fds_tmplt t2(fds_template_copy(t1.get()), &::fds_template_destroy);
+    ASSERT_NE(t2, nullptr);
+    EXPECT_EQ(t2->index.shared, t1->index.shared);
+    EXPECT_EQ(t2->raw.data, t1->raw.data);
+    EXPECT_EQ(t2->index.uid, t1->index.uid);
+
+    // Redefinition changes only the copy
+    EXPECT_EQ(fds_template_ies_define(t2.get(), nullptr, false), FDS_OK);
+    EXPECT_EQ(t2->fields[0].def, nullptr);
+    EXPECT_EQ(t2->fields_rev, nullptr);
+    EXPECT_NE(t2->index.uid, t1->index.uid);
+    EXPECT_NE(t1->fields[0].def, nullptr);
+    EXPECT_NE(t1->fields_rev, nullptr);
+
+    // Flow key is private too
+    const uint64_t fkey = 3;
+    EXPECT_EQ(fds_template_flowkey_define(t2.get(), fkey), FDS_OK);
+    EXPECT_TRUE(t2->fields[0].flags & FDS_TFIELD_FKEY);
+    EXPECT_FALSE(t1->fields[0].flags & FDS_TFIELD_FKEY);
+    EXPECT_EQ(fds_template_cfind(t1.get(), 0, 7), &t1->fields[2]);
+    EXPECT_EQ(fds_template_cfind(t2.get(), 0, 7), &t2->fields[2]);
+}
+
+// Template managers accept templates from the pool
+TEST_F(Pool, templateManager)
+{
+    TGenerator gen(256, 7);
+    biflow(gen);
+
+    fds_tmgr_t *tmgr1 = fds_tmgr_create(FDS_SESSION_UDP);
+    fds_tmgr_t *tmgr2 = fds_tmgr_create(FDS_SESSION_TCP);
+    ASSERT_NE(tmgr1, nullptr);
+    ASSERT_NE(tmgr2, nullptr);
+    EXPECT_EQ(fds_tmgr_set_iemgr(tmgr1, iemgr), FDS_OK);
+    EXPECT_EQ(fds_tmgr_set_time(tmgr1, 10), FDS_OK);
+    EXPECT_EQ(fds_tmgr_set_time(tmgr2, 10), FDS_OK);
+
+    // The first manager uses the same IE manager, the second one has none
+    EXPECT_EQ(fds_tmgr_template_add(tmgr1, get(gen, iemgr).release()), FDS_OK);
+    EXPECT_EQ(fds_tmgr_template_add(tmgr2, get(gen, iemgr).release()), FDS_OK);
+
+    const struct fds_template *t1, *t2;
+    ASSERT_EQ(fds_tmgr_template_get(tmgr1, 256, &t1), FDS_OK);
+    ASSERT_EQ(fds_tmgr_template_get(tmgr2, 256, &t2), FDS_OK);
+    EXPECT_EQ(t1->raw.data, t2->raw.data);
+    EXPECT_NE(t1->fields[0].def, nullptr);
+    EXPECT_EQ(t2->fields[0].def, nullptr);
+    EXPECT_EQ(t1->time.first_seen, 10U);
+
+    // The pool can be destroyed while the managers are still in use
+    fds_tpool_destroy(pool);
+    pool = nullptr;
+    EXPECT_EQ(fds_tmgr_set_time(tmgr1, 20), FDS_OK);
+    TGenerator gen_other(256, 1);
+    gen_other.append(8, 4);
+    uint16_t len = gen_other.length();
+    struct fds_template *tmplt;
+    ASSERT_EQ(fds_template_parse(FDS_TYPE_TEMPLATE, gen_other.get(), &len, &tmplt), FDS_OK);
+    EXPECT_EQ(fds_tmgr_template_add(tmgr1, tmplt), FDS_OK);
+    EXPECT_EQ(fds_tmgr_set_time(tmgr1, 10), FDS_OK);
+    ASSERT_EQ(fds_tmgr_template_get(tmgr1, 256, &t1), FDS_OK);
+    EXPECT_EQ(t1->fields_cnt_total, 7);
+
+    fds_tmgr_destroy(tmgr1);
+    fds_tmgr_destroy(tmgr2);
+}
+
+// Multiple threads use the same pool
+TEST_F(Pool, concurrent)
+{
+    const unsigned int threads_cnt = 4;
+    std::atomic<unsigned int> errors(0);
+    std::vector<std::thread> threads;
+
+    for (unsigned int i = 0; i < threads_cnt; ++i) {
+        threads.emplace_back([&]() {
+            for (uint16_t j = 0; j < 1000; ++j) {
+                TGenerator gen(256 + (j % 50), 2);
+                gen.append(8, 4);
+                gen.append(1 + (j % 50), 8);
+                uint16_t len = gen.length();
+                struct fds_template *tmplt;
+                if (fds_tpool_template(pool, FDS_TYPE_TEMPLATE, gen.get(), &len, iemgr, &tmplt)
+                        != FDS_OK) {
+                    errors++;
+                    continue;
+                }
+
+                if (tmplt->id != 256 + (j % 50) || tmplt->fields[0].def == nullptr) {
+                    errors++;
+                }
+                fds_template_destroy(tmplt);
+                if (j % 100 == 0) {
+                    fds_tpool_purge(pool);
+                }
+            }
+        });
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(errors.load(), 0U);
+}
@@ -7,6 +7,8 @@
 #include <TGenerator.h>
 #include <TMock.h>
 #include <cstdint>
+#include <cstring>
+#include <vector>
 
 int main(int argc, char **argv)
 {
@@ -35,6 +37,42 @@ protected:
     }
 };
 
+/**
+ * \brief Create an (Options) Template Set from raw definitions of templates
+ * \note The templates are destroyed.
+ * \param[in] set_id Set ID
+ * \param[in] tmplts Templates
+ * \return The Set
+ */
+static std::vector<uint8_t>
+set_create(uint16_t set_id, const std::vector<struct fds_template *> &tmplts)
+{
+    std::vector<uint8_t> set(FDS_IPFIX_SET_HDR_LEN);
+    for (struct fds_template *tmplt : tmplts) {
+        set.insert(set.end(), tmplt->raw.data, tmplt->raw.data + tmplt->raw.length);
+        fds_template_destroy(tmplt);
+    }
+
+    auto hdr = reinterpret_cast<struct fds_ipfix_set_hdr *>(set.data());
+    hdr->flowset_id = htons(set_id);
+    hdr->length = htons(uint16_t(set.size()));
+    return set;
+}
+
+/**
+ * \brief Add all templates of an (Options) Template Set to a manager
+ * \param[in] tmgr Template manager
+ * \param[in] set  The Set
+ * \return Return code of fds_tmgr_template_add_set()
+ */
+static int
+set_add(fds_tmgr_t *tmgr, std::vector<uint8_t> &set)
+{
+    struct fds_tset_iter it;
+    fds_tset_iter_init(&it, reinterpret_cast<struct fds_ipfix_set_hdr *>(set.data()));
+    return fds_tmgr_template_add_set(tmgr, &it);
+}
+
 // Define parameters of parametrized test
 INSTANTIATE_TEST_CASE_P(TemplateManager, Common,
     ::testing::Values(FDS_SESSION_UDP, FDS_SESSION_TCP, FDS_SESSION_SCTP,
@@ -1023,3 +1061,106 @@ TEST_P(Common, snapshotEq)
 // TODO: Multiple updates of the same template at the same time + cleanup
 
 // TODO: Test snapshot lifetime (TO ALL except TCP)
+
+// Add all templates of (Options) Template Sets at once
+TEST_P(Common, addSet)
+{
+    const struct fds_template *tmplt2check;
+    auto tset = set_create(FDS_IPFIX_SET_TMPLT, {
+        TMock::create(TMock::type::DATA_BASIC_FLOW, 256),
+        TMock::create(TMock::type::DATA_BASIC_BIFLOW, 257),
+        TMock::create(TMock::type::DATA_BASIC_FLOW, 1000)});
+    auto otset = set_create(FDS_IPFIX_SET_OPTS_TMPLT, {
+        TMock::create(TMock::type::OPTS_MPROC_STAT, 300),
+        TMock::create(TMock::type::OPTS_FKEY, 301)});
+
+    // Time context is not defined
+    EXPECT_EQ(set_add(tmgr, tset), FDS_ERR_ARG);
+
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 10), FDS_OK);
+    EXPECT_EQ(set_add(tmgr, tset), FDS_OK);
+    EXPECT_EQ(set_add(tmgr, otset), FDS_OK);
+    for (uint16_t tid : {256, 257, 1000, 300, 301}) {
+        SCOPED_TRACE("Template ID: " + std::to_string(tid));
+        ASSERT_EQ(fds_tmgr_template_get(tmgr, tid, &tmplt2check), FDS_OK);
+        EXPECT_EQ(tmplt2check->id, tid);
+        EXPECT_EQ(tmplt2check->type, (tid >= 300 && tid <= 301) ? FDS_TYPE_TEMPLATE_OPTS : FDS_TYPE_TEMPLATE);
+        EXPECT_EQ(tmplt2check->time.first_seen, 10U);
+        EXPECT_EQ(tmplt2check->time.last_seen, 10U);
+    }
+
+    const fds_tsnapshot_t *snap;
+    ASSERT_EQ(fds_tmgr_snapshot_get(tmgr, &snap), FDS_OK);
+
+    // Add the same Set again (the templates are only refreshed)
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 20), FDS_OK);
+    EXPECT_EQ(set_add(tmgr, tset), FDS_OK);
+    for (uint16_t tid : {256, 257, 1000}) {
+        SCOPED_TRACE("Template ID: " + std::to_string(tid));
+        ASSERT_EQ(fds_tmgr_template_get(tmgr, tid, &tmplt2check), FDS_OK);
+        EXPECT_EQ(tmplt2check->time.first_seen, 10U);
+        EXPECT_EQ(tmplt2check->time.last_seen, 20U);
+
+        // The previous snapshot is not modified
+        ASSERT_NE(tmplt2check = fds_tsnapshot_template_get(snap, tid), nullptr);
+        EXPECT_EQ(tmplt2check->time.last_seen, 10U);
+    }
+
+    ASSERT_EQ(fds_tmgr_template_get(tmgr, 300, &tmplt2check), FDS_OK);
+    EXPECT_EQ(tmplt2check->time.last_seen, 10U);
+}
+
+// Invalid (Options) Template Sets and templates that cannot be added
+TEST_P(Common, addSetInvalid)
+{
+    const struct fds_template *tmplt2check;
+    const bool wdrl_required = (GetParam() == FDS_SESSION_TCP || GetParam() == FDS_SESSION_SCTP);
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 10), FDS_OK);
+
+    // Template Withdrawals are not supported
+    auto wset = set_create(FDS_IPFIX_SET_TMPLT, {
+        TMock::create(TMock::type::DATA_WITHDRAWAL, 256)});
+    EXPECT_EQ(set_add(tmgr, wset), FDS_ERR_ARG);
+
+    // Malformed Set (the last template is truncated)
+    auto mset = set_create(FDS_IPFIX_SET_TMPLT, {
+        TMock::create(TMock::type::DATA_BASIC_FLOW, 256),
+        TMock::create(TMock::type::DATA_BASIC_FLOW, 257)});
+    mset.resize(mset.size() - 8);
+    auto hdr = reinterpret_cast<struct fds_ipfix_set_hdr *>(mset.data());
+    hdr->length = htons(uint16_t(mset.size()));
+    EXPECT_EQ(set_add(tmgr, mset), FDS_ERR_FORMAT);
+    EXPECT_EQ(fds_tmgr_template_get(tmgr, 256, &tmplt2check), FDS_ERR_NOTFOUND);
+
+    // Redefinition of a template
+    EXPECT_EQ(fds_tmgr_template_add(tmgr, TMock::create(TMock::type::DATA_BASIC_FLOW, 256)), FDS_OK);
+    struct fds_template *biflow = TMock::create(TMock::type::DATA_BASIC_BIFLOW, 256);
+    const uint16_t biflow_len = biflow->raw.length;
+    auto rset = set_create(FDS_IPFIX_SET_TMPLT, {
+        TMock::create(TMock::type::DATA_BASIC_BIFLOW, 257),
+        biflow});
+    if (wdrl_required) {
+        // Nothing is added
+        EXPECT_EQ(set_add(tmgr, rset), FDS_ERR_DENIED);
+        EXPECT_EQ(fds_tmgr_template_get(tmgr, 257, &tmplt2check), FDS_ERR_NOTFOUND);
+    } else {
+        EXPECT_EQ(set_add(tmgr, rset), FDS_OK);
+        EXPECT_EQ(fds_tmgr_template_get(tmgr, 257, &tmplt2check), FDS_OK);
+        ASSERT_EQ(fds_tmgr_template_get(tmgr, 256, &tmplt2check), FDS_OK);
+        EXPECT_EQ(tmplt2check->raw.length, biflow_len);
+    }
+
+    // Redefinition of a template within the same Set
+    auto dset = set_create(FDS_IPFIX_SET_TMPLT, {
+        TMock::create(TMock::type::DATA_BASIC_FLOW, 258),
+        TMock::create(TMock::type::DATA_BASIC_FLOW, 258),
+        TMock::create(TMock::type::DATA_BASIC_BIFLOW, 258)});
+    if (wdrl_required) {
+        EXPECT_EQ(set_add(tmgr, dset), FDS_ERR_DENIED);
+        EXPECT_EQ(fds_tmgr_template_get(tmgr, 258, &tmplt2check), FDS_ERR_NOTFOUND);
+    } else {
+        EXPECT_EQ(set_add(tmgr, dset), FDS_OK);
+        ASSERT_EQ(fds_tmgr_template_get(tmgr, 258, &tmplt2check), FDS_OK);
+        EXPECT_EQ(tmplt2check->raw.length, biflow_len);
+    }
+}
@@ -0,0 +1,194 @@
+/**
+ * \brief Test cases for publishing snapshots to concurrent readers
+ */
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include <libfds.h>
+#include <TGenerator.h>
+#include <TMock.h>
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+// Create main class for parameterized test
+class publish : public ::testing::TestWithParam<enum fds_session_type> {
+protected:
+    fds_tmgr_t *tmgr = nullptr;
+    /** \brief Prepare a template manager*/
+    void SetUp() override {
+        tmgr = fds_tmgr_create(GetParam());
+        if (!tmgr) {
+            throw std::runtime_error("Failed to create a template manager!");
+        }
+    }
+
+    /** \brief Destroy a template manager */
+    void TearDown() override {
+        if (tmgr == nullptr) {
+            return;
+        }
+        fds_tmgr_destroy(tmgr);
+    }
+};
+
+// Define parameters of parametrized test
+INSTANTIATE_TEST_CASE_P(TemplateManager, publish,
+    ::testing::Values(FDS_SESSION_UDP, FDS_SESSION_TCP, FDS_SESSION_SCTP, FDS_SESSION_FILE));
+
+// Nothing has been published yet
+TEST_P(publish, empty)
+{
+    fds_treader_t *reader = fds_treader_create(tmgr);
+    ASSERT_NE(reader, nullptr);
+    EXPECT_EQ(fds_treader_lock(reader), nullptr);
+    fds_treader_unlock(reader);
+
+    // Publish an empty snapshot
+    EXPECT_EQ(fds_tmgr_publish(tmgr), FDS_OK);
+    const fds_tsnapshot_t *snap = fds_treader_lock(reader);
+    ASSERT_NE(snap, nullptr);
+    EXPECT_EQ(fds_tsnapshot_template_get(snap, 256), nullptr);
+    fds_treader_unlock(reader);
+    fds_treader_destroy(reader);
+}
+
+// Published snapshot must be valid until the reader leaves the critical section
+TEST_P(publish, snapshotValidity)
+{
+    const uint16_t tid1 = 256;
+    const uint16_t tid2 = 300;
+    fds_treader_t *reader = fds_treader_create(tmgr);
+    ASSERT_NE(reader, nullptr);
+
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 10), FDS_OK);
+    EXPECT_EQ(fds_tmgr_template_add(tmgr, TMock::create(TMock::type::DATA_BASIC_FLOW, tid1)), FDS_OK);
+    EXPECT_EQ(fds_tmgr_publish(tmgr), FDS_OK);
+
+    const fds_tsnapshot_t *snap = fds_treader_lock(reader);
+    ASSERT_NE(snap, nullptr);
+    const struct fds_template *tmplt = fds_tsnapshot_template_get(snap, tid1);
+    ASSERT_NE(tmplt, nullptr);
+    EXPECT_EQ(tmplt->type, FDS_TYPE_TEMPLATE);
+
+    // Withdraw/redefine the template and publish multiple times
+    for (uint32_t time = 11; time < 50; ++time) {
+        EXPECT_EQ(fds_tmgr_set_time(tmgr, time), FDS_OK);
+        if (GetParam() != FDS_SESSION_UDP) {
+            EXPECT_EQ(fds_tmgr_template_withdraw(tmgr, tid1, FDS_TYPE_TEMPLATE_UNDEF), FDS_OK);
+        }
+        TMock::type type = (time % 2) ? TMock::type::OPTS_FKEY : TMock::type::DATA_BASIC_FLOW;
+        EXPECT_EQ(fds_tmgr_template_add(tmgr, TMock::create(type, tid1)), FDS_OK);
+        EXPECT_EQ(fds_tmgr_publish(tmgr), FDS_OK);
+    }
+
+    // The old snapshot and its template are still accessible
+    EXPECT_EQ(fds_tsnapshot_template_get(snap, tid1), tmplt);
+    EXPECT_EQ(tmplt->id, tid1);
+    EXPECT_EQ(tmplt->type, FDS_TYPE_TEMPLATE);
+    EXPECT_EQ(tmplt->time.first_seen, 10U);
+    fds_treader_unlock(reader);
+
+    // The new snapshot contains the newest definition
+    snap = fds_treader_lock(reader);
+    ASSERT_NE(snap, nullptr);
+    ASSERT_NE(tmplt = fds_tsnapshot_template_get(snap, tid1), nullptr);
+    EXPECT_EQ(tmplt->type, FDS_TYPE_TEMPLATE_OPTS);
+    EXPECT_EQ(tmplt->time.first_seen, 49U);
+    EXPECT_EQ(fds_tsnapshot_template_get(snap, tid2), nullptr);
+    fds_treader_unlock(reader);
+
+    // Clear the manager
+    fds_tmgr_clear(tmgr);
+    EXPECT_EQ(fds_tmgr_publish(tmgr), FDS_OK);
+    snap = fds_treader_lock(reader);
+    ASSERT_NE(snap, nullptr);
+    EXPECT_EQ(fds_tsnapshot_template_get(snap, tid1), nullptr);
+    fds_treader_unlock(reader);
+    fds_treader_destroy(reader);
+}
+
+// Slots of destroyed readers are reused
+TEST_P(publish, readerReuse)
+{
+    fds_treader_t *reader1 = fds_treader_create(tmgr);
+    fds_treader_t *reader2 = fds_treader_create(tmgr);
+    ASSERT_NE(reader1, nullptr);
+    ASSERT_NE(reader2, nullptr);
+    EXPECT_NE(reader1, reader2);
+
+    fds_treader_destroy(reader1);
+    fds_treader_t *reader3 = fds_treader_create(tmgr);
+    EXPECT_EQ(reader3, reader1);
+
+    fds_treader_destroy(reader2);
+    fds_treader_destroy(reader3);
+    fds_treader_destroy(nullptr);
+}
+
+// One thread modifies the manager, other threads read published snapshots
+TEST_P(publish, concurrentReaders)
+{
+    const unsigned int readers_cnt = 4;
+    const uint32_t iterations = 2000;
+    const uint16_t tids[] = {256, 257, 1000, 40000};
+    std::atomic<bool> stop(false);
+    std::atomic<unsigned int> errors(0);
+
+    std::vector<std::thread> threads;
+    for (unsigned int i = 0; i < readers_cnt; ++i) {
+        threads.emplace_back([&]() {
+            fds_treader_t *reader = fds_treader_create(tmgr);
+            if (!reader) {
+                errors++;
+                return;
+            }
+
+            while (!stop.load()) {
+                const fds_tsnapshot_t *snap = fds_treader_lock(reader);
+                if (snap != nullptr) {
+                    for (uint16_t tid : tids) {
+                        const struct fds_template *tmplt = fds_tsnapshot_template_get(snap, tid);
+                        if (tmplt != nullptr && (tmplt->id != tid || tmplt->fields_cnt_total == 0)) {
+                            errors++;
+                        }
+                    }
+
+                    fds_tsnapshot_for(snap, [](const struct fds_template *tmplt, void *data) -> bool {
+                        if (tmplt->fields_cnt_total == 0) {
+                            (*reinterpret_cast<std::atomic<unsigned int> *>(data))++;
+                        }
+                        return true;
+                    }, &errors);
+                }
+                fds_treader_unlock(reader);
+            }
+
+            fds_treader_destroy(reader);
+        });
+    }
+
+    // Threads must be always joined, so failures do not terminate the test immediately
+    for (uint32_t time = 1; time <= iterations && !HasFailure(); ++time) {
+        EXPECT_EQ(fds_tmgr_set_time(tmgr, time), FDS_OK);
+        const uint16_t tid = tids[time % (sizeof(tids) / sizeof(tids[0]))];
+        const struct fds_template *tmplt;
+        if (GetParam() != FDS_SESSION_UDP && fds_tmgr_template_get(tmgr, tid, &tmplt) == FDS_OK) {
+            EXPECT_EQ(fds_tmgr_template_withdraw(tmgr, tid, FDS_TYPE_TEMPLATE_UNDEF), FDS_OK);
+        }
+        TMock::type type = (time % 3) ? TMock::type::DATA_BASIC_BIFLOW : TMock::type::OPTS_MPROC_STAT;
+        EXPECT_EQ(fds_tmgr_template_add(tmgr, TMock::create(type, tid)), FDS_OK);
+        EXPECT_EQ(fds_tmgr_publish(tmgr), FDS_OK);
+    }
+
+    stop.store(true);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(errors.load(), 0U);
+}
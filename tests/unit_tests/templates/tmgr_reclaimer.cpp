@@ -0,0 +1,282 @@
+/**
+ * \brief Test cases for the background reclaimer of garbage
+ */
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include <libfds.h>
+#include <TGenerator.h>
+#include <TMock.h>
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+/**
+ * \brief Create a non-empty garbage
+ * \param[in] tmgr Template manager
+ * \param[in] time Export time (must be different for each call)
+ * \return Garbage
+ */
+static fds_tgarbage_t *
+garbage_make(fds_tmgr_t *tmgr, uint32_t time)
+{
+    // Remove a template referenced by a snapshot
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, time), FDS_OK);
+    EXPECT_EQ(fds_tmgr_template_add(tmgr, TMock::create(TMock::type::DATA_BASIC_FLOW, 256)), FDS_OK);
+    const fds_tsnapshot_t *snap;
+    EXPECT_EQ(fds_tmgr_snapshot_get(tmgr, &snap), FDS_OK);
+    EXPECT_EQ(fds_tmgr_template_remove(tmgr, 256, FDS_TYPE_TEMPLATE_UNDEF), FDS_OK);
+
+    fds_tgarbage_t *gc = nullptr;
+    EXPECT_EQ(fds_tmgr_garbage_get(tmgr, &gc), FDS_OK);
+    EXPECT_NE(gc, nullptr);
+    return gc;
+}
+
+// Create and destroy a reclaimer without any garbage
+TEST(Reclaimer, empty)
+{
+    fds_tmgr_reclaimer_destroy(nullptr);
+
+    fds_tmgr_reclaimer_t *rcl = fds_tmgr_reclaimer_create(0);
+    ASSERT_NE(rcl, nullptr);
+    EXPECT_EQ(fds_tmgr_reclaimer_add(rcl, nullptr), FDS_OK);
+    fds_tmgr_reclaimer_flush(rcl);
+
+    struct fds_tmgr_reclaimer_stats stats;
+    fds_tmgr_reclaimer_stats(rcl, &stats);
+    EXPECT_EQ(stats.gc_added, 0U);
+    EXPECT_EQ(stats.gc_destroyed, 0U);
+    EXPECT_EQ(stats.rec_destroyed, 0U);
+    EXPECT_EQ(stats.rec_pending, 0U);
+    EXPECT_EQ(stats.batches, 0U);
+    fds_tmgr_reclaimer_destroy(rcl);
+}
+
+// Garbage is destroyed in the background
+TEST(Reclaimer, destroy)
+{
+    fds_tmgr_reclaimer_t *rcl = fds_tmgr_reclaimer_create(0);
+    ASSERT_NE(rcl, nullptr);
+    fds_tmgr_t *tmgr = fds_tmgr_create(FDS_SESSION_FILE);
+    ASSERT_NE(tmgr, nullptr);
+
+    const uint32_t cnt = 50;
+    for (uint32_t i = 0; i < cnt; ++i) {
+        EXPECT_EQ(fds_tmgr_reclaimer_add(rcl, garbage_make(tmgr, i)), FDS_OK);
+    }
+
+    fds_tmgr_reclaimer_flush(rcl);
+    struct fds_tmgr_reclaimer_stats stats;
+    fds_tmgr_reclaimer_stats(rcl, &stats);
+    EXPECT_EQ(stats.gc_added, cnt);
+    EXPECT_EQ(stats.gc_destroyed, cnt);
+    EXPECT_GE(stats.rec_destroyed, cnt);
+    EXPECT_EQ(stats.rec_pending, 0U);
+    EXPECT_GE(stats.batches, 1U);
+    EXPECT_LE(stats.batches, cnt);
+
+    // Destroyed managers can be added as garbage too (via the registry)
+    fds_tmgr_registry_t *reg = fds_tmgr_registry_create(0);
+    ASSERT_NE(reg, nullptr);
+    EXPECT_EQ(fds_tmgr_registry_add(reg, nullptr, 0, tmgr, 0), FDS_OK);
+    EXPECT_EQ(fds_tmgr_registry_remove(reg, nullptr, 0), FDS_OK);
+    fds_tgarbage_t *gc;
+    fds_tmgr_registry_garbage_get(reg, &gc);
+    EXPECT_EQ(fds_tmgr_reclaimer_add(rcl, gc), FDS_OK);
+    fds_tmgr_registry_destroy(reg);
+
+    fds_tmgr_reclaimer_flush(rcl);
+    fds_tmgr_reclaimer_stats(rcl, &stats);
+    EXPECT_EQ(stats.gc_destroyed, cnt + 1);
+    fds_tmgr_reclaimer_destroy(rcl);
+}
+
+// Garbage of published snapshots is passed to the reclaimer
+TEST(Reclaimer, publish)
+{
+    fds_tmgr_reclaimer_t *rcl = fds_tmgr_reclaimer_create(0);
+    ASSERT_NE(rcl, nullptr);
+    fds_tmgr_t *tmgr = fds_tmgr_create(FDS_SESSION_UDP);
+    ASSERT_NE(tmgr, nullptr);
+    fds_treader_t *reader = fds_treader_create(tmgr);
+    ASSERT_NE(reader, nullptr);
+    fds_tmgr_set_reclaimer(tmgr, rcl);
+
+    // Remove a template referenced by a snapshot and publish the change
+    auto modify = [&](uint32_t time) {
+        EXPECT_EQ(fds_tmgr_set_time(tmgr, time), FDS_OK);
+        EXPECT_EQ(fds_tmgr_template_add(tmgr, TMock::create(TMock::type::DATA_BASIC_FLOW, 256)), FDS_OK);
+        const fds_tsnapshot_t *snap;
+        EXPECT_EQ(fds_tmgr_snapshot_get(tmgr, &snap), FDS_OK);
+        EXPECT_EQ(fds_tmgr_template_remove(tmgr, 256, FDS_TYPE_TEMPLATE_UNDEF), FDS_OK);
+        EXPECT_EQ(fds_tmgr_publish(tmgr), FDS_OK);
+    };
+
+    // Without readers, garbage is passed immediately
+    const uint32_t cnt = 20;
+    for (uint32_t i = 0; i < cnt; ++i) {
+        modify(i);
+    }
+
+    fds_tmgr_reclaimer_flush(rcl);
+    struct fds_tmgr_reclaimer_stats stats;
+    fds_tmgr_reclaimer_stats(rcl, &stats);
+    EXPECT_EQ(stats.gc_added, cnt);
+    EXPECT_EQ(stats.gc_destroyed, cnt);
+    EXPECT_EQ(stats.rec_pending, 0U);
+
+    // Garbage accessible by a reader is passed after the reader leaves
+    EXPECT_NE(fds_treader_lock(reader), nullptr);
+    modify(cnt);
+    fds_tmgr_reclaimer_flush(rcl);
+    fds_tmgr_reclaimer_stats(rcl, &stats);
+    EXPECT_EQ(stats.gc_added, cnt);
+    fds_treader_unlock(reader);
+
+    EXPECT_EQ(fds_tmgr_publish(tmgr), FDS_OK);
+    fds_tmgr_reclaimer_flush(rcl);
+    fds_tmgr_reclaimer_stats(rcl, &stats);
+    EXPECT_EQ(stats.gc_added, cnt + 1);
+    EXPECT_EQ(stats.gc_destroyed, cnt + 1);
+
+    // Without the reclaimer, garbage is destroyed by the manager
+    fds_tmgr_set_reclaimer(tmgr, nullptr);
+    modify(cnt + 1);
+    fds_tmgr_reclaimer_stats(rcl, &stats);
+    EXPECT_EQ(stats.gc_added, cnt + 1);
+
+    fds_treader_destroy(reader);
+    fds_tmgr_destroy(tmgr);
+    fds_tmgr_reclaimer_destroy(rcl);
+}
+
+// Shared garbage of a registry is passed to the reclaimer
+TEST(Reclaimer, registry)
+{
+    fds_tmgr_reclaimer_t *rcl = fds_tmgr_reclaimer_create(0);
+    ASSERT_NE(rcl, nullptr);
+    fds_tmgr_registry_t *reg = fds_tmgr_registry_create(0);
+    ASSERT_NE(reg, nullptr);
+    fds_tmgr_registry_set_reclaimer(reg, rcl);
+
+    const uint32_t cnt = 10;
+    for (uint32_t odid = 0; odid < cnt; ++odid) {
+        fds_tmgr_t *tmgr = fds_tmgr_create(FDS_SESSION_FILE);
+        ASSERT_NE(tmgr, nullptr);
+        fds_tgarbage_t *gc = garbage_make(tmgr, 1);
+        fds_tmgr_garbage_destroy(gc);
+        EXPECT_EQ(fds_tmgr_registry_add(reg, nullptr, odid, tmgr, 0), FDS_OK);
+    }
+
+    EXPECT_EQ(fds_tmgr_registry_remove_session(reg, nullptr), FDS_OK);
+    fds_tgarbage_t *gc = nullptr;
+    fds_tmgr_registry_garbage_get(reg, &gc);
+    EXPECT_EQ(gc, nullptr);
+
+    fds_tmgr_reclaimer_flush(rcl);
+    struct fds_tmgr_reclaimer_stats stats;
+    fds_tmgr_reclaimer_stats(rcl, &stats);
+    EXPECT_EQ(stats.gc_added, 1U);
+    EXPECT_EQ(stats.gc_destroyed, 1U);
+    EXPECT_GE(stats.rec_destroyed, cnt);
+
+    // Empty garbage is not passed
+    fds_tmgr_registry_garbage_get(reg, &gc);
+    EXPECT_EQ(gc, nullptr);
+    fds_tmgr_reclaimer_stats(rcl, &stats);
+    EXPECT_EQ(stats.gc_added, 1U);
+
+    fds_tmgr_registry_destroy(reg);
+    fds_tmgr_reclaimer_destroy(rcl);
+}
+
+// Garbage added during the interval is destroyed in a single batch
+TEST(Reclaimer, batches)
+{
+    fds_tmgr_reclaimer_t *rcl = fds_tmgr_reclaimer_create(200);
+    ASSERT_NE(rcl, nullptr);
+    fds_tmgr_t *tmgr = fds_tmgr_create(FDS_SESSION_UDP);
+    ASSERT_NE(tmgr, nullptr);
+
+    const uint32_t cnt = 20;
+    for (uint32_t i = 0; i < cnt; ++i) {
+        EXPECT_EQ(fds_tmgr_reclaimer_add(rcl, garbage_make(tmgr, i)), FDS_OK);
+    }
+
+    // The flush doesn't wait for the end of the interval
+    fds_tmgr_reclaimer_flush(rcl);
+    struct fds_tmgr_reclaimer_stats stats;
+    fds_tmgr_reclaimer_stats(rcl, &stats);
+    EXPECT_EQ(stats.gc_destroyed, cnt);
+    EXPECT_EQ(stats.rec_pending, 0U);
+    EXPECT_LE(stats.batches, 2U);
+
+    // Pending garbage is destroyed together with the reclaimer
+    fds_tmgr_reclaimer_t *rcl_long = fds_tmgr_reclaimer_create(60000);
+    ASSERT_NE(rcl_long, nullptr);
+    EXPECT_EQ(fds_tmgr_reclaimer_add(rcl_long, garbage_make(tmgr, cnt)), FDS_OK);
+    fds_tmgr_reclaimer_destroy(rcl_long);
+
+    fds_tmgr_destroy(tmgr);
+    fds_tmgr_reclaimer_destroy(rcl);
+}
+
+// Multiple threads add garbage at the same time
+TEST(Reclaimer, concurrent)
+{
+    fds_tmgr_reclaimer_t *rcl = fds_tmgr_reclaimer_create(1);
+    ASSERT_NE(rcl, nullptr);
+
+    const unsigned int threads_cnt = 4;
+    const uint32_t cnt = 100;
+    std::atomic<unsigned int> errors(0);
+    std::vector<std::thread> threads;
+
+    for (unsigned int t = 0; t < threads_cnt; ++t) {
+        threads.emplace_back([&]() {
+            fds_tmgr_t *tmgr = fds_tmgr_create(FDS_SESSION_SCTP);
+            if (!tmgr) {
+                errors++;
+                return;
+            }
+
+            for (uint32_t i = 0; i < cnt; ++i) {
+                fds_tgarbage_t *gc = garbage_make(tmgr, i);
+                if (fds_tmgr_reclaimer_add(rcl, gc) != FDS_OK) {
+                    fds_tmgr_garbage_destroy(gc);
+                    errors++;
+                }
+
+                if (i % 20 == 0) {
+                    fds_tmgr_reclaimer_flush(rcl);
+                }
+            }
+
+            fds_tmgr_destroy(tmgr);
+        });
+    }
+
+    struct fds_tmgr_reclaimer_stats stats;
+    for (unsigned int i = 0; i < 100; ++i) {
+        fds_tmgr_reclaimer_stats(rcl, &stats);
+        EXPECT_LE(stats.gc_destroyed, stats.gc_added);
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(errors.load(), 0U);
+    fds_tmgr_reclaimer_flush(rcl);
+    fds_tmgr_reclaimer_stats(rcl, &stats);
+    EXPECT_EQ(stats.gc_added, threads_cnt * cnt);
+    EXPECT_EQ(stats.gc_destroyed, threads_cnt * cnt);
+    EXPECT_EQ(stats.rec_pending, 0U);
+    fds_tmgr_reclaimer_destroy(rcl);
+}
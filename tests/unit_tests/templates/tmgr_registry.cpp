@@ -0,0 +1,345 @@
+/**
+ * \brief Test cases for the registry of template managers
+ */
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include <libfds.h>
+#include <TGenerator.h>
+#include <TMock.h>
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+class Registry : public ::testing::Test {
+protected:
+    fds_tmgr_registry_t *reg = nullptr;
+
+    /** \brief Prepare a registry */
+    void SetUp() override {
+        reg = fds_tmgr_registry_create(0);
+        if (!reg) {
+            throw std::runtime_error("Failed to create a registry!");
+        }
+    }
+
+    /** \brief Destroy the registry */
+    void TearDown() override {
+        fds_tmgr_registry_destroy(reg);
+    }
+
+    /** \brief Fake Transport Session */
+    static const void *
+    session(uintptr_t id) {
+        return reinterpret_cast<const void *>(id * 64U);
+    }
+
+    /** \brief Create a manager and add it to the registry */
+    fds_tmgr_t *
+    add(const void *sess, uint32_t odid, uint32_t now = 0) {
+        fds_tmgr_t *tmgr = fds_tmgr_create(FDS_SESSION_UDP);
+        EXPECT_NE(tmgr, nullptr);
+        EXPECT_EQ(fds_tmgr_registry_add(reg, sess, odid, tmgr, now), FDS_OK);
+        return tmgr;
+    }
+};
+
+// Add, find and remove managers
+TEST_F(Registry, addFindRemove)
+{
+    EXPECT_EQ(fds_tmgr_registry_find(reg, session(1), 0, 0), nullptr);
+    fds_tmgr_t *tmgr1 = add(session(1), 0);
+    fds_tmgr_t *tmgr2 = add(session(1), 1);
+    fds_tmgr_t *tmgr3 = add(session(2), 0);
+
+    EXPECT_EQ(fds_tmgr_registry_find(reg, session(1), 0, 0), tmgr1);
+    EXPECT_EQ(fds_tmgr_registry_find(reg, session(1), 1, 0), tmgr2);
+    EXPECT_EQ(fds_tmgr_registry_find(reg, session(2), 0, 0), tmgr3);
+    EXPECT_EQ(fds_tmgr_registry_find(reg, session(2), 1, 0), nullptr);
+    EXPECT_EQ(fds_tmgr_registry_find(reg, session(3), 0, 0), nullptr);
+
+    // Duplicate key
+    fds_tmgr_t *tmgr_dup = fds_tmgr_create(FDS_SESSION_UDP);
+    ASSERT_NE(tmgr_dup, nullptr);
+    EXPECT_EQ(fds_tmgr_registry_add(reg, session(1), 1, tmgr_dup, 0), FDS_ERR_DENIED);
+    fds_tmgr_destroy(tmgr_dup);
+
+    // Remove a manager (it remains valid until the garbage is destroyed)
+    fds_tgarbage_t *gc;
+    fds_tmgr_registry_garbage_get(reg, &gc);
+    EXPECT_EQ(gc, nullptr);
+    EXPECT_EQ(fds_tmgr_registry_remove(reg, session(1), 1), FDS_OK);
+    EXPECT_EQ(fds_tmgr_registry_remove(reg, session(1), 1), FDS_ERR_NOTFOUND);
+    EXPECT_EQ(fds_tmgr_registry_find(reg, session(1), 1, 0), nullptr);
+    EXPECT_EQ(fds_tmgr_set_time(tmgr2, 10), FDS_OK);
+    EXPECT_EQ(fds_tmgr_template_add(tmgr2, TMock::create(TMock::type::DATA_BASIC_FLOW, 256)), FDS_OK);
+
+    fds_tmgr_registry_garbage_get(reg, &gc);
+    ASSERT_NE(gc, nullptr);
+    fds_tmgr_garbage_destroy(gc);
+    fds_tmgr_registry_garbage_get(reg, &gc);
+    EXPECT_EQ(gc, nullptr);
+
+    // The manager can be added again
+    tmgr2 = add(session(1), 1);
+    EXPECT_EQ(fds_tmgr_registry_find(reg, session(1), 1, 0), tmgr2);
+}
+
+// Remove all managers of a Transport Session
+TEST_F(Registry, removeSession)
+{
+    const uint32_t odid_cnt = 100;
+    for (uint32_t odid = 0; odid < odid_cnt; ++odid) {
+        add(session(1), odid);
+        add(session(2), odid);
+    }
+
+    EXPECT_EQ(fds_tmgr_registry_remove_session(reg, session(1)), FDS_OK);
+    for (uint32_t odid = 0; odid < odid_cnt; ++odid) {
+        EXPECT_EQ(fds_tmgr_registry_find(reg, session(1), odid, 0), nullptr);
+        EXPECT_NE(fds_tmgr_registry_find(reg, session(2), odid, 0), nullptr);
+    }
+
+    // Nothing to remove
+    EXPECT_EQ(fds_tmgr_registry_remove_session(reg, session(3)), FDS_OK);
+
+    fds_tgarbage_t *gc;
+    fds_tmgr_registry_garbage_get(reg, &gc);
+    EXPECT_NE(gc, nullptr);
+    fds_tmgr_garbage_destroy(gc);
+}
+
+// Inactive managers are removed in batches
+TEST_F(Registry, sweep)
+{
+    const uint32_t cnt = 1000;
+    for (uint32_t i = 0; i < cnt; ++i) {
+        add(session(i), i % 3, 100);
+    }
+
+    // Nothing is inactive
+    EXPECT_EQ(fds_tmgr_registry_sweep(reg, 110, 10, 2 * cnt), 0U);
+
+    // Keep every second manager active
+    for (uint32_t i = 0; i < cnt; i += 2) {
+        EXPECT_NE(fds_tmgr_registry_find(reg, session(i), i % 3, 150), nullptr);
+    }
+
+    size_t removed = 0;
+    size_t calls = 0;
+    while (removed < cnt / 2 && calls < 1000) {
+        removed += fds_tmgr_registry_sweep(reg, 160, 30, 50);
+        calls++;
+    }
+
+    EXPECT_EQ(removed, cnt / 2);
+    EXPECT_GT(calls, 1U);
+    for (uint32_t i = 0; i < cnt; ++i) {
+        fds_tmgr_t *tmgr = fds_tmgr_registry_find(reg, session(i), i % 3, 160);
+        if (i % 2 == 0) {
+            EXPECT_NE(tmgr, nullptr);
+        } else {
+            EXPECT_EQ(tmgr, nullptr);
+        }
+    }
+
+    EXPECT_EQ(fds_tmgr_registry_sweep(reg, 165, 10, 2 * cnt), 0U);
+    EXPECT_EQ(fds_tmgr_registry_sweep(reg, 200, 10, 2 * cnt), cnt / 2);
+
+    fds_tgarbage_t *gc;
+    fds_tmgr_registry_garbage_get(reg, &gc);
+    EXPECT_NE(gc, nullptr);
+    fds_tmgr_garbage_destroy(gc);
+
+    // Empty registry
+    EXPECT_EQ(fds_tmgr_registry_sweep(reg, 300, 10, 100), 0U);
+}
+
+// Garbage of managers is collected in the shared garbage
+TEST_F(Registry, sharedGarbage)
+{
+    EXPECT_EQ(fds_tmgr_registry_garbage_add(reg, nullptr), FDS_OK);
+
+    fds_tmgr_t *tmgr = add(session(1), 0);
+    for (uint32_t time = 0; time < 10; ++time) {
+        EXPECT_EQ(fds_tmgr_set_time(tmgr, time), FDS_OK);
+        EXPECT_EQ(fds_tmgr_template_add(tmgr, TMock::create(TMock::type::DATA_BASIC_FLOW, 256)), FDS_OK);
+        const struct fds_template *tmplt;
+        EXPECT_EQ(fds_tmgr_template_get(tmgr, 256, &tmplt), FDS_OK);
+        EXPECT_EQ(fds_tmgr_template_add(tmgr, TMock::create(TMock::type::DATA_BASIC_BIFLOW, 256)), FDS_OK);
+
+        fds_tgarbage_t *gc;
+        EXPECT_EQ(fds_tmgr_garbage_get(tmgr, &gc), FDS_OK);
+        EXPECT_EQ(fds_tmgr_registry_garbage_add(reg, gc), FDS_OK);
+    }
+
+    EXPECT_EQ(fds_tmgr_registry_remove(reg, session(1), 0), FDS_OK);
+    fds_tgarbage_t *gc;
+    fds_tmgr_registry_garbage_get(reg, &gc);
+    ASSERT_NE(gc, nullptr);
+    fds_tmgr_garbage_destroy(gc);
+}
+
+// Multiple threads access the registry
+TEST_F(Registry, concurrent)
+{
+    const unsigned int threads_cnt = 4;
+    const uint32_t sessions_cnt = 500;
+    std::atomic<unsigned int> errors(0);
+    std::vector<std::thread> threads;
+
+    for (unsigned int t = 0; t < threads_cnt; ++t) {
+        threads.emplace_back([&, t]() {
+            // Each thread owns its sessions
+            for (uint32_t now = 0; now < 20; ++now) {
+                for (uint32_t i = t; i < sessions_cnt; i += threads_cnt) {
+                    fds_tmgr_t *tmgr = fds_tmgr_registry_find(reg, session(i + 1), 0, now);
+                    if (!tmgr) {
+                        tmgr = fds_tmgr_create(FDS_SESSION_UDP);
+                        if (!tmgr) {
+                            errors++;
+                            continue;
+                        }
+
+                        if (fds_tmgr_registry_add(reg, session(i + 1), 0, tmgr, now) != FDS_OK) {
+                            errors++;
+                            fds_tmgr_destroy(tmgr);
+                            continue;
+                        }
+                    }
+
+                    if (fds_tmgr_set_time(tmgr, now) != FDS_OK) {
+                        errors++;
+                    }
+                }
+
+                if (now == 10) {
+                    fds_tmgr_registry_remove_session(reg, session(t + 1));
+                }
+            }
+        });
+    }
+
+    // Inactive managers don't exist, so the sweeps don't remove anything
+    for (unsigned int i = 0; i < 100; ++i) {
+        EXPECT_EQ(fds_tmgr_registry_sweep(reg, 20, 1000, 100), 0U);
+        if (i % 10 == 0) {
+            // Managers are redefined by the threads that use them
+            fds_tmgr_registry_set_iemgr(reg, nullptr);
+        }
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(errors.load(), 0U);
+    for (uint32_t i = 0; i < sessions_cnt; ++i) {
+        EXPECT_NE(fds_tmgr_registry_find(reg, session(i + 1), 0, 20), nullptr);
+    }
+    EXPECT_LE(fds_tmgr_registry_iemgr_pending(reg), sessions_cnt);
+    EXPECT_EQ(fds_tmgr_registry_redefine(reg), FDS_OK);
+    EXPECT_EQ(fds_tmgr_registry_iemgr_pending(reg), 0U);
+
+    fds_tgarbage_t *gc;
+    fds_tmgr_registry_garbage_get(reg, &gc);
+    fds_tmgr_garbage_destroy(gc);
+}
+
+// IE manager of all managers is changed lazily
+TEST_F(Registry, iemgrRedefine)
+{
+    fds_iemgr_t *iemgr[2];
+    for (auto &ptr : iemgr) {
+        ptr = fds_iemgr_create();
+        ASSERT_NE(ptr, nullptr);
+        ASSERT_EQ(fds_iemgr_read_file(ptr, "./data/iana.xml", false), FDS_OK);
+    }
+
+    const uint32_t cnt = 20;
+    const uint16_t tid = 256;
+    for (uint32_t i = 0; i < cnt; ++i) {
+        fds_tmgr_t *tmgr = add(session(i), 0);
+        EXPECT_EQ(fds_tmgr_set_time(tmgr, 10), FDS_OK);
+        EXPECT_EQ(fds_tmgr_template_add(tmgr, TMock::create(TMock::type::DATA_BASIC_BIFLOW, tid)), FDS_OK);
+    }
+
+    // Check that all fields of the template are defined by the IE manager
+    auto check = [&](fds_tmgr_t *tmgr, const fds_iemgr_t *ies) {
+        const struct fds_template *tmplt;
+        ASSERT_EQ(fds_tmgr_template_get(tmgr, tid, &tmplt), FDS_OK);
+        for (uint16_t i = 0; i < tmplt->fields_cnt_total; ++i) {
+            const struct fds_tfield *field = &tmplt->fields[i];
+            const struct fds_iemgr_elem *def = nullptr;
+            if (ies != nullptr) {
+                def = fds_iemgr_elem_find_id(ies, field->en, field->id);
+            }
+            EXPECT_EQ(field->def, def);
+        }
+    };
+
+    // No IE manager has been set yet
+    EXPECT_EQ(fds_tmgr_registry_iemgr_pending(reg), 0U);
+    EXPECT_EQ(fds_tmgr_registry_redefine(reg), FDS_OK);
+    for (uint32_t n = 0; n < 2; ++n) {
+        SCOPED_TRACE("IE manager: " + std::to_string(n));
+        fds_tmgr_registry_set_iemgr(reg, iemgr[n]);
+        EXPECT_EQ(fds_tmgr_registry_iemgr_pending(reg), cnt);
+
+        // Lookups don't modify the managers
+        for (uint32_t i = 0; i < cnt; ++i) {
+            fds_tmgr_t *tmgr = fds_tmgr_registry_find(reg, session(i), 0, 0);
+            ASSERT_NE(tmgr, nullptr);
+            check(tmgr, (n == 0) ? nullptr : iemgr[n - 1]);
+        }
+        EXPECT_EQ(fds_tmgr_registry_iemgr_pending(reg), cnt);
+
+        // Managers are redefined on their first use
+        for (uint32_t i = 0; i < cnt / 2; ++i) {
+            fds_tmgr_t *tmgr = fds_tmgr_registry_find(reg, session(i), 0, 0);
+            EXPECT_EQ(fds_tmgr_set_time(tmgr, 10), FDS_OK);
+            check(tmgr, iemgr[n]);
+        }
+        EXPECT_EQ(fds_tmgr_registry_iemgr_pending(reg), cnt - cnt / 2);
+
+        // The remaining (i.e. idle) managers are redefined at once
+        EXPECT_EQ(fds_tmgr_registry_redefine(reg), FDS_OK);
+        EXPECT_EQ(fds_tmgr_registry_iemgr_pending(reg), 0U);
+        for (uint32_t i = 0; i < cnt; ++i) {
+            fds_tmgr_t *tmgr = fds_tmgr_registry_find(reg, session(i), 0, 0);
+            EXPECT_EQ(fds_tmgr_set_time(tmgr, 10), FDS_OK);
+            check(tmgr, iemgr[n]);
+        }
+    }
+
+    // The previous IE manager is not used anymore
+    fds_iemgr_destroy(iemgr[0]);
+
+    // New managers are redefined too
+    fds_tmgr_t *tmgr = add(session(cnt), 0);
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 10), FDS_OK);
+    EXPECT_EQ(fds_tmgr_template_add(tmgr, TMock::create(TMock::type::DATA_BASIC_BIFLOW, tid)), FDS_OK);
+    EXPECT_EQ(fds_tmgr_registry_iemgr_pending(reg), 1U);
+    EXPECT_EQ(fds_tmgr_registry_find(reg, session(cnt), 0, 0), tmgr);
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 10), FDS_OK);
+    EXPECT_EQ(fds_tmgr_registry_iemgr_pending(reg), 0U);
+    check(tmgr, iemgr[1]);
+
+    // Remove all definitions
+    fds_tmgr_registry_set_iemgr(reg, nullptr);
+    EXPECT_EQ(fds_tmgr_registry_iemgr_pending(reg), cnt + 1);
+    EXPECT_EQ(fds_tmgr_registry_redefine(reg), FDS_OK);
+    EXPECT_EQ(fds_tmgr_registry_iemgr_pending(reg), 0U);
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 10), FDS_OK);
+    check(tmgr, nullptr);
+    fds_iemgr_destroy(iemgr[1]);
+
+    fds_tgarbage_t *gc;
+    fds_tmgr_registry_garbage_get(reg, &gc);
+    fds_tmgr_garbage_destroy(gc);
+}
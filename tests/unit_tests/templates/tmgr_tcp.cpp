@@ -1,6 +1,7 @@
 /**
  * \brief Test cases only for TCP sessions
  */
+#include <vector>
 #include <gtest/gtest.h>
 #include <libfds.h>
 #include <TGenerator.h>
@@ -45,4 +46,42 @@ TEST_P(tcp, goEmptyHistory)
 {
     EXPECT_EQ(fds_tmgr_set_time(tmgr, 10), FDS_OK);
     EXPECT_EQ(fds_tmgr_set_time(tmgr, 0), FDS_ERR_DENIED);
-}
\ No newline at end of file
+}
+
+// Refresh of a template at a new Export Time doesn't create a new snapshot
+TEST_P(tcp, refreshInPlace)
+{
+    const uint16_t tid = 256;
+    struct fds_template *aux = TMock::create(TMock::type::DATA_BASIC_FLOW, tid);
+    std::vector<uint8_t> raw(aux->raw.data, aux->raw.data + aux->raw.length);
+    fds_template_destroy(aux);
+
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 10), FDS_OK);
+    EXPECT_EQ(fds_tmgr_template_add(tmgr, TMock::create(TMock::type::DATA_BASIC_FLOW, tid)), FDS_OK);
+    fds_tgarbage_t *gc;
+    ASSERT_EQ(fds_tmgr_garbage_get(tmgr, &gc), FDS_OK);
+    fds_tmgr_garbage_destroy(gc);
+
+    // Refresh the template (raw and parsed) later, nothing should be thrown away
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 20), FDS_OK);
+    EXPECT_EQ(fds_tmgr_template_refresh(tmgr, FDS_TYPE_TEMPLATE, raw.data(), raw.size()), FDS_OK);
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 30), FDS_OK);
+    EXPECT_EQ(fds_tmgr_template_add(tmgr, TMock::create(TMock::type::DATA_BASIC_FLOW, tid)), FDS_OK);
+    ASSERT_EQ(fds_tmgr_garbage_get(tmgr, &gc), FDS_OK);
+    EXPECT_EQ(gc, nullptr);
+
+    const struct fds_template *tmplt;
+    ASSERT_EQ(fds_tmgr_template_get(tmgr, tid, &tmplt), FDS_OK);
+    EXPECT_EQ(tmplt->time.first_seen, 10U);
+    EXPECT_EQ(tmplt->time.last_seen, 30U);
+
+    // The template has been passed to the user, so it must not be modified anymore
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 40), FDS_OK);
+    EXPECT_EQ(fds_tmgr_template_refresh(tmgr, FDS_TYPE_TEMPLATE, raw.data(), raw.size()), FDS_OK);
+    EXPECT_EQ(tmplt->time.last_seen, 30U);
+    const struct fds_template *tmplt_new;
+    ASSERT_EQ(fds_tmgr_template_get(tmgr, tid, &tmplt_new), FDS_OK);
+    EXPECT_NE(tmplt_new, tmplt);
+    EXPECT_EQ(tmplt_new->time.first_seen, 10U);
+    EXPECT_EQ(tmplt_new->time.last_seen, 40U);
+}
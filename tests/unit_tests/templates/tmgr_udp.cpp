@@ -2,6 +2,7 @@
  * \brief Test cases only for UDP sessions
  */
 
+#include <vector>
 #include <gtest/gtest.h>
 #include <libfds.h>
 #include <TGenerator.h>
@@ -341,3 +342,78 @@ TEST_P(udp, disableTimeoutLater)
 
 // TODO: Test combination of snapshot timeouts and template timeouts (+ on demand snapshot)
 
+
+// Refresh templates using raw definitions (without parsing)
+TEST_P(udp, templateRefreshRaw)
+{
+    fds_tmgr_set_udp_timeouts(tmgr, 10, 10);
+    fds_tmgr_set_snapshot_timeout(tmgr, 60);
+
+    const uint16_t tid1 = 256;
+    const uint16_t tid2 = 257;
+    struct fds_template *aux = TMock::create(TMock::type::DATA_BASIC_FLOW, tid1);
+    std::vector<uint8_t> raw1(aux->raw.data, aux->raw.data + aux->raw.length);
+    fds_template_destroy(aux);
+    aux = TMock::create(TMock::type::DATA_BASIC_BIFLOW, tid1);
+    std::vector<uint8_t> raw1_other(aux->raw.data, aux->raw.data + aux->raw.length);
+    fds_template_destroy(aux);
+    aux = TMock::create(TMock::type::DATA_BASIC_FLOW, tid2);
+    std::vector<uint8_t> raw2(aux->raw.data, aux->raw.data + aux->raw.length);
+    fds_template_destroy(aux);
+
+    // Undefined time context
+    EXPECT_EQ(fds_tmgr_template_refresh(tmgr, FDS_TYPE_TEMPLATE, raw1.data(), raw1.size()),
+        FDS_ERR_ARG);
+
+    // Unknown template
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 0), FDS_OK);
+    EXPECT_EQ(fds_tmgr_template_refresh(tmgr, FDS_TYPE_TEMPLATE, raw1.data(), raw1.size()),
+        FDS_ERR_NOTFOUND);
+    EXPECT_EQ(fds_tmgr_template_add(tmgr, TMock::create(TMock::type::DATA_BASIC_FLOW, tid1)), FDS_OK);
+
+    // Invalid arguments, different definitions, types, lengths and IDs
+    EXPECT_EQ(fds_tmgr_template_refresh(tmgr, FDS_TYPE_TEMPLATE, raw1.data(), 2), FDS_ERR_ARG);
+    EXPECT_EQ(fds_tmgr_template_refresh(tmgr, FDS_TYPE_TEMPLATE_UNDEF, raw1.data(), raw1.size()),
+        FDS_ERR_ARG);
+    EXPECT_EQ(fds_tmgr_template_refresh(tmgr, FDS_TYPE_TEMPLATE_OPTS, raw1.data(), raw1.size()),
+        FDS_ERR_NOTFOUND);
+    EXPECT_EQ(fds_tmgr_template_refresh(tmgr, FDS_TYPE_TEMPLATE, raw1.data(), raw1.size() - 4),
+        FDS_ERR_NOTFOUND);
+    EXPECT_EQ(fds_tmgr_template_refresh(tmgr, FDS_TYPE_TEMPLATE, raw1_other.data(),
+        raw1_other.size()), FDS_ERR_NOTFOUND);
+    EXPECT_EQ(fds_tmgr_template_refresh(tmgr, FDS_TYPE_TEMPLATE, raw2.data(), raw2.size()),
+        FDS_ERR_NOTFOUND);
+
+    // Refresh within the same Export Time
+    EXPECT_EQ(fds_tmgr_template_refresh(tmgr, FDS_TYPE_TEMPLATE, raw1.data(), raw1.size()), FDS_OK);
+
+    // Refresh later (the template is refreshed multiple times in the new snapshot)
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 5), FDS_OK);
+    EXPECT_EQ(fds_tmgr_template_refresh(tmgr, FDS_TYPE_TEMPLATE, raw1.data(), raw1.size()), FDS_OK);
+    EXPECT_EQ(fds_tmgr_template_refresh(tmgr, FDS_TYPE_TEMPLATE, raw1.data(), raw1.size()), FDS_OK);
+    const struct fds_template *tmplt_old;
+    ASSERT_EQ(fds_tmgr_template_get(tmgr, tid1, &tmplt_old), FDS_OK);
+    EXPECT_EQ(tmplt_old->time.first_seen, 0U);
+    EXPECT_EQ(tmplt_old->time.last_seen, 5U);
+    EXPECT_EQ(tmplt_old->time.end_of_life, 15U);
+
+    // The template has been passed to the user, so the refresh must not modify it
+    EXPECT_EQ(fds_tmgr_template_refresh(tmgr, FDS_TYPE_TEMPLATE, raw1.data(), raw1.size()), FDS_OK);
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 8), FDS_OK);
+    EXPECT_EQ(fds_tmgr_template_refresh(tmgr, FDS_TYPE_TEMPLATE, raw1.data(), raw1.size()), FDS_OK);
+    EXPECT_EQ(tmplt_old->time.last_seen, 5U);
+
+    // Check the extended lifetime
+    const struct fds_template *tmplt2check;
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 17), FDS_OK);
+    ASSERT_EQ(fds_tmgr_template_get(tmgr, tid1, &tmplt2check), FDS_OK);
+    EXPECT_NE(tmplt2check, tmplt_old);
+    EXPECT_EQ(tmplt2check->time.first_seen, 0U);
+    EXPECT_EQ(tmplt2check->time.last_seen, 8U);
+    EXPECT_EQ(tmplt2check->time.end_of_life, 18U);
+
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 19), FDS_OK);
+    EXPECT_EQ(fds_tmgr_template_get(tmgr, tid1, &tmplt2check), FDS_ERR_NOTFOUND);
+    EXPECT_EQ(fds_tmgr_template_refresh(tmgr, FDS_TYPE_TEMPLATE, raw1.data(), raw1.size()),
+        FDS_ERR_NOTFOUND);
+}
@@ -629,3 +629,256 @@ TEST_P(udpSctpFile, timeWrapparound)
     ASSERT_EQ(fds_tmgr_template_get(tmgr, tid2, &tmplt2check), FDS_OK);
     EXPECT_EQ(tmplt2check->type, FDS_TYPE_TEMPLATE_OPTS);
 }
+
+// Modify templates spread over multiple internal tables and check that old snapshots are unchanged
+TEST_P(udpSctpFile, sparseIdsSnapshotIsolation)
+{
+    fds_tmgr_set_snapshot_timeout(tmgr, 30);
+    const struct fds_template *tmplt2check;
+    const fds_tsnapshot_t *snap[3];
+
+    // Define templates with IDs in different ranges
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 100), FDS_OK);
+    const uint16_t tid1 = 256;
+    const uint16_t tid2 = 1000;
+    const uint16_t tid3 = 40000;
+    EXPECT_EQ(fds_tmgr_template_add(tmgr, TMock::create(TMock::type::DATA_BASIC_FLOW, tid1)), FDS_OK);
+    EXPECT_EQ(fds_tmgr_template_add(tmgr, TMock::create(TMock::type::DATA_BASIC_FLOW, tid2)), FDS_OK);
+    EXPECT_EQ(fds_tmgr_template_add(tmgr, TMock::create(TMock::type::DATA_BASIC_FLOW, tid3)), FDS_OK);
+    ASSERT_EQ(fds_tmgr_snapshot_get(tmgr, &snap[0]), FDS_OK);
+
+    // Add a template to a new range and remove a template
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 101), FDS_OK);
+    const uint16_t tid4 = 2000;
+    EXPECT_EQ(fds_tmgr_template_add(tmgr, TMock::create(TMock::type::OPTS_FKEY, tid4)), FDS_OK);
+    EXPECT_EQ(fds_tmgr_template_remove(tmgr, tid2, FDS_TYPE_TEMPLATE_UNDEF), FDS_OK);
+    ASSERT_EQ(fds_tmgr_snapshot_get(tmgr, &snap[1]), FDS_OK);
+
+    // Add a template to the range of the removed template
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 102), FDS_OK);
+    const uint16_t tid5 = 1001;
+    EXPECT_EQ(fds_tmgr_template_add(tmgr, TMock::create(TMock::type::DATA_BASIC_BIFLOW, tid5)), FDS_OK);
+    ASSERT_EQ(fds_tmgr_snapshot_get(tmgr, &snap[2]), FDS_OK);
+
+    // Check content of all snapshots
+    const uint16_t tids[] = {tid1, tid2, tid3, tid4, tid5};
+    const bool present[3][5] = {
+        {true, true,  true, false, false},
+        {true, false, true, true,  false},
+        {true, false, true, true,  true}
+    };
+    for (size_t s = 0; s < 3; ++s) {
+        for (size_t t = 0; t < 5; ++t) {
+            SCOPED_TRACE("Snapshot: " + std::to_string(s) + ", Template ID: " + std::to_string(tids[t]));
+            tmplt2check = fds_tsnapshot_template_get(snap[s], tids[t]);
+            if (!present[s][t]) {
+                EXPECT_EQ(tmplt2check, nullptr);
+                continue;
+            }
+            ASSERT_NE(tmplt2check, nullptr);
+            EXPECT_EQ(tmplt2check->id, tids[t]);
+        }
+    }
+
+    ASSERT_NE(tmplt2check = fds_tsnapshot_template_get(snap[0], tid1), nullptr);
+    EXPECT_EQ(tmplt2check->time.first_seen, 100);
+    ASSERT_NE(tmplt2check = fds_tsnapshot_template_get(snap[2], tid5), nullptr);
+    EXPECT_EQ(tmplt2check->time.first_seen, 102);
+
+    // Go back in time (removal of the template also affects the history of the manager)
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 100), FDS_OK);
+    ASSERT_EQ(fds_tmgr_template_get(tmgr, tid3, &tmplt2check), FDS_OK);
+    EXPECT_EQ(tmplt2check->id, tid3);
+    EXPECT_EQ(fds_tmgr_template_get(tmgr, tid2, &tmplt2check), FDS_ERR_NOTFOUND);
+    EXPECT_EQ(fds_tmgr_template_get(tmgr, tid4, &tmplt2check), FDS_ERR_NOTFOUND);
+}
+
+// Seek backwards in a long history of snapshots
+TEST_P(udpSctpFile, manySnapshotsSeekBackwards)
+{
+    fds_tmgr_set_snapshot_timeout(tmgr, 1000);
+    const struct fds_template *tmplt2check;
+
+    // Each snapshot defines a new template (snapshots start every second second)
+    const uint32_t time_start = 1000;
+    const uint16_t tid_base = 256;
+    const uint16_t snap_cnt = 200;
+    for (uint16_t i = 0; i < snap_cnt; ++i) {
+        EXPECT_EQ(fds_tmgr_set_time(tmgr, time_start + 2U * i), FDS_OK);
+        const enum TMock::type type = (i % 2 == 0)
+            ? TMock::type::DATA_BASIC_FLOW : TMock::type::OPTS_FKEY;
+        EXPECT_EQ(fds_tmgr_template_add(tmgr, TMock::create(type, tid_base + i)), FDS_OK);
+    }
+
+    // Check the templates at the time (the last defined template must be tid_base + last)
+    auto check = [&](uint32_t time, uint16_t last) {
+        SCOPED_TRACE("Time: " + std::to_string(time));
+        ASSERT_EQ(fds_tmgr_set_time(tmgr, time), FDS_OK);
+        for (uint16_t i : {uint16_t(0), uint16_t(last / 2), last}) {
+            ASSERT_EQ(fds_tmgr_template_get(tmgr, tid_base + i, &tmplt2check), FDS_OK);
+            EXPECT_EQ(tmplt2check->id, tid_base + i);
+            EXPECT_EQ(tmplt2check->type, (i % 2 == 0) ? FDS_TYPE_TEMPLATE : FDS_TYPE_TEMPLATE_OPTS);
+            EXPECT_EQ(tmplt2check->time.first_seen, time_start + 2U * i);
+        }
+        EXPECT_EQ(fds_tmgr_template_get(tmgr, tid_base + last + 1, &tmplt2check), FDS_ERR_NOTFOUND);
+    };
+
+    // Seek backwards (to start of snapshots and between them) and forwards in random order
+    for (uint16_t i = 0; i < snap_cnt; ++i) {
+        const uint16_t idx = (i * 37U) % snap_cnt;
+        check(time_start + 2U * idx, idx);
+        check(time_start + 2U * idx + 1U, idx);
+    }
+
+    // Nothing has been defined before the oldest snapshot
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, time_start - 1), FDS_OK);
+    EXPECT_EQ(fds_tmgr_template_get(tmgr, tid_base, &tmplt2check), FDS_ERR_NOTFOUND);
+
+    // Define a template in history (a new snapshot in the middle of the history)
+    const uint16_t idx_hist = 50;
+    const uint16_t tid_hist = 5000;
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, time_start + 2U * idx_hist + 1U), FDS_OK);
+    EXPECT_EQ(fds_tmgr_template_add(tmgr, TMock::create(TMock::type::DATA_BASIC_BIFLOW, tid_hist)), FDS_OK);
+
+    for (uint16_t idx : {uint16_t(10), uint16_t(idx_hist), uint16_t(idx_hist + 1), uint16_t(150)}) {
+        check(time_start + 2U * idx, idx);
+    }
+
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, time_start + 2U * idx_hist), FDS_OK);
+    EXPECT_EQ(fds_tmgr_template_get(tmgr, tid_hist, &tmplt2check), FDS_ERR_NOTFOUND);
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, time_start + 2U * idx_hist + 1U), FDS_OK);
+    ASSERT_EQ(fds_tmgr_template_get(tmgr, tid_hist, &tmplt2check), FDS_OK);
+    EXPECT_EQ(tmplt2check->time.first_seen, time_start + 2U * idx_hist + 1U);
+
+    // More snapshots in the middle of the history, before and after the previous one
+    for (uint16_t idx : {uint16_t(20), uint16_t(idx_hist - 1), uint16_t(120), uint16_t(198)}) {
+        EXPECT_EQ(fds_tmgr_set_time(tmgr, time_start + 2U * idx + 1U), FDS_OK);
+        EXPECT_EQ(fds_tmgr_template_add(tmgr, TMock::create(TMock::type::DATA_BASIC_BIFLOW,
+            tid_hist + 1U + idx)), FDS_OK);
+    }
+
+    for (uint16_t i = 0; i < snap_cnt; ++i) {
+        const uint16_t idx = (i * 53U) % snap_cnt;
+        check(time_start + 2U * idx, idx);
+        check(time_start + 2U * idx + 1U, idx);
+    }
+
+    // Remove old snapshots and seek again
+    fds_tgarbage_t *gc;
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, time_start + 2U * (snap_cnt - 1)), FDS_OK);
+    ASSERT_EQ(fds_tmgr_garbage_get(tmgr, &gc), FDS_OK);
+    fds_tmgr_garbage_destroy(gc);
+    check(time_start + 2U * 100, 100);
+    check(time_start + 2U * 20 + 1U, 20);
+}
+
+// History bounded by the number of snapshots
+TEST_P(udpSctpFile, snapshotLimit)
+{
+    fds_tmgr_set_snapshot_timeout(tmgr, 1000);
+    const uint16_t limit = 5;
+    fds_tmgr_set_snapshot_limit(tmgr, limit);
+    const struct fds_template *tmplt2check;
+
+    const uint16_t tid_base = 256;
+    const uint16_t snap_cnt = 20;
+    for (uint16_t i = 0; i < snap_cnt; ++i) {
+        EXPECT_EQ(fds_tmgr_set_time(tmgr, 10U + i), FDS_OK);
+        EXPECT_EQ(fds_tmgr_template_add(tmgr, TMock::create(TMock::type::DATA_BASIC_FLOW, tid_base + i)), FDS_OK);
+    }
+
+    // Until cleanup, the whole history is accessible
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 10), FDS_OK);
+    EXPECT_EQ(fds_tmgr_template_get(tmgr, tid_base, &tmplt2check), FDS_OK);
+    EXPECT_EQ(fds_tmgr_template_get(tmgr, tid_base + 1, &tmplt2check), FDS_ERR_NOTFOUND);
+
+    // Cleanup removes the oldest snapshots
+    fds_tgarbage_t *gc;
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 10U + snap_cnt - 1), FDS_OK);
+    ASSERT_EQ(fds_tmgr_garbage_get(tmgr, &gc), FDS_OK);
+    ASSERT_NE(gc, nullptr);
+    fds_tmgr_garbage_destroy(gc);
+
+    const uint32_t time_oldest = 10U + snap_cnt - limit;
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 10), FDS_ERR_NOTFOUND);
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, time_oldest - 1), FDS_ERR_NOTFOUND);
+    for (uint32_t time = time_oldest; time < 10U + snap_cnt; ++time) {
+        SCOPED_TRACE("Time: " + std::to_string(time));
+        EXPECT_EQ(fds_tmgr_set_time(tmgr, time), FDS_OK);
+        const uint16_t last = time - 10U;
+        EXPECT_EQ(fds_tmgr_template_get(tmgr, tid_base, &tmplt2check), FDS_OK);
+        EXPECT_EQ(fds_tmgr_template_get(tmgr, tid_base + last, &tmplt2check), FDS_OK);
+        EXPECT_EQ(fds_tmgr_template_get(tmgr, tid_base + last + 1, &tmplt2check), FDS_ERR_NOTFOUND);
+    }
+
+    // Disable the limit (the removed history remains inaccessible)
+    fds_tmgr_set_snapshot_limit(tmgr, 0);
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, time_oldest - 1), FDS_ERR_NOTFOUND);
+
+    // After clearing, the manager is not bounded by the removed history
+    fds_tmgr_clear(tmgr);
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 10), FDS_OK);
+    EXPECT_EQ(fds_tmgr_template_add(tmgr, TMock::create(TMock::type::DATA_BASIC_FLOW, tid_base)), FDS_OK);
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 20), FDS_OK);
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 10), FDS_OK);
+    EXPECT_EQ(fds_tmgr_template_get(tmgr, tid_base, &tmplt2check), FDS_OK);
+}
+
+// Refresh of a template with history access creates a copy sharing its definition
+TEST_P(udpSctpFile, refreshCopy)
+{
+    const uint16_t tid = 256;
+    struct fds_template *aux = TMock::create(TMock::type::DATA_BASIC_FLOW, tid);
+    std::vector<uint8_t> raw(aux->raw.data, aux->raw.data + aux->raw.length);
+    fds_template_destroy(aux);
+
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 10), FDS_OK);
+    EXPECT_EQ(fds_tmgr_template_add(tmgr, TMock::create(TMock::type::DATA_BASIC_FLOW, tid)), FDS_OK);
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 20), FDS_OK);
+    EXPECT_EQ(fds_tmgr_template_refresh(tmgr, FDS_TYPE_TEMPLATE, raw.data(), raw.size()), FDS_OK);
+    const struct fds_template *tmplt20;
+    ASSERT_EQ(fds_tmgr_template_get(tmgr, tid, &tmplt20), FDS_OK);
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 30), FDS_OK);
+    EXPECT_EQ(fds_tmgr_template_refresh(tmgr, FDS_TYPE_TEMPLATE, raw.data(), raw.size()), FDS_OK);
+    const struct fds_template *tmplt30;
+    ASSERT_EQ(fds_tmgr_template_get(tmgr, tid, &tmplt30), FDS_OK);
+
+    EXPECT_NE(tmplt30, tmplt20);
+    EXPECT_EQ(tmplt30->raw.data, tmplt20->raw.data);
+    EXPECT_EQ(tmplt20->time.last_seen, 20U);
+    EXPECT_EQ(tmplt30->time.last_seen, 30U);
+
+    // The history is still accessible
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 20), FDS_OK);
+    ASSERT_EQ(fds_tmgr_template_get(tmgr, tid, &tmplt20), FDS_OK);
+    EXPECT_EQ(tmplt20->time.last_seen, 20U);
+}
+
+// Without access to history, refresh of a template doesn't create a new snapshot
+TEST_P(udpSctpFile, refreshInPlaceWithoutHistory)
+{
+    const uint16_t tid = 256;
+    struct fds_template *aux = TMock::create(TMock::type::DATA_BASIC_FLOW, tid);
+    std::vector<uint8_t> raw(aux->raw.data, aux->raw.data + aux->raw.length);
+    fds_template_destroy(aux);
+
+    fds_tmgr_set_snapshot_timeout(tmgr, 0);
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 10), FDS_OK);
+    EXPECT_EQ(fds_tmgr_template_add(tmgr, TMock::create(TMock::type::DATA_BASIC_FLOW, tid)), FDS_OK);
+    fds_tgarbage_t *gc;
+    ASSERT_EQ(fds_tmgr_garbage_get(tmgr, &gc), FDS_OK);
+    fds_tmgr_garbage_destroy(gc);
+
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 20), FDS_OK);
+    EXPECT_EQ(fds_tmgr_template_refresh(tmgr, FDS_TYPE_TEMPLATE, raw.data(), raw.size()), FDS_OK);
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 30), FDS_OK);
+    EXPECT_EQ(fds_tmgr_template_refresh(tmgr, FDS_TYPE_TEMPLATE, raw.data(), raw.size()), FDS_OK);
+    ASSERT_EQ(fds_tmgr_garbage_get(tmgr, &gc), FDS_OK);
+    EXPECT_EQ(gc, nullptr);
+
+    const struct fds_template *tmplt;
+    ASSERT_EQ(fds_tmgr_template_get(tmgr, tid, &tmplt), FDS_OK);
+    EXPECT_EQ(tmplt->time.first_seen, 10U);
+    EXPECT_EQ(tmplt->time.last_seen, 30U);
+    EXPECT_EQ(fds_tmgr_set_time(tmgr, 20), FDS_ERR_NOTFOUND);
+}